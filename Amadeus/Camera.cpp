@@ -130,6 +130,11 @@ namespace Amadeus
 		return XMMatrixPerspectiveFovLH(mFov, mAspectRatio, mNearPlane, mFarPlane);
 	}
 
+	XMMATRIX Camera::GetViewProjectionMatrix()
+	{
+		return XMMatrixMultiply(GetViewMatrix(), GetUnjitteredProjectionMatrix());
+	}
+
 	XMMATRIX Camera::GetTransformMatrix()
 	{
 		XMVECTOR scale = { 1.0f, 1.0f, 1.0f };
@@ -38,6 +38,8 @@ namespace Amadeus
 		float GetRadius();
 		XMMATRIX GetTransformMatrix();
 		XMMATRIX GetTransformMatrixWithoutTranslation();
+		// Without the TAA jitter, for culling on the CPU.
+		XMMATRIX GetViewProjectionMatrix();
 		float GetNearPlane();
 		float GetFarPlane();
 
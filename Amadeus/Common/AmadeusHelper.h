@@ -24,7 +24,7 @@ namespace Amadeus
         return path.data() + assetName;
     }
 
-    inline std::wstring String2WString(std::string& str)
+    inline std::wstring String2WString(const std::string& str)
     {
         int count = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()), NULL, 0);
         std::wstring wstr(count, 0);
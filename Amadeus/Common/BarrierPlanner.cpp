@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "Common/BarrierPlanner.h"
+
+namespace Amadeus
+{
+	BarrierPlanner::Result BarrierPlanner::Plan(uint32_t resourceCount, uint32_t levelCount, const std::vector<Access>& accesses)
+	{
+		struct Group
+		{
+			uint32_t first;
+			uint32_t last;
+			uint32_t state;
+			bool write;
+		};
+
+		Result result;
+		result.batches.resize(levelCount);
+		result.initialStates.assign(resourceCount, 0);
+
+		std::vector<std::vector<const Access*>> resourceAccesses(resourceCount);
+		for (const auto& access : accesses)
+		{
+			assert(access.resource < resourceCount);
+			assert(access.level < levelCount);
+			resourceAccesses[access.resource].push_back(&access);
+		}
+
+		std::vector<Group> groups;
+		for (uint32_t resource = 0; resource < resourceCount; ++resource)
+		{
+			auto& list = resourceAccesses[resource];
+			if (list.empty())
+				continue;
+
+			std::stable_sort(list.begin(), list.end(), [](const Access* a, const Access* b) {
+				return a->level < b->level;
+			});
+
+			// Reads that follow each other share one state, so they need no barrier in between.
+			groups.clear();
+			for (const auto& access : list)
+			{
+				if (!groups.empty() && !groups.back().write && !access->write)
+				{
+					groups.back().last = access->level;
+					groups.back().state |= access->state;
+				}
+				else
+				{
+					assert(groups.empty() || groups.back().last < access->level);
+					groups.push_back({ access->level, access->level, access->state, access->write });
+				}
+			}
+
+			const Group& head = groups.front();
+			const Group& tail = groups.back();
+			result.initialStates[resource] = tail.state;
+
+			auto& headBatch = result.batches[head.first];
+			headBatch.push_back({ BarrierType::ALIASING, resource, 0, head.state });
+			// Back to where the previous frame started. Not split, the memory belonged to
+			// other resources in between.
+			if (tail.state != head.state)
+				headBatch.push_back({ BarrierType::TRANSITION, resource, tail.state, head.state });
+
+			for (size_t i = 1; i < groups.size(); ++i)
+			{
+				const Group& prev = groups[i - 1];
+				const Group& next = groups[i];
+				if (prev.state == next.state)
+					continue;
+
+				const uint32_t begin = prev.last + 1;
+				if (begin < next.first)
+				{
+					result.batches[begin].push_back({ BarrierType::BEGIN_ONLY, resource, prev.state, next.state });
+					result.batches[next.first].push_back({ BarrierType::END_ONLY, resource, prev.state, next.state });
+				}
+				else
+				{
+					result.batches[next.first].push_back({ BarrierType::TRANSITION, resource, prev.state, next.state });
+				}
+			}
+		}
+
+		return result;
+	}
+}
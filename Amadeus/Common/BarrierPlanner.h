@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Plans the state transitions of a frame before anything is recorded. Passes are grouped
+	// into levels that are submitted in order, and every level starts with one batch of
+	// barriers. States are bit masks, consecutive reads are combined into a single state.
+	class BarrierPlanner
+	{
+	public:
+		struct Access
+		{
+			uint32_t resource;
+			uint32_t level;
+			uint32_t state;
+			bool write;
+		};
+
+		enum class BarrierType : uint8_t
+		{
+			// The resource takes over memory it shares with other resources. Issued before
+			// the first access of a frame, after is the state of that access.
+			ALIASING,
+			TRANSITION,
+			// Split transition, begun right after the last access in the old state and
+			// ended before the first access in the new one.
+			BEGIN_ONLY,
+			END_ONLY,
+		};
+
+		struct Barrier
+		{
+			BarrierType type;
+			uint32_t resource;
+			uint32_t before;
+			uint32_t after;
+		};
+
+		struct Result
+		{
+			// One batch per level, issued before the passes of the level.
+			std::vector<std::vector<Barrier>> batches;
+			// State of every resource between two frames, resources are created in it.
+			std::vector<uint32_t> initialStates;
+		};
+
+		// A resource is written at most once per level, and not read on the level it is written.
+		static Result Plan(uint32_t resourceCount, uint32_t levelCount, const std::vector<Access>& accesses);
+	};
+}
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "Common/BindlessTable.h"
+
+namespace Amadeus
+{
+	BindlessTable::BindlessTable(uint32_t capacity)
+		: mIndices(capacity)
+	{
+	}
+
+	void BindlessTable::Reset(uint32_t capacity)
+	{
+		mEntries.clear();
+		mIndices.Reset(capacity);
+	}
+
+	uint32_t BindlessTable::Acquire(uint64_t key, bool& bAssigned)
+	{
+		bAssigned = false;
+
+		auto entry = mEntries.find(key);
+		if (entry != mEntries.end())
+		{
+			++entry->second.references;
+			return entry->second.index;
+		}
+
+		const uint32_t index = mIndices.Allocate(1);
+		if (index == InvalidIndex)
+			return InvalidIndex;
+
+		mEntries.emplace(key, Entry{ index, 1 });
+		bAssigned = true;
+		return index;
+	}
+
+	bool BindlessTable::Release(uint64_t key)
+	{
+		auto entry = mEntries.find(key);
+		assert(entry != mEntries.end());
+		if (entry == mEntries.end() || --entry->second.references > 0)
+			return false;
+
+		mIndices.Free(entry->second.index, 1);
+		mEntries.erase(entry);
+		return true;
+	}
+
+	uint32_t BindlessTable::Find(uint64_t key) const
+	{
+		auto entry = mEntries.find(key);
+		return entry != mEntries.end() ? entry->second.index : InvalidIndex;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Common/RangeAllocator.h"
+
+namespace Amadeus
+{
+	// Indices of resources in the bindless range of the shader-visible heap, shaders index the range
+	// with them. Keys are whatever identifies a resource to the caller. A resource keeps its index
+	// while it is acquired, released indices are handed out again.
+	class BindlessTable
+	{
+	public:
+		static constexpr uint32_t InvalidIndex = RangeAllocator::InvalidOffset;
+
+		explicit BindlessTable(uint32_t capacity = 0);
+
+		void Reset(uint32_t capacity);
+
+		// Index of the resource, or InvalidIndex when the range is full. bAssigned tells whether the
+		// index is new and its descriptor has to be written.
+		uint32_t Acquire(uint64_t key, bool& bAssigned);
+
+		// Returns whether this was the last reference and the index was given up.
+		bool Release(uint64_t key);
+
+		uint32_t Find(uint64_t key) const;
+
+		size_t Size() const { return mEntries.size(); }
+
+		uint32_t GetCapacity() const { return mIndices.GetCapacity(); }
+
+	private:
+		struct Entry
+		{
+			uint32_t index;
+			uint32_t references;
+		};
+
+		std::map<uint64_t, Entry> mEntries;
+		RangeAllocator mIndices;
+	};
+}
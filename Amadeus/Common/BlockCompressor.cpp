@@ -0,0 +1,1502 @@
+#include "pch.h"
+#include "Common/BlockCompressor.h"
+
+namespace Amadeus
+{
+	using Format = BlockCompressor::Format;
+	using Quality = BlockCompressor::Quality;
+
+	static constexpr uint32_t AllTexels = 0xFFFF;
+
+	// Texels of one block by channel, RGBA in 0 to 255.
+	struct Texels
+	{
+		alignas(16) float channels[4][16];
+	};
+
+	// How hard each format is searched.
+	struct Effort
+	{
+		// Least squares passes over the endpoints after the first indices are found.
+		uint32_t refinements;
+		// Best estimated partitions of BC7 encoded for each two and three subset mode, none skips them.
+		uint32_t partitions2;
+		uint32_t partitions3;
+		// BC7 also tries the modes that rarely win, every p-bit combination and neighbors of the
+		// quantized BC1 and BC4 endpoints.
+		bool bExhaustive;
+	};
+
+	static Effort GetEffort(Quality quality)
+	{
+		switch (quality)
+		{
+		case Quality::FAST:
+			return { 1, 0, 0, false };
+		case Quality::HIGH:
+			return { 3, 16, 8, true };
+		default:
+			return { 2, 4, 0, false };
+		}
+	}
+
+	static uint32_t Expand(uint32_t value, uint32_t bits)
+	{
+		value <<= 8 - bits;
+		return value | (value >> bits);
+	}
+
+	static float Clamp255(float value)
+	{
+		return (std::min)((std::max)(value, 0.0f), 255.0f);
+	}
+
+	// Nearest palette entry of every texel in the mask over the channels with a weight, returns their
+	// summed squared error. Four texels are compared with each entry at a time.
+	static float FindIndices(const Texels& texels, uint32_t mask, const float (*palette)[4], uint32_t count, const float weights[4],
+		uint8_t indices[16])
+	{
+		uint32_t active[4];
+		uint32_t activeCount = 0;
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			if (weights[channel] != 0.0f)
+				active[activeCount++] = channel;
+		}
+
+		__m128 best[4];
+		__m128i bestIndex[4];
+		for (uint32_t group = 0; group < 4; ++group)
+		{
+			best[group] = _mm_set1_ps((std::numeric_limits<float>::max)());
+			bestIndex[group] = _mm_setzero_si128();
+		}
+
+		for (uint32_t entry = 0; entry < count; ++entry)
+		{
+			const __m128i index = _mm_set1_epi32(static_cast<int>(entry));
+			for (uint32_t group = 0; group < 4; ++group)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (uint32_t k = 0; k < activeCount; ++k)
+				{
+					const uint32_t channel = active[k];
+					const __m128 difference = _mm_sub_ps(_mm_load_ps(texels.channels[channel] + group * 4), _mm_set1_ps(palette[entry][channel]));
+					error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(difference, difference), _mm_set1_ps(weights[channel])));
+				}
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best[group]));
+				best[group] = _mm_min_ps(error, best[group]);
+				bestIndex[group] = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex[group]));
+			}
+		}
+
+		__m128 total = _mm_setzero_ps();
+		for (uint32_t group = 0; group < 4; ++group)
+		{
+			const __m128i bits = _mm_and_si128(_mm_set1_epi32(static_cast<int>(mask >> (group * 4))), _mm_setr_epi32(1, 2, 4, 8));
+			const __m128 inMask = _mm_castsi128_ps(_mm_cmpgt_epi32(bits, _mm_setzero_si128()));
+			total = _mm_add_ps(total, _mm_and_ps(best[group], inMask));
+
+			alignas(16) int32_t chosen[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(chosen), bestIndex[group]);
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				if (mask & (1u << (group * 4 + i)))
+					indices[group * 4 + i] = static_cast<uint8_t>(chosen[i]);
+			}
+		}
+
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+		return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+	}
+
+	// Line through the texels of the mask along their principal axis over the channels with a weight,
+	// its ends are the extreme projections.
+	static void FitLine(const Texels& texels, uint32_t mask, const float weights[4], float ends[2][4])
+	{
+		float mean[4] = {};
+		float count = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1u << i)))
+				continue;
+			for (uint32_t channel = 0; channel < 4; ++channel)
+				mean[channel] += texels.channels[channel][i];
+			count += 1.0f;
+		}
+		for (uint32_t channel = 0; channel < 4; ++channel)
+			mean[channel] = weights[channel] != 0.0f ? mean[channel] / count : 255.0f;
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1u << i)))
+				continue;
+			float offset[4];
+			for (uint32_t channel = 0; channel < 4; ++channel)
+				offset[channel] = weights[channel] != 0.0f ? texels.channels[channel][i] - mean[channel] : 0.0f;
+			for (uint32_t row = 0; row < 4; ++row)
+				for (uint32_t column = row; column < 4; ++column)
+					covariance[row][column] += offset[row] * offset[column];
+		}
+
+		// Power iteration from the channel that varies most.
+		uint32_t widest = 0;
+		for (uint32_t channel = 1; channel < 4; ++channel)
+		{
+			if (covariance[channel][channel] > covariance[widest][widest])
+				widest = channel;
+		}
+		float axis[4];
+		for (uint32_t channel = 0; channel < 4; ++channel)
+			axis[channel] = channel < widest ? covariance[channel][widest] : covariance[widest][channel];
+
+		for (uint32_t iteration = 0; iteration < 6; ++iteration)
+		{
+			float next[4] = {};
+			for (uint32_t row = 0; row < 4; ++row)
+				for (uint32_t column = 0; column < 4; ++column)
+					next[row] += (row <= column ? covariance[row][column] : covariance[column][row]) * axis[column];
+			const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+			if (length < 1e-6f)
+				break;
+			for (uint32_t channel = 0; channel < 4; ++channel)
+				axis[channel] = next[channel] / length;
+		}
+
+		const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+		float low = 0.0f;
+		float high = 0.0f;
+		if (length >= 1e-6f)
+		{
+			for (uint32_t channel = 0; channel < 4; ++channel)
+				axis[channel] /= length;
+
+			low = (std::numeric_limits<float>::max)();
+			high = std::numeric_limits<float>::lowest();
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (!(mask & (1u << i)))
+					continue;
+				float projection = 0.0f;
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					if (weights[channel] != 0.0f)
+						projection += (texels.channels[channel][i] - mean[channel]) * axis[channel];
+				}
+				low = (std::min)(low, projection);
+				high = (std::max)(high, projection);
+			}
+		}
+
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			ends[0][channel] = Clamp255(mean[channel] + low * axis[channel]);
+			ends[1][channel] = Clamp255(mean[channel] + high * axis[channel]);
+		}
+	}
+
+	// Ends that minimize the error of the texels in the mask when each sits at the factor of its index
+	// between them, false when the texels do not spread over two factors.
+	static bool RefineLine(const Texels& texels, uint32_t mask, const uint8_t indices[16], const float* factors, const float weights[4],
+		float ends[2][4])
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1u << i)))
+				continue;
+			const float b = factors[indices[i]];
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				ax[channel] += a * texels.channels[channel][i];
+				bx[channel] += b * texels.channels[channel][i];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			if (weights[channel] == 0.0f)
+				continue;
+			ends[0][channel] = Clamp255((ax[channel] * bb - bx[channel] * ab) / determinant);
+			ends[1][channel] = Clamp255((bx[channel] * aa - ax[channel] * ab) / determinant);
+		}
+		return true;
+	}
+
+	static void LoadTexels(const BlockCompressor::Image& image, uint32_t blockX, uint32_t blockY, Texels& texels)
+	{
+		const uint32_t red = image.bBgra ? 2 : 0;
+		const uint32_t blue = image.bBgra ? 0 : 2;
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t sourceY = (std::min)(blockY * 4 + y, image.height - 1);
+			const uint8_t* row = image.pixels + sourceY * image.rowPitch;
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint8_t* texel = row + (std::min)(blockX * 4 + x, image.width - 1) * 4;
+				const uint32_t i = y * 4 + x;
+				texels.channels[0][i] = texel[red];
+				texels.channels[1][i] = texel[1];
+				texels.channels[2][i] = texel[blue];
+				texels.channels[3][i] = texel[3];
+			}
+		}
+	}
+
+	// BC1 ---------------------------------------------------------------------------------------------
+
+	static constexpr float Bc1Factors[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	static constexpr float ColorWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+
+	static uint32_t Pack565(const float color[4])
+	{
+		const uint32_t red = static_cast<uint32_t>(color[0] * (31.0f / 255.0f) + 0.5f);
+		const uint32_t green = static_cast<uint32_t>(color[1] * (63.0f / 255.0f) + 0.5f);
+		const uint32_t blue = static_cast<uint32_t>(color[2] * (31.0f / 255.0f) + 0.5f);
+		return (red << 11) | (green << 5) | blue;
+	}
+
+	static void Unpack565(uint32_t packed, uint32_t color[3])
+	{
+		color[0] = Expand(packed >> 11, 5);
+		color[1] = Expand((packed >> 5) & 63, 6);
+		color[2] = Expand(packed & 31, 5);
+	}
+
+	// Error of the endpoints, the palette interpolates in thirds as the format defines.
+	static float EvaluateBc1(const Texels& texels, uint32_t color0, uint32_t color1, uint8_t indices[16])
+	{
+		uint32_t ends[2][3];
+		Unpack565(color0, ends[0]);
+		Unpack565(color1, ends[1]);
+
+		float palette[4][4] = {};
+		for (uint32_t entry = 0; entry < 4; ++entry)
+		{
+			for (uint32_t channel = 0; channel < 3; ++channel)
+				palette[entry][channel] = ends[0][channel] + (static_cast<float>(ends[1][channel]) - ends[0][channel]) * Bc1Factors[entry];
+		}
+		return FindIndices(texels, AllTexels, palette, 4, ColorWeights, indices);
+	}
+
+	static void EncodeBc1(const Texels& texels, const Effort& effort, uint8_t* block)
+	{
+		float ends[2][4];
+		FitLine(texels, AllTexels, ColorWeights, ends);
+
+		// Pulled in a little, the ends of the line are rarely hit exactly by the rounded colors.
+		for (uint32_t channel = 0; channel < 3; ++channel)
+		{
+			const float inset = (ends[1][channel] - ends[0][channel]) / 16.0f;
+			ends[0][channel] += inset;
+			ends[1][channel] -= inset;
+		}
+
+		uint32_t best[2] = { Pack565(ends[0]), Pack565(ends[1]) };
+		uint8_t bestIndices[16];
+		float bestError = EvaluateBc1(texels, best[0], best[1], bestIndices);
+
+		uint8_t indices[16];
+		memcpy(indices, bestIndices, sizeof(indices));
+		for (uint32_t pass = 0; pass < effort.refinements && bestError > 0.0f; ++pass)
+		{
+			if (!RefineLine(texels, AllTexels, indices, Bc1Factors, ColorWeights, ends))
+				break;
+			const uint32_t candidate[2] = { Pack565(ends[0]), Pack565(ends[1]) };
+			const float error = EvaluateBc1(texels, candidate[0], candidate[1], indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				best[0] = candidate[0];
+				best[1] = candidate[1];
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		// Steps each channel of each end by one while that helps.
+		static constexpr uint32_t Shifts[3] = { 11, 5, 0 };
+		static constexpr uint32_t Limits[3] = { 31, 63, 31 };
+		for (uint32_t round = 0; effort.bExhaustive && round < 2 && bestError > 0.0f; ++round)
+		{
+			bool bImproved = false;
+			for (uint32_t end = 0; end < 2; ++end)
+			{
+				for (uint32_t channel = 0; channel < 3; ++channel)
+				{
+					const uint32_t value = (best[end] >> Shifts[channel]) & Limits[channel];
+					for (int step = -1; step <= 1; step += 2)
+					{
+						if ((step < 0 && value == 0) || (step > 0 && value == Limits[channel]))
+							continue;
+						uint32_t candidate[2] = { best[0], best[1] };
+						candidate[end] = (candidate[end] & ~(Limits[channel] << Shifts[channel])) | ((value + step) << Shifts[channel]);
+						const float error = EvaluateBc1(texels, candidate[0], candidate[1], indices);
+						if (error < bestError)
+						{
+							bestError = error;
+							best[0] = candidate[0];
+							best[1] = candidate[1];
+							memcpy(bestIndices, indices, sizeof(indices));
+							bImproved = true;
+						}
+					}
+				}
+			}
+			if (!bImproved)
+				break;
+		}
+
+		// The first color has to be the larger one for the four color palette.
+		static constexpr uint8_t Swapped[4] = { 1, 0, 3, 2 };
+		if (best[0] < best[1])
+		{
+			std::swap(best[0], best[1]);
+			for (auto& index : bestIndices)
+				index = Swapped[index];
+		}
+		else if (best[0] == best[1])
+		{
+			memset(bestIndices, 0, sizeof(bestIndices));
+		}
+
+		uint32_t indexBits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+			indexBits |= static_cast<uint32_t>(bestIndices[i]) << (i * 2);
+
+		block[0] = static_cast<uint8_t>(best[0]);
+		block[1] = static_cast<uint8_t>(best[0] >> 8);
+		block[2] = static_cast<uint8_t>(best[1]);
+		block[3] = static_cast<uint8_t>(best[1] >> 8);
+		memcpy(block + 4, &indexBits, sizeof(indexBits));
+	}
+
+	static void DecodeBc1(const uint8_t* block, bool bFourColors, uint8_t texels[64])
+	{
+		const uint32_t color0 = block[0] | (block[1] << 8);
+		const uint32_t color1 = block[2] | (block[3] << 8);
+		uint32_t ends[2][3];
+		Unpack565(color0, ends[0]);
+		Unpack565(color1, ends[1]);
+
+		uint8_t palette[4][4];
+		for (uint32_t channel = 0; channel < 3; ++channel)
+		{
+			palette[0][channel] = static_cast<uint8_t>(ends[0][channel]);
+			palette[1][channel] = static_cast<uint8_t>(ends[1][channel]);
+			if (bFourColors || color0 > color1)
+			{
+				palette[2][channel] = static_cast<uint8_t>((2 * ends[0][channel] + ends[1][channel] + 1) / 3);
+				palette[3][channel] = static_cast<uint8_t>((ends[0][channel] + 2 * ends[1][channel] + 1) / 3);
+			}
+			else
+			{
+				palette[2][channel] = static_cast<uint8_t>((ends[0][channel] + ends[1][channel] + 1) / 2);
+				palette[3][channel] = 0;
+			}
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = bFourColors || color0 > color1 ? 255 : 0;
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+			memcpy(texels + i * 4, palette[index], 4);
+		}
+	}
+
+	// BC4 ---------------------------------------------------------------------------------------------
+
+	// Palette of the ends, eight interpolated values when the first is larger, otherwise six and the
+	// extremes 0 and 255.
+	static void GetBc4Palette(uint32_t end0, uint32_t end1, float palette[8])
+	{
+		palette[0] = static_cast<float>(end0);
+		palette[1] = static_cast<float>(end1);
+		if (end0 > end1)
+		{
+			for (uint32_t i = 2; i < 8; ++i)
+				palette[i] = ((8 - i) * end0 + (i - 1) * end1) / 7.0f;
+		}
+		else
+		{
+			for (uint32_t i = 2; i < 6; ++i)
+				palette[i] = ((6 - i) * end0 + (i - 1) * end1) / 5.0f;
+			palette[6] = 0.0f;
+			palette[7] = 255.0f;
+		}
+	}
+
+	static float EvaluateBc4(const Texels& texels, uint32_t channel, uint32_t end0, uint32_t end1, uint8_t indices[16])
+	{
+		float values[8];
+		GetBc4Palette(end0, end1, values);
+		float palette[8][4] = {};
+		for (uint32_t i = 0; i < 8; ++i)
+			palette[i][channel] = values[i];
+
+		float weights[4] = {};
+		weights[channel] = 1.0f;
+		return FindIndices(texels, AllTexels, palette, 8, weights, indices);
+	}
+
+	static void EncodeBc4(const Texels& texels, uint32_t channel, const Effort& effort, uint8_t* block)
+	{
+		static constexpr float Factors8[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+		static constexpr float Factors6[6] = { 0.0f, 1.0f, 1.0f / 5.0f, 2.0f / 5.0f, 3.0f / 5.0f, 4.0f / 5.0f };
+
+		const float* values = texels.channels[channel];
+		float low = 255.0f;
+		float high = 0.0f;
+		float innerLow = 255.0f;
+		float innerHigh = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			low = (std::min)(low, values[i]);
+			high = (std::max)(high, values[i]);
+			if (values[i] != 0.0f && values[i] != 255.0f)
+			{
+				innerLow = (std::min)(innerLow, values[i]);
+				innerHigh = (std::max)(innerHigh, values[i]);
+			}
+		}
+
+		uint32_t best[2] = { static_cast<uint32_t>(high), static_cast<uint32_t>(low) };
+		uint8_t bestIndices[16];
+		float bestError = EvaluateBc4(texels, channel, best[0], best[1], bestIndices);
+
+		uint8_t indices[16];
+		auto tryEnds = [&](int end0, int end1)
+		{
+			end0 = std::clamp(end0, 0, 255);
+			end1 = std::clamp(end1, 0, 255);
+			const float error = EvaluateBc4(texels, channel, end0, end1, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				best[0] = end0;
+				best[1] = end1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		};
+
+		// Blocks that reach 0 or 255 may do better with those two for free and six steps between the rest.
+		if (bestError > 0.0f && (low == 0.0f || high == 255.0f) && innerLow <= innerHigh)
+			tryEnds(static_cast<int>(innerLow), static_cast<int>(innerHigh));
+
+		for (uint32_t pass = 0; pass < effort.refinements && bestError > 0.0f; ++pass)
+		{
+			const bool bEight = best[0] > best[1];
+			memcpy(indices, bestIndices, sizeof(indices));
+			uint32_t mask = AllTexels;
+			if (!bEight)
+			{
+				// Texels on the fixed extremes do not move the ends.
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					if (indices[i] >= 6)
+						mask &= ~(1u << i);
+				}
+			}
+			float weights[4] = {};
+			weights[channel] = 1.0f;
+			float ends[2][4] = {};
+			if (mask == 0 || !RefineLine(texels, mask, indices, bEight ? Factors8 : Factors6, weights, ends))
+				break;
+
+			const int end0 = static_cast<int>(ends[0][channel] + 0.5f);
+			const int end1 = static_cast<int>(ends[1][channel] + 0.5f);
+			if (bEight ? end0 > end1 : end0 <= end1)
+				tryEnds(end0, end1);
+			else
+				tryEnds(end1, end0);
+		}
+
+		for (uint32_t round = 0; effort.bExhaustive && round < 2 && bestError > 0.0f; ++round)
+		{
+			const uint32_t start[2] = { best[0], best[1] };
+			for (int step0 = -2; step0 <= 2; ++step0)
+			{
+				for (int step1 = -2; step1 <= 2; ++step1)
+				{
+					const int end0 = static_cast<int>(start[0]) + step0;
+					const int end1 = static_cast<int>(start[1]) + step1;
+					// The mode is kept, a step across the other mode changes every index.
+					if ((start[0] > start[1]) == (end0 > end1))
+						tryEnds(end0, end1);
+				}
+			}
+		}
+
+		block[0] = static_cast<uint8_t>(best[0]);
+		block[1] = static_cast<uint8_t>(best[1]);
+		uint64_t indexBits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+			indexBits |= static_cast<uint64_t>(bestIndices[i]) << (i * 3);
+		for (uint32_t i = 0; i < 6; ++i)
+			block[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+	}
+
+	static void DecodeBc4(const uint8_t* block, uint32_t channel, uint8_t texels[64])
+	{
+		float palette[8];
+		GetBc4Palette(block[0], block[1], palette);
+		uint64_t indexBits = 0;
+		for (uint32_t i = 0; i < 6; ++i)
+			indexBits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		for (uint32_t i = 0; i < 16; ++i)
+			texels[i * 4 + channel] = static_cast<uint8_t>(palette[(indexBits >> (i * 3)) & 7] + 0.5f);
+	}
+
+	// BC7 ---------------------------------------------------------------------------------------------
+
+	struct Bc7Mode
+	{
+		uint8_t subsets;
+		uint8_t partitionBits;
+		uint8_t rotationBits;
+		uint8_t indexSelectionBits;
+		uint8_t colorBits;
+		uint8_t alphaBits;
+		// A p-bit, the lowest bit of every channel, for each endpoint or for each subset.
+		uint8_t endpointPBits;
+		uint8_t sharedPBits;
+		uint8_t indexBits;
+		uint8_t secondaryIndexBits;
+	};
+
+	static constexpr Bc7Mode Bc7Modes[8] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	static constexpr uint8_t Bc7Weights2[4] = { 0, 21, 43, 64 };
+	static constexpr uint8_t Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	static constexpr uint8_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	static const uint8_t* GetBc7Weights(uint32_t bits)
+	{
+		return bits == 2 ? Bc7Weights2 : bits == 3 ? Bc7Weights3 : Bc7Weights4;
+	}
+
+	// Subset of every texel in rows, for each partition of two and three subsets.
+	static const char* const Bc7Partitions2[64] = {
+		"0011001100110011", "0001000100010001", "0111011101110111", "0001001100110111",
+		"0000000100010011", "0011011101111111", "0001001101111111", "0000000100110111",
+		"0000000000010011", "0011011111111111", "0000000101111111", "0000000000010111",
+		"0001011111111111", "0000000011111111", "0000111111111111", "0000000000001111",
+		"0000100011101111", "0111000100000000", "0000000010001110", "0111001100010000",
+		"0011000100000000", "0000100011001110", "0000000010001100", "0111001100110001",
+		"0011000100010000", "0000100010001100", "0110011001100110", "0011011001101100",
+		"0001011111101000", "0000111111110000", "0111000110001110", "0011100110011100",
+		"0101010101010101", "0000111100001111", "0101101001011010", "0011001111001100",
+		"0011110000111100", "0101010110101010", "0110100101101001", "0101101010100101",
+		"0111001111001110", "0001001111001000", "0011001001001100", "0011101111011100",
+		"0110100110010110", "0011110011000011", "0110011010011001", "0000011001100000",
+		"0100111001000000", "0010011100100000", "0000001001110010", "0000010011100100",
+		"0110110010010011", "0011011011001001", "0110001110011100", "0011100111000110",
+		"0110110011001001", "0110001100111001", "0111111010000001", "0001100011100111",
+		"0000111100110011", "0011001111110000", "0010001011101110", "0100010001110111",
+	};
+
+	static const char* const Bc7Partitions3[64] = {
+		"0011001102212222", "0001001122112221", "0000200122112211", "0222002200110111",
+		"0000000011221122", "0011001100220022", "0022002211111111", "0011001122112211",
+		"0000000011112222", "0000111111112222", "0000111122222222", "0012001200120012",
+		"0112011201120112", "0122012201220122", "0011011211221222", "0011200122002220",
+		"0001001101121122", "0111001120012200", "0000112211221122", "0022002200221111",
+		"0111011102220222", "0001000122212221", "0000001101220122", "0000110022102210",
+		"0122012200110000", "0012001211222222", "0110122112210110", "0000011012211221",
+		"0022110211020022", "0110011020022222", "0011012201220011", "0000200022112221",
+		"0000000211221222", "0222002200120011", "0011001200220222", "0120012001200120",
+		"0000111122220000", "0120120120120120", "0120201212010120", "0011220011220011",
+		"0011112222000011", "0101010122222222", "0000000021212121", "0022112200221122",
+		"0022001100220011", "0220122102201221", "0101222222220101", "0000212121212121",
+		"0101010101012222", "0222011102220111", "0002111200021112", "0000211221122112",
+		"0222011101110222", "0002111211120002", "0110011001102222", "0000000021122112",
+		"0110011022222222", "0022001100110022", "0022112211220022", "0000000000002112",
+		"0002000100020001", "0222122202221222", "0101222222222222", "0111201122012220",
+	};
+
+	// Texel of each subset past the first whose index has its top bit dropped.
+	static constexpr uint8_t Bc7Anchors2[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+	};
+
+	static constexpr uint8_t Bc7Anchors3[2][64] = {
+		{
+			3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+			3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+			8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+			3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3,
+		},
+		{
+			15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+			15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+			15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+			15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8,
+		},
+	};
+
+	struct Bc7Tables
+	{
+		// Texels of each subset as bits.
+		uint32_t masks2[64][2];
+		uint32_t masks3[64][3];
+		// The same as lanes of all ones and the texel counts, for every subset but the last.
+		alignas(16) uint32_t lanes2[64][16];
+		alignas(16) uint32_t lanes3[64][2][16];
+		alignas(16) float counts2[64];
+		alignas(16) float counts3[2][64];
+	};
+
+	static const Bc7Tables& GetBc7Tables()
+	{
+		static const std::unique_ptr<Bc7Tables> tables = []
+		{
+			std::unique_ptr<Bc7Tables> built(new Bc7Tables());
+			for (uint32_t partition = 0; partition < 64; ++partition)
+			{
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					const uint32_t subset2 = Bc7Partitions2[partition][i] - '0';
+					const uint32_t subset3 = Bc7Partitions3[partition][i] - '0';
+					built->masks2[partition][subset2] |= 1u << i;
+					built->masks3[partition][subset3] |= 1u << i;
+					built->lanes2[partition][i] = subset2 == 0 ? ~0u : 0u;
+					built->counts2[partition] += subset2 == 0;
+					for (uint32_t subset = 0; subset < 2; ++subset)
+					{
+						built->lanes3[partition][subset][i] = subset3 == subset ? ~0u : 0u;
+						built->counts3[subset][partition] += subset3 == subset;
+					}
+				}
+			}
+			return built;
+		}();
+		return *tables;
+	}
+
+	static uint32_t GetBc7Subset(uint32_t subsets, uint32_t partition, uint32_t texel)
+	{
+		if (subsets == 1)
+			return 0;
+		return (subsets == 2 ? Bc7Partitions2 : Bc7Partitions3)[partition][texel] - '0';
+	}
+
+	static uint32_t GetBc7Anchor(uint32_t subsets, uint32_t partition, uint32_t subset)
+	{
+		if (subset == 0)
+			return 0;
+		return subsets == 2 ? Bc7Anchors2[partition] : Bc7Anchors3[subset - 1][partition];
+	}
+
+	// Endpoints of one subset or of one index set, quantized to the bits of the mode.
+	struct Bc7Endpoints
+	{
+		uint8_t values[2][4];
+		uint8_t pBits[2];
+	};
+
+	// How a mode stores the endpoints of the channels an index set covers, channels without bits are
+	// not part of it.
+	struct Bc7Precision
+	{
+		uint8_t bits[4];
+		bool bEndpointPBits;
+		bool bSharedPBit;
+		uint8_t indexBits;
+	};
+
+	static void DecodeBc7Endpoints(const Bc7Endpoints& endpoints, const Bc7Precision& precision, uint32_t decoded[2][4])
+	{
+		const bool bPBits = precision.bEndpointPBits || precision.bSharedPBit;
+		for (uint32_t end = 0; end < 2; ++end)
+		{
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				const uint32_t bits = precision.bits[channel];
+				if (bits == 0)
+					decoded[end][channel] = 255;
+				else if (bPBits)
+					decoded[end][channel] = Expand((endpoints.values[end][channel] << 1) | endpoints.pBits[end], bits + 1);
+				else
+					decoded[end][channel] = Expand(endpoints.values[end][channel], bits);
+			}
+		}
+	}
+
+	// Rounds one end to the bits of each channel under a p-bit, returns the error of the rounding.
+	static float QuantizeBc7End(const float end[4], const Bc7Precision& precision, uint32_t pBit, uint8_t values[4])
+	{
+		const bool bPBits = precision.bEndpointPBits || precision.bSharedPBit;
+		float error = 0.0f;
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			const uint32_t bits = precision.bits[channel];
+			if (bits == 0)
+			{
+				values[channel] = 0;
+				continue;
+			}
+
+			const int limit = (1 << bits) - 1;
+			int value;
+			uint32_t decoded;
+			if (bPBits)
+			{
+				const float scaled = end[channel] * ((1 << (bits + 1)) - 1) / 255.0f;
+				value = std::clamp(static_cast<int>((scaled - pBit) * 0.5f + 0.5f), 0, limit);
+				decoded = Expand((value << 1) | pBit, bits + 1);
+			}
+			else
+			{
+				value = std::clamp(static_cast<int>(end[channel] * limit / 255.0f + 0.5f), 0, limit);
+				decoded = Expand(value, bits);
+			}
+			values[channel] = static_cast<uint8_t>(value);
+			const float difference = decoded - end[channel];
+			error += difference * difference;
+		}
+		return error;
+	}
+
+	static void QuantizeBc7Endpoints(const float ends[2][4], const Bc7Precision& precision, int forcedPBits, Bc7Endpoints& endpoints)
+	{
+		endpoints.pBits[0] = endpoints.pBits[1] = 0;
+		if (precision.bEndpointPBits)
+		{
+			for (uint32_t end = 0; end < 2; ++end)
+			{
+				uint8_t values[2][4];
+				uint32_t pBit;
+				if (forcedPBits >= 0)
+				{
+					pBit = (forcedPBits >> end) & 1;
+					QuantizeBc7End(ends[end], precision, pBit, values[pBit]);
+				}
+				else
+				{
+					const float errors[2] = {
+						QuantizeBc7End(ends[end], precision, 0, values[0]), QuantizeBc7End(ends[end], precision, 1, values[1]) };
+					pBit = errors[1] < errors[0];
+				}
+				memcpy(endpoints.values[end], values[pBit], 4);
+				endpoints.pBits[end] = static_cast<uint8_t>(pBit);
+			}
+		}
+		else if (precision.bSharedPBit)
+		{
+			uint8_t values[2][2][4];
+			uint32_t pBit;
+			if (forcedPBits >= 0)
+			{
+				pBit = forcedPBits & 1;
+				QuantizeBc7End(ends[0], precision, pBit, values[pBit][0]);
+				QuantizeBc7End(ends[1], precision, pBit, values[pBit][1]);
+			}
+			else
+			{
+				float errors[2];
+				for (uint32_t bit = 0; bit < 2; ++bit)
+					errors[bit] = QuantizeBc7End(ends[0], precision, bit, values[bit][0]) + QuantizeBc7End(ends[1], precision, bit, values[bit][1]);
+				pBit = errors[1] < errors[0];
+			}
+			memcpy(endpoints.values, values[pBit], sizeof(endpoints.values));
+			endpoints.pBits[0] = endpoints.pBits[1] = static_cast<uint8_t>(pBit);
+		}
+		else
+		{
+			QuantizeBc7End(ends[0], precision, 0, endpoints.values[0]);
+			QuantizeBc7End(ends[1], precision, 0, endpoints.values[1]);
+		}
+	}
+
+	static float EvaluateBc7(const Texels& texels, uint32_t mask, const Bc7Endpoints& endpoints, const Bc7Precision& precision,
+		const float weights[4], uint8_t indices[16])
+	{
+		uint32_t decoded[2][4];
+		DecodeBc7Endpoints(endpoints, precision, decoded);
+
+		const uint8_t* factors = GetBc7Weights(precision.indexBits);
+		const uint32_t count = 1u << precision.indexBits;
+		float palette[16][4];
+		for (uint32_t entry = 0; entry < count; ++entry)
+		{
+			for (uint32_t channel = 0; channel < 4; ++channel)
+				palette[entry][channel] = static_cast<float>(((64 - factors[entry]) * decoded[0][channel] + factors[entry] * decoded[1][channel] + 32) >> 6);
+		}
+		return FindIndices(texels, mask, palette, count, weights, indices);
+	}
+
+	// Fits, quantizes and indexes the texels of the mask for one index set of a mode.
+	static float EncodeBc7Subset(const Texels& texels, uint32_t mask, const Bc7Precision& precision, const Effort& effort,
+		Bc7Endpoints& endpoints, uint8_t indices[16])
+	{
+		float weights[4];
+		for (uint32_t channel = 0; channel < 4; ++channel)
+			weights[channel] = precision.bits[channel] != 0 ? 1.0f : 0.0f;
+
+		float ends[2][4];
+		FitLine(texels, mask, weights, ends);
+
+		const bool bPBits = precision.bEndpointPBits || precision.bSharedPBit;
+		const int pBitCombinations = effort.bExhaustive && bPBits ? (precision.bEndpointPBits ? 4 : 2) : 0;
+
+		float bestError = (std::numeric_limits<float>::max)();
+		uint8_t candidateIndices[16];
+		Bc7Endpoints candidate;
+		auto tryEnds = [&]()
+		{
+			// Every p-bit choice when searching exhaustively, otherwise the closest rounding.
+			for (int pBits = pBitCombinations ? 0 : -1; pBits < pBitCombinations; ++pBits)
+			{
+				QuantizeBc7Endpoints(ends, precision, pBits, candidate);
+				const float error = EvaluateBc7(texels, mask, candidate, precision, weights, candidateIndices);
+				if (error < bestError)
+				{
+					bestError = error;
+					endpoints = candidate;
+					for (uint32_t i = 0; i < 16; ++i)
+					{
+						if (mask & (1u << i))
+							indices[i] = candidateIndices[i];
+					}
+				}
+			}
+		};
+		tryEnds();
+
+		float factors[16];
+		const uint8_t* table = GetBc7Weights(precision.indexBits);
+		for (uint32_t i = 0; i < (1u << precision.indexBits); ++i)
+			factors[i] = table[i] / 64.0f;
+
+		for (uint32_t pass = 0; pass < effort.refinements && bestError > 0.0f; ++pass)
+		{
+			memcpy(candidateIndices, indices, sizeof(candidateIndices));
+			if (!RefineLine(texels, mask, candidateIndices, factors, weights, ends))
+				break;
+			tryEnds();
+		}
+		return bestError;
+	}
+
+	struct Bc7Block
+	{
+		uint32_t mode;
+		uint32_t partition;
+		uint32_t rotation;
+		uint32_t indexSelection;
+		Bc7Endpoints endpoints[3];
+		// Of the color and alpha separately in modes 4 and 5.
+		Bc7Endpoints alphaEndpoints;
+		uint8_t indices[16];
+		uint8_t alphaIndices[16];
+		float error;
+	};
+
+	// Endpoints of one subset of a mode, color and alpha together.
+	static Bc7Precision GetBc7Precision(const Bc7Mode& mode)
+	{
+		return { { mode.colorBits, mode.colorBits, mode.colorBits, mode.alphaBits }, mode.endpointPBits != 0, mode.sharedPBits != 0, mode.indexBits };
+	}
+
+	static void EncodeBc7Partitioned(const Texels& texels, uint32_t modeIndex, uint32_t partition, const Effort& effort, Bc7Block& best)
+	{
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		const Bc7Precision precision = GetBc7Precision(mode);
+		const Bc7Tables& tables = GetBc7Tables();
+
+		Bc7Block block = {};
+		block.mode = modeIndex;
+		block.partition = partition;
+		block.rotation = 0;
+		block.indexSelection = 0;
+		block.error = 0.0f;
+		for (uint32_t subset = 0; subset < mode.subsets && block.error < best.error; ++subset)
+		{
+			const uint32_t mask = mode.subsets == 1 ? AllTexels : mode.subsets == 2 ? tables.masks2[partition][subset] : tables.masks3[partition][subset];
+			block.error += EncodeBc7Subset(texels, mask, precision, effort, block.endpoints[subset], block.indices);
+		}
+		if (block.error < best.error)
+			best = block;
+	}
+
+	// Modes 4 and 5 index color and alpha separately, after alpha was swapped with a color channel.
+	static void EncodeBc7Separate(const Texels& texels, uint32_t modeIndex, uint32_t rotation, uint32_t indexSelection, const Effort& effort,
+		Bc7Block& best)
+	{
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		Texels rotated = texels;
+		if (rotation != 0)
+			std::swap(rotated.channels[3], rotated.channels[rotation - 1]);
+
+		const uint8_t colorIndexBits = indexSelection ? mode.secondaryIndexBits : mode.indexBits;
+		const uint8_t alphaIndexBits = indexSelection ? mode.indexBits : mode.secondaryIndexBits;
+		const Bc7Precision color = { { mode.colorBits, mode.colorBits, mode.colorBits, 0 }, false, false, colorIndexBits };
+		const Bc7Precision alpha = { { 0, 0, 0, mode.alphaBits }, false, false, alphaIndexBits };
+
+		Bc7Block block = {};
+		block.mode = modeIndex;
+		block.partition = 0;
+		block.rotation = rotation;
+		block.indexSelection = indexSelection;
+		block.error = EncodeBc7Subset(rotated, AllTexels, color, effort, block.endpoints[0], block.indices);
+		if (block.error < best.error)
+		{
+			block.error += EncodeBc7Subset(rotated, AllTexels, alpha, effort, block.alphaEndpoints, block.alphaIndices);
+			if (block.error < best.error)
+				best = block;
+		}
+	}
+
+	// Variance of four subsets off their principal axes, one in each lane, from the sums of their
+	// channels followed by the sums of their products. The axis is estimated by power iteration on the
+	// covariance scaled by its trace, started from the row of the channel that varies most.
+	template<uint32_t Channels>
+	static __m128 GetLineResiduals(const __m128* sums, __m128 count)
+	{
+		__m128 covariance[Channels][Channels];
+		const __m128* products = sums + Channels;
+		const __m128 inverseCount = _mm_div_ps(_mm_set1_ps(1.0f), count);
+		__m128 trace = _mm_setzero_ps();
+		for (uint32_t row = 0; row < Channels; ++row)
+		{
+			for (uint32_t column = row; column < Channels; ++column)
+			{
+				covariance[row][column] = covariance[column][row] =
+					_mm_sub_ps(*products++, _mm_mul_ps(_mm_mul_ps(sums[row], sums[column]), inverseCount));
+			}
+			trace = _mm_add_ps(trace, covariance[row][row]);
+		}
+
+		// Flat subsets have nothing off any axis.
+		const __m128 minimum = _mm_set1_ps(1e-3f);
+		const __m128 varied = _mm_cmpgt_ps(trace, minimum);
+		const __m128 inverseTrace = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(trace, minimum));
+		for (uint32_t row = 0; row < Channels; ++row)
+			for (uint32_t column = 0; column < Channels; ++column)
+				covariance[row][column] = _mm_mul_ps(covariance[row][column], inverseTrace);
+
+		__m128 axis[Channels];
+		__m128 widest = covariance[0][0];
+		for (uint32_t channel = 0; channel < Channels; ++channel)
+			axis[channel] = covariance[0][channel];
+		for (uint32_t row = 1; row < Channels; ++row)
+		{
+			const __m128 wider = _mm_cmpgt_ps(covariance[row][row], widest);
+			widest = _mm_max_ps(covariance[row][row], widest);
+			for (uint32_t channel = 0; channel < Channels; ++channel)
+				axis[channel] = _mm_or_ps(_mm_and_ps(wider, covariance[row][channel]), _mm_andnot_ps(wider, axis[channel]));
+		}
+
+		__m128 next[Channels];
+		for (uint32_t iteration = 0; iteration < 3; ++iteration)
+		{
+			for (uint32_t row = 0; row < Channels; ++row)
+			{
+				next[row] = _mm_mul_ps(covariance[row][0], axis[0]);
+				for (uint32_t column = 1; column < Channels; ++column)
+					next[row] = _mm_add_ps(next[row], _mm_mul_ps(covariance[row][column], axis[column]));
+			}
+			if (iteration < 2)
+				memcpy(axis, next, sizeof(axis));
+		}
+
+		// Rayleigh quotient, the largest eigenvalue as a share of the trace.
+		__m128 numerator = _mm_setzero_ps();
+		__m128 denominator = _mm_setzero_ps();
+		for (uint32_t channel = 0; channel < Channels; ++channel)
+		{
+			numerator = _mm_add_ps(numerator, _mm_mul_ps(axis[channel], next[channel]));
+			denominator = _mm_add_ps(denominator, _mm_mul_ps(axis[channel], axis[channel]));
+		}
+		const __m128 converged = _mm_cmpgt_ps(denominator, _mm_set1_ps(1e-20f));
+		const __m128 share = _mm_and_ps(converged, _mm_div_ps(numerator, _mm_max_ps(denominator, _mm_set1_ps(1e-20f))));
+		const __m128 residual = _mm_mul_ps(trace, _mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), share), _mm_setzero_ps()));
+		return _mm_and_ps(varied, residual);
+	}
+
+	// Partitions of the subset count ordered by how well a line fits each of their subsets, the
+	// variance off the principal axis of each subset summed.
+	static void RankBc7Partitions(const Texels& texels, uint32_t subsets, bool bAlpha, uint32_t count, uint32_t ranked[64])
+	{
+		const Bc7Tables& tables = GetBc7Tables();
+		const uint32_t channels = bAlpha ? 4 : 3;
+
+		// Every channel and every product of two channels of each texel, summed over a subset they give
+		// its covariance.
+		alignas(16) float features[14][16];
+		uint32_t featureCount = 0;
+		for (uint32_t channel = 0; channel < channels; ++channel)
+			memcpy(features[featureCount++], texels.channels[channel], sizeof(features[0]));
+		for (uint32_t row = 0; row < channels; ++row)
+		{
+			for (uint32_t column = row; column < channels; ++column, ++featureCount)
+			{
+				for (uint32_t group = 0; group < 4; ++group)
+				{
+					_mm_store_ps(features[featureCount] + group * 4,
+						_mm_mul_ps(_mm_load_ps(texels.channels[row] + group * 4), _mm_load_ps(texels.channels[column] + group * 4)));
+				}
+			}
+		}
+
+		float totals[14];
+		for (uint32_t feature = 0; feature < featureCount; ++feature)
+		{
+			totals[feature] = 0.0f;
+			for (uint32_t i = 0; i < 16; ++i)
+				totals[feature] += features[feature][i];
+		}
+
+		// Sums of every subset but the last, by feature and partition.
+		alignas(16) float sums[2][14][64];
+		for (uint32_t partition = 0; partition < 64; ++partition)
+		{
+			for (uint32_t subset = 0; subset + 1 < subsets; ++subset)
+			{
+				const uint32_t* lanes = subsets == 2 ? tables.lanes2[partition] : tables.lanes3[partition][subset];
+				__m128 masks[4];
+				for (uint32_t group = 0; group < 4; ++group)
+					masks[group] = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(lanes + group * 4)));
+				for (uint32_t feature = 0; feature < featureCount; ++feature)
+				{
+					__m128 total = _mm_setzero_ps();
+					for (uint32_t group = 0; group < 4; ++group)
+						total = _mm_add_ps(total, _mm_and_ps(masks[group], _mm_load_ps(features[feature] + group * 4)));
+					alignas(16) float lanesSum[4];
+					_mm_store_ps(lanesSum, total);
+					sums[subset][feature][partition] = (lanesSum[0] + lanesSum[1]) + (lanesSum[2] + lanesSum[3]);
+				}
+			}
+		}
+
+		// Four partitions at a time, the last subset has what the others leave of the totals.
+		alignas(16) float errors[64];
+		for (uint32_t first = 0; first < 64; first += 4)
+		{
+			__m128 rest[14];
+			for (uint32_t feature = 0; feature < featureCount; ++feature)
+				rest[feature] = _mm_set1_ps(totals[feature]);
+			__m128 restCount = _mm_set1_ps(16.0f);
+			__m128 error = _mm_setzero_ps();
+			for (uint32_t subset = 0; subset + 1 < subsets; ++subset)
+			{
+				__m128 subsetSums[14];
+				for (uint32_t feature = 0; feature < featureCount; ++feature)
+				{
+					subsetSums[feature] = _mm_load_ps(sums[subset][feature] + first);
+					rest[feature] = _mm_sub_ps(rest[feature], subsetSums[feature]);
+				}
+				const __m128 subsetCount = _mm_load_ps((subsets == 2 ? tables.counts2 : tables.counts3[subset]) + first);
+				restCount = _mm_sub_ps(restCount, subsetCount);
+				error = _mm_add_ps(error, bAlpha ? GetLineResiduals<4>(subsetSums, subsetCount) : GetLineResiduals<3>(subsetSums, subsetCount));
+			}
+			error = _mm_add_ps(error, bAlpha ? GetLineResiduals<4>(rest, restCount) : GetLineResiduals<3>(rest, restCount));
+			_mm_store_ps(errors + first, error);
+		}
+
+		for (uint32_t partition = 0; partition < 64; ++partition)
+			ranked[partition] = partition;
+		std::partial_sort(ranked, ranked + count, ranked + 64, [&](uint32_t a, uint32_t b) { return errors[a] < errors[b]; });
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(uint8_t* bytes) : mBytes(bytes) { memset(mBytes, 0, 16); }
+
+		void Write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t bit = 0; bit < bits; ++bit, ++mPosition)
+			{
+				if (value & (1u << bit))
+					mBytes[mPosition >> 3] |= static_cast<uint8_t>(1u << (mPosition & 7));
+			}
+		}
+
+	private:
+		uint8_t* mBytes;
+		uint32_t mPosition = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(const uint8_t* bytes) : mBytes(bytes) {}
+
+		uint32_t Read(uint32_t bits)
+		{
+			uint32_t value = 0;
+			for (uint32_t bit = 0; bit < bits; ++bit, ++mPosition)
+				value |= ((mBytes[mPosition >> 3] >> (mPosition & 7)) & 1u) << bit;
+			return value;
+		}
+
+	private:
+		const uint8_t* mBytes;
+		uint32_t mPosition = 0;
+	};
+
+	// The index of every anchor texel has to have its top bit clear, the ends of a subset whose anchor
+	// does not are swapped and its indices mirrored.
+	static void FixBc7Anchors(Bc7Block& block)
+	{
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		auto fix = [](Bc7Endpoints& endpoints, uint8_t* indices, uint32_t bits, uint32_t subsets, uint32_t partition, uint32_t subset)
+		{
+			const uint32_t anchor = GetBc7Anchor(subsets, partition, subset);
+			const uint32_t last = (1u << bits) - 1;
+			if (indices[anchor] <= last / 2)
+				return;
+			std::swap(endpoints.values[0], endpoints.values[1]);
+			std::swap(endpoints.pBits[0], endpoints.pBits[1]);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (GetBc7Subset(subsets, partition, i) == subset)
+					indices[i] = static_cast<uint8_t>(last - indices[i]);
+			}
+		};
+
+		if (mode.secondaryIndexBits)
+		{
+			fix(block.endpoints[0], block.indices, block.indexSelection ? mode.secondaryIndexBits : mode.indexBits, 1, 0, 0);
+			fix(block.alphaEndpoints, block.alphaIndices, block.indexSelection ? mode.indexBits : mode.secondaryIndexBits, 1, 0, 0);
+			return;
+		}
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			fix(block.endpoints[subset], block.indices, mode.indexBits, mode.subsets, block.partition, subset);
+	}
+
+	static void PackBc7(Bc7Block& block, uint8_t* bytes)
+	{
+		FixBc7Anchors(block);
+
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		BitWriter writer(bytes);
+		writer.Write(1u << block.mode, block.mode + 1);
+		writer.Write(block.partition, mode.partitionBits);
+		writer.Write(block.rotation, mode.rotationBits);
+		writer.Write(block.indexSelection, mode.indexSelectionBits);
+
+		for (uint32_t channel = 0; channel < 3; ++channel)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				writer.Write(block.endpoints[subset].values[0][channel], mode.colorBits);
+				writer.Write(block.endpoints[subset].values[1][channel], mode.colorBits);
+			}
+		}
+		if (mode.alphaBits)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				const Bc7Endpoints& alpha = mode.secondaryIndexBits ? block.alphaEndpoints : block.endpoints[subset];
+				writer.Write(alpha.values[0][3], mode.alphaBits);
+				writer.Write(alpha.values[1][3], mode.alphaBits);
+			}
+		}
+
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			if (mode.endpointPBits)
+			{
+				writer.Write(block.endpoints[subset].pBits[0], 1);
+				writer.Write(block.endpoints[subset].pBits[1], 1);
+			}
+			else if (mode.sharedPBits)
+			{
+				writer.Write(block.endpoints[subset].pBits[0], 1);
+			}
+		}
+
+		// Mode 4 swaps which set of indices the color and alpha use.
+		const uint8_t* primary = block.indexSelection ? block.alphaIndices : block.indices;
+		const uint8_t* secondary = block.indexSelection ? block.indices : block.alphaIndices;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t subset = GetBc7Subset(mode.subsets, block.partition, i);
+			const bool bAnchor = i == GetBc7Anchor(mode.subsets, block.partition, subset);
+			writer.Write(primary[i], mode.indexBits - bAnchor);
+		}
+		if (mode.secondaryIndexBits)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+				writer.Write(secondary[i], mode.secondaryIndexBits - (i == 0));
+		}
+	}
+
+	static void EncodeBc7(const Texels& texels, const Effort& effort, uint8_t* bytes)
+	{
+		bool bOpaque = true;
+		for (uint32_t i = 0; i < 16; ++i)
+			bOpaque = bOpaque && texels.channels[3][i] == 255.0f;
+
+		Bc7Block best = {};
+		best.error = (std::numeric_limits<float>::max)();
+
+		// One subset of RGBA with the most precise indices, enough for smooth blocks.
+		EncodeBc7Partitioned(texels, 6, 0, effort, best);
+
+		// Separate alpha, rotated into the channel it varies least against.
+		if (!bOpaque || effort.bExhaustive)
+		{
+			for (uint32_t rotation = 0; rotation < 4 && best.error > 0.0f; ++rotation)
+			{
+				EncodeBc7Separate(texels, 5, rotation, 0, effort, best);
+				if (effort.bExhaustive)
+				{
+					EncodeBc7Separate(texels, 4, rotation, 0, effort, best);
+					EncodeBc7Separate(texels, 4, rotation, 1, effort, best);
+				}
+				if (!effort.bExhaustive && bOpaque)
+					break;
+			}
+		}
+
+		if (effort.partitions2 && best.error > 0.0f)
+		{
+			uint32_t ranked[64];
+			RankBc7Partitions(texels, 2, !bOpaque, effort.partitions2, ranked);
+			for (uint32_t k = 0; k < effort.partitions2 && best.error > 0.0f; ++k)
+			{
+				if (bOpaque)
+				{
+					EncodeBc7Partitioned(texels, 1, ranked[k], effort, best);
+					// Fewer index bits for more endpoint bits, it wins on blocks of two flat colors.
+					if (k < (std::max)(effort.partitions2 / 2, 1u))
+						EncodeBc7Partitioned(texels, 3, ranked[k], effort, best);
+				}
+				else
+				{
+					EncodeBc7Partitioned(texels, 7, ranked[k], effort, best);
+				}
+			}
+		}
+
+		if (bOpaque && effort.partitions3 && best.error > 0.0f)
+		{
+			uint32_t ranked[64];
+			RankBc7Partitions(texels, 3, false, effort.partitions3, ranked);
+			for (uint32_t k = 0; k < effort.partitions3 && best.error > 0.0f; ++k)
+			{
+				EncodeBc7Partitioned(texels, 2, ranked[k], effort, best);
+				if (effort.bExhaustive && ranked[k] < 16)
+					EncodeBc7Partitioned(texels, 0, ranked[k], effort, best);
+			}
+		}
+
+		PackBc7(best, bytes);
+	}
+
+	static void DecodeBc7(const uint8_t* bytes, uint8_t texels[64])
+	{
+		uint32_t modeIndex = 0;
+		while (modeIndex < 8 && !(bytes[0] & (1u << modeIndex)))
+			++modeIndex;
+		if (modeIndex == 8)
+		{
+			// Reserved, decodes to transparent black.
+			memset(texels, 0, 64);
+			return;
+		}
+
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		BitReader reader(bytes);
+		reader.Read(modeIndex + 1);
+		const uint32_t partition = reader.Read(mode.partitionBits);
+		const uint32_t rotation = reader.Read(mode.rotationBits);
+		const uint32_t indexSelection = reader.Read(mode.indexSelectionBits);
+
+		uint32_t ends[3][2][4];
+		for (uint32_t channel = 0; channel < 3; ++channel)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				ends[subset][0][channel] = reader.Read(mode.colorBits);
+				ends[subset][1][channel] = reader.Read(mode.colorBits);
+			}
+		}
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			ends[subset][0][3] = reader.Read(mode.alphaBits);
+			ends[subset][1][3] = reader.Read(mode.alphaBits);
+		}
+
+		uint32_t pBits[3][2] = {};
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			if (mode.endpointPBits)
+			{
+				pBits[subset][0] = reader.Read(1);
+				pBits[subset][1] = reader.Read(1);
+			}
+			else if (mode.sharedPBits)
+			{
+				pBits[subset][0] = pBits[subset][1] = reader.Read(1);
+			}
+		}
+
+		const bool bPBits = mode.endpointPBits || mode.sharedPBits;
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			for (uint32_t end = 0; end < 2; ++end)
+			{
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					const uint32_t bits = channel < 3 ? mode.colorBits : mode.alphaBits;
+					uint32_t& value = ends[subset][end][channel];
+					if (bits == 0)
+						value = 255;
+					else if (bPBits)
+						value = Expand((value << 1) | pBits[subset][end], bits + 1);
+					else
+						value = Expand(value, bits);
+				}
+			}
+		}
+
+		uint32_t primary[16];
+		uint32_t secondary[16] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t subset = GetBc7Subset(mode.subsets, partition, i);
+			const bool bAnchor = i == GetBc7Anchor(mode.subsets, partition, subset);
+			primary[i] = reader.Read(mode.indexBits - bAnchor);
+		}
+		if (mode.secondaryIndexBits)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+				secondary[i] = reader.Read(mode.secondaryIndexBits - (i == 0));
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t subset = GetBc7Subset(mode.subsets, partition, i);
+			uint32_t colorWeight;
+			uint32_t alphaWeight;
+			if (!mode.secondaryIndexBits)
+			{
+				colorWeight = alphaWeight = GetBc7Weights(mode.indexBits)[primary[i]];
+			}
+			else if (indexSelection)
+			{
+				colorWeight = GetBc7Weights(mode.secondaryIndexBits)[secondary[i]];
+				alphaWeight = GetBc7Weights(mode.indexBits)[primary[i]];
+			}
+			else
+			{
+				colorWeight = GetBc7Weights(mode.indexBits)[primary[i]];
+				alphaWeight = GetBc7Weights(mode.secondaryIndexBits)[secondary[i]];
+			}
+
+			uint8_t* texel = texels + i * 4;
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				const uint32_t weight = channel < 3 ? colorWeight : alphaWeight;
+				texel[channel] = static_cast<uint8_t>(((64 - weight) * ends[subset][0][channel] + weight * ends[subset][1][channel] + 32) >> 6);
+			}
+			if (rotation != 0)
+				std::swap(texel[3], texel[rotation - 1]);
+		}
+	}
+
+	// -------------------------------------------------------------------------------------------------
+
+	size_t BlockCompressor::GetBlockSize(Format format)
+	{
+		return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+	}
+
+	void BlockCompressor::Compress(const Image& source, Format format, Quality quality, uint32_t firstRow, uint32_t rowCount,
+		uint8_t* destination, size_t rowPitch)
+	{
+		const Effort effort = GetEffort(quality);
+		const size_t blockSize = GetBlockSize(format);
+		const uint32_t columns = GetBlockCount(source.width);
+
+		Texels texels;
+		for (uint32_t row = firstRow; row < firstRow + rowCount; ++row)
+		{
+			uint8_t* block = destination + (row - firstRow) * rowPitch;
+			for (uint32_t column = 0; column < columns; ++column, block += blockSize)
+			{
+				LoadTexels(source, column, row, texels);
+				switch (format)
+				{
+				case Format::BC1:
+					EncodeBc1(texels, effort, block);
+					break;
+				case Format::BC3:
+					EncodeBc4(texels, 3, effort, block);
+					EncodeBc1(texels, effort, block + 8);
+					break;
+				case Format::BC4:
+					EncodeBc4(texels, 0, effort, block);
+					break;
+				case Format::BC5:
+					EncodeBc4(texels, 0, effort, block);
+					EncodeBc4(texels, 1, effort, block + 8);
+					break;
+				case Format::BC7:
+					EncodeBc7(texels, effort, block);
+					break;
+				}
+			}
+		}
+	}
+
+	void BlockCompressor::Decompress(Format format, const uint8_t* block, uint8_t texels[64])
+	{
+		switch (format)
+		{
+		case Format::BC1:
+			DecodeBc1(block, false, texels);
+			break;
+		case Format::BC3:
+			DecodeBc1(block + 8, true, texels);
+			DecodeBc4(block, 3, texels);
+			break;
+		case Format::BC4:
+			memset(texels, 0, 64);
+			DecodeBc4(block, 0, texels);
+			for (uint32_t i = 0; i < 16; ++i)
+				texels[i * 4 + 3] = 255;
+			break;
+		case Format::BC5:
+			memset(texels, 0, 64);
+			DecodeBc4(block, 0, texels);
+			DecodeBc4(block + 8, 1, texels);
+			for (uint32_t i = 0; i < 16; ++i)
+				texels[i * 4 + 3] = 255;
+			break;
+		case Format::BC7:
+			DecodeBc7(block, texels);
+			break;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Encodes 8-bit RGBA or BGRA images into BC1, BC3, BC4, BC5 and BC7 blocks on the cpu. Every block
+	// is encoded on its own from the 4x4 texels it covers, texels past the right and bottom edge repeat
+	// the last column and row, so callers split an image into bands of block rows and encode them on as
+	// many threads as they like. Endpoints are fitted along the principal axis of the texels and refined
+	// by least squares against the decoded palette, the nearest palette entries of four texels at a time
+	// are found with SSE. Errors are measured on the stored bytes, sRGB color is not linearized.
+	class BlockCompressor
+	{
+	public:
+		enum class Format : uint8_t
+		{
+			// RGB, 4 bits per texel, alpha is dropped.
+			BC1,
+			// BC1 color and a BC4 alpha, 8 bits per texel.
+			BC3,
+			// The red channel, 4 bits per texel.
+			BC4,
+			// Red and green each as BC4, 8 bits per texel, for normal maps.
+			BC5,
+			// RGBA with eight block modes and partitions, 8 bits per texel.
+			BC7,
+		};
+
+		enum class Quality : uint8_t
+		{
+			// One refinement and only the cheapest modes of BC7, for a quick iteration on assets.
+			FAST,
+			// A few of the best estimated two subset BC7 partitions, the default for imports.
+			NORMAL,
+			// More BC7 modes and partitions and more refinement, several times slower than NORMAL.
+			HIGH,
+		};
+
+		struct Image
+		{
+			uint32_t width;
+			uint32_t height;
+			size_t rowPitch;
+			const uint8_t* pixels;
+			// Texels are stored as BGRA instead of RGBA.
+			bool bBgra;
+		};
+
+		// Bytes of one 4x4 block, 8 for BC1 and BC4 and 16 for the others.
+		static size_t GetBlockSize(Format format);
+
+		// Blocks along a side of size texels.
+		static uint32_t GetBlockCount(uint32_t size) { return (size + 3) / 4; }
+
+		// Encodes the block rows [firstRow, firstRow + rowCount) of source, block row r is written
+		// rowPitch bytes after row r - 1 starting at destination.
+		static void Compress(const Image& source, Format format, Quality quality, uint32_t firstRow, uint32_t rowCount,
+			uint8_t* destination, size_t rowPitch);
+
+		// Decodes one block to 16 RGBA texels in rows, missing channels are 0 and alpha 255 as a gpu
+		// samples them. BC1 and BC3 interpolate like the D3D reference, a gpu may round by one.
+		static void Decompress(Format format, const uint8_t* block, uint8_t texels[64]);
+	};
+}
@@ -0,0 +1,488 @@
+#include "pch.h"
+#include "Common/BoundingVolumeHierarchy.h"
+#include <immintrin.h>
+
+namespace Amadeus
+{
+	// Centroids are binned along every axis, more bins find better splits but cost more to build.
+	// Small nodes use one bin per item, sweeping empty bins costs more than binning their items.
+	static constexpr uint32_t BinCount = 16;
+	// Cost of visiting a node relative to testing the box of an item.
+	static constexpr float TraversalCost = 1.0f;
+
+	// Bounds while building and refitting, in SSE registers with the last lane unused.
+	struct Bounds
+	{
+		__m128 minimum = _mm_set1_ps((std::numeric_limits<float>::max)());
+		__m128 maximum = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+		void Grow(__m128 low, __m128 high)
+		{
+			minimum = _mm_min_ps(minimum, low);
+			maximum = _mm_max_ps(maximum, high);
+		}
+
+		void Grow(const Bounds& bounds) { Grow(bounds.minimum, bounds.maximum); }
+
+		void Grow(const float low[3], const float high[3])
+		{
+			Grow(_mm_setr_ps(low[0], low[1], low[2], 0.0f), _mm_setr_ps(high[0], high[1], high[2], 0.0f));
+		}
+
+		void Store(float low[3], float high[3]) const
+		{
+			float values[4];
+			_mm_storeu_ps(values, minimum);
+			memcpy(low, values, sizeof(float) * 3);
+			_mm_storeu_ps(values, maximum);
+			memcpy(high, values, sizeof(float) * 3);
+		}
+
+		// Half the surface area, the probability of a random ray hitting the box is proportional to it.
+		float Area() const
+		{
+			float extent[4];
+			_mm_storeu_ps(extent, _mm_sub_ps(maximum, minimum));
+			const float x = extent[0];
+			const float y = extent[1];
+			const float z = extent[2];
+			return (x < 0.0f || y < 0.0f || z < 0.0f) ? 0.0f : x * y + y * z + z * x;
+		}
+	};
+
+	// Build input, kept together so that partitioning moves whole items.
+	struct BoundingVolumeHierarchy::BuildItem
+	{
+		Bounds bounds;
+		float centroid[3];
+		uint32_t item;
+	};
+
+	// Same arithmetic as the binning loop, so that partitioning puts every item on the side of its bin.
+	static uint32_t GetBin(float centroid, float low, float scale, uint32_t binCount)
+	{
+		return static_cast<uint32_t>((std::min)((centroid - low) * scale, static_cast<float>(binCount - 1)));
+	}
+
+	static void GetBox(const FrustumCuller::Boxes& boxes, uint32_t index, float minimum[3], float maximum[3])
+	{
+		minimum[0] = boxes.minX[index];
+		minimum[1] = boxes.minY[index];
+		minimum[2] = boxes.minZ[index];
+		maximum[0] = boxes.maxX[index];
+		maximum[1] = boxes.maxY[index];
+		maximum[2] = boxes.maxZ[index];
+	}
+
+	// Distance along the ray to the box, or infinity when it misses before distance.
+	static float IntersectBox(const float minimum[3], const float maximum[3], const float origin[3], const float inverse[3], float distance)
+	{
+		float enter = 0.0f;
+		float exit = distance;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float t0 = (minimum[axis] - origin[axis]) * inverse[axis];
+			const float t1 = (maximum[axis] - origin[axis]) * inverse[axis];
+			enter = (std::max)(enter, (std::min)(t0, t1));
+			exit = (std::min)(exit, (std::max)(t0, t1));
+		}
+		return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+	}
+
+	void BoundingVolumeHierarchy::Build(const FrustumCuller::Boxes& boxes)
+	{
+		const uint32_t count = static_cast<uint32_t>(boxes.Size());
+		mNodes.clear();
+		mParents.clear();
+		mSubtreeFirsts.clear();
+		mSubtreeEnds.clear();
+		mItems.resize(count);
+		if (count == 0)
+		{
+			mItemSlots.clear();
+			mSlotLeaves.clear();
+			mBoxes.Clear();
+			return;
+		}
+
+		std::vector<BuildItem> items(count);
+		for (uint32_t item = 0; item < count; ++item)
+		{
+			BuildItem& buildItem = items[item];
+			float minimum[3], maximum[3];
+			GetBox(boxes, item, minimum, maximum);
+			buildItem.bounds.Grow(minimum, maximum);
+			for (int axis = 0; axis < 3; ++axis)
+				buildItem.centroid[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+			buildItem.item = item;
+		}
+
+		// A binary tree with single item leaves has 2n - 1 nodes, nodes never move while building.
+		mNodes.reserve(count * 2 - 1);
+		mParents.reserve(count * 2 - 1);
+		mNodes.push_back({ {}, 0, {}, count });
+		mParents.push_back(~0u);
+		Subdivide(0, items.data());
+		for (uint32_t slot = 0; slot < count; ++slot)
+			mItems[slot] = items[slot].item;
+
+		mBoxes.Clear();
+		mItemSlots.resize(count);
+		mSlotLeaves.resize(count);
+		for (uint32_t slot = 0; slot < count; ++slot)
+		{
+			float minimum[3], maximum[3];
+			GetBox(boxes, mItems[slot], minimum, maximum);
+			mBoxes.Add(minimum, maximum);
+			mItemSlots[mItems[slot]] = slot;
+		}
+		for (uint32_t node = 0; node < mNodes.size(); ++node)
+		{
+			for (uint32_t i = 0; i < mNodes[node].count; ++i)
+				mSlotLeaves[mNodes[node].first + i] = node;
+		}
+
+		// Subtrees cover contiguous slots, from the first slot of their leftmost leaf to the end of their rightmost.
+		mSubtreeFirsts.resize(mNodes.size());
+		mSubtreeEnds.resize(mNodes.size());
+		for (size_t node = mNodes.size(); node-- > 0;)
+		{
+			const Node& current = mNodes[node];
+			mSubtreeFirsts[node] = current.count > 0 ? current.first : mSubtreeFirsts[current.first];
+			mSubtreeEnds[node] = current.count > 0 ? current.first + current.count : mSubtreeEnds[current.first + 1];
+		}
+	}
+
+	void BoundingVolumeHierarchy::Subdivide(uint32_t node, BuildItem* items)
+	{
+		const uint32_t first = mNodes[node].first;
+		const uint32_t count = mNodes[node].count;
+		BuildItem* begin = items + first;
+		BuildItem* end = begin + count;
+
+		Bounds bounds;
+		Bounds centroidBounds;
+		for (const BuildItem* item = begin; item != end; ++item)
+		{
+			bounds.Grow(item->bounds);
+			const __m128 centroid = _mm_loadu_ps(item->centroid);
+			centroidBounds.Grow(centroid, centroid);
+		}
+		bounds.Store(mNodes[node].minimum, mNodes[node].maximum);
+
+		if (count == 1)
+			return;
+
+		// Every axis is binned in the same pass over the items.
+		const uint32_t binCount = (std::min)(BinCount, count);
+		float low[3], high[3];
+		centroidBounds.Store(low, high);
+		float scales[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float extent = high[axis] - low[axis];
+			scales[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+		}
+
+		Bounds bins[3][BinCount];
+		uint32_t binCounts[3][BinCount] = {};
+		const __m128 binLow = centroidBounds.minimum;
+		const __m128 binScale = _mm_setr_ps(scales[0], scales[1], scales[2], 0.0f);
+		const __m128 lastBin = _mm_set1_ps(static_cast<float>(binCount - 1));
+		for (const BuildItem* item = begin; item != end; ++item)
+		{
+			// The last lane holds the item, its bin is never used.
+			const __m128 position = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(item->centroid), binLow), binScale);
+			alignas(16) int32_t axisBins[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(axisBins), _mm_cvttps_epi32(_mm_min_ps(position, lastBin)));
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				bins[axis][axisBins[axis]].Grow(item->bounds);
+				++binCounts[axis][axisBins[axis]];
+			}
+		}
+
+		// Cheapest split over the bin boundaries of every axis, both sides weighted by their area.
+		int bestAxis = -1;
+		uint32_t bestBin = 0;
+		float bestCost = (std::numeric_limits<float>::max)();
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (scales[axis] == 0.0f)
+				continue;
+
+			float rightAreas[BinCount];
+			uint32_t rightCounts[BinCount];
+			Bounds right;
+			uint32_t rightCount = 0;
+			for (uint32_t bin = binCount - 1; bin > 0; --bin)
+			{
+				right.Grow(bins[axis][bin]);
+				rightCount += binCounts[axis][bin];
+				rightAreas[bin] = right.Area();
+				rightCounts[bin] = rightCount;
+			}
+
+			Bounds left;
+			uint32_t leftCount = 0;
+			for (uint32_t bin = 0; bin < binCount - 1; ++bin)
+			{
+				left.Grow(bins[axis][bin]);
+				leftCount += binCounts[axis][bin];
+				if (leftCount == 0 || rightCounts[bin + 1] == 0)
+					continue;
+
+				const float cost = left.Area() * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+
+		const float area = bounds.Area();
+		const float splitCost = area > 0.0f ? TraversalCost + bestCost / area : TraversalCost;
+		if (count <= MaxLeafSize && (bestAxis < 0 || splitCost >= static_cast<float>(count)))
+			return;
+
+		BuildItem* middle;
+		if (bestAxis >= 0)
+		{
+			middle = std::partition(begin, end, [&](const BuildItem& item) {
+				return GetBin(item.centroid[bestAxis], low[bestAxis], scales[bestAxis], binCount) <= bestBin;
+			});
+		}
+		else
+		{
+			// Every centroid in the same place, halve the items so that the leaves stay small.
+			middle = begin + count / 2;
+		}
+
+		const uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+		const uint32_t left = static_cast<uint32_t>(mNodes.size());
+		mNodes.push_back({ {}, first, {}, leftCount });
+		mNodes.push_back({ {}, first + leftCount, {}, count - leftCount });
+		mParents.push_back(node);
+		mParents.push_back(node);
+		mNodes[node].first = left;
+		mNodes[node].count = 0;
+
+		Subdivide(left, items);
+		Subdivide(left + 1, items);
+	}
+
+	void BoundingVolumeHierarchy::CopyBox(const FrustumCuller::Boxes& boxes, uint32_t slot)
+	{
+		const uint32_t item = mItems[slot];
+		mBoxes.minX[slot] = boxes.minX[item];
+		mBoxes.minY[slot] = boxes.minY[item];
+		mBoxes.minZ[slot] = boxes.minZ[item];
+		mBoxes.maxX[slot] = boxes.maxX[item];
+		mBoxes.maxY[slot] = boxes.maxY[item];
+		mBoxes.maxZ[slot] = boxes.maxZ[item];
+	}
+
+	void BoundingVolumeHierarchy::UpdateLeaf(uint32_t node)
+	{
+		Bounds bounds;
+		for (uint32_t slot = mNodes[node].first; slot < mNodes[node].first + mNodes[node].count; ++slot)
+		{
+			float minimum[3], maximum[3];
+			GetBox(mBoxes, slot, minimum, maximum);
+			bounds.Grow(minimum, maximum);
+		}
+		bounds.Store(mNodes[node].minimum, mNodes[node].maximum);
+	}
+
+	bool BoundingVolumeHierarchy::UpdateInterior(uint32_t node)
+	{
+		const Node& left = mNodes[mNodes[node].first];
+		const Node& right = mNodes[mNodes[node].first + 1];
+		Bounds bounds;
+		bounds.Grow(left.minimum, left.maximum);
+		bounds.Grow(right.minimum, right.maximum);
+
+		float minimum[3], maximum[3];
+		bounds.Store(minimum, maximum);
+
+		Node& parent = mNodes[node];
+		if (memcmp(parent.minimum, minimum, sizeof(minimum)) == 0 && memcmp(parent.maximum, maximum, sizeof(maximum)) == 0)
+		{
+			return false;
+		}
+		memcpy(parent.minimum, minimum, sizeof(minimum));
+		memcpy(parent.maximum, maximum, sizeof(maximum));
+		return true;
+	}
+
+	void BoundingVolumeHierarchy::Refit(const FrustumCuller::Boxes& boxes)
+	{
+		assert(boxes.Size() == mItems.size());
+
+		for (uint32_t slot = 0; slot < mItems.size(); ++slot)
+		{
+			CopyBox(boxes, slot);
+		}
+
+		// Children always come after their parent.
+		for (size_t node = mNodes.size(); node-- > 0;)
+		{
+			if (mNodes[node].count > 0)
+				UpdateLeaf(static_cast<uint32_t>(node));
+			else
+				UpdateInterior(static_cast<uint32_t>(node));
+		}
+	}
+
+	void BoundingVolumeHierarchy::Refit(const FrustumCuller::Boxes& boxes, const uint32_t* items, size_t count)
+	{
+		assert(boxes.Size() == mItems.size());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t slot = mItemSlots[items[i]];
+			CopyBox(boxes, slot);
+
+			uint32_t node = mSlotLeaves[slot];
+			UpdateLeaf(node);
+			// Above a node that kept its box nothing changes.
+			for (node = mParents[node]; node != ~0u && UpdateInterior(node); node = mParents[node]);
+		}
+	}
+
+	void BoundingVolumeHierarchy::Cull(const FrustumCuller::Frustum& frustum, std::vector<uint32_t>& visible) const
+	{
+		if (mNodes.empty())
+			return;
+
+		// Planes a node is entirely inside of are not tested again below it.
+		constexpr uint32_t AllPlanes = (1u << 6) - 1;
+		std::vector<std::pair<uint32_t, uint32_t>> stack;
+		stack.emplace_back(0, AllPlanes);
+		while (!stack.empty())
+		{
+			const uint32_t index = stack.back().first;
+			uint32_t planes = stack.back().second;
+			stack.pop_back();
+
+			const Node& node = mNodes[index];
+			bool outside = false;
+			for (int plane = 0; plane < 6 && !outside; ++plane)
+			{
+				if (!(planes & (1u << plane)))
+					continue;
+
+				const float* p = frustum.planes[plane];
+				float furthest = p[3];
+				float nearest = p[3];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					furthest += p[axis] * (p[axis] >= 0.0f ? node.maximum[axis] : node.minimum[axis]);
+					nearest += p[axis] * (p[axis] >= 0.0f ? node.minimum[axis] : node.maximum[axis]);
+				}
+				outside = furthest < 0.0f;
+				if (nearest >= 0.0f)
+					planes &= ~(1u << plane);
+			}
+			if (outside)
+				continue;
+
+			if (planes == 0)
+			{
+				visible.insert(visible.end(), mItems.begin() + mSubtreeFirsts[index], mItems.begin() + mSubtreeEnds[index]);
+				continue;
+			}
+
+			if (node.count == 0)
+			{
+				stack.emplace_back(node.first + 1, planes);
+				stack.emplace_back(node.first, planes);
+				continue;
+			}
+
+			uint8_t inside[MaxLeafSize];
+			FrustumCuller::Cull(frustum, mBoxes, node.first, node.count, inside);
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				if (inside[i])
+					visible.push_back(mItems[node.first + i]);
+			}
+		}
+	}
+
+	uint32_t BoundingVolumeHierarchy::Raycast(const float origin[3], const float direction[3], float& distance, const IntersectItem& intersect) const
+	{
+		if (mNodes.empty())
+			return ~0u;
+
+		// A huge finite value instead of infinity, so that rays in a slab plane never produce NaN.
+		float inverse[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			inverse[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis]
+				: (std::signbit(direction[axis]) ? std::numeric_limits<float>::lowest() : (std::numeric_limits<float>::max)());
+		}
+
+		uint32_t hit = ~0u;
+		std::vector<std::pair<uint32_t, float>> stack;
+		const float rootDistance = IntersectBox(mNodes[0].minimum, mNodes[0].maximum, origin, inverse, distance);
+		if (rootDistance < distance)
+			stack.emplace_back(0, rootDistance);
+
+		while (!stack.empty())
+		{
+			const uint32_t index = stack.back().first;
+			const float entry = stack.back().second;
+			stack.pop_back();
+			if (entry >= distance)
+				continue;
+
+			const Node& node = mNodes[index];
+			if (node.count > 0)
+			{
+				for (uint32_t slot = node.first; slot < node.first + node.count; ++slot)
+				{
+					float minimum[3], maximum[3];
+					GetBox(mBoxes, slot, minimum, maximum);
+					if (IntersectBox(minimum, maximum, origin, inverse, distance) < distance && intersect(mItems[slot], distance))
+						hit = mItems[slot];
+				}
+				continue;
+			}
+
+			const Node& left = mNodes[node.first];
+			const Node& right = mNodes[node.first + 1];
+			const float leftDistance = IntersectBox(left.minimum, left.maximum, origin, inverse, distance);
+			const float rightDistance = IntersectBox(right.minimum, right.maximum, origin, inverse, distance);
+
+			// The nearer child is popped first.
+			const bool leftFirst = leftDistance <= rightDistance;
+			const float nearDistance = leftFirst ? leftDistance : rightDistance;
+			const float farDistance = leftFirst ? rightDistance : leftDistance;
+			if (farDistance < distance)
+				stack.emplace_back(leftFirst ? node.first + 1 : node.first, farDistance);
+			if (nearDistance < distance)
+				stack.emplace_back(leftFirst ? node.first : node.first + 1, nearDistance);
+		}
+		return hit;
+	}
+
+	float BoundingVolumeHierarchy::ComputeCost() const
+	{
+		if (mNodes.empty())
+			return 0.0f;
+
+		Bounds root;
+		root.Grow(mNodes[0].minimum, mNodes[0].maximum);
+		double cost = 0.0;
+		for (const Node& node : mNodes)
+		{
+			Bounds bounds;
+			bounds.Grow(node.minimum, node.maximum);
+			cost += bounds.Area() * (node.count > 0 ? static_cast<float>(node.count) : TraversalCost);
+		}
+		return root.Area() > 0.0f ? static_cast<float>(cost / root.Area()) : 0.0f;
+	}
+}
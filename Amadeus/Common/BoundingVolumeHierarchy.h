@@ -0,0 +1,72 @@
+#pragma once
+#include "Common/FrustumCuller.h"
+
+namespace Amadeus
+{
+	// Binary tree over the world bounds of scene items, built with the surface area heuristic and
+	// stored as a flat array of 32 byte nodes with siblings next to each other. Items are the indices
+	// of the boxes passed to Build, leaves keep copies of their boxes in tree order.
+	class BoundingVolumeHierarchy
+	{
+	public:
+		struct Node
+		{
+			float minimum[3];
+			// First child of an interior node, the second one follows it. First slot of a leaf.
+			uint32_t first;
+			float maximum[3];
+			// Items of a leaf, 0 for interior nodes.
+			uint32_t count;
+		};
+		static_assert(sizeof(Node) == 32, "Two nodes per cache line");
+
+		static constexpr uint32_t MaxLeafSize = 4;
+
+		// Called with the item and the closest hit so far, returns whether it found a closer one and updated distance.
+		typedef std::function<bool(uint32_t item, float& distance)> IntersectItem;
+
+		void Build(const FrustumCuller::Boxes& boxes);
+
+		// Refits every node after any number of boxes moved, the tree keeps its topology.
+		void Refit(const FrustumCuller::Boxes& boxes);
+
+		// Refits only the paths from the leaves of the given items to the root.
+		void Refit(const FrustumCuller::Boxes& boxes, const uint32_t* items, size_t count);
+
+		// Appends the items whose boxes are at least partly inside the frustum.
+		void Cull(const FrustumCuller::Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+		// Visits the items whose boxes the ray hits before distance, nearest nodes first, and returns
+		// the item intersect reported the closest hit for, or ~0u.
+		uint32_t Raycast(const float origin[3], const float direction[3], float& distance, const IntersectItem& intersect) const;
+
+		size_t Size() const { return mItems.size(); }
+
+		const std::vector<Node>& GetNodes() const { return mNodes; }
+
+		// Sum of the areas of the nodes over the area of the root, weighted like the build weighs them.
+		float ComputeCost() const;
+
+	private:
+		struct BuildItem;
+
+		std::vector<Node> mNodes;
+		std::vector<uint32_t> mParents;
+		// Item of every slot, slots are the items in leaf order.
+		std::vector<uint32_t> mItems;
+		std::vector<uint32_t> mItemSlots;
+		std::vector<uint32_t> mSlotLeaves;
+		// Slots under every node, a node entirely inside a frustum takes them all at once.
+		std::vector<uint32_t> mSubtreeFirsts;
+		std::vector<uint32_t> mSubtreeEnds;
+		FrustumCuller::Boxes mBoxes;
+
+		void Subdivide(uint32_t node, BuildItem* items);
+
+		void CopyBox(const FrustumCuller::Boxes& boxes, uint32_t slot);
+
+		void UpdateLeaf(uint32_t node);
+
+		bool UpdateInterior(uint32_t node);
+	};
+}
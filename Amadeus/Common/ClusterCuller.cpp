@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "Common/ClusterCuller.h"
+
+namespace Amadeus
+{
+	// Scales this close to each other still count as uniform for the normal cone.
+	static constexpr float UniformScaleTolerance = 1.001f;
+
+	ClusterCuller::View ClusterCuller::CreateView(const float viewProjection[4][4], const float position[3])
+	{
+		View view;
+		view.frustum = FrustumCuller::CreateFrustum(viewProjection);
+		memcpy(view.position, position, sizeof(view.position));
+		return view;
+	}
+
+	void ClusterCuller::Cull(const MeshletBuilder::Meshlet* meshlets, size_t count, const float world[4][4],
+		const View& view, bool coneCulling, uint32_t mergeGap, std::vector<DrawRange>& ranges, Statistics& statistics)
+	{
+		float scales[3];
+		for (int row = 0; row < 3; ++row)
+		{
+			scales[row] = std::sqrt(world[row][0] * world[row][0] + world[row][1] * world[row][1] + world[row][2] * world[row][2]);
+		}
+		const float maxScale = (std::max)({ scales[0], scales[1], scales[2] });
+		const float minScale = (std::min)({ scales[0], scales[1], scales[2] });
+
+		// Under uniform scale the normals transform like directions, mirrored when the determinant is negative.
+		const float determinant =
+			world[0][0] * (world[1][1] * world[2][2] - world[1][2] * world[2][1]) -
+			world[0][1] * (world[1][0] * world[2][2] - world[1][2] * world[2][0]) +
+			world[0][2] * (world[1][0] * world[2][1] - world[1][1] * world[2][0]);
+		const bool useCones = coneCulling && minScale > 0.0f && maxScale <= minScale * UniformScaleTolerance;
+		const float mirror = determinant < 0.0f ? -1.0f : 1.0f;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const MeshletBuilder::Meshlet& meshlet = meshlets[i];
+			const size_t triangles = meshlet.indexCount / 3;
+			++statistics.meshlets;
+			statistics.triangles += triangles;
+
+			float center[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				center[axis] = meshlet.center[0] * world[0][axis] + meshlet.center[1] * world[1][axis]
+					+ meshlet.center[2] * world[2][axis] + world[3][axis];
+			}
+			const float radius = meshlet.radius * maxScale;
+
+			bool visible = true;
+			for (int plane = 0; plane < 6 && visible; ++plane)
+			{
+				const float* p = view.frustum.planes[plane];
+				visible = p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] >= -radius;
+			}
+			if (!visible)
+			{
+				++statistics.frustumCulled;
+				statistics.trianglesCulled += triangles;
+				continue;
+			}
+
+			// Every triangle faces away when the camera lies outside the cone widened by the sphere.
+			if (useCones && meshlet.coneCutoff < 1.0f)
+			{
+				float axis[3];
+				for (int j = 0; j < 3; ++j)
+				{
+					axis[j] = mirror * (meshlet.coneAxis[0] * world[0][j] + meshlet.coneAxis[1] * world[1][j] + meshlet.coneAxis[2] * world[2][j]) / maxScale;
+				}
+
+				const float direction[3] = { center[0] - view.position[0], center[1] - view.position[1], center[2] - view.position[2] };
+				const float distance = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+				if (direction[0] * axis[0] + direction[1] * axis[1] + direction[2] * axis[2] >= meshlet.coneCutoff * distance + radius)
+				{
+					++statistics.coneCulled;
+					statistics.trianglesCulled += triangles;
+					continue;
+				}
+			}
+
+			// Culled meshlets in between are drawn anyway when they are cheaper than another draw.
+			const uint32_t rangeEnd = ranges.empty() ? 0 : ranges.back().firstIndex + ranges.back().indexCount;
+			if (!ranges.empty() && meshlet.firstIndex - rangeEnd <= mergeGap)
+			{
+				statistics.trianglesCulled -= (meshlet.firstIndex - rangeEnd) / 3;
+				ranges.back().indexCount = meshlet.firstIndex + meshlet.indexCount - ranges.back().firstIndex;
+			}
+			else
+			{
+				ranges.push_back({ meshlet.indexCount, meshlet.firstIndex });
+				++statistics.draws;
+			}
+		}
+	}
+}
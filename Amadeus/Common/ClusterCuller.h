@@ -0,0 +1,49 @@
+#pragma once
+#include "Common/MeshletBuilder.h"
+#include "Common/FrustumCuller.h"
+
+namespace Amadeus
+{
+	// Rejects meshlets outside the view frustum or facing away from the camera, and merges the
+	// survivors that are adjacent in the index buffer into as few indexed draws as possible.
+	// Matrices use the DirectXMath convention, row vectors and clip depth in [0, 1].
+	class ClusterCuller
+	{
+	public:
+		struct View
+		{
+			FrustumCuller::Frustum frustum;
+			float position[3];
+		};
+
+		// One indexed draw of a single instance.
+		struct DrawRange
+		{
+			uint32_t indexCount;
+			uint32_t firstIndex;
+		};
+
+		struct Statistics
+		{
+			size_t meshlets = 0;
+			size_t frustumCulled = 0;
+			size_t coneCulled = 0;
+			size_t triangles = 0;
+			// Triangles left out of every range, culled meshlets swallowed by a merge are drawn.
+			size_t trianglesCulled = 0;
+			size_t draws = 0;
+		};
+
+		static View CreateView(const float viewProjection[4][4], const float position[3]);
+
+		// Default for the merge gap, a range swallows up to one full meshlet of culled indices.
+		static constexpr uint32_t DefaultMergeGap = MeshletBuilder::MaxTriangles * 3;
+
+		// World is the object to world matrix of the meshlets, which are in index order. Cone culling
+		// has to be off for double-sided geometry, it is skipped on its own under non-uniform scale.
+		// Visible meshlets at most mergeGap indices after the last range extend it, ranges has to be
+		// cleared between index buffers.
+		static void Cull(const MeshletBuilder::Meshlet* meshlets, size_t count, const float world[4][4],
+			const View& view, bool coneCulling, uint32_t mergeGap, std::vector<DrawRange>& ranges, Statistics& statistics);
+	};
+}
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "Common/DependencyGraph.h"
+
+namespace Amadeus
+{
+	DependencyGraph::DependencyGraph() noexcept
+	{
+		mNodes.reserve(8);
+		mEdges.reserve(16);
+	}
+
+	DependencyGraph::Edge::Edge(DependencyGraph& graph, Node* from, Node* to) noexcept
+		: from(from->GetId())
+		, to(to->GetId())
+	{
+		assert(graph.mNodes[this->from] == from);
+		assert(graph.mNodes[this->to] == to);
+		graph.Link(this);
+	}
+
+	DependencyGraph::Node::Node(DependencyGraph& graph) noexcept
+		: mId(graph.GenerateNodeId())
+	{
+		graph.RegisterNode(this, mId);
+	}
+
+	DependencyGraph::Node* DependencyGraph::GetNode(NodeId id) noexcept
+	{
+		return mNodes[id];
+	}
+
+	const DependencyGraph::Node* DependencyGraph::GetNode(NodeId id) const noexcept
+	{
+		return mNodes[id];
+	}
+
+	DependencyGraph::EdgeSpan DependencyGraph::GetIncomingEdges(const Node* node) noexcept
+	{
+		BuildAdjacency();
+		const NodeId nodeId = node->GetId();
+		const uint32_t first = mIncomingOffsets[nodeId];
+		return EdgeSpan(mIncoming.data() + first, mIncomingOffsets[nodeId + 1] - first);
+	}
+
+	DependencyGraph::EdgeSpan DependencyGraph::GetOutgoingEdges(const Node* node) noexcept
+	{
+		BuildAdjacency();
+		const NodeId nodeId = node->GetId();
+		const uint32_t first = mOutgoingOffsets[nodeId];
+		return EdgeSpan(mOutgoing.data() + first, mOutgoingOffsets[nodeId + 1] - first);
+	}
+
+	void DependencyGraph::ClearEdges() noexcept
+	{
+		mEdges.clear();
+		bAdjacencyDirty = true;
+	}
+
+	void DependencyGraph::Cull() noexcept
+	{
+		BuildAdjacency();
+
+		// Start from scratch every time, only the target bit survives.
+		for (auto& node : mNodes)
+		{
+			node->mRefCount &= Node::TARGET;
+			node->mRefCount += mOutgoingOffsets[node->mId + 1] - mOutgoingOffsets[node->mId];
+		}
+
+		NodeContainer stack;
+		stack.reserve(mNodes.size());
+		std::copy_if(mNodes.begin(), mNodes.end(),
+			std::back_insert_iterator<NodeContainer>(stack),
+			[](auto node) { return node->mRefCount == 0; });
+
+		while (!stack.empty())
+		{
+			Node* node = stack.back();
+			stack.pop_back();
+			for (auto& edge : GetIncomingEdges(node))
+			{
+				Node* from = GetNode(edge->from);
+				if (--from->mRefCount == 0)
+				{
+					stack.push_back(from);
+				}
+			}
+		}
+	}
+
+	bool DependencyGraph::IsEdgeValid(const Edge* edge) const noexcept
+	{
+		const Node* from = GetNode(edge->from);
+		const Node* to = GetNode(edge->to);
+		return !from->IsCulled() && !to->IsCulled();
+	}
+
+	bool DependencyGraph::IsAcyclic() noexcept
+	{
+		BuildAdjacency();
+
+		// Kahn's algorithm: a graph is acyclic if every node can be removed once
+		// all of its incoming edges have been removed.
+		std::vector<uint32_t> inDegrees(mNodes.size());
+		NodeContainer stack;
+		stack.reserve(mNodes.size());
+		for (auto& node : mNodes)
+		{
+			inDegrees[node->mId] = mIncomingOffsets[node->mId + 1] - mIncomingOffsets[node->mId];
+			if (inDegrees[node->mId] == 0)
+				stack.push_back(node);
+		}
+
+		size_t visited = 0;
+		while (!stack.empty())
+		{
+			Node* node = stack.back();
+			stack.pop_back();
+			++visited;
+			for (auto& edge : GetOutgoingEdges(node))
+			{
+				if (--inDegrees[edge->to] == 0)
+					stack.push_back(GetNode(edge->to));
+			}
+		}
+
+		return visited == mNodes.size();
+	}
+
+	uint32_t DependencyGraph::GenerateNodeId() noexcept
+	{
+		return mNodes.size();
+	}
+
+	void DependencyGraph::RegisterNode(Node* node, [[maybe_unused]] NodeId id) noexcept
+	{
+		assert(id == mNodes.size());
+		mNodes.push_back(node);
+		bAdjacencyDirty = true;
+	}
+
+	void DependencyGraph::Link(Edge* edge) noexcept
+	{
+		mEdges.push_back(edge);
+		bAdjacencyDirty = true;
+	}
+
+	void DependencyGraph::BuildAdjacency() noexcept
+	{
+		if (!bAdjacencyDirty)
+			return;
+
+		const size_t nodeCount = mNodes.size();
+		mIncomingOffsets.assign(nodeCount + 1, 0);
+		mOutgoingOffsets.assign(nodeCount + 1, 0);
+
+		for (auto& edge : mEdges)
+		{
+			++mIncomingOffsets[edge->to + 1];
+			++mOutgoingOffsets[edge->from + 1];
+		}
+
+		for (size_t i = 0; i < nodeCount; ++i)
+		{
+			mIncomingOffsets[i + 1] += mIncomingOffsets[i];
+			mOutgoingOffsets[i + 1] += mOutgoingOffsets[i];
+		}
+
+		// Fill in edge order, so each node's edges keep the order they were linked in.
+		std::vector<uint32_t> incomingCursor(mIncomingOffsets.begin(), mIncomingOffsets.end() - 1);
+		std::vector<uint32_t> outgoingCursor(mOutgoingOffsets.begin(), mOutgoingOffsets.end() - 1);
+		mIncoming.resize(mEdges.size());
+		mOutgoing.resize(mEdges.size());
+		for (auto& edge : mEdges)
+		{
+			mIncoming[incomingCursor[edge->to]++] = edge;
+			mOutgoing[outgoingCursor[edge->from]++] = edge;
+		}
+
+		bAdjacencyDirty = false;
+	}
+
+}
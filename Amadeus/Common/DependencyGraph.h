@@ -1,5 +1,4 @@
 #pragma once
-#include "Prerequisites.h"
 
 namespace Amadeus
 {
@@ -50,23 +49,38 @@ namespace Amadeus
 
 		typedef std::vector<Edge*> EdgeContainer;
 		typedef std::vector<Node*> NodeContainer;
+		typedef std::span<Edge* const> EdgeSpan;
 
 		Node* GetNode(NodeId id) noexcept;
 		const Node* GetNode(NodeId id) const noexcept;
-		EdgeContainer GetIncomingEdges(const Node* node) noexcept;
-		EdgeContainer GetOutgoingEdges(const Node* node) noexcept;
+		size_t GetNodeCount() const noexcept { return mNodes.size(); }
+
+		// The spans stay valid until the next node or edge is added.
+		EdgeSpan GetIncomingEdges(const Node* node) noexcept;
+		EdgeSpan GetOutgoingEdges(const Node* node) noexcept;
+
+		// Edges are owned by whoever created them, the graph only forgets them.
+		void ClearEdges() noexcept;
 
 		void Cull() noexcept;
 
 		bool IsEdgeValid(const Edge* edge) const noexcept;
-		bool IsAcyclic() const noexcept;
+		bool IsAcyclic() noexcept;
 
 	private:
 		uint32_t GenerateNodeId() noexcept;
 		void RegisterNode(Node* node, NodeId id) noexcept;
 		void Link(Edge* edge) noexcept;
-		bool _IsAcyclic() const noexcept;
+		void BuildAdjacency() noexcept;
 		NodeContainer mNodes;
 		EdgeContainer mEdges;
+
+		// Adjacency in CSR layout: the edges of node i are
+		// mIncoming[mIncomingOffsets[i], mIncomingOffsets[i + 1]), same for outgoing.
+		EdgeContainer mIncoming;
+		EdgeContainer mOutgoing;
+		std::vector<uint32_t> mIncomingOffsets;
+		std::vector<uint32_t> mOutgoingOffsets;
+		bool bAdjacencyDirty = true;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "Common/DerivedDataCache.h"
+
+namespace Amadeus
+{
+	static constexpr uint32_t EntryMagic = 0x43444441;
+	static constexpr uint32_t EntryVersion = 1;
+
+	static double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	DerivedDataCache::DerivedDataCache(const std::filesystem::path& directory, uint64_t capacity)
+		: mDirectory(directory)
+		, mCapacity(capacity)
+	{
+		std::filesystem::create_directories(mDirectory);
+
+		// Ordered by write time, which hits refresh, the oldest are evicted first.
+		std::vector<std::pair<std::filesystem::file_time_type, std::pair<uint64_t, uint64_t>>> found;
+		for (const auto& file : std::filesystem::directory_iterator(mDirectory))
+		{
+			std::error_code error;
+			const auto path = file.path();
+			if (path.extension() == ".tmp")
+			{
+				// Left by a run that ended while it stored.
+				std::filesystem::remove(path, error);
+				continue;
+			}
+
+			const std::string stem = path.stem().string();
+			if (path.extension() != ".ddc" || stem.size() != 16 || stem.find_first_not_of("0123456789abcdef") != std::string::npos)
+				continue;
+
+			const uint64_t size = file.file_size(error);
+			const auto time = file.last_write_time(error);
+			if (!error)
+				found.push_back({ time, { std::stoull(stem, nullptr, 16), size } });
+		}
+		std::sort(found.begin(), found.end());
+
+		for (const auto& [time, entry] : found)
+		{
+			Entry& inserted = mEntries[entry.first];
+			inserted.size = entry.second;
+			inserted.lastUse = ++mClock;
+			mOrder[inserted.lastUse] = entry.first;
+			mSize += entry.second;
+		}
+		Evict();
+		mStatistics.evictions = 0;
+	}
+
+	bool DerivedDataCache::Fetch(uint64_t key, std::vector<uint8_t>& data, const std::function<void(std::vector<uint8_t>&)>& compute)
+	{
+		auto start = std::chrono::steady_clock::now();
+		double seconds = 0.0;
+		if (Load(key, data, seconds))
+		{
+			const double elapsed = SecondsSince(start);
+			std::lock_guard<std::mutex> lock(mLock);
+			++mStatistics.hits;
+			mStatistics.bytesRead += data.size();
+			mStatistics.secondsSaved += (std::max)(seconds - elapsed, 0.0);
+			return true;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			++mStatistics.misses;
+		}
+
+		data.clear();
+		start = std::chrono::steady_clock::now();
+		compute(data);
+		Store(key, data, SecondsSince(start));
+		return false;
+	}
+
+	void DerivedDataCache::Remove(uint64_t key)
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		Erase(key);
+	}
+
+	DerivedDataCache::Statistics DerivedDataCache::GetStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		return mStatistics;
+	}
+
+	uint64_t DerivedDataCache::GetSize() const
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		return mSize;
+	}
+
+	std::filesystem::path DerivedDataCache::GetPath(uint64_t key) const
+	{
+		char name[24];
+		snprintf(name, sizeof(name), "%016llx.ddc", static_cast<unsigned long long>(key));
+		return mDirectory / name;
+	}
+
+	bool DerivedDataCache::Load(uint64_t key, std::vector<uint8_t>& data, double& seconds)
+	{
+		uint64_t size = 0;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			auto entry = mEntries.find(key);
+			if (entry == mEntries.end())
+				return false;
+			size = entry->second.size;
+		}
+
+		// The file is read without the lock, an entry evicted meanwhile fails to open or is read whole.
+		const std::filesystem::path path = GetPath(key);
+		bool bValid = false;
+		{
+			std::ifstream file(path, std::ios::binary);
+			Header header = {};
+			if (file.read(reinterpret_cast<char*>(&header), sizeof(header))
+				&& header.magic == EntryMagic && header.version == EntryVersion && header.key == key
+				&& header.size == size - (std::min)(size, static_cast<uint64_t>(sizeof(Header))))
+			{
+				data.resize(static_cast<size_t>(header.size));
+				bValid = file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))
+					&& file.peek() == std::ifstream::traits_type::eof();
+				seconds = header.seconds;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mLock);
+		auto entry = mEntries.find(key);
+		if (!bValid)
+		{
+			// A truncated or foreign file is dropped and derived again.
+			if (entry != mEntries.end())
+				Erase(key);
+			data.clear();
+			return false;
+		}
+
+		if (entry != mEntries.end())
+		{
+			Touch(key, entry->second);
+		}
+		// Later runs order the entries by this time.
+		std::error_code error;
+		std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+		return true;
+	}
+
+	void DerivedDataCache::Store(uint64_t key, const std::vector<uint8_t>& data, double seconds)
+	{
+		const uint64_t size = sizeof(Header) + data.size();
+		if (size > mCapacity)
+			return;
+
+		const std::filesystem::path path = GetPath(key);
+		std::filesystem::path temporary = path;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			char suffix[32];
+			snprintf(suffix, sizeof(suffix), ".%llu.tmp", static_cast<unsigned long long>(++mTemporaries));
+			temporary += suffix;
+		}
+
+		// A cache that cannot be written only costs the time it would have saved.
+		std::error_code error;
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			const Header header = { EntryMagic, EntryVersion, key, data.size(), seconds };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			file.close();
+			if (!file)
+			{
+				std::filesystem::remove(temporary, error);
+				return;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mLock);
+		std::filesystem::rename(temporary, path, error);
+		if (error)
+		{
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+		// Stamped from the same clock as hits, file systems round their own times coarsely.
+		std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+		auto entry = mEntries.find(key);
+		if (entry != mEntries.end())
+		{
+			mSize -= entry->second.size;
+		}
+		else
+		{
+			entry = mEntries.insert({ key, { 0, 0 } }).first;
+		}
+		entry->second.size = size;
+		Touch(key, entry->second);
+		mSize += size;
+		mStatistics.bytesWritten += size;
+		Evict();
+	}
+
+	void DerivedDataCache::Touch(uint64_t key, Entry& entry)
+	{
+		mOrder.erase(entry.lastUse);
+		entry.lastUse = ++mClock;
+		mOrder[entry.lastUse] = key;
+	}
+
+	void DerivedDataCache::Evict()
+	{
+		while (mSize > mCapacity && !mOrder.empty())
+		{
+			Erase(mOrder.begin()->second);
+			++mStatistics.evictions;
+		}
+	}
+
+	void DerivedDataCache::Erase(uint64_t key)
+	{
+		auto entry = mEntries.find(key);
+		if (entry == mEntries.end())
+			return;
+
+		mSize -= entry->second.size;
+		mOrder.erase(entry->second.lastUse);
+		mEntries.erase(entry);
+
+		// A file still open for a load stays behind, the next run finds it again.
+		std::error_code error;
+		std::filesystem::remove(GetPath(key), error);
+	}
+}
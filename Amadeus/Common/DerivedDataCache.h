@@ -0,0 +1,85 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Data derived from imported sources, kept on disk between runs. An entry is found by a key the
+	// caller hashes from the source bytes and every setting the derivation depends on, so a changed
+	// source or setting simply misses and the stale entry ages out. Entries are files in one directory,
+	// written next to their name first and renamed, and the least recently used ones are deleted once
+	// the directory grows past its capacity. Safe to use from several threads.
+	class DerivedDataCache
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t evictions;
+			uint64_t bytesRead;
+			uint64_t bytesWritten;
+			// What the hits would have cost to derive minus what reading them cost.
+			double secondsSaved;
+		};
+
+		// Entries left by earlier runs are picked up, their last use is the time their file was written
+		// or last hit.
+		DerivedDataCache(const std::filesystem::path& directory, uint64_t capacity);
+		DerivedDataCache(const DerivedDataCache&) = delete;
+		DerivedDataCache& operator=(const DerivedDataCache&) = delete;
+
+		// Fills data from the entry of the key and returns true. Otherwise compute fills it, the result is
+		// stored and false is returned. An exception of compute leaves the cache as it was. Threads that
+		// miss the same key at the same time each compute it.
+		bool Fetch(uint64_t key, std::vector<uint8_t>& data, const std::function<void(std::vector<uint8_t>&)>& compute);
+
+		// Drops an entry the caller found unusable.
+		void Remove(uint64_t key);
+
+		Statistics GetStatistics() const;
+
+		uint64_t GetSize() const;
+
+	private:
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key;
+			uint64_t size;
+			// Time it took to derive the data.
+			double seconds;
+		};
+
+		struct Entry
+		{
+			uint64_t size;
+			uint64_t lastUse;
+		};
+
+		std::filesystem::path GetPath(uint64_t key) const;
+
+		bool Load(uint64_t key, std::vector<uint8_t>& data, double& seconds);
+
+		void Store(uint64_t key, const std::vector<uint8_t>& data, double seconds);
+
+		// Moves the entry to the most recently used end, the lock is held.
+		void Touch(uint64_t key, Entry& entry);
+
+		// Deletes the least recently used entries until the rest fit, the lock is held.
+		void Evict();
+
+		void Erase(uint64_t key);
+
+		std::filesystem::path mDirectory;
+		uint64_t mCapacity;
+
+		mutable std::mutex mLock;
+		std::map<uint64_t, Entry> mEntries;
+		// Keys by last use, the front is evicted first.
+		std::map<uint64_t, uint64_t> mOrder;
+		uint64_t mClock = 0;
+		uint64_t mSize = 0;
+		uint64_t mTemporaries = 0;
+		Statistics mStatistics = {};
+	};
+}
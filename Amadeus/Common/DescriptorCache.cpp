@@ -4,12 +4,10 @@
 namespace Amadeus
 {
 	DescriptorCache::DescriptorCache(std::shared_ptr<DeviceResources> device)
-		: mRtvCacheOffset(0)
+		: mCbvSrvUavRing(c_frameCount * CBV_SRV_UAV_CACHE_SIZE, CBV_SRV_UAV_CACHE_CHUNK_SIZE)
+		, mRtvCacheOffset(0)
 		, mDsvCacheOffset(0)
 	{
-		for (UINT i = 0; i < c_frameCount; ++i)
-			mCbvSrvUavCacheOffsets[i] = 0;
-
 		CreateCbvSrvUavCache(device);
 		CreateRtvCache(device);
 		CreateDsvCache(device);
@@ -25,126 +23,201 @@ namespace Amadeus
 	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorCache::AppendSrvCache(
 		std::shared_ptr<DeviceResources> device, const D3D12_CPU_DESCRIPTOR_HANDLE& srcHandle)
 	{
-		UINT curFrameIndex = device->GetCurrentFrameIndex();
-		assert(mCbvSrvUavCacheOffsets[curFrameIndex] + 1 <= CBV_SRV_UAV_CACHE_SIZE);
+		const UINT offset = ReserveCbvSrvUavCache();
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE dstHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-			mCbvSrvUavCaches[curFrameIndex]->GetCPUDescriptorHandleForHeapStart(), 
-			mCbvSrvUavCacheOffsets[curFrameIndex], 
+			mCbvSrvUavCache->GetCPUDescriptorHandleForHeapStart(),
+			offset,
 			mCbvSrvUavDescriptorSize);
 
 		device->GetD3DDevice()->CopyDescriptors(1, &dstHandle, nullptr, 1, &srcHandle, nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(
-			mCbvSrvUavCaches[curFrameIndex]->GetGPUDescriptorHandleForHeapStart(), 
-			mCbvSrvUavCacheOffsets[curFrameIndex], 
+			mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart(),
+			offset,
 			mCbvSrvUavDescriptorSize);
 
-		++mCbvSrvUavCacheOffsets[curFrameIndex];
-
 		return gpuHandle;
 	}
 
 	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorCache::AppendCbvCache(
 		std::shared_ptr<DeviceResources> device, const D3D12_CONSTANT_BUFFER_VIEW_DESC& cbvDesc)
 	{
-		UINT curFrameIndex = device->GetCurrentFrameIndex();
-		assert(mCbvSrvUavCacheOffsets[curFrameIndex] + 1 <= CBV_SRV_UAV_CACHE_SIZE);
+		const UINT offset = ReserveCbvSrvUavCache();
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-			mCbvSrvUavCaches[curFrameIndex]->GetCPUDescriptorHandleForHeapStart(),
-			mCbvSrvUavCacheOffsets[curFrameIndex],
+			mCbvSrvUavCache->GetCPUDescriptorHandleForHeapStart(),
+			offset,
 			mCbvSrvUavDescriptorSize);
 
 		device->GetD3DDevice()->CreateConstantBufferView(&cbvDesc, cpuHandle);
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(
-			mCbvSrvUavCaches[curFrameIndex]->GetGPUDescriptorHandleForHeapStart(),
-			mCbvSrvUavCacheOffsets[curFrameIndex],
+			mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart(),
+			offset,
 			mCbvSrvUavDescriptorSize);
 
-		++mCbvSrvUavCacheOffsets[curFrameIndex];
-
 		return gpuHandle;
 	}
 
 	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorCache::AppendSrvCache(
 		std::shared_ptr<DeviceResources> device, ID3D12Resource* renderTarget, const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc)
 	{
-		UINT curFrameIndex = device->GetCurrentFrameIndex();
-		assert(mCbvSrvUavCacheOffsets[curFrameIndex] + 1 <= CBV_SRV_UAV_CACHE_SIZE);
+		const UINT offset = ReserveCbvSrvUavCache();
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-			mCbvSrvUavCaches[curFrameIndex]->GetCPUDescriptorHandleForHeapStart(),
-			mCbvSrvUavCacheOffsets[curFrameIndex],
+			mCbvSrvUavCache->GetCPUDescriptorHandleForHeapStart(),
+			offset,
 			mCbvSrvUavDescriptorSize);
 
 		device->GetD3DDevice()->CreateShaderResourceView(renderTarget, &srvDesc, cpuHandle);
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(
-			mCbvSrvUavCaches[curFrameIndex]->GetGPUDescriptorHandleForHeapStart(),
-			mCbvSrvUavCacheOffsets[curFrameIndex],
+			mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart(),
+			offset,
 			mCbvSrvUavDescriptorSize);
 
-		++mCbvSrvUavCacheOffsets[curFrameIndex];
-
 		return gpuHandle;
 	}
 
+	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorCache::AppendSrvTable(
+		std::shared_ptr<DeviceResources> device, const D3D12_CPU_DESCRIPTOR_HANDLE* srcHandles, UINT count)
+	{
+		const UINT offset = ReserveCbvSrvUavCache(count);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dstHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+			mCbvSrvUavCache->GetCPUDescriptorHandleForHeapStart(),
+			offset,
+			mCbvSrvUavDescriptorSize);
+
+		// One destination range, the sources are single descriptors anywhere in the cpu heaps.
+		device->GetD3DDevice()->CopyDescriptors(1, &dstHandle, &count, count, srcHandles, nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(
+			mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart(),
+			offset,
+			mCbvSrvUavDescriptorSize);
+	}
+
 	CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorCache::AppendRtvCache(
 		std::shared_ptr<DeviceResources> device, ID3D12Resource* renderTarget, const D3D12_RENDER_TARGET_VIEW_DESC& rtvDesc)
 	{
-		assert(mRtvCacheOffset + 1 <= RTV_CACHE_SIZE);
+		const UINT offset = mRtvCacheOffset.fetch_add(1, std::memory_order_relaxed);
+		if (offset >= RTV_CACHE_SIZE)
+			throw std::runtime_error("DescriptorCache::AppendRtvCache Error");
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-			mRtvCache->GetCPUDescriptorHandleForHeapStart(), mRtvCacheOffset, mRtvDescriptorSize);
+			mRtvCache->GetCPUDescriptorHandleForHeapStart(), offset, mRtvDescriptorSize);
 
 		device->GetD3DDevice()->CreateRenderTargetView(renderTarget, &rtvDesc, cpuHandle);
 
-		++mRtvCacheOffset;
-
 		return cpuHandle;
 	}
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorCache::AppendDsvCache(
 		std::shared_ptr<DeviceResources> device, ID3D12Resource* depthStencil, const D3D12_DEPTH_STENCIL_VIEW_DESC& dsvDesc)
 	{
-		assert(mDsvCacheOffset + 1 <= DSV_CACHE_SIZE);
+		const UINT offset = mDsvCacheOffset.fetch_add(1, std::memory_order_relaxed);
+		if (offset >= DSV_CACHE_SIZE)
+			throw std::runtime_error("DescriptorCache::AppendDsvCache Error");
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-			mDsvCache->GetCPUDescriptorHandleForHeapStart(), mDsvCacheOffset, mDsvDescriptorSize);
+			mDsvCache->GetCPUDescriptorHandleForHeapStart(), offset, mDsvDescriptorSize);
 
 		device->GetD3DDevice()->CreateDepthStencilView(depthStencil, &dsvDesc, cpuHandle);
 
-		++mDsvCacheOffset;
-
 		return cpuHandle;
 	}
 
-	void DescriptorCache::Destroy()
+	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorCache::AllocatePersistentTable(
+		std::shared_ptr<DeviceResources> device, const D3D12_CPU_DESCRIPTOR_HANDLE* srcHandles, UINT count)
+	{
+		const UINT first = mPersistentTables.Allocate(count);
+		if (first == RangeAllocator::InvalidOffset)
+			throw std::runtime_error("DescriptorCache::AllocatePersistentTable Error");
+
+		const UINT offset = c_frameCount * CBV_SRV_UAV_CACHE_SIZE + first;
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dstHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+			mCbvSrvUavCache->GetCPUDescriptorHandleForHeapStart(),
+			offset,
+			mCbvSrvUavDescriptorSize);
+
+		// One destination range, the sources are single descriptors anywhere in the cpu heaps.
+		device->GetD3DDevice()->CopyDescriptors(1, &dstHandle, &count, count, srcHandles, nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(
+			mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart(),
+			offset,
+			mCbvSrvUavDescriptorSize);
+	}
+
+	void DescriptorCache::FreePersistentTable(const D3D12_GPU_DESCRIPTOR_HANDLE& handle, UINT count)
+	{
+		const UINT offset = static_cast<UINT>(
+			(handle.ptr - mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart().ptr) / mCbvSrvUavDescriptorSize);
+		mPersistentTables.Free(offset - c_frameCount * CBV_SRV_UAV_CACHE_SIZE, count);
+	}
+
+	void DescriptorCache::RetirePersistentTable(
+		std::shared_ptr<DeviceResources> device, const D3D12_GPU_DESCRIPTOR_HANDLE& handle, UINT count)
 	{
-		for (auto& cache : mCbvSrvUavCaches)
+		mRetiredTables.push_back({ device->GetSignaledFenceValue() + 1, handle, count });
+	}
+
+	UINT DescriptorCache::AcquireBindlessIndex(
+		std::shared_ptr<DeviceResources> device, UINT64 key, const D3D12_CPU_DESCRIPTOR_HANDLE& srcHandle)
+	{
+		bool bAssigned = false;
+		const UINT index = mBindlessTable.Acquire(key, bAssigned);
+		if (index == BindlessTable::InvalidIndex)
+			throw std::runtime_error("DescriptorCache::AcquireBindlessIndex Error");
+
+		if (bAssigned)
 		{
-			cache->Release();
+			CD3DX12_CPU_DESCRIPTOR_HANDLE dstHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+				mCbvSrvUavCache->GetCPUDescriptorHandleForHeapStart(),
+				c_frameCount * CBV_SRV_UAV_CACHE_SIZE + CBV_SRV_UAV_PERSISTENT_SIZE + index,
+				mCbvSrvUavDescriptorSize);
+
+			device->GetD3DDevice()->CopyDescriptorsSimple(1, dstHandle, srcHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 		}
+
+		return index;
+	}
+
+	void DescriptorCache::ReleaseBindlessIndex(UINT64 key)
+	{
+		mBindlessTable.Release(key);
+	}
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorCache::GetBindlessTable() const
+	{
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(
+			mCbvSrvUavCache->GetGPUDescriptorHandleForHeapStart(),
+			c_frameCount * CBV_SRV_UAV_CACHE_SIZE + CBV_SRV_UAV_PERSISTENT_SIZE,
+			mCbvSrvUavDescriptorSize);
+	}
+
+	void DescriptorCache::Destroy()
+	{
+		mCbvSrvUavCache->Release();
 		mRtvCache->Release();
 		mDsvCache->Release();
 	}
 
 	void DescriptorCache::CreateCbvSrvUavCache(std::shared_ptr<DeviceResources> device)
 	{
-		// Describe and create a cbv srv uav descriptor cache.
+		// Describe and create a cbv srv uav descriptor cache. Only one shader-visible heap of a type
+		// can be bound, so the ring, the persistent tables and the bindless range share it.
 		D3D12_DESCRIPTOR_HEAP_DESC cbvSrvUavHeapDesc = {};
-		cbvSrvUavHeapDesc.NumDescriptors = CBV_SRV_UAV_CACHE_SIZE;
+		cbvSrvUavHeapDesc.NumDescriptors = c_frameCount * CBV_SRV_UAV_CACHE_SIZE + CBV_SRV_UAV_PERSISTENT_SIZE + CBV_SRV_UAV_BINDLESS_SIZE;
 		cbvSrvUavHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 		cbvSrvUavHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		for (UINT i = 0; i < c_frameCount; ++i)
-		{
-			Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap = {};
-			ThrowIfFailed(device->GetD3DDevice()->CreateDescriptorHeap(&cbvSrvUavHeapDesc, IID_PPV_ARGS(&descriptorHeap)));
-			mCbvSrvUavCaches.emplace_back(descriptorHeap);
-			NAME_D3D12_OBJECT_INDEXED(mCbvSrvUavCaches, i);
-		}
+		ThrowIfFailed(device->GetD3DDevice()->CreateDescriptorHeap(&cbvSrvUavHeapDesc, IID_PPV_ARGS(&mCbvSrvUavCache)));
+		NAME_D3D12_OBJECT(mCbvSrvUavCache);
+
+		mPersistentTables.Reset(CBV_SRV_UAV_PERSISTENT_SIZE);
+		mBindlessTable.Reset(CBV_SRV_UAV_BINDLESS_SIZE);
 
 		mCbvSrvUavDescriptorSize = device->GetD3DDevice()->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 	}
@@ -177,9 +250,29 @@ namespace Amadeus
 		NAME_D3D12_OBJECT(mDsvCache);
 	}
 
+	UINT DescriptorCache::ReserveCbvSrvUavCache(UINT count)
+	{
+		if (count == 0 || count > CBV_SRV_UAV_CACHE_CHUNK_SIZE)
+			throw std::runtime_error("DescriptorCache::ReserveCbvSrvUavCache Error");
+
+		const UINT offset = mCbvSrvUavRing.Allocate(count);
+		if (offset == DescriptorRing::InvalidSlot)
+			throw std::runtime_error("DescriptorCache::ReserveCbvSrvUavCache Error");
+
+		return offset;
+	}
+
 	void DescriptorCache::ResetCbvSrvUavCache(std::shared_ptr<DeviceResources> device)
 	{
-		mCbvSrvUavCacheOffsets[device->GetCurrentFrameIndex()] = 0;
+		mCbvSrvUavRing.EndFrame(device->GetSignaledFenceValue());
+		const UINT64 completedFenceValue = device->GetCompletedFenceValue();
+		mCbvSrvUavRing.BeginFrame(completedFenceValue);
+
+		while (!mRetiredTables.empty() && mRetiredTables.front().fenceValue <= completedFenceValue)
+		{
+			FreePersistentTable(mRetiredTables.front().handle, mRetiredTables.front().count);
+			mRetiredTables.pop_front();
+		}
 	}
 
 	void DescriptorCache::ResetRtvCache()
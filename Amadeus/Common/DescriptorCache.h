@@ -1,16 +1,31 @@
 #pragma once
+#include "Common/RangeAllocator.h"
+#include "Common/BindlessTable.h"
+#include "Common/DescriptorRing.h"
 
 namespace Amadeus
 {
+	// Descriptors a frame appends, the ring holds one frame's worth per frame in flight.
 	static const UINT CBV_SRV_UAV_CACHE_SIZE = 1024;
+	// Slots a recording thread reserves at once.
+	static const UINT CBV_SRV_UAV_CACHE_CHUNK_SIZE = 32;
+	// Descriptor tables that live as long as their owner, after the ring in the same heap.
+	static const UINT CBV_SRV_UAV_PERSISTENT_SIZE = 4096;
+	// Single descriptors shaders index directly, last in the heap.
+	static const UINT CBV_SRV_UAV_BINDLESS_SIZE = 16384;
 	static const UINT RTV_CACHE_SIZE = 256;
 	static const UINT DSV_CACHE_SIZE = 32;
 
+	// One shader-visible cbv srv uav heap holds the ring frames append to, a persistent region for
+	// tables written once and the bindless range. Appends are safe from the threads recording passes,
+	// a full ring or cache throws.
 	class DescriptorCache
 	{
 	public:
 		DescriptorCache(std::shared_ptr<DeviceResources> device);
 
+		// Called once the frame is submitted. Its ring slots stay in use until the fence value it was
+		// signaled with completes, the slots of frames the gpu finished are reclaimed.
 		void Reset(std::shared_ptr<DeviceResources> device);
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE AppendSrvCache(
@@ -22,15 +37,40 @@ namespace Amadeus
 		CD3DX12_GPU_DESCRIPTOR_HANDLE AppendSrvCache(
 			std::shared_ptr<DeviceResources> device, ID3D12Resource* renderTarget, const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc);
 
+		// Copies count descriptors into slots in a row of the current frame, for tables of more than
+		// one descriptor. Separate appends may land in different chunks of the ring.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE AppendSrvTable(
+			std::shared_ptr<DeviceResources> device, const D3D12_CPU_DESCRIPTOR_HANDLE* srcHandles, UINT count);
+
 		CD3DX12_CPU_DESCRIPTOR_HANDLE AppendRtvCache(
 			std::shared_ptr<DeviceResources> device, ID3D12Resource* renderTarget, const D3D12_RENDER_TARGET_VIEW_DESC& rtvDesc);
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE AppendDsvCache(
 			std::shared_ptr<DeviceResources> device, ID3D12Resource* depthStencil, const D3D12_DEPTH_STENCIL_VIEW_DESC& dsvDesc);
 
+		// Copies count descriptors into a persistent table and returns its shader-visible handle.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE AllocatePersistentTable(
+			std::shared_ptr<DeviceResources> device, const D3D12_CPU_DESCRIPTOR_HANDLE* srcHandles, UINT count);
+
+		void FreePersistentTable(const D3D12_GPU_DESCRIPTOR_HANDLE& handle, UINT count);
+
+		// Frees the table once the frames submitted so far, and the one being recorded, completed.
+		// Called from the thread that resets the cache.
+		void RetirePersistentTable(
+			std::shared_ptr<DeviceResources> device, const D3D12_GPU_DESCRIPTOR_HANDLE& handle, UINT count);
+
+		// Index of the resource in the bindless range, its descriptor is copied the first time.
+		UINT AcquireBindlessIndex(
+			std::shared_ptr<DeviceResources> device, UINT64 key, const D3D12_CPU_DESCRIPTOR_HANDLE& srcHandle);
+
+		void ReleaseBindlessIndex(UINT64 key);
+
+		// Start of the bindless range, bound as an unbounded table.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE GetBindlessTable() const;
+
 		ID3D12DescriptorHeap* GetCbvSrvUavCache(std::shared_ptr<DeviceResources> device) 
 		{
-			return mCbvSrvUavCaches[device->GetCurrentFrameIndex()].Get();
+			return mCbvSrvUavCache.Get();
 		}
 
 		void Destroy();
@@ -48,16 +88,30 @@ namespace Amadeus
 
 		void ResetDsvCache();
 
-		std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> mCbvSrvUavCaches;
+		// First of count slots in a row of the heap an append of the current frame takes, at most a chunk.
+		UINT ReserveCbvSrvUavCache(UINT count = 1);
+
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mCbvSrvUavCache;
 		UINT mCbvSrvUavDescriptorSize;
-		UINT mCbvSrvUavCacheOffsets[c_frameCount];
+		DescriptorRing mCbvSrvUavRing;
+		RangeAllocator mPersistentTables;
+		BindlessTable mBindlessTable;
+
+		struct RetiredTable
+		{
+			UINT64 fenceValue;
+			D3D12_GPU_DESCRIPTOR_HANDLE handle;
+			UINT count;
+		};
+		std::deque<RetiredTable> mRetiredTables;
 
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtvCache;
 		UINT mRtvDescriptorSize;
-		UINT mRtvCacheOffset;
+		// Read when a pass records its targets, so the cpu-only caches are reset every frame.
+		std::atomic<UINT> mRtvCacheOffset;
 
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mDsvCache;
 		UINT mDsvDescriptorSize;
-		UINT mDsvCacheOffset;
+		std::atomic<UINT> mDsvCacheOffset;
 	};
 }
\ No newline at end of file
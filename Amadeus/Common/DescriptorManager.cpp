@@ -1,42 +1,79 @@
 #include "pch.h"
 #include "Common/DescriptorManager.h"
+#include "Common/Hash.h"
 
 namespace Amadeus
 {
 	DescriptorManager::DescriptorManager(std::shared_ptr<DeviceResources> device)
+		: mSamplerHeapOffset(0)
 	{
-		CreateSrvHeap(device);
+		mSrvDescriptorSize = device->GetD3DDevice()->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		mSrvAllocator.reset(new PagedAllocator(SRV_HEAP_PAGE_SIZE, mSrvDescriptorSize));
+
 		CreateSamplerHeap(device);
+
+		// The first sampler takes DEFAULT_SAMPLER_SLOT, glTF samplers with the same description share it.
+		D3D12_SAMPLER_DESC samplerDesc = {};
+		samplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
+		samplerDesc.MaxAnisotropy = 1;
+		samplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+		AllocateSampler(device, samplerDesc);
 	}
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorManager::AllocateSrvHeap(
 		std::shared_ptr<DeviceResources> device, ID3D12Resource* texture, const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc)
 	{
-		assert(mSrvHeapOffset + 1 <= SRV_HEAP_SIZE);
+		const uint64_t address = mSrvAllocator->Allocate(1, [&](uint32_t page) { return CreateSrvHeap(device, page); });
+		if (address == PagedAllocator::InvalidAddress)
+			throw std::runtime_error("DescriptorManager::AllocateSrvHeap Error");
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-			mSrvHeap->GetCPUDescriptorHandleForHeapStart(), mSrvHeapOffset, mSrvDescriptorSize);
+		CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle = {};
+		srvHandle.ptr = static_cast<SIZE_T>(address);
 
 		device->GetD3DDevice()->CreateShaderResourceView(texture, &srvDesc, srvHandle);
 
-		++mSrvHeapOffset;
-
 		return srvHandle;
 	}
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorManager::AllocateSamplerHeap(
-		std::shared_ptr<DeviceResources> device, const D3D12_SAMPLER_DESC& samplerDesc)
+	void DescriptorManager::FreeSrvHeap(const D3D12_CPU_DESCRIPTOR_HANDLE& handle)
+	{
+		mSrvAllocator->Free(handle.ptr, 1);
+	}
+
+	UINT DescriptorManager::AllocateSampler(std::shared_ptr<DeviceResources> device, const D3D12_SAMPLER_DESC& samplerDesc)
 	{
-		assert(mSamplerHeapOffset + 1 <= SAMPLER_HEAP_SIZE);
+		std::lock_guard<std::mutex> lock(mSamplerMutex);
+
+		const uint64_t hash = HashBytes(&samplerDesc, sizeof(samplerDesc));
+		auto sampler = mSamplers.find(hash);
+		if (sampler != mSamplers.end() && memcmp(&mSamplerDescs[sampler->second], &samplerDesc, sizeof(samplerDesc)) == 0)
+		{
+			return sampler->second;
+		}
+
+		if (mSamplerHeapOffset + 1 > SAMPLER_HEAP_SIZE)
+			throw std::runtime_error("DescriptorManager::AllocateSampler Error");
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE samplerHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
 			mSamplerHeap->GetCPUDescriptorHandleForHeapStart(), mSamplerHeapOffset, mSamplerDescriptorSize);
 
 		device->GetD3DDevice()->CreateSampler(&samplerDesc, samplerHandle);
 
-		++mSamplerHeapOffset;
+		// A colliding description keeps the slot of the first one, it is only never shared.
+		mSamplers.emplace(hash, mSamplerHeapOffset);
+		mSamplerDescs.push_back(samplerDesc);
+
+		return mSamplerHeapOffset++;
+	}
 
-		return samplerHandle;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorManager::GetSamplerTable(UINT slot)
+	{
+		assert(slot < SAMPLER_HEAP_SIZE);
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(mSamplerHeap->GetGPUDescriptorHandleForHeapStart(), slot, mSamplerDescriptorSize);
 	}
 
 	void DescriptorManager::Destroy()
@@ -45,17 +82,19 @@ namespace Amadeus
 		//mSamplerHeap->Release();
 	}
 
-	void DescriptorManager::CreateSrvHeap(std::shared_ptr<DeviceResources> device)
+	uint64_t DescriptorManager::CreateSrvHeap(std::shared_ptr<DeviceResources> device, UINT page)
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC cbvSrvUavHeapDesc = {};
-		cbvSrvUavHeapDesc.NumDescriptors = SRV_HEAP_SIZE;
+		cbvSrvUavHeapDesc.NumDescriptors = SRV_HEAP_PAGE_SIZE;
 		cbvSrvUavHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 		cbvSrvUavHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-		ThrowIfFailed(device->GetD3DDevice()->CreateDescriptorHeap(&cbvSrvUavHeapDesc, IID_PPV_ARGS(&mSrvHeap)));
 
-		mSrvDescriptorSize = device->GetD3DDevice()->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeap;
+		ThrowIfFailed(device->GetD3DDevice()->CreateDescriptorHeap(&cbvSrvUavHeapDesc, IID_PPV_ARGS(&srvHeap)));
+		mSrvHeaps.push_back(srvHeap);
+		NAME_D3D12_OBJECT_INDEXED(mSrvHeaps, page);
 
-		NAME_D3D12_OBJECT(mSrvHeap);
+		return srvHeap->GetCPUDescriptorHandleForHeapStart().ptr;
 	}
 
 	void DescriptorManager::CreateSamplerHeap(std::shared_ptr<DeviceResources> device)
@@ -70,4 +109,4 @@ namespace Amadeus
 
 		NAME_D3D12_OBJECT(mSamplerHeap);
 	}
-}
\ No newline at end of file
+}
@@ -1,9 +1,14 @@
 #pragma once
+#include "Common/PagedAllocator.h"
 
 namespace Amadeus
 {
-	static const UINT SRV_HEAP_SIZE = 256;
-	static const UINT SAMPLER_HEAP_SIZE = 1;
+	// Descriptors of one cpu srv heap page, pages are added as textures need them.
+	static const UINT SRV_HEAP_PAGE_SIZE = 256;
+	// Samplers have to be in the single shader-visible heap bound for the passes.
+	static const UINT SAMPLER_HEAP_SIZE = 64;
+	// The glTF default, wrapping and trilinear, for textures without a sampler.
+	static const UINT DEFAULT_SAMPLER_SLOT = 0;
 	static const UINT STANDARD_SAMPLER_ROOT_INDEX = 6;
 
 	class DescriptorManager
@@ -11,29 +16,38 @@ namespace Amadeus
 	public:
 		DescriptorManager(std::shared_ptr<DeviceResources> device);
 
+		// Safe to call from the threads that create textures.
 		CD3DX12_CPU_DESCRIPTOR_HANDLE AllocateSrvHeap(
 			std::shared_ptr<DeviceResources> device, ID3D12Resource* texture, const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc);
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE AllocateSamplerHeap(
-			std::shared_ptr<DeviceResources> device, const D3D12_SAMPLER_DESC& samplerDesc);
+		// Gives the slot back, for textures that are unloaded or streamed again.
+		void FreeSrvHeap(const D3D12_CPU_DESCRIPTOR_HANDLE& handle);
+
+		// Slot of the sampler in the heap, samplers with the same description share one descriptor.
+		UINT AllocateSampler(std::shared_ptr<DeviceResources> device, const D3D12_SAMPLER_DESC& samplerDesc);
 
 		ID3D12DescriptorHeap* GetSamplerHeap() { return mSamplerHeap.Get(); }
 
-		ID3D12DescriptorHeap* GetSrvHeap() { return mSrvHeap.Get(); }
+		// Table of the one sampler in the slot.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE GetSamplerTable(UINT slot);
 
 		void Destroy();
 
 	private:
-		void CreateSrvHeap(std::shared_ptr<DeviceResources> device);
+		uint64_t CreateSrvHeap(std::shared_ptr<DeviceResources> device, UINT page);
 
 		void CreateSamplerHeap(std::shared_ptr<DeviceResources> device);
 
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mSrvHeap;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> mSrvHeaps;
 		UINT mSrvDescriptorSize;
-		UINT mSrvHeapOffset;
+		std::unique_ptr<PagedAllocator> mSrvAllocator;
 
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mSamplerHeap;
 		UINT mSamplerDescriptorSize;
 		UINT mSamplerHeapOffset;
+		std::mutex mSamplerMutex;
+		// Hash of the description to the sampler slot.
+		std::map<uint64_t, UINT> mSamplers;
+		std::vector<D3D12_SAMPLER_DESC> mSamplerDescs;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "Common/DescriptorRing.h"
+
+namespace Amadeus
+{
+	namespace
+	{
+		// Chunk the calling thread fills, valid for one ring and one frame.
+		struct Chunk
+		{
+			uint64_t ring = 0;
+			uint64_t frame = 0;
+			uint64_t cursor = 0;
+			uint64_t end = 0;
+		};
+
+		thread_local Chunk tChunk;
+
+		std::atomic<uint64_t> sNextRingId{ 1 };
+	}
+
+	DescriptorRing::DescriptorRing(uint32_t capacity, uint32_t chunkSize)
+		: mCapacity(capacity)
+		, mChunkSize(chunkSize)
+		, mId(sNextRingId.fetch_add(1, std::memory_order_relaxed))
+		, mHead(0)
+		, mLimit(capacity)
+		, mFrameSerial(0)
+	{
+		assert(chunkSize > 0 && capacity % chunkSize == 0);
+	}
+
+	void DescriptorRing::BeginFrame(uint64_t completedFenceValue)
+	{
+		while (!mFrames.empty() && mFrames.front().fenceValue <= completedFenceValue)
+		{
+			mTail = mFrames.front().end;
+			mFrames.pop_front();
+		}
+		mLimit.store(mTail + mCapacity, std::memory_order_relaxed);
+		mFrameSerial.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void DescriptorRing::EndFrame(uint64_t fenceValue)
+	{
+		// Reservations that failed moved the head past the limit without getting slots.
+		const uint64_t end = (std::min)(mHead.load(std::memory_order_relaxed), mLimit.load(std::memory_order_relaxed));
+		mHead.store(end, std::memory_order_relaxed);
+		if (end == (mFrames.empty() ? mTail : mFrames.back().end))
+			return;
+
+		mFrames.push_back({ fenceValue, end });
+		// The chunks of this frame are done with, a thread starts a new one next frame.
+		mFrameSerial.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint32_t DescriptorRing::Allocate(uint32_t count)
+	{
+		assert(count > 0 && count <= mChunkSize);
+
+		const uint64_t frame = mFrameSerial.load(std::memory_order_relaxed);
+		Chunk& chunk = tChunk;
+		if (chunk.ring != mId || chunk.frame != frame || chunk.cursor + count > chunk.end)
+		{
+			const uint64_t start = mHead.fetch_add(mChunkSize, std::memory_order_relaxed);
+			if (start + mChunkSize > mLimit.load(std::memory_order_relaxed))
+				return InvalidSlot;
+
+			chunk = { mId, frame, start, start + mChunkSize };
+		}
+
+		// Chunks are aligned to their size and the capacity is a multiple of it, so count slots
+		// from the cursor never wrap.
+		const uint32_t slot = static_cast<uint32_t>(chunk.cursor % mCapacity);
+		chunk.cursor += count;
+		return slot;
+	}
+
+	uint64_t DescriptorRing::GetUsed() const
+	{
+		return (std::min)(mHead.load(std::memory_order_relaxed), mLimit.load(std::memory_order_relaxed)) - mTail;
+	}
+}
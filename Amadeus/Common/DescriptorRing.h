@@ -0,0 +1,52 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Slots of a ring that many threads append to while passes record. A thread reserves a chunk of
+	// slots with one atomic add and fills it alone, the chunk lasts it until the frame ends. The
+	// slots of a frame are reclaimed once the fence value the frame was signaled with completes.
+	// BeginFrame and EndFrame are called while no thread allocates.
+	class DescriptorRing
+	{
+	public:
+		static constexpr uint32_t InvalidSlot = ~0u;
+
+		// capacity has to be a multiple of chunkSize.
+		DescriptorRing(uint32_t capacity, uint32_t chunkSize);
+
+		// Reclaims the slots of the frames whose fence value is at most completedFenceValue.
+		void BeginFrame(uint64_t completedFenceValue);
+
+		// The slots allocated since BeginFrame stay in use until fenceValue completes.
+		void EndFrame(uint64_t fenceValue);
+
+		// First of count slots in a row, at most a chunk, or InvalidSlot when the ring is full.
+		uint32_t Allocate(uint32_t count = 1);
+
+		uint32_t GetCapacity() const { return mCapacity; }
+
+		uint32_t GetChunkSize() const { return mChunkSize; }
+
+		// Slots of the frames in flight and of the current one, chunks count whole.
+		uint64_t GetUsed() const;
+
+	private:
+		struct Frame
+		{
+			uint64_t fenceValue;
+			uint64_t end;
+		};
+
+		const uint32_t mCapacity;
+		const uint32_t mChunkSize;
+		// Tells the thread-local chunks of rings apart.
+		const uint64_t mId;
+
+		// Slots count up without wrapping, the slot in the ring is the count modulo the capacity.
+		std::atomic<uint64_t> mHead;
+		std::atomic<uint64_t> mLimit;
+		std::atomic<uint64_t> mFrameSerial;
+		uint64_t mTail = 0;
+		std::deque<Frame> mFrames;
+	};
+}
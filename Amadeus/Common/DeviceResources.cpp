@@ -93,13 +93,6 @@ namespace Amadeus
 		ThrowIfFailed(m_d3dDevice->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
 		NAME_D3D12_OBJECT(m_dsvHeap);
 
-		for (UINT n = 0; n < c_frameCount; n++)
-		{
-			ThrowIfFailed(
-				m_d3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[n]))
-			);
-		}
-
 		// 创建同步对象。
 		ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValues[m_currentFrame], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
 		m_fenceValues[m_currentFrame]++;
@@ -21,7 +21,6 @@ namespace Amadeus
 		ID3D12Resource*				GetRenderTarget() const				{ return m_renderTargets[m_currentFrame].Get(); }
 		ID3D12Resource*				GetDepthStencil() const				{ return m_depthStencil.Get(); }
 		ID3D12CommandQueue*			GetCommandQueue() const				{ return m_commandQueue.Get(); }
-		ID3D12CommandAllocator*		GetCommandAllocator() const			{ return m_commandAllocators[m_currentFrame].Get(); }
 		DXGI_FORMAT					GetBackBufferFormat() const			{ return m_backBufferFormat; }
 		DXGI_FORMAT					GetDepthBufferFormat() const		{ return m_depthBufferFormat; }
 		D3D12_VIEWPORT				GetScreenViewport() const			{ return m_screenViewport; }
@@ -29,6 +28,9 @@ namespace Amadeus
 		UINT						GetCurrentFrameIndex() const		{ return m_currentFrame; }
 		UINT64						GetWindowWidth() const				{ return static_cast<UINT64>(m_width); }
 		UINT						GetWindowHeight() const				{ return m_height; }
+		// Value the last Present or WaitForGpu signaled, and the value the gpu has reached.
+		UINT64						GetSignaledFenceValue() const		{ return m_fenceValues[m_currentFrame] - 1; }
+		UINT64						GetCompletedFenceValue() const		{ return m_fence->GetCompletedValue(); }
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView() const
 		{
@@ -57,7 +59,6 @@ namespace Amadeus
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>	m_rtvHeap;
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>	m_dsvHeap;
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue>		m_commandQueue;
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator>	m_commandAllocators[c_frameCount];
 		DXGI_FORMAT										m_backBufferFormat;
 		DXGI_FORMAT										m_depthBufferFormat;
 		D3D12_VIEWPORT									m_screenViewport;
@@ -0,0 +1,96 @@
+#include "pch.h"
+#include "Common/DrawList.h"
+
+namespace Amadeus
+{
+	static constexpr uint32_t PassShift = 64 - DrawList::PassBits;
+
+	uint64_t DrawList::MakeKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
+	{
+		assert(pass < (1u << PassBits) && pipeline < (1u << PipelineBits) && material < (1u << MaterialBits));
+		return (static_cast<uint64_t>(pass) << PassShift)
+			| (static_cast<uint64_t>(pipeline) << (MaterialBits + 32))
+			| (static_cast<uint64_t>(material) << 32)
+			| GetDepthBits(depth);
+	}
+
+	uint64_t DrawList::MakeBackToFrontKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
+	{
+		assert(pass < (1u << PassBits) && pipeline < (1u << PipelineBits) && material < (1u << MaterialBits));
+		return (static_cast<uint64_t>(pass) << PassShift)
+			| (static_cast<uint64_t>(~GetDepthBits(depth)) << (PipelineBits + MaterialBits))
+			| (static_cast<uint64_t>(pipeline) << MaterialBits)
+			| material;
+	}
+
+	uint32_t DrawList::GetDepthBits(float depth)
+	{
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		// Positive floats order like their bits, negative ones in reverse and below every positive one.
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	void DrawList::Clear()
+	{
+		mKeys.clear();
+		mItems.clear();
+	}
+
+	void DrawList::Add(uint64_t key, uint32_t item)
+	{
+		mKeys.push_back(key);
+		mItems.push_back(item);
+	}
+
+	void DrawList::Sort()
+	{
+		const size_t count = mKeys.size();
+		if (count < 2)
+			return;
+
+		// One pass counts every byte, the passes that follow only scatter.
+		mHistograms.assign(8 * 256, 0);
+		for (uint64_t key : mKeys)
+		{
+			for (int digit = 0; digit < 8; ++digit)
+				++mHistograms[digit * 256 + ((key >> (digit * 8)) & 0xFF)];
+		}
+
+		mSortedKeys.resize(count);
+		mSortedItems.resize(count);
+		for (int digit = 0; digit < 8; ++digit)
+		{
+			uint32_t* histogram = &mHistograms[digit * 256];
+			if (histogram[(mKeys[0] >> (digit * 8)) & 0xFF] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (int bucket = 0; bucket < 256; ++bucket)
+			{
+				const uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				const uint32_t slot = histogram[(mKeys[i] >> (digit * 8)) & 0xFF]++;
+				mSortedKeys[slot] = mKeys[i];
+				mSortedItems[slot] = mItems[i];
+			}
+			mKeys.swap(mSortedKeys);
+			mItems.swap(mSortedItems);
+		}
+	}
+
+	std::pair<size_t, size_t> DrawList::GetRange(uint32_t pass) const
+	{
+		const uint64_t first = static_cast<uint64_t>(pass) << PassShift;
+		const auto begin = std::lower_bound(mKeys.begin(), mKeys.end(), first);
+		const auto end = pass + 1 < (1u << PassBits)
+			? std::lower_bound(begin, mKeys.end(), static_cast<uint64_t>(pass + 1) << PassShift)
+			: mKeys.end();
+		return { static_cast<size_t>(begin - mKeys.begin()), static_cast<size_t>(end - mKeys.begin()) };
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Draws of one frame as parallel arrays of sort keys and items, the index of whatever the caller
+	// draws. Sorted, every pass is a contiguous range ordered to change as little state as possible.
+	class DrawList
+	{
+	public:
+		// Key layouts, most significant bits first:
+		//   front to back  pass:4 | pipeline:8 | material:20 | depth:32
+		//   back to front  pass:4 | inverted depth:32 | pipeline:8 | material:20
+		static constexpr uint32_t PassBits = 4;
+		static constexpr uint32_t PipelineBits = 8;
+		static constexpr uint32_t MaterialBits = 20;
+
+		// Opaque draws, grouped by pipeline and material and then nearest first inside a group.
+		static uint64_t MakeKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth);
+
+		// Blended draws, furthest first regardless of their state.
+		static uint64_t MakeBackToFrontKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth);
+
+		// Bits that order like the float, negative depths included.
+		static uint32_t GetDepthBits(float depth);
+
+		void Clear();
+
+		void Add(uint64_t key, uint32_t item);
+
+		// Stable radix sort over the key bytes, bytes that are the same in every key are skipped.
+		void Sort();
+
+		size_t Size() const { return mKeys.size(); }
+
+		const std::vector<uint64_t>& GetKeys() const { return mKeys; }
+
+		const std::vector<uint32_t>& GetItems() const { return mItems; }
+
+		// First and one past the last draw of a pass, the list has to be sorted.
+		std::pair<size_t, size_t> GetRange(uint32_t pass) const;
+
+	private:
+		std::vector<uint64_t> mKeys;
+		std::vector<uint32_t> mItems;
+		std::vector<uint64_t> mSortedKeys;
+		std::vector<uint32_t> mSortedItems;
+		// Counts of every key byte, kept so that sorting allocates nothing once the list stops growing.
+		std::vector<uint32_t> mHistograms;
+	};
+}
@@ -5,6 +5,18 @@ namespace EngineVar
 {
 	bool TAA_Enable = false;
 	bool Draw_Sky = true;
+	bool Vertex_Quantize = true;
+	bool Mesh_Optimize = true;
+	bool Meshlet_Cull = true;
+	bool Frustum_Cull = true;
+	bool Bindless_Materials = false;
+	bool Texture_CpuMips = true;
+	bool Texture_KaiserMips = false;
+	bool Texture_Compress = true;
+	UINT32 Texture_CompressQuality = 1;
+	bool Package_Scenes = true;
+	bool DerivedData_Cache = true;
+	UINT32 DerivedData_CacheMegabytes = 2048;
 
 	wchar_t TEXTURE_WHITE_ID[19] = L"Textures\\white.dds";
 	wchar_t TEXTURE_BLACK_ID[19] = L"Textures\\black.dds";
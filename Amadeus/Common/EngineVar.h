@@ -4,6 +4,31 @@ namespace EngineVar
 {
 	extern bool TAA_Enable;
 	extern bool Draw_Sky;
+	// Packed 20 byte vertices instead of 48 byte float vertices, read when the passes and primitives are created.
+	extern bool Vertex_Quantize;
+	// Reorder indices and vertices of imported primitives for the vertex cache, overdraw and vertex fetch.
+	extern bool Mesh_Optimize;
+	// Split primitives into meshlets and skip the ones outside the frustum or facing away from the camera.
+	extern bool Meshlet_Cull;
+	// Skip meshes and primitives whose world bounds are outside the camera or the shadow frustum.
+	extern bool Frustum_Cull;
+	// Materials index one table of every texture instead of binding a table each, needs resource binding tier 2.
+	extern bool Bindless_Materials;
+	// Base color mips are filtered on the cpu in the decode job instead of by a gpu pass after the upload.
+	extern bool Texture_CpuMips;
+	// Kaiser windowed sinc instead of a box for the cpu mips, sharper and slower.
+	extern bool Texture_KaiserMips;
+	// Imported material textures are encoded into BC1, BC3, BC4, BC5 or BC7 by their slot in the decode job.
+	extern bool Texture_Compress;
+	// 0 fast, 1 normal, 2 high, each encodes several times slower than the one before for a little less error.
+	extern UINT32 Texture_CompressQuality;
+	// Models without an up to date package are cooked into one while they load, later starts map the package
+	// instead of importing the glTF.
+	extern bool Package_Scenes;
+	// Normals, tangents, optimized orders and decoded textures are kept on disk between runs, keyed by their
+	// source bytes and settings. The least recently used go once the cache is larger than its capacity.
+	extern bool DerivedData_Cache;
+	extern UINT32 DerivedData_CacheMegabytes;
 
 	extern wchar_t TEXTURE_WHITE_ID[19];
 	extern wchar_t TEXTURE_BLACK_ID[19];
@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "Common/FrustumCuller.h"
+#include <emmintrin.h>
+
+namespace Amadeus
+{
+	// For every plane, the corner of a box furthest along its normal. The box is outside when that
+	// corner is, so the test needs one corner per plane instead of all eight.
+	struct PlaneCorner
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+	};
+
+	static void GetPlaneCorners(const FrustumCuller::Frustum& frustum, const FrustumCuller::Boxes& boxes, PlaneCorner corners[6])
+	{
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			const float* p = frustum.planes[plane];
+			corners[plane].x = p[0] >= 0.0f ? boxes.maxX.data() : boxes.minX.data();
+			corners[plane].y = p[1] >= 0.0f ? boxes.maxY.data() : boxes.minY.data();
+			corners[plane].z = p[2] >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+		}
+	}
+
+	static void CullScalarCorners(const FrustumCuller::Frustum& frustum, const PlaneCorner corners[6],
+		size_t first, size_t count, uint8_t* visible)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const size_t box = first + i;
+			bool inside = true;
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				const float* p = frustum.planes[plane];
+				const float distance = p[0] * corners[plane].x[box] + p[1] * corners[plane].y[box] + p[2] * corners[plane].z[box] + p[3];
+				inside &= !(distance < 0.0f);
+			}
+			visible[i] = inside ? 1 : 0;
+		}
+	}
+
+	void FrustumCuller::Boxes::Clear()
+	{
+		for (auto* bound : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ })
+		{
+			bound->clear();
+		}
+	}
+
+	void FrustumCuller::Boxes::Add(const float minimum[3], const float maximum[3])
+	{
+		minX.push_back(minimum[0]);
+		minY.push_back(minimum[1]);
+		minZ.push_back(minimum[2]);
+		maxX.push_back(maximum[0]);
+		maxY.push_back(maximum[1]);
+		maxZ.push_back(maximum[2]);
+	}
+
+	FrustumCuller::Frustum FrustumCuller::CreateFrustum(const float viewProjection[4][4])
+	{
+		// With row vectors the planes are combinations of the columns of the matrix: w * w-column + sign * column >= 0
+		// for left, right, bottom, top, near and far. Depth starts at 0, so the near plane has no w term.
+		static const float combinations[6][3] = {
+			{ 1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, -1.0f },
+			{ 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, -1.0f },
+			{ 0.0f, 2.0f, 1.0f }, { 1.0f, 2.0f, -1.0f } };
+
+		Frustum frustum;
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			const float w = combinations[plane][0];
+			const int column = static_cast<int>(combinations[plane][1]);
+			const float sign = combinations[plane][2];
+			for (int row = 0; row < 4; ++row)
+			{
+				frustum.planes[plane][row] = w * viewProjection[row][3] + sign * viewProjection[row][column];
+			}
+
+			const float* p = frustum.planes[plane];
+			const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			if (length > 0.0f)
+			{
+				for (int i = 0; i < 4; ++i)
+					frustum.planes[plane][i] /= length;
+			}
+		}
+		return frustum;
+	}
+
+	void FrustumCuller::TransformBox(const float world[4][4], const float minimum[3], const float maximum[3],
+		float transformedMinimum[3], float transformedMaximum[3])
+	{
+		for (int column = 0; column < 3; ++column)
+		{
+			float low = world[3][column];
+			float high = world[3][column];
+			for (int row = 0; row < 3; ++row)
+			{
+				const float a = world[row][column] * minimum[row];
+				const float b = world[row][column] * maximum[row];
+				low += (std::min)(a, b);
+				high += (std::max)(a, b);
+			}
+			transformedMinimum[column] = low;
+			transformedMaximum[column] = high;
+		}
+	}
+
+	void FrustumCuller::Cull(const Frustum& frustum, const Boxes& boxes, size_t first, size_t count, uint8_t* visible)
+	{
+		assert(first + count <= boxes.Size());
+
+		PlaneCorner corners[6];
+		GetPlaneCorners(frustum, boxes, corners);
+
+		__m128 normals[6][4];
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			for (int i = 0; i < 4; ++i)
+				normals[plane][i] = _mm_set1_ps(frustum.planes[plane][i]);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const size_t box = first + i;
+			__m128 outside = _mm_setzero_ps();
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				const __m128 x = _mm_loadu_ps(corners[plane].x + box);
+				const __m128 y = _mm_loadu_ps(corners[plane].y + box);
+				const __m128 z = _mm_loadu_ps(corners[plane].z + box);
+				__m128 distance = _mm_add_ps(_mm_mul_ps(normals[plane][0], x), _mm_mul_ps(normals[plane][1], y));
+				distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(normals[plane][2], z)), normals[plane][3]);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+			}
+
+			const int mask = _mm_movemask_ps(outside);
+			visible[i + 0] = (mask & 1) ? 0 : 1;
+			visible[i + 1] = (mask & 2) ? 0 : 1;
+			visible[i + 2] = (mask & 4) ? 0 : 1;
+			visible[i + 3] = (mask & 8) ? 0 : 1;
+		}
+
+		CullScalarCorners(frustum, corners, first + i, count - i, visible + i);
+	}
+
+	void FrustumCuller::CullScalar(const Frustum& frustum, const Boxes& boxes, size_t first, size_t count, uint8_t* visible)
+	{
+		assert(first + count <= boxes.Size());
+
+		PlaneCorner corners[6];
+		GetPlaneCorners(frustum, boxes, corners);
+		CullScalarCorners(frustum, corners, first, count, visible);
+	}
+}
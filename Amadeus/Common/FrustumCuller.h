@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Tests world-space axis-aligned boxes against a view frustum, four boxes at a time with SSE2.
+	// Matrices use the DirectXMath convention, row vectors and clip depth in [0, 1], so the planes
+	// of perspective and orthographic projections come out the same way.
+	class FrustumCuller
+	{
+	public:
+		// Normalized planes pointing inwards, a point is inside when dot(plane.xyz, p) + plane.w >= 0.
+		// Left, right, bottom, top, near, far.
+		struct Frustum
+		{
+			float planes[6][4];
+		};
+
+		// One array per bound, so that the kernel loads four boxes with one instruction per bound.
+		struct Boxes
+		{
+			std::vector<float> minX;
+			std::vector<float> minY;
+			std::vector<float> minZ;
+			std::vector<float> maxX;
+			std::vector<float> maxY;
+			std::vector<float> maxZ;
+
+			size_t Size() const { return minX.size(); }
+
+			void Clear();
+
+			void Add(const float minimum[3], const float maximum[3]);
+		};
+
+		static Frustum CreateFrustum(const float viewProjection[4][4]);
+
+		// Arvo's method, the tightest box around the transformed corners of the box.
+		static void TransformBox(const float world[4][4], const float minimum[3], const float maximum[3],
+			float transformedMinimum[3], float transformedMaximum[3]);
+
+		// Writes 1 for every box in [first, first + count) that is at least partly inside, 0 for the
+		// others, to visible[0, count). A box is only rejected when it lies entirely outside one plane.
+		static void Cull(const Frustum& frustum, const Boxes& boxes, size_t first, size_t count, uint8_t* visible);
+
+		static void CullScalar(const Frustum& frustum, const Boxes& boxes, size_t first, size_t count, uint8_t* visible);
+	};
+}
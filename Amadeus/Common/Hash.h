@@ -0,0 +1,19 @@
+#pragma once
+
+namespace Amadeus
+{
+	static constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+	// 64-bit FNV-1a over raw bytes, for keys that are plain structs without padding. Pass the
+	// previous result as hash to continue over more bytes.
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HASH_SEED)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,533 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <cstddef>
+#include <exception>
+#include <unordered_map>
+
+namespace Amadeus
+{
+	// A fixed-size job. The callable lives in-place in mPayload, so creating a job
+	// never touches the heap; jobs are recycled from a per-thread ring.
+	struct alignas(64) Job
+	{
+		static constexpr size_t PayloadSize = 96;
+
+		using InvokeFn = void(*)(void*);
+		using DestroyFn = void(*)(void*);
+
+		InvokeFn mInvoke;
+		DestroyFn mDestroy;
+		Job* mParent;
+		std::atomic<int32_t> mUnfinished{ 0 };
+		// A root that is still to be waited on, its slot is not reused even once it is finished.
+		std::atomic<bool> bPinned{ false };
+		// The job or one of its children threw, the exception is kept by the system until Wait.
+		bool bFailed = false;
+
+		alignas(std::max_align_t) unsigned char mPayload[PayloadSize];
+
+		bool IsFinished() const { return mUnfinished.load(std::memory_order_acquire) == 0; }
+	};
+
+	// Chase-Lev deque. Push and Pop may only be called by the owning worker, Steal
+	// may be called from any thread.
+	class WorkStealingQueue
+	{
+	public:
+		static constexpr int64_t Capacity = 4096;
+
+		WorkStealingQueue()
+		{
+			for (auto& job : mJobs)
+				job.store(nullptr, std::memory_order_relaxed);
+		}
+
+		bool Push(Job* job)
+		{
+			int64_t bottom = mBottom.load(std::memory_order_relaxed);
+			int64_t top = mTop.load(std::memory_order_acquire);
+			if (bottom - top >= Capacity)
+				return false;
+
+			mJobs[bottom & Mask].store(job, std::memory_order_relaxed);
+			mBottom.store(bottom + 1, std::memory_order_release);
+			return true;
+		}
+
+		Job* Pop()
+		{
+			int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+			mBottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = mTop.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				mBottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Job* job = mJobs[bottom & Mask].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// Last job in the queue, race against thieves for it.
+				if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					job = nullptr;
+				mBottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job* Steal()
+		{
+			int64_t top = mTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t bottom = mBottom.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+				return nullptr;
+
+			Job* job = mJobs[top & Mask].load(std::memory_order_relaxed);
+			if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return job;
+		}
+
+	private:
+		static constexpr int64_t Mask = Capacity - 1;
+		static_assert((Capacity & Mask) == 0, "WorkStealingQueue capacity must be a power of two");
+
+		alignas(64) std::atomic<int64_t> mTop{ 0 };
+		alignas(64) std::atomic<int64_t> mBottom{ 0 };
+		std::atomic<Job*> mJobs[Capacity];
+	};
+
+	class JobSystem
+	{
+	public:
+		static constexpr size_t JobPoolSize = 4096;
+
+		JobSystem(size_t threads, std::wstring name);
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		~JobSystem();
+
+		// A root job, wait on it to wait for all of its children. The job stays pinned to its slot
+		// until Wait returns, so it has to be waited on once unless it is run in the background.
+		template<class F>
+		Job* CreateJob(F&& f);
+
+		// The parent is not finished until every child created under it has run.
+		template<class F>
+		Job* CreateChildJob(Job* parent, F&& f);
+
+		void Run(Job* job);
+
+		// Queues a long job, e.g. an asset decode, that only the worker threads pick up once their
+		// own and the stolen jobs run out. Wait on the creating thread never runs one, so the frame
+		// is not held up behind it. Nobody waits on a background job, what it throws is dropped.
+		void RunBackground(Job* job);
+
+		// Executes other jobs on the calling thread until the root job is finished, then rethrows the
+		// first exception thrown by it or its children. Exceptions of other roots are left to their
+		// own Wait.
+		void Wait(Job* job);
+
+		// ThreadPool compatible entry point for callers that need a result.
+		template<class F, class... Args>
+		auto Enqueue(F&& f, Args&&... args)
+			->std::future<typename std::invoke_result<F, Args...>::type>;
+
+		size_t GetWorkerCount() const { return mThreads.size(); }
+
+	private:
+		struct alignas(64) Worker
+		{
+			WorkStealingQueue queue;
+			Job pool[JobPoolSize];
+			size_t allocated = 0;
+			size_t index = 0;
+		};
+
+		static thread_local JobSystem* tOwner;
+		static thread_local Worker* tWorker;
+
+		Worker* GetCurrentWorker() const { return tOwner == this ? tWorker : nullptr; }
+
+		template<class F>
+		Job* Allocate(Job* parent, F&& f);
+
+		Job* AcquireJob();
+
+		Job* GetJob(Worker* worker);
+
+		Job* GetBackgroundJob();
+
+		void Execute(Job* job);
+
+		void Finish(Job* job);
+
+		// Drops the exception of a job whose slot is reused or that is waited on.
+		std::exception_ptr TakeException(Job* job);
+
+		void WorkerLoop(size_t index, std::wstring name);
+
+		// Slot 0 belongs to the thread that created the system.
+		std::vector<std::unique_ptr<Worker>> mWorkers;
+		std::vector<std::thread> mThreads;
+
+		// Jobs pushed from threads that are not part of the system.
+		std::mutex mForeignLock;
+		std::deque<Job*> mForeignJobs;
+		std::atomic<size_t> mForeignCount{ 0 };
+		std::atomic<size_t> mForeignAllocated{ 0 };
+		Job mForeignPool[JobPoolSize];
+
+		// Jobs of RunBackground, under mForeignLock as well.
+		std::deque<Job*> mBackgroundJobs;
+		std::atomic<size_t> mBackgroundCount{ 0 };
+
+		std::mutex mSleepLock;
+		std::condition_variable mSleepCondition;
+		std::atomic<int32_t> mSleeping{ 0 };
+		std::atomic<bool> bStop{ false };
+
+		// First exception of each root that failed, until its Wait or the reuse of its slot.
+		std::mutex mExceptionLock;
+		std::unordered_map<const Job*, std::exception_ptr> mExceptions;
+	};
+
+	inline thread_local JobSystem* JobSystem::tOwner = nullptr;
+	inline thread_local JobSystem::Worker* JobSystem::tWorker = nullptr;
+
+	inline JobSystem::JobSystem(size_t threads, std::wstring name)
+	{
+		// Futures returned by Enqueue need at least one thread that is not blocked on them.
+		threads = (std::max)(threads, size_t(1));
+
+		for (size_t i = 0; i < threads + 1; ++i)
+		{
+			mWorkers.emplace_back(new Worker());
+			mWorkers.back()->index = i;
+		}
+
+		tOwner = this;
+		tWorker = mWorkers[0].get();
+
+		for (size_t i = 1; i < threads + 1; ++i)
+			mThreads.emplace_back(&JobSystem::WorkerLoop, this, i, name);
+	}
+
+	inline JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mSleepLock);
+			bStop.store(true, std::memory_order_release);
+		}
+		mSleepCondition.notify_all();
+
+		for (auto& thread : mThreads)
+			thread.join();
+
+		if (tOwner == this)
+		{
+			tOwner = nullptr;
+			tWorker = nullptr;
+		}
+	}
+
+	template<class F>
+	inline Job* JobSystem::CreateJob(F&& f)
+	{
+		Job* job = Allocate(nullptr, std::forward<F>(f));
+		job->bPinned.store(true, std::memory_order_relaxed);
+		return job;
+	}
+
+	template<class F>
+	inline Job* JobSystem::CreateChildJob(Job* parent, F&& f)
+	{
+		assert(parent && !parent->IsFinished());
+		parent->mUnfinished.fetch_add(1, std::memory_order_relaxed);
+		return Allocate(parent, std::forward<F>(f));
+	}
+
+	inline void JobSystem::Run(Job* job)
+	{
+		Worker* worker = GetCurrentWorker();
+		if (worker)
+		{
+			// The deque is full, so the job is cheaper to run here than to queue.
+			if (!worker->queue.Push(job))
+			{
+				Execute(job);
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(mForeignLock);
+			mForeignJobs.push_back(job);
+			mForeignCount.fetch_add(1, std::memory_order_release);
+		}
+
+		if (mSleeping.load(std::memory_order_acquire) > 0)
+			mSleepCondition.notify_one();
+	}
+
+	inline void JobSystem::RunBackground(Job* job)
+	{
+		job->bPinned.store(false, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(mForeignLock);
+			mBackgroundJobs.push_back(job);
+			mBackgroundCount.fetch_add(1, std::memory_order_release);
+		}
+
+		if (mSleeping.load(std::memory_order_acquire) > 0)
+			mSleepCondition.notify_one();
+	}
+
+	inline void JobSystem::Wait(Job* job)
+	{
+		assert(!job->mParent);
+		Worker* worker = GetCurrentWorker();
+		while (!job->IsFinished())
+		{
+			Job* next = worker ? GetJob(worker) : nullptr;
+			if (next)
+				Execute(next);
+			else
+				std::this_thread::yield();
+		}
+
+		// Every child has finished, nothing writes the flag any more.
+		std::exception_ptr exception = job->bFailed ? TakeException(job) : nullptr;
+		job->bPinned.store(false, std::memory_order_release);
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	template<class F, class... Args>
+	inline auto JobSystem::Enqueue(F&& f, Args&&... args)
+		-> std::future<typename std::invoke_result<F, Args...>::type>
+	{
+		using return_type = typename std::invoke_result<F, Args...>::type;
+
+		if (bStop.load(std::memory_order_acquire))
+			throw std::runtime_error("Enqueue on stopped JobSystem");
+
+		std::promise<return_type> promise;
+		std::future<return_type> res = promise.get_future();
+
+		// The future is the result, the job itself is never waited on.
+		Job* job = Allocate(nullptr,
+			[promise = std::move(promise), func = std::forward<F>(f), ...params = std::forward<Args>(args)]() mutable
+		{
+			try
+			{
+				if constexpr (std::is_void_v<return_type>)
+				{
+					std::invoke(func, params...);
+					promise.set_value();
+				}
+				else
+				{
+					promise.set_value(std::invoke(func, params...));
+				}
+			}
+			catch (...)
+			{
+				promise.set_exception(std::current_exception());
+			}
+		});
+		Run(job);
+
+		return res;
+	}
+
+	template<class F>
+	inline Job* JobSystem::Allocate(Job* parent, F&& f)
+	{
+		using Callable = std::decay_t<F>;
+		static_assert(sizeof(Callable) <= Job::PayloadSize, "Job lambda is capturing too much data.");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "Job lambda is over-aligned.");
+
+		Job* job = AcquireJob();
+		// A root that failed in the background was never waited on.
+		if (job->bFailed)
+			TakeException(job);
+		new (job->mPayload) Callable(std::forward<F>(f));
+		job->mInvoke = [](void* payload) { (*static_cast<Callable*>(payload))(); };
+		job->mDestroy = [](void* payload) { static_cast<Callable*>(payload)->~Callable(); };
+		job->mParent = parent;
+		job->mUnfinished.store(1, std::memory_order_release);
+		return job;
+	}
+
+	inline Job* JobSystem::AcquireJob()
+	{
+		Worker* worker = GetCurrentWorker();
+		for (;;)
+		{
+			// Skip slots that are still in flight, e.g. a long-lived parent.
+			for (size_t i = 0; i < JobPoolSize; ++i)
+			{
+				Job* job = worker
+					? &worker->pool[worker->allocated++ & (JobPoolSize - 1)]
+					: &mForeignPool[mForeignAllocated.fetch_add(1, std::memory_order_relaxed) & (JobPoolSize - 1)];
+
+				if (job->IsFinished() && !job->bPinned.load(std::memory_order_acquire))
+					return job;
+			}
+
+			// Every slot is busy, help drain the queues before trying again.
+			Job* next = worker ? GetJob(worker) : nullptr;
+			if (next)
+				Execute(next);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	inline Job* JobSystem::GetJob(Worker* worker)
+	{
+		Job* job = worker->queue.Pop();
+		if (job)
+			return job;
+
+		if (mForeignCount.load(std::memory_order_acquire) > 0)
+		{
+			std::lock_guard<std::mutex> lock(mForeignLock);
+			if (!mForeignJobs.empty())
+			{
+				job = mForeignJobs.front();
+				mForeignJobs.pop_front();
+				mForeignCount.fetch_sub(1, std::memory_order_release);
+				return job;
+			}
+		}
+
+		// Start stealing next to ourselves so that thieves spread over the victims.
+		const size_t count = mWorkers.size();
+		for (size_t i = 1; i < count; ++i)
+		{
+			Worker* victim = mWorkers[(worker->index + i) % count].get();
+			job = victim->queue.Steal();
+			if (job)
+				return job;
+		}
+
+		return nullptr;
+	}
+
+	inline Job* JobSystem::GetBackgroundJob()
+	{
+		if (mBackgroundCount.load(std::memory_order_acquire) == 0)
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(mForeignLock);
+		if (mBackgroundJobs.empty())
+			return nullptr;
+
+		Job* job = mBackgroundJobs.front();
+		mBackgroundJobs.pop_front();
+		mBackgroundCount.fetch_sub(1, std::memory_order_release);
+		return job;
+	}
+
+	inline void JobSystem::Execute(Job* job)
+	{
+		try
+		{
+			job->mInvoke(job->mPayload);
+		}
+		catch (...)
+		{
+			// Kept for the root, which is unfinished until this job finishes below.
+			Job* root = job;
+			while (root->mParent)
+				root = root->mParent;
+
+			std::lock_guard<std::mutex> lock(mExceptionLock);
+			if (mExceptions.emplace(root, std::current_exception()).second)
+				root->bFailed = true;
+		}
+		job->mDestroy(job->mPayload);
+
+		Finish(job);
+	}
+
+	inline void JobSystem::Finish(Job* job)
+	{
+		Job* parent = job->mParent;
+		if (job->mUnfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent)
+			Finish(parent);
+	}
+
+	inline std::exception_ptr JobSystem::TakeException(Job* job)
+	{
+		std::lock_guard<std::mutex> lock(mExceptionLock);
+		std::exception_ptr exception;
+		auto iter = mExceptions.find(job);
+		if (iter != mExceptions.end())
+		{
+			exception = std::move(iter->second);
+			mExceptions.erase(iter);
+		}
+		job->bFailed = false;
+		return exception;
+	}
+
+	inline void JobSystem::WorkerLoop(size_t index, std::wstring name)
+	{
+#ifdef _WIN32
+		SetThreadDescription(GetCurrentThread(), name.c_str());
+		// Background jobs decode images through WIC.
+		const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#else
+		(void)name;
+#endif // _WIN32
+
+		tOwner = this;
+		tWorker = mWorkers[index].get();
+
+		static constexpr int SpinCount = 64;
+		int idle = 0;
+
+		while (!bStop.load(std::memory_order_acquire))
+		{
+			// Background jobs only start from here, never inside a Wait of a frame's job.
+			Job* job = GetJob(tWorker);
+			if (!job)
+				job = GetBackgroundJob();
+			if (job)
+			{
+				Execute(job);
+				idle = 0;
+				continue;
+			}
+
+			if (++idle < SpinCount)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// The timeout covers the window between a failed steal and a Run()
+			// that saw no sleepers.
+			std::unique_lock<std::mutex> lock(mSleepLock);
+			mSleeping.fetch_add(1, std::memory_order_acq_rel);
+			mSleepCondition.wait_for(lock, std::chrono::milliseconds(1));
+			mSleeping.fetch_sub(1, std::memory_order_acq_rel);
+			idle = 0;
+		}
+
+#ifdef _WIN32
+		if (SUCCEEDED(com))
+			CoUninitialize();
+#endif // _WIN32
+	}
+}
@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "Common/LoadPipeline.h"
+
+namespace Amadeus
+{
+	LoadPipeline::LoadPipeline(Dispatch dispatch)
+		: mDispatch(std::move(dispatch))
+	{
+	}
+
+	LoadPipeline::~LoadPipeline()
+	{
+		Cancel();
+	}
+
+	void LoadPipeline::Add(std::vector<Task>&& tasks)
+	{
+		if (tasks.empty())
+			return;
+
+		Item* item = new Item();
+		item->tasks = std::move(tasks);
+		for (const auto& task : item->tasks)
+		{
+			mPending[static_cast<size_t>(task.stage)].fetch_add(1, std::memory_order_relaxed);
+		}
+		mItems.fetch_add(1, std::memory_order_acq_rel);
+
+		Advance(item);
+	}
+
+	size_t LoadPipeline::Poll(size_t maxTasks)
+	{
+		size_t count = 0;
+		for (;;)
+		{
+			Item* item = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(mLock);
+				if (mException)
+				{
+					std::exception_ptr exception;
+					std::swap(exception, mException);
+					std::rethrow_exception(exception);
+				}
+
+				if (mReady.empty() || (maxTasks > 0 && count == maxTasks))
+					break;
+
+				item = mReady.front();
+				mReady.pop_front();
+			}
+
+			try
+			{
+				item->tasks[item->next].work();
+			}
+			catch (...)
+			{
+				Drop(item);
+				throw;
+			}
+			++count;
+
+			Complete(item);
+			Advance(item);
+		}
+
+		return count;
+	}
+
+	void LoadPipeline::Cancel()
+	{
+		bCancelled.store(true, std::memory_order_release);
+
+		// A worker task that returns now drops its item instead of handing out the next task.
+		while (mRunning.load(std::memory_order_acquire) > 0)
+		{
+			std::this_thread::yield();
+		}
+
+		std::deque<Item*> ready;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			std::swap(ready, mReady);
+		}
+		for (Item* item : ready)
+		{
+			Drop(item);
+		}
+	}
+
+	void LoadPipeline::Advance(Item* item)
+	{
+		if (item->next == item->tasks.size() || bCancelled.load(std::memory_order_acquire))
+		{
+			Drop(item);
+			return;
+		}
+
+		if (item->tasks[item->next].bMainThread)
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			mReady.push_back(item);
+			return;
+		}
+
+		mRunning.fetch_add(1, std::memory_order_acq_rel);
+		mDispatch([this, item] { RunWorker(item); });
+	}
+
+	void LoadPipeline::RunWorker(Item* item)
+	{
+		bool bDone = !bCancelled.load(std::memory_order_acquire);
+		if (bDone)
+		{
+			try
+			{
+				item->tasks[item->next].work();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mLock);
+				if (!mException)
+					mException = std::current_exception();
+				bDone = false;
+			}
+		}
+
+		if (bDone)
+		{
+			Complete(item);
+			Advance(item);
+		}
+		else
+		{
+			Drop(item);
+		}
+
+		// Last, so that Cancel does not return while the item could still be queued.
+		mRunning.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	void LoadPipeline::Complete(Item* item)
+	{
+		const size_t stage = static_cast<size_t>(item->tasks[item->next].stage);
+		mPending[stage].fetch_sub(1, std::memory_order_acq_rel);
+		mCompleted[stage].fetch_add(1, std::memory_order_acq_rel);
+		++item->next;
+	}
+
+	void LoadPipeline::Drop(Item* item)
+	{
+		for (size_t i = item->next; i < item->tasks.size(); ++i)
+		{
+			mPending[static_cast<size_t>(item->tasks[i].stage)].fetch_sub(1, std::memory_order_acq_rel);
+		}
+		delete item;
+
+		mItems.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Loads assets as items, each a chain of stage tasks. Worker tasks go to the dispatch function, the
+	// next task of an item is only handed out once the previous one returned, so the tasks of one item
+	// run in order and never at the same time while different items overlap. Main thread tasks wait for
+	// Poll, which the owner calls between frames, and run there in the order they became ready.
+	class LoadPipeline
+	{
+	public:
+		enum class Stage : uint32_t
+		{
+			Parse,
+			DecodeGeometry,
+			DecodeTexture,
+			Upload,
+			Commit,
+			// Writes what a load imported into a package for the next one.
+			Cook,
+			Count
+		};
+
+		struct Task
+		{
+			Stage stage;
+			// Runs in Poll rather than on a worker, e.g. to join the result to the scene.
+			bool bMainThread;
+			std::function<void()> work;
+		};
+
+		// Runs the function on some worker thread later.
+		typedef std::function<void(std::function<void()>)> Dispatch;
+
+		explicit LoadPipeline(Dispatch dispatch);
+		LoadPipeline(const LoadPipeline&) = delete;
+		LoadPipeline& operator=(const LoadPipeline&) = delete;
+		~LoadPipeline();
+
+		// Safe from any thread, tasks add the items they fan out to.
+		void Add(std::vector<Task>&& tasks);
+
+		// Runs ready main thread tasks, at most maxTasks of them unless it is zero, and returns how many
+		// ran. The first exception of a worker task is rethrown here, its item is dropped.
+		size_t Poll(size_t maxTasks = 0);
+
+		// Tasks of the stage that have not run yet, items added later not counted.
+		size_t GetPending(Stage stage) const { return mPending[static_cast<size_t>(stage)].load(std::memory_order_acquire); }
+
+		size_t GetCompleted(Stage stage) const { return mCompleted[static_cast<size_t>(stage)].load(std::memory_order_acquire); }
+
+		// Every item added so far has finished or was dropped.
+		bool Idle() const { return mItems.load(std::memory_order_acquire) == 0; }
+
+		// Drops the tasks that have not started and waits for the worker tasks that have.
+		void Cancel();
+
+	private:
+		struct Item
+		{
+			std::vector<Task> tasks;
+			size_t next = 0;
+		};
+
+		// Hands the next task of the item out, or drops the item when it is done or cancelled.
+		void Advance(Item* item);
+
+		void RunWorker(Item* item);
+
+		void Complete(Item* item);
+
+		void Drop(Item* item);
+
+		Dispatch mDispatch;
+
+		std::mutex mLock;
+		std::deque<Item*> mReady;
+		std::exception_ptr mException;
+
+		std::atomic<size_t> mItems{ 0 };
+		// Worker tasks dispatched that have not returned.
+		std::atomic<size_t> mRunning{ 0 };
+		std::atomic<bool> bCancelled{ false };
+
+		std::atomic<size_t> mPending[static_cast<size_t>(Stage::Count)] = {};
+		std::atomic<size_t> mCompleted[static_cast<size_t>(Stage::Count)] = {};
+	};
+}
@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "Common/MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <system_error>
+#endif // _WIN32
+
+namespace Amadeus
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::wstring& fileName)
+	{
+		mFile = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+
+		LARGE_INTEGER size = {};
+		if (!GetFileSizeEx(mFile, &size))
+		{
+			const DWORD error = GetLastError();
+			CloseHandle(mFile);
+			ThrowIfFailed(HRESULT_FROM_WIN32(error));
+		}
+
+		// Empty files can not be mapped, they are simply empty.
+		mSize = static_cast<size_t>(size.QuadPart);
+		if (mSize == 0)
+			return;
+
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mMapping != nullptr)
+		{
+			mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		}
+
+		if (mData == nullptr)
+		{
+			const DWORD error = GetLastError();
+			if (mMapping != nullptr)
+				CloseHandle(mMapping);
+			CloseHandle(mFile);
+			ThrowIfFailed(HRESULT_FROM_WIN32(error));
+		}
+	}
+
+	MappedFile::~MappedFile() noexcept
+	{
+		if (mData != nullptr)
+			UnmapViewOfFile(mData);
+		if (mMapping != nullptr)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+	}
+#else
+	MappedFile::MappedFile(const std::wstring& fileName)
+	{
+		const std::string path = std::filesystem::path(fileName).string();
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+		{
+			throw std::system_error(errno, std::generic_category(), "MappedFile " + path);
+		}
+
+		struct stat status = {};
+		if (fstat(file, &status) != 0)
+		{
+			const int error = errno;
+			close(file);
+			throw std::system_error(error, std::generic_category(), "MappedFile " + path);
+		}
+
+		// Empty files can not be mapped, they are simply empty.
+		mSize = static_cast<size_t>(status.st_size);
+		if (mSize != 0)
+		{
+			void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data == MAP_FAILED)
+			{
+				const int error = errno;
+				close(file);
+				throw std::system_error(error, std::generic_category(), "MappedFile " + path);
+			}
+			mData = static_cast<const uint8_t*>(data);
+		}
+		close(file);
+	}
+
+	MappedFile::~MappedFile() noexcept
+	{
+		if (mData != nullptr)
+			munmap(const_cast<uint8_t*>(mData), mSize);
+	}
+#endif // _WIN32
+}
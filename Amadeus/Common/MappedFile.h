@@ -0,0 +1,26 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Read-only mapping of a whole file. The bytes stay valid until the object is destroyed,
+	// pages are only read from disk when they are touched. Maps through CreateFileMapping on
+	// Windows and mmap elsewhere, the descriptor is closed once the mapping holds the file.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::wstring& fileName);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile() noexcept;
+
+		std::span<const uint8_t> GetBytes() const { return std::span<const uint8_t>(mData, mSize); }
+
+	private:
+#ifdef _WIN32
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+#endif // _WIN32
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+	};
+}
@@ -0,0 +1,430 @@
+#include "pch.h"
+#include "Common/MeshOptimizer.h"
+
+namespace Amadeus
+{
+	// Size of the LRU cache the vertex cache pass models. It is larger than the FIFO used for the
+	// statistics, an order that is good for a large cache stays good for smaller ones.
+	static constexpr uint32_t LruCacheSize = 32;
+	static constexpr uint32_t MaxValence = 32;
+	static constexpr uint32_t InvalidIndex = ~0u;
+
+	struct VertexScoreTable
+	{
+		float cache[LruCacheSize];
+		float valence[MaxValence + 1];
+
+		VertexScoreTable()
+		{
+			// The vertices of the last triangle get a fixed score, so that the next triangle does
+			// not strictly prefer reusing the same edge.
+			for (uint32_t i = 0; i < LruCacheSize; ++i)
+			{
+				cache[i] = i < 3 ? 0.75f : std::pow(1.0f - (i - 3) / static_cast<float>(LruCacheSize - 3), 1.5f);
+			}
+
+			// Vertices with few triangles left are finished first, so they can leave the cache.
+			valence[0] = 0.0f;
+			for (uint32_t i = 1; i <= MaxValence; ++i)
+			{
+				valence[i] = 2.0f / std::sqrt(static_cast<float>(i));
+			}
+		}
+	};
+
+	static float VertexScore(const VertexScoreTable& table, uint32_t cachePosition, uint32_t liveTriangles)
+	{
+		if (liveTriangles == 0)
+			return -1.0f;
+
+		const float cacheScore = cachePosition < LruCacheSize ? table.cache[cachePosition] : 0.0f;
+		const float valenceScore = liveTriangles <= MaxValence ? table.valence[liveTriangles]
+			: 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+		return cacheScore + valenceScore;
+	}
+
+	// FIFO cache keyed by timestamps, a vertex is cached while fewer than cacheSize misses happened since its own.
+	struct FifoCache
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t cacheSize;
+
+		FifoCache(size_t vertexCount, uint32_t size)
+			: timestamps(vertexCount, 0)
+			, time(size + 1)
+			, cacheSize(size)
+		{
+		}
+
+		uint32_t Access(uint32_t vertex)
+		{
+			if (time - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = time++;
+				return 1;
+			}
+			return 0;
+		}
+
+		void Flush()
+		{
+			time += cacheSize + 1;
+		}
+	};
+
+	MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount,
+		size_t vertexCount, uint32_t cacheSize)
+	{
+		assert(indexCount % 3 == 0);
+
+		CacheStatistics statistics;
+		if (indexCount == 0)
+			return statistics;
+
+		FifoCache cache(vertexCount, cacheSize);
+		std::vector<bool> referenced(vertexCount, false);
+		size_t misses = 0;
+		size_t uniqueVertices = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			assert(indices[i] < vertexCount);
+			misses += cache.Access(indices[i]);
+			if (!referenced[indices[i]])
+			{
+				referenced[indices[i]] = true;
+				++uniqueVertices;
+			}
+		}
+
+		statistics.acmr = static_cast<float>(misses) / (indexCount / 3);
+		statistics.atvr = static_cast<float>(misses) / uniqueVertices;
+		return statistics;
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+		uint32_t* destination)
+	{
+		assert(indexCount % 3 == 0);
+		assert(indexCount == 0 || indices != destination);
+
+		static const VertexScoreTable table;
+		const size_t triangleCount = indexCount / 3;
+
+		// Triangles of every vertex, the first liveTriangles[vertex] entries are the ones not emitted yet.
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			assert(indices[i] < vertexCount);
+			++liveTriangles[indices[i]];
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+		}
+
+		std::vector<uint32_t> adjacency(indexCount);
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<uint32_t> cachePositions(vertexCount, InvalidIndex);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			vertexScores[vertex] = VertexScore(table, InvalidIndex, liveTriangles[vertex]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			const uint32_t* corners = indices + triangle * 3;
+			triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+		}
+
+		std::vector<bool> emitted(triangleCount, false);
+		uint32_t cache[LruCacheSize + 3];
+		uint32_t nextCache[LruCacheSize + 3];
+		uint32_t cacheCount = 0;
+
+		uint32_t best = InvalidIndex;
+		size_t cursor = 0;
+		for (size_t output = 0; output < triangleCount; ++output)
+		{
+			// Dead end, nothing in the cache has triangles left. Restart at the first triangle not emitted.
+			if (best == InvalidIndex)
+			{
+				while (emitted[cursor])
+					++cursor;
+				best = static_cast<uint32_t>(cursor);
+			}
+
+			const uint32_t* corners = indices + best * 3;
+			memcpy(destination + output * 3, corners, sizeof(uint32_t) * 3);
+			emitted[best] = true;
+
+			// Degenerate triangles list a vertex more than once, so one entry is removed per corner.
+			uint32_t nextCount = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = corners[corner];
+				uint32_t* triangles = adjacency.data() + adjacencyOffsets[vertex];
+				uint32_t& live = liveTriangles[vertex];
+				for (uint32_t i = 0; i < live; ++i)
+				{
+					if (triangles[i] == best)
+					{
+						std::swap(triangles[i], triangles[live - 1]);
+						--live;
+						break;
+					}
+				}
+
+				if (std::find(nextCache, nextCache + nextCount, vertex) == nextCache + nextCount)
+					nextCache[nextCount++] = vertex;
+			}
+
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				const uint32_t vertex = cache[i];
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+					nextCache[nextCount++] = vertex;
+			}
+
+			// Rescore everything that moved, evicted vertices included.
+			for (uint32_t i = 0; i < nextCount; ++i)
+			{
+				const uint32_t vertex = nextCache[i];
+				cachePositions[vertex] = i < LruCacheSize ? i : InvalidIndex;
+
+				const float score = VertexScore(table, cachePositions[vertex], liveTriangles[vertex]);
+				const float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				const uint32_t* triangles = adjacency.data() + adjacencyOffsets[vertex];
+				for (uint32_t j = 0; j < liveTriangles[vertex]; ++j)
+				{
+					triangleScores[triangles[j]] += delta;
+				}
+			}
+
+			cacheCount = (std::min)(nextCount, LruCacheSize);
+			memcpy(cache, nextCache, sizeof(uint32_t) * cacheCount);
+
+			// The next triangle is the best one that touches the cache.
+			best = InvalidIndex;
+			float bestScore = -1.0f;
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				const uint32_t vertex = cache[i];
+				const uint32_t* triangles = adjacency.data() + adjacencyOffsets[vertex];
+				for (uint32_t j = 0; j < liveTriangles[vertex]; ++j)
+				{
+					const uint32_t triangle = triangles[j];
+					if (triangleScores[triangle] > bestScore
+						|| (triangleScores[triangle] == bestScore && triangle < best))
+					{
+						best = triangle;
+						bestScore = triangleScores[triangle];
+					}
+				}
+			}
+		}
+	}
+
+	// Writes the clusters front to back: clusters far out along their own normal are likely to
+	// occlude the rest and are drawn first.
+	static void SortClusters(const uint32_t* indices, const std::vector<uint32_t>& clusters,
+		const float* positions, size_t positionStride, [[maybe_unused]] size_t vertexCount, uint32_t* destination)
+	{
+		auto position = [&](uint32_t vertex) {
+			assert(vertex < vertexCount);
+			return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+		};
+
+		// Area weighted centroid and summed normal of every cluster.
+		struct Cluster
+		{
+			double centroid[3];
+			double normal[3];
+			double area;
+			float sortKey;
+		};
+		const size_t clusterCount = clusters.size() - 1;
+		std::vector<Cluster> clusterData(clusterCount, Cluster{});
+		double meshCentroid[3] = {};
+		double meshArea = 0.0;
+		for (size_t i = 0; i < clusterCount; ++i)
+		{
+			Cluster& cluster = clusterData[i];
+			for (uint32_t triangle = clusters[i]; triangle < clusters[i + 1]; ++triangle)
+			{
+				const float* p0 = position(indices[triangle * 3 + 0]);
+				const float* p1 = position(indices[triangle * 3 + 1]);
+				const float* p2 = position(indices[triangle * 3 + 2]);
+
+				const double e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const double e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				const double normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+				const double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const double center = (static_cast<double>(p0[axis]) + p1[axis] + p2[axis]) / 3.0;
+					cluster.centroid[axis] += center * area;
+					cluster.normal[axis] += normal[axis];
+					meshCentroid[axis] += center * area;
+				}
+				cluster.area += area;
+				meshArea += area;
+			}
+		}
+
+		if (meshArea > 0.0)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+				meshCentroid[axis] /= meshArea;
+		}
+
+		for (auto& cluster : clusterData)
+		{
+			const double normalLength = std::sqrt(cluster.normal[0] * cluster.normal[0]
+				+ cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+			cluster.sortKey = 0.0f;
+			if (cluster.area > 0.0 && normalLength > 0.0)
+			{
+				double key = 0.0;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					key += (cluster.centroid[axis] / cluster.area - meshCentroid[axis]) * cluster.normal[axis] / normalLength;
+				}
+				cluster.sortKey = static_cast<float>(key);
+			}
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		for (size_t i = 0; i < clusterCount; ++i)
+			order[i] = static_cast<uint32_t>(i);
+
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return clusterData[a].sortKey > clusterData[b].sortKey;
+		});
+
+		size_t output = 0;
+		for (uint32_t cluster : order)
+		{
+			const size_t count = (clusters[cluster + 1] - clusters[cluster]) * 3;
+			memcpy(destination + output, indices + clusters[cluster] * 3, sizeof(uint32_t) * count);
+			output += count;
+		}
+		assert(output == clusters.back() * 3);
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		float threshold, uint32_t* destination)
+	{
+		assert(indexCount % 3 == 0);
+		assert(indexCount == 0 || indices != destination);
+
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Hard boundaries are where the cache order jumped, the first triangle after a jump misses every corner.
+		std::vector<uint32_t> hardBoundaries;
+		{
+			FifoCache cache(vertexCount, DefaultCacheSize);
+			for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+			{
+				const uint32_t* corners = indices + triangle * 3;
+				const uint32_t misses = cache.Access(corners[0]) + cache.Access(corners[1]) + cache.Access(corners[2]);
+				if (triangle == 0 || misses == 3)
+					hardBoundaries.push_back(static_cast<uint32_t>(triangle));
+			}
+		}
+		hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+		// Soft boundaries split a hard cluster wherever the part so far is already close to the
+		// ACMR of the whole cluster, so that restarting the cache there costs little.
+		std::vector<uint32_t> clusters;
+		{
+			FifoCache cache(vertexCount, DefaultCacheSize);
+			for (size_t i = 0; i + 1 < hardBoundaries.size(); ++i)
+			{
+				const uint32_t begin = hardBoundaries[i];
+				const uint32_t end = hardBoundaries[i + 1];
+
+				cache.Flush();
+				uint32_t clusterMisses = 0;
+				for (uint32_t triangle = begin; triangle < end; ++triangle)
+				{
+					const uint32_t* corners = indices + triangle * 3;
+					clusterMisses += cache.Access(corners[0]) + cache.Access(corners[1]) + cache.Access(corners[2]);
+				}
+				const float limit = threshold * clusterMisses / (end - begin);
+
+				cache.Flush();
+				clusters.push_back(begin);
+				uint32_t start = begin;
+				uint32_t misses = 0;
+				for (uint32_t triangle = begin; triangle < end; ++triangle)
+				{
+					const uint32_t* corners = indices + triangle * 3;
+					misses += cache.Access(corners[0]) + cache.Access(corners[1]) + cache.Access(corners[2]);
+					if (triangle + 1 < end && misses <= limit * (triangle + 1 - start))
+					{
+						cache.Flush();
+						clusters.push_back(triangle + 1);
+						start = triangle + 1;
+						misses = 0;
+					}
+				}
+			}
+		}
+		clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+		// Restarting the cache at every cluster costs more than the threshold on some meshes. Then
+		// only the hard clusters are sorted, and if even that costs too much the order is kept.
+		const float limit = threshold * AnalyzeVertexCache(indices, indexCount, vertexCount).acmr;
+		SortClusters(indices, clusters, positions, positionStride, vertexCount, destination);
+		if (AnalyzeVertexCache(destination, indexCount, vertexCount).acmr <= limit)
+			return;
+
+		SortClusters(indices, hardBoundaries, positions, positionStride, vertexCount, destination);
+		if (AnalyzeVertexCache(destination, indexCount, vertexCount).acmr <= limit)
+			return;
+
+		memcpy(destination, indices, sizeof(uint32_t) * indexCount);
+	}
+
+
+	size_t MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, size_t indexCount,
+		void* vertices, size_t vertexCount, size_t vertexSize)
+	{
+		std::vector<uint32_t> remap(vertexCount, InvalidIndex);
+		uint32_t nextVertex = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t& vertex = remap[indices[i]];
+			if (vertex == InvalidIndex)
+				vertex = nextVertex++;
+			indices[i] = vertex;
+		}
+
+		uint8_t* data = static_cast<uint8_t*>(vertices);
+		const std::vector<uint8_t> source(data, data + vertexCount * vertexSize);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			if (remap[vertex] != InvalidIndex)
+				memcpy(data + remap[vertex] * vertexSize, source.data() + vertex * vertexSize, vertexSize);
+		}
+		return nextVertex;
+	}
+}
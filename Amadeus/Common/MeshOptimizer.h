@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Reorders indexed triangle lists at import time. The vertex cache pass follows Forsyth's
+	// linear-speed optimizer, the overdraw pass splits that order into clusters and sorts them
+	// front to back like Tipsify does, the vertex fetch pass renumbers vertices in first use order.
+	// Every pass is deterministic, ties are broken by the original order.
+	class MeshOptimizer
+	{
+	public:
+		// Post-transform cache statistics of a FIFO cache. ACMR is transformed vertices per
+		// triangle, ATVR is transformed vertices per referenced vertex, 1 is optimal for ATVR.
+		struct CacheStatistics
+		{
+			float acmr = 0.0f;
+			float atvr = 0.0f;
+		};
+
+		struct Report
+		{
+			CacheStatistics before;
+			CacheStatistics after;
+			size_t triangleCount = 0;
+		};
+
+		static constexpr uint32_t DefaultCacheSize = 16;
+
+		// The overdraw order may get this much worse ACMR than the cache optimized order.
+		static constexpr float DefaultOverdrawThreshold = 1.05f;
+
+		static CacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+			uint32_t cacheSize = DefaultCacheSize);
+
+		// The destination must not alias the source.
+		static void OptimizeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+			uint32_t* destination);
+
+		// Expects indices already optimized for the vertex cache. Positions are three floats
+		// at the start of every vertex. The destination must not alias the source.
+		static void OptimizeOverdraw(const uint32_t* indices, size_t indexCount,
+			const float* positions, size_t positionStride, size_t vertexCount,
+			float threshold, uint32_t* destination);
+
+		// Moves vertices into the order the indices first reference them and rewrites the
+		// indices in place. Unreferenced vertices are dropped, returns the new vertex count.
+		static size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount,
+			void* vertices, size_t vertexCount, size_t vertexSize);
+	};
+}
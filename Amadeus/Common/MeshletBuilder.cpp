@@ -0,0 +1,259 @@
+#include "pch.h"
+#include "Common/MeshletBuilder.h"
+
+namespace Amadeus
+{
+	// Cost of bending the normal cone, in new vertices. Flat meshlets reject more with their cone.
+	static constexpr float ConeWeight = 0.5f;
+	// Triangles facing more than about 84 degrees apart make the cone useless.
+	static constexpr float MinConeDot = 0.1f;
+
+	static const float* GetPosition(const float* positions, size_t positionStride, uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+	}
+
+	// Normals are the unit normals of the triangles of the meshlet, zero for degenerate ones.
+	static void ComputeBounds(const std::vector<uint32_t>& vertices, const float* positions, size_t positionStride,
+		const float* normals, size_t triangleCount, MeshletBuilder::Meshlet& meshlet)
+	{
+		float minimum[3] = { (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)() };
+		float maximum[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+		for (uint32_t vertex : vertices)
+		{
+			const float* position = GetPosition(positions, positionStride, vertex);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = (std::min)(minimum[axis], position[axis]);
+				maximum[axis] = (std::max)(maximum[axis], position[axis]);
+			}
+		}
+
+		float radius = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			meshlet.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+		}
+		for (uint32_t vertex : vertices)
+		{
+			const float* position = GetPosition(positions, positionStride, vertex);
+			const float dx = position[0] - meshlet.center[0];
+			const float dy = position[1] - meshlet.center[1];
+			const float dz = position[2] - meshlet.center[2];
+			radius = (std::max)(radius, dx * dx + dy * dy + dz * dz);
+		}
+		meshlet.radius = std::sqrt(radius);
+
+		// The axis is the average direction, the cone has to reach the triangle furthest from it.
+		float axis[3] = {};
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			for (int i = 0; i < 3; ++i)
+				axis[i] += normals[triangle * 3 + i];
+		}
+
+		const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		float minimumDot = -1.0f;
+		if (length > 0.0f)
+		{
+			minimumDot = 1.0f;
+			for (int i = 0; i < 3; ++i)
+				axis[i] /= length;
+
+			for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+			{
+				const float* normal = normals + triangle * 3;
+				if (normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f)
+					continue;
+				minimumDot = (std::min)(minimumDot, normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2]);
+			}
+		}
+
+		memcpy(meshlet.coneAxis, axis, sizeof(axis));
+		meshlet.coneCutoff = minimumDot > MinConeDot ? std::sqrt(1.0f - minimumDot * minimumDot) : 1.0f;
+	}
+
+	std::vector<MeshletBuilder::Meshlet> MeshletBuilder::Build(uint32_t* indices, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount)
+	{
+		assert(indexCount % 3 == 0);
+
+		std::vector<Meshlet> meshlets;
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return meshlets;
+
+		// Vertices that differ only in normal or texture coordinates share a position id, meshlets grow across them.
+		std::vector<uint32_t> positionIds(vertexCount);
+		uint32_t positionCount = 0;
+		{
+			std::vector<uint32_t> sorted(vertexCount);
+			for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+				sorted[vertex] = static_cast<uint32_t>(vertex);
+
+			auto less = [&](uint32_t a, uint32_t b) {
+				const float* pa = GetPosition(positions, positionStride, a);
+				const float* pb = GetPosition(positions, positionStride, b);
+				return std::tie(pa[0], pa[1], pa[2], a) < std::tie(pb[0], pb[1], pb[2], b);
+			};
+			std::sort(sorted.begin(), sorted.end(), less);
+
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				if (i > 0)
+				{
+					const float* previous = GetPosition(positions, positionStride, sorted[i - 1]);
+					const float* current = GetPosition(positions, positionStride, sorted[i]);
+					if (previous[0] != current[0] || previous[1] != current[1] || previous[2] != current[2])
+						++positionCount;
+				}
+				positionIds[sorted[i]] = positionCount;
+			}
+			++positionCount;
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(positionCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			assert(indices[i] < vertexCount);
+			++adjacencyOffsets[positionIds[indices[i]] + 1];
+		}
+		for (uint32_t id = 0; id < positionCount; ++id)
+		{
+			adjacencyOffsets[id + 1] += adjacencyOffsets[id];
+		}
+
+		std::vector<uint32_t> adjacency(indexCount);
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				adjacency[fill[positionIds[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<float> normals(triangleCount * 3, 0.0f);
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			const float* p0 = GetPosition(positions, positionStride, indices[triangle * 3 + 0]);
+			const float* p1 = GetPosition(positions, positionStride, indices[triangle * 3 + 1]);
+			const float* p2 = GetPosition(positions, positionStride, indices[triangle * 3 + 2]);
+
+			const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length > 0.0f)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+					normals[triangle * 3 + axis] = normal[axis] / length;
+			}
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		std::vector<float> outputNormals;
+		outputNormals.reserve(triangleCount * 3);
+
+		std::vector<bool> assigned(triangleCount, false);
+		// Meshlet each vertex was last added to.
+		std::vector<uint32_t> vertexMeshlet(vertexCount, ~0u);
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(MaxVertices);
+
+		size_t cursor = 0;
+		while (true)
+		{
+			while (cursor < triangleCount && assigned[cursor])
+				++cursor;
+			if (cursor == triangleCount)
+				break;
+
+			const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+			const size_t firstTriangle = output.size() / 3;
+			meshletVertices.clear();
+			uint32_t meshletTriangles = 0;
+			float normalSum[3] = {};
+
+			auto newVertices = [&](uint32_t triangle) {
+				const uint32_t* corners = indices + triangle * 3;
+				uint32_t count = vertexMeshlet[corners[0]] != meshletIndex;
+				count += corners[1] != corners[0] && vertexMeshlet[corners[1]] != meshletIndex;
+				count += corners[2] != corners[0] && corners[2] != corners[1] && vertexMeshlet[corners[2]] != meshletIndex;
+				return count;
+			};
+
+			auto add = [&](uint32_t triangle) {
+				assigned[triangle] = true;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t vertex = indices[triangle * 3 + corner];
+					output.push_back(vertex);
+					if (vertexMeshlet[vertex] != meshletIndex)
+					{
+						vertexMeshlet[vertex] = meshletIndex;
+						meshletVertices.push_back(vertex);
+					}
+				}
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					normalSum[axis] += normals[triangle * 3 + axis];
+					outputNormals.push_back(normals[triangle * 3 + axis]);
+				}
+				++meshletTriangles;
+			};
+
+			add(static_cast<uint32_t>(cursor));
+			while (meshletTriangles < MaxTriangles)
+			{
+				float axis[3] = { normalSum[0], normalSum[1], normalSum[2] };
+				const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+				if (length > 0.0f)
+				{
+					for (int i = 0; i < 3; ++i)
+						axis[i] /= length;
+				}
+
+				// Prefer triangles that add the fewest vertices, then the ones that keep the cone narrow.
+				uint32_t best = ~0u;
+				float bestScore = (std::numeric_limits<float>::max)();
+				for (uint32_t vertex : meshletVertices)
+				{
+					const uint32_t id = positionIds[vertex];
+					for (uint32_t i = adjacencyOffsets[id]; i < adjacencyOffsets[id + 1]; ++i)
+					{
+						const uint32_t triangle = adjacency[i];
+						if (assigned[triangle])
+							continue;
+
+						const uint32_t extra = newVertices(triangle);
+						if (meshletVertices.size() + extra > MaxVertices)
+							continue;
+
+						const float* normal = &normals[triangle * 3];
+						const float score = extra + ConeWeight * (1.0f - (normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2]));
+						if (score < bestScore || (score == bestScore && triangle < best))
+						{
+							best = triangle;
+							bestScore = score;
+						}
+					}
+				}
+
+				if (best == ~0u)
+					break;
+				add(best);
+			}
+
+			Meshlet meshlet = {};
+			meshlet.firstIndex = static_cast<uint32_t>(firstTriangle * 3);
+			meshlet.indexCount = meshletTriangles * 3;
+			ComputeBounds(meshletVertices, positions, positionStride,
+				outputNormals.data() + firstTriangle * 3, meshletTriangles, meshlet);
+			meshlets.push_back(meshlet);
+		}
+
+		memcpy(indices, output.data(), sizeof(uint32_t) * indexCount);
+		return meshlets;
+	}
+}
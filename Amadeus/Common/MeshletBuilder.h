@@ -0,0 +1,32 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Splits an indexed triangle list into meshlets, small clusters of triangles with their own
+	// bounding sphere and normal cone. The indices are regrouped so that every meshlet is one
+	// contiguous range, a range of meshlets can be drawn with a single indexed draw.
+	class MeshletBuilder
+	{
+	public:
+		static constexpr uint32_t MaxVertices = 64;
+		static constexpr uint32_t MaxTriangles = 124;
+
+		struct Meshlet
+		{
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			// Bounding sphere in the space of the positions.
+			float center[3];
+			float radius;
+			// Every triangle normal lies within the cone around the axis. The cutoff is the sine of
+			// the half angle, 1 when the triangles face too many ways for the cone to reject anything.
+			float coneAxis[3];
+			float coneCutoff;
+		};
+
+		// Meshlets grow from the first triangle not yet taken, across shared positions so that
+		// texture seams do not split them. The input order is kept at meshlet granularity.
+		static std::vector<Meshlet> Build(uint32_t* indices, size_t indexCount,
+			const float* positions, size_t positionStride, size_t vertexCount);
+	};
+}
@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "Common/MipGenerator.h"
+
+namespace Amadeus
+{
+	static constexpr double KaiserRadius = 3.0;
+	static constexpr double KaiserAlpha = 4.0;
+
+	// Source texels that contribute to each destination texel, a contiguous range per texel.
+	struct Taps
+	{
+		std::vector<uint32_t> first;
+		std::vector<uint32_t> count;
+		std::vector<uint32_t> offset;
+		std::vector<float> weights;
+		uint32_t maxCount = 0;
+	};
+
+	struct Tables
+	{
+		// Byte to linear float, indexed by whether the byte is sRGB encoded.
+		float toLinear[2][256];
+		// Linear float quantized to 16 bits to sRGB byte, fine enough near black where the curve is steep.
+		uint8_t toSrgb[65536];
+	};
+
+	static const Tables& GetTables()
+	{
+		static const std::unique_ptr<Tables> tables = []
+		{
+			std::unique_ptr<Tables> built(new Tables());
+			for (int i = 0; i < 256; ++i)
+			{
+				const double value = i / 255.0;
+				built->toLinear[0][i] = static_cast<float>(value);
+				built->toLinear[1][i] = static_cast<float>(
+					value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+			}
+			for (int i = 0; i < 65536; ++i)
+			{
+				const double value = i / 65535.0;
+				const double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+				built->toSrgb[i] = static_cast<uint8_t>((std::min)(255.0, encoded * 255.0 + 0.5));
+			}
+			return built;
+		}();
+		return *tables;
+	}
+
+	static double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	// x in destination texels.
+	static double Kaiser(double x)
+	{
+		if (std::abs(x) >= KaiserRadius)
+			return 0.0;
+
+		const double pi = 3.14159265358979323846;
+		const double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+		const double t = x / KaiserRadius;
+		return sinc * BesselI0(KaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(KaiserAlpha);
+	}
+
+	static Taps ComputeTaps(uint32_t sourceSize, uint32_t destinationSize, MipGenerator::Filter filter)
+	{
+		Taps taps;
+		taps.first.resize(destinationSize);
+		taps.count.resize(destinationSize);
+		taps.offset.resize(destinationSize);
+
+		// Texel j covers [j, j + 1) of the source, destination texel i is centered on (i + 0.5) * scale.
+		const double scale = static_cast<double>(sourceSize) / destinationSize;
+		const double support = filter == MipGenerator::Filter::BOX ? scale * 0.5 : KaiserRadius * scale;
+		const int64_t last = static_cast<int64_t>(sourceSize) - 1;
+
+		std::vector<double> weights;
+		for (uint32_t i = 0; i < destinationSize; ++i)
+		{
+			const double center = (i + 0.5) * scale;
+			const double low = center - support;
+			const double high = center + support;
+			const int64_t begin = static_cast<int64_t>(std::floor(low));
+			const int64_t end = static_cast<int64_t>(std::ceil(high));
+
+			// Texels past an edge fold onto it, the range stays contiguous.
+			const int64_t first = std::clamp<int64_t>(begin, 0, last);
+			const int64_t limit = std::clamp<int64_t>(end - 1, 0, last);
+			weights.assign(static_cast<size_t>(limit - first + 1), 0.0);
+
+			double sum = 0.0;
+			for (int64_t j = begin; j < end; ++j)
+			{
+				double weight;
+				if (filter == MipGenerator::Filter::BOX)
+					weight = (std::min)(high, j + 1.0) - (std::max)(low, static_cast<double>(j));
+				else
+					weight = Kaiser((j + 0.5 - center) / scale);
+
+				weights[static_cast<size_t>(std::clamp<int64_t>(j, 0, last) - first)] += weight;
+				sum += weight;
+			}
+
+			taps.first[i] = static_cast<uint32_t>(first);
+			taps.count[i] = static_cast<uint32_t>(weights.size());
+			taps.offset[i] = static_cast<uint32_t>(taps.weights.size());
+			for (double weight : weights)
+			{
+				taps.weights.push_back(static_cast<float>(weight / sum));
+			}
+			taps.maxCount = (std::max)(taps.maxCount, taps.count[i]);
+		}
+		return taps;
+	}
+
+	static void DecodeRow(const uint8_t* pixels, uint32_t width, bool bSrgb, float* row)
+	{
+		const Tables& tables = GetTables();
+		const float* color = tables.toLinear[bSrgb ? 1 : 0];
+		const float* alpha = tables.toLinear[0];
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			row[x * 4 + 0] = color[pixels[x * 4 + 0]];
+			row[x * 4 + 1] = color[pixels[x * 4 + 1]];
+			row[x * 4 + 2] = color[pixels[x * 4 + 2]];
+			row[x * 4 + 3] = alpha[pixels[x * 4 + 3]];
+		}
+	}
+
+	template<bool Simd>
+	static void FilterRow(const float* row, const Taps& taps, uint32_t width, float* filtered)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const float* weights = taps.weights.data() + taps.offset[x];
+			const float* texels = row + static_cast<size_t>(taps.first[x]) * 4;
+			const uint32_t count = taps.count[x];
+			if constexpr (Simd)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t k = 0; k < count; ++k)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(texels + k * 4)));
+				}
+				_mm_storeu_ps(filtered + x * 4, sum);
+			}
+			else
+			{
+				float sum[4] = {};
+				for (uint32_t k = 0; k < count; ++k)
+				{
+					for (int c = 0; c < 4; ++c)
+						sum[c] = sum[c] + weights[k] * texels[k * 4 + c];
+				}
+				for (int c = 0; c < 4; ++c)
+					filtered[x * 4 + c] = sum[c];
+			}
+		}
+	}
+
+	template<bool Simd>
+	static void AccumulateRow(const float* row, float weight, size_t floats, float* sum)
+	{
+		size_t i = 0;
+		if constexpr (Simd)
+		{
+			const __m128 scale = _mm_set1_ps(weight);
+			for (; i < floats; i += 4)
+			{
+				_mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(scale, _mm_loadu_ps(row + i))));
+			}
+		}
+		for (; i < floats; ++i)
+		{
+			sum[i] = sum[i] + weight * row[i];
+		}
+	}
+
+	template<bool Simd>
+	static void EncodeRow(const float* row, uint32_t width, bool bSrgb, uint8_t* pixels)
+	{
+		const uint8_t* toSrgb = GetTables().toSrgb;
+		const float colorScale = bSrgb ? 65535.0f : 255.0f;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			int32_t quantized[4];
+			if constexpr (Simd)
+			{
+				const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + x * 4), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+				const __m128 scaled = _mm_add_ps(_mm_mul_ps(clamped, _mm_setr_ps(colorScale, colorScale, colorScale, 255.0f)), _mm_set1_ps(0.5f));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(quantized), _mm_cvttps_epi32(scaled));
+			}
+			else
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					const float clamped = (std::min)((std::max)(row[x * 4 + c], 0.0f), 1.0f);
+					quantized[c] = static_cast<int32_t>(clamped * (c < 3 ? colorScale : 255.0f) + 0.5f);
+				}
+			}
+
+			for (int c = 0; c < 3; ++c)
+				pixels[x * 4 + c] = bSrgb ? toSrgb[quantized[c]] : static_cast<uint8_t>(quantized[c]);
+			pixels[x * 4 + 3] = static_cast<uint8_t>(quantized[3]);
+		}
+	}
+
+	template<bool Simd>
+	static void Downsample(const MipGenerator::Image& source, const MipGenerator::Image& destination,
+		MipGenerator::Filter filter, bool bSrgb)
+	{
+		if (destination.width > source.width || destination.height > source.height || destination.width == 0 || destination.height == 0)
+			throw std::runtime_error("MipGenerator::Downsample Error");
+
+		const Taps horizontal = ComputeTaps(source.width, destination.width, filter);
+		const Taps vertical = ComputeTaps(source.height, destination.height, filter);
+
+		// The rows a destination row reads slide down monotonically, a ring as deep as the widest
+		// window holds them without filtering a row twice.
+		const size_t floats = static_cast<size_t>(destination.width) * 4;
+		const uint32_t ringSize = vertical.maxCount;
+		std::vector<float> decoded(static_cast<size_t>(source.width) * 4);
+		std::vector<float> ring(ringSize * floats);
+		std::vector<int64_t> ringRows(ringSize, -1);
+		std::vector<float> sum(floats);
+
+		for (uint32_t y = 0; y < destination.height; ++y)
+		{
+			std::fill(sum.begin(), sum.end(), 0.0f);
+
+			const float* weights = vertical.weights.data() + vertical.offset[y];
+			for (uint32_t k = 0; k < vertical.count[y]; ++k)
+			{
+				const uint32_t row = vertical.first[y] + k;
+				const uint32_t slot = row % ringSize;
+				float* filtered = ring.data() + slot * floats;
+				if (ringRows[slot] != row)
+				{
+					DecodeRow(source.pixels + row * source.rowPitch, source.width, bSrgb, decoded.data());
+					FilterRow<Simd>(decoded.data(), horizontal, destination.width, filtered);
+					ringRows[slot] = row;
+				}
+				AccumulateRow<Simd>(filtered, weights[k], floats, sum.data());
+			}
+
+			EncodeRow<Simd>(sum.data(), destination.width, bSrgb, destination.pixels + y * destination.rowPitch);
+		}
+	}
+
+	uint32_t MipGenerator::GetLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		uint32_t size = (std::max)(width, height);
+		while (size > 1)
+		{
+			size >>= 1;
+			++levels;
+		}
+		return levels;
+	}
+
+	void MipGenerator::Downsample(const Image& source, const Image& destination, Filter filter, bool bSrgb)
+	{
+		Amadeus::Downsample<true>(source, destination, filter, bSrgb);
+	}
+
+	void MipGenerator::DownsampleScalar(const Image& source, const Image& destination, Filter filter, bool bSrgb)
+	{
+		Amadeus::Downsample<false>(source, destination, filter, bSrgb);
+	}
+}
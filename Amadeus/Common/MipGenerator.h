@@ -0,0 +1,41 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Builds mip levels of 8-bit RGBA or BGRA images on the cpu. A level is filtered from the one
+	// above it in linear space, so sRGB color is decoded before and encoded after the filter, alpha is
+	// always linear. The filters are separable, each source row is filtered horizontally once into a
+	// small ring of rows the vertical pass reads, edges are clamped. The kernels use SSE, the scalar
+	// kernels are the reference for them.
+	class MipGenerator
+	{
+	public:
+		enum class Filter : uint8_t
+		{
+			// Average of the texels a destination texel covers.
+			BOX,
+			// Kaiser windowed sinc over three destination texels each side, sharper than the box with
+			// a little ringing at hard edges.
+			KAISER,
+		};
+
+		struct Image
+		{
+			uint32_t width;
+			uint32_t height;
+			size_t rowPitch;
+			uint8_t* pixels;
+		};
+
+		// Levels of the full chain down to 1x1.
+		static uint32_t GetLevelCount(uint32_t width, uint32_t height);
+
+		// Size of the level below, halved and at least one texel.
+		static uint32_t GetNextSize(uint32_t size) { return size > 1 ? size / 2 : 1; }
+
+		// Filters source into destination, which is at most as large in each dimension.
+		static void Downsample(const Image& source, const Image& destination, Filter filter, bool bSrgb);
+
+		static void DownsampleScalar(const Image& source, const Image& destination, Filter filter, bool bSrgb);
+	};
+}
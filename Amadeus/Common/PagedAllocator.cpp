@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "Common/PagedAllocator.h"
+
+namespace Amadeus
+{
+	PagedAllocator::PagedAllocator(uint32_t pageSize, uint64_t stride)
+		: mPageSize(pageSize)
+		, mStride(stride)
+	{
+	}
+
+	uint64_t PagedAllocator::Allocate(uint32_t count, const CreatePage& createPage)
+	{
+		if (count == 0 || count > mPageSize)
+			return InvalidAddress;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (uint32_t page = mFirstFreePage; page < mPages.size(); ++page)
+		{
+			const uint32_t offset = mPages[page].slots.Allocate(count);
+			if (offset != RangeAllocator::InvalidOffset)
+			{
+				if (count == 1)
+					mFirstFreePage = page;
+				return mPages[page].base + offset * mStride;
+			}
+		}
+
+		const uint32_t page = static_cast<uint32_t>(mPages.size());
+		mPages.push_back({ createPage(page), RangeAllocator(mPageSize) });
+		if (count == 1)
+			mFirstFreePage = page;
+		return mPages.back().base + mPages.back().slots.Allocate(count) * mStride;
+	}
+
+	void PagedAllocator::Free(uint64_t address, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		const uint64_t pageBytes = mPageSize * mStride;
+		for (uint32_t page = 0; page < mPages.size(); ++page)
+		{
+			const uint64_t base = mPages[page].base;
+			if (address < base || address >= base + pageBytes)
+				continue;
+
+			mPages[page].slots.Free(static_cast<uint32_t>((address - base) / mStride), count);
+			mFirstFreePage = (std::min)(mFirstFreePage, page);
+			return;
+		}
+		assert(!"PagedAllocator::Free of an address outside every page");
+	}
+
+	uint32_t PagedAllocator::GetPageCount() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return static_cast<uint32_t>(mPages.size());
+	}
+
+	uint64_t PagedAllocator::GetAllocated() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		uint64_t allocated = 0;
+		for (const auto& page : mPages)
+			allocated += page.slots.GetAllocated();
+		return allocated;
+	}
+}
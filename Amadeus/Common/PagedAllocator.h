@@ -0,0 +1,44 @@
+#pragma once
+#include "Common/RangeAllocator.h"
+
+namespace Amadeus
+{
+	// Slots spread over pages of a fixed size, such as descriptor heaps. A page is added when none has
+	// room, an allocation never crosses pages. Addresses are the base the page was created with plus
+	// the offset in slots times the stride. Allocate and Free can be called from any thread.
+	class PagedAllocator
+	{
+	public:
+		static constexpr uint64_t InvalidAddress = ~0ull;
+
+		// Creates page, called with the lock held, and returns its base address.
+		typedef std::function<uint64_t(uint32_t page)> CreatePage;
+
+		PagedAllocator(uint32_t pageSize, uint64_t stride);
+
+		// Address of count slots in a row, InvalidAddress when count is larger than a page.
+		uint64_t Allocate(uint32_t count, const CreatePage& createPage);
+
+		void Free(uint64_t address, uint32_t count);
+
+		uint32_t GetPageCount() const;
+
+		uint32_t GetPageSize() const { return mPageSize; }
+
+		uint64_t GetAllocated() const;
+
+	private:
+		struct Page
+		{
+			uint64_t base;
+			RangeAllocator slots;
+		};
+
+		const uint32_t mPageSize;
+		const uint64_t mStride;
+		mutable std::mutex mMutex;
+		std::vector<Page> mPages;
+		// Every page before it is full.
+		uint32_t mFirstFreePage = 0;
+	};
+}
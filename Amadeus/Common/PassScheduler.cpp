@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "Common/PassScheduler.h"
+
+namespace Amadeus
+{
+	std::vector<uint32_t> PassScheduler::AssignLevels(uint32_t passCount, const std::vector<Edge>& edges, const std::vector<Access>& accesses)
+	{
+		struct ResourceLevels
+		{
+			uint32_t write = 0;
+			uint32_t read = 0;
+			bool bWritten = false;
+			bool bRead = false;
+		};
+
+		// Edges and accesses grouped by pass, keeping their order.
+		std::vector<uint32_t> edgeOffsets(passCount + 1, 0);
+		for (const Edge& edge : edges)
+			++edgeOffsets[edge.to + 1];
+		std::vector<uint32_t> accessOffsets(passCount + 1, 0);
+		uint32_t resourceCount = 0;
+		for (const Access& access : accesses)
+		{
+			++accessOffsets[access.pass + 1];
+			resourceCount = (std::max)(resourceCount, access.resource + 1);
+		}
+		for (uint32_t pass = 0; pass < passCount; ++pass)
+		{
+			edgeOffsets[pass + 1] += edgeOffsets[pass];
+			accessOffsets[pass + 1] += accessOffsets[pass];
+		}
+
+		std::vector<uint32_t> froms(edges.size());
+		std::vector<uint32_t> cursors(edgeOffsets.begin(), edgeOffsets.end() - 1);
+		for (const Edge& edge : edges)
+			froms[cursors[edge.to]++] = edge.from;
+		std::vector<const Access*> passAccesses(accesses.size());
+		cursors.assign(accessOffsets.begin(), accessOffsets.end() - 1);
+		for (const Access& access : accesses)
+			passAccesses[cursors[access.pass]++] = &access;
+
+		std::vector<uint32_t> levels(passCount, 0);
+		std::vector<ResourceLevels> resourceLevels(resourceCount);
+		for (uint32_t pass = 0; pass < passCount; ++pass)
+		{
+			uint32_t level = 0;
+			for (uint32_t i = edgeOffsets[pass]; i < edgeOffsets[pass + 1]; ++i)
+			{
+				if (froms[i] < pass)
+					level = (std::max)(level, levels[froms[i]] + 1);
+			}
+
+			for (uint32_t i = accessOffsets[pass]; i < accessOffsets[pass + 1]; ++i)
+			{
+				const ResourceLevels& resource = resourceLevels[passAccesses[i]->resource];
+				if (resource.bWritten)
+					level = (std::max)(level, resource.write + 1);
+				if (passAccesses[i]->write && resource.bRead)
+					level = (std::max)(level, resource.read + 1);
+			}
+
+			for (uint32_t i = accessOffsets[pass]; i < accessOffsets[pass + 1]; ++i)
+			{
+				ResourceLevels& resource = resourceLevels[passAccesses[i]->resource];
+				if (passAccesses[i]->write)
+				{
+					resource.write = level;
+					resource.bWritten = true;
+					resource.bRead = false;
+				}
+				else
+				{
+					resource.read = resource.bRead ? (std::max)(resource.read, level) : level;
+					resource.bRead = true;
+				}
+			}
+			levels[pass] = level;
+		}
+		return levels;
+	}
+}
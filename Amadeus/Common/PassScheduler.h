@@ -0,0 +1,119 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Drives the passes of a frame graph plan without touching D3D12, so the same code runs with
+	// mock passes. Passes are grouped into levels whose passes do not depend on each other.
+	class PassScheduler
+	{
+	public:
+		// What a plan is built for. The pass set is not part of it, adding a pass invalidates.
+		struct Key
+		{
+			uint64_t width = 0;
+			uint32_t height = 0;
+			// One bit per toggle that changes which passes run or what they access.
+			uint32_t toggles = 0;
+
+			bool operator==(const Key&) const = default;
+		};
+
+		// A pass reading what another one wrote, through a graph edge. Passes are indices
+		// into the live passes in declaration order.
+		struct Edge
+		{
+			uint32_t from;
+			uint32_t to;
+		};
+
+		struct Access
+		{
+			uint32_t pass;
+			uint32_t resource;
+			bool write;
+		};
+
+		// Calls build() when the plan was built for another key or invalidated since, then
+		// visit(pass) for every pass. A plan that is still valid is neither built nor copied,
+		// so compiling it does not allocate. If build throws the plan stays invalid.
+		template<class Passes, class Build, class Visit>
+		void Compile(const Key& key, const Passes& passes, Build&& build, Visit&& visit);
+
+		void Invalidate() noexcept { bValid = false; }
+
+		bool IsValid(const Key& key) const noexcept { return bValid && mKey == key; }
+
+		// Returns the level of every pass. Besides the edges, a pass writing a resource is kept
+		// on a later level than every pass before it that touches the resource, and a pass
+		// reading it on a later level than the last write. Reads of the same resource may
+		// share a level. Accesses of a pass are taken in the order they are given, edges from
+		// a later pass are ignored.
+		static std::vector<uint32_t> AssignLevels(uint32_t passCount, const std::vector<Edge>& edges, const std::vector<Access>& accesses);
+
+		// Records the levels in order. The passes of a level are recorded in parallel on the jobs,
+		// the calling thread helping while it waits, and submit(level) runs once every pass of the
+		// level is recorded. Without jobs or AMADEUS_CONCURRENCY they are recorded one after the
+		// other on the calling thread. False once a pass fails, later levels are not submitted.
+		template<class Levels, class Record, class Submit>
+		static bool Execute(JobSystem* jobs, const Levels& levels, Record&& record, Submit&& submit);
+
+	private:
+		Key mKey;
+		bool bValid = false;
+	};
+
+	template<class Passes, class Build, class Visit>
+	inline void PassScheduler::Compile(const Key& key, const Passes& passes, Build&& build, Visit&& visit)
+	{
+		if (!IsValid(key))
+		{
+			bValid = false;
+			build();
+			mKey = key;
+			bValid = true;
+		}
+
+		for (const auto& pass : passes)
+		{
+			visit(pass);
+		}
+	}
+
+	template<class Levels, class Record, class Submit>
+	inline bool PassScheduler::Execute(JobSystem* jobs, const Levels& levels, Record&& record, Submit&& submit)
+	{
+		for (const auto& level : levels)
+		{
+#ifdef AMADEUS_CONCURRENCY
+			if (jobs && level.size() > 1)
+			{
+				Job* root = jobs->CreateJob([] {});
+				std::atomic<bool> failed = false;
+				for (const auto& pass : level)
+				{
+					jobs->Run(jobs->CreateChildJob(root, [&record, &failed, &pass]
+					{
+						if (!record(pass))
+							failed.store(true, std::memory_order_relaxed);
+					}));
+				}
+				jobs->Run(root);
+				jobs->Wait(root);
+				if (failed.load())
+					return false;
+			}
+			else
+#endif // AMADEUS_CONCURRENCY
+			{
+				for (const auto& pass : level)
+				{
+					if (!record(pass))
+						return false;
+				}
+			}
+
+			submit(level);
+		}
+		return true;
+	}
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "Common/RangeAllocator.h"
+
+namespace Amadeus
+{
+	RangeAllocator::RangeAllocator(uint32_t capacity)
+	{
+		Reset(capacity);
+	}
+
+	void RangeAllocator::Reset(uint32_t capacity)
+	{
+		mCapacity = capacity;
+		mAllocated = 0;
+		mFreeRanges.clear();
+		if (capacity > 0)
+			mFreeRanges.emplace(0, capacity);
+	}
+
+	uint32_t RangeAllocator::Allocate(uint32_t count)
+	{
+		if (count == 0)
+			return InvalidOffset;
+
+		for (auto range = mFreeRanges.begin(); range != mFreeRanges.end(); ++range)
+		{
+			if (range->second < count)
+				continue;
+
+			const uint32_t offset = range->first;
+			const uint32_t left = range->second - count;
+			mFreeRanges.erase(range);
+			if (left > 0)
+				mFreeRanges.emplace(offset + count, left);
+
+			mAllocated += count;
+			return offset;
+		}
+		return InvalidOffset;
+	}
+
+	void RangeAllocator::Free(uint32_t offset, uint32_t count)
+	{
+		if (count == 0)
+			return;
+		assert(offset + count <= mCapacity && count <= mAllocated);
+		mAllocated -= count;
+
+		auto next = mFreeRanges.lower_bound(offset);
+		assert(next == mFreeRanges.end() || offset + count <= next->first);
+		if (next != mFreeRanges.end() && next->first == offset + count)
+		{
+			count += next->second;
+			next = mFreeRanges.erase(next);
+		}
+
+		if (next != mFreeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			assert(previous->first + previous->second <= offset);
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += count;
+				return;
+			}
+		}
+
+		mFreeRanges.emplace_hint(next, offset, count);
+	}
+
+	uint32_t RangeAllocator::GetLargestFree() const
+	{
+		uint32_t largest = 0;
+		for (const auto& range : mFreeRanges)
+			largest = (std::max)(largest, range.second);
+		return largest;
+	}
+}
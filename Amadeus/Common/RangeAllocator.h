@@ -0,0 +1,35 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Hands out contiguous ranges of a fixed number of slots, first fit over a free list kept
+	// in offset order. Freed ranges merge with their free neighbours.
+	class RangeAllocator
+	{
+	public:
+		static constexpr uint32_t InvalidOffset = ~0u;
+
+		explicit RangeAllocator(uint32_t capacity = 0);
+
+		// Frees everything and changes the number of slots.
+		void Reset(uint32_t capacity);
+
+		// First slot of count free ones in a row, or InvalidOffset.
+		uint32_t Allocate(uint32_t count);
+
+		void Free(uint32_t offset, uint32_t count);
+
+		uint32_t GetCapacity() const { return mCapacity; }
+
+		uint32_t GetAllocated() const { return mAllocated; }
+
+		// Longest range Allocate could still return.
+		uint32_t GetLargestFree() const;
+
+	private:
+		uint32_t mCapacity = 0;
+		uint32_t mAllocated = 0;
+		// Offset of every free range to its size.
+		std::map<uint32_t, uint32_t> mFreeRanges;
+	};
+}
@@ -17,4 +17,7 @@ namespace Amadeus
 	static constexpr UINT COMMON_RENDER_TARGET_SSAO_TABLE_INDEX = 6;
 
 	static constexpr UINT COMMON_SAMPLER_ROOT_TABLE_INDEX = 8;
+
+	// Only in the root signature of Shaders/BindlessRS.hlsli.
+	static constexpr UINT COMMON_BINDLESS_ROOT_TABLE_INDEX = 9;
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "pch.h"
+#include "Common/ScenePackage.h"
+#include "Common/MeshletBuilder.h"
+
+namespace Amadeus
+{
+	static constexpr uint64_t RecordAlignment = 8;
+
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	ScenePackage::Writer::Writer(size_t textureCount, size_t primitiveCount)
+		: mTextures(textureCount)
+		, mTextureSubresources(textureCount)
+		, mPrimitives(primitiveCount)
+	{
+	}
+
+	void ScenePackage::Writer::SetHeader(uint32_t flags, const float boundsMin[3], const float boundsMax[3])
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mHeader.flags = flags;
+		memcpy(mHeader.boundsMin, boundsMin, sizeof(mHeader.boundsMin));
+		memcpy(mHeader.boundsMax, boundsMax, sizeof(mHeader.boundsMax));
+	}
+
+	void ScenePackage::Writer::AddSource(std::string_view path, uint64_t size, uint64_t time)
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mSources.push_back({ AddBlob(std::vector<uint8_t>(path.begin(), path.end())), size, time });
+	}
+
+	void ScenePackage::Writer::AddSampler(const SamplerRecord& record)
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mSamplers.push_back(record);
+	}
+
+	void ScenePackage::Writer::AddMaterial(const MaterialRecord& record)
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mMaterials.push_back(record);
+	}
+
+	void ScenePackage::Writer::AddNode(const NodeRecord& record)
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mNodes.push_back(record);
+	}
+
+	void ScenePackage::Writer::SetTexture(size_t index, TextureRecord record, std::string_view name,
+		std::span<const Subresource> subresources)
+	{
+		// The copies are made before the lock is taken, textures of different workers do not wait on each other.
+		std::vector<std::vector<uint8_t>> data(subresources.size());
+		for (size_t i = 0; i < subresources.size(); ++i)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(subresources[i].data);
+			data[i].assign(bytes, bytes + subresources[i].slicePitch);
+		}
+
+		std::lock_guard<std::mutex> lock(mLock);
+		if (index >= mTextures.size())
+			throw std::runtime_error("ScenePackage::Writer::SetTexture Error");
+
+		record.name = AddBlob(std::vector<uint8_t>(name.begin(), name.end()));
+		record.subresourceCount = static_cast<uint32_t>(subresources.size());
+
+		auto& records = mTextureSubresources[index];
+		records.clear();
+		for (size_t i = 0; i < subresources.size(); ++i)
+		{
+			records.push_back({ AddBlob(std::move(data[i])), subresources[i].rowPitch, subresources[i].slicePitch });
+		}
+		mTextures[index] = record;
+	}
+
+	void ScenePackage::Writer::SetPrimitive(size_t index, PrimitiveRecord record, std::span<const uint8_t> vertices,
+		std::span<const uint8_t> indices, std::span<const uint8_t> meshlets)
+	{
+		std::vector<uint8_t> vertexData(vertices.begin(), vertices.end());
+		std::vector<uint8_t> indexData(indices.begin(), indices.end());
+		std::vector<uint8_t> meshletData(meshlets.begin(), meshlets.end());
+
+		std::lock_guard<std::mutex> lock(mLock);
+		if (index >= mPrimitives.size())
+			throw std::runtime_error("ScenePackage::Writer::SetPrimitive Error");
+
+		record.vertices = AddBlob(std::move(vertexData));
+		record.indices = AddBlob(std::move(indexData));
+		record.meshlets = AddBlob(std::move(meshletData));
+		mPrimitives[index] = record;
+	}
+
+	ScenePackage::Blob ScenePackage::Writer::AddBlob(std::vector<uint8_t>&& data)
+	{
+		const Blob blob = { mBlobs.size(), data.size() };
+		mBlobs.push_back(std::move(data));
+		return blob;
+	}
+
+	void ScenePackage::Writer::Write(const std::filesystem::path& path)
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+
+		// A slot never filled has no name, a texture always has one.
+		for (const auto& texture : mTextures)
+		{
+			if (texture.name.size == 0)
+				throw std::runtime_error("ScenePackage::Writer::Write Error");
+		}
+
+		std::vector<SubresourceRecord> subresources;
+		std::vector<TextureRecord> textures = mTextures;
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			textures[i].firstSubresource = static_cast<uint32_t>(subresources.size());
+			subresources.insert(subresources.end(), mTextureSubresources[i].begin(), mTextureSubresources[i].end());
+		}
+		std::vector<PrimitiveRecord> primitives = mPrimitives;
+		std::vector<SourceRecord> sources = mSources;
+
+		// Header, record arrays and then the blobs.
+		Header header = mHeader;
+		header.magic = Magic;
+		header.version = Version;
+		header.headerSize = sizeof(Header);
+
+		uint64_t size = sizeof(Header);
+		auto place = [&size](Blob& array, size_t bytes)
+		{
+			size = AlignUp(size, RecordAlignment);
+			array = { size, bytes };
+			size += bytes;
+		};
+		place(header.samplers, mSamplers.size() * sizeof(SamplerRecord));
+		place(header.textures, textures.size() * sizeof(TextureRecord));
+		place(header.subresources, subresources.size() * sizeof(SubresourceRecord));
+		place(header.materials, mMaterials.size() * sizeof(MaterialRecord));
+		place(header.nodes, mNodes.size() * sizeof(NodeRecord));
+		place(header.primitives, primitives.size() * sizeof(PrimitiveRecord));
+		place(header.sources, sources.size() * sizeof(SourceRecord));
+
+		// Blobs follow their records rather than the order workers added them, a scene always cooks to
+		// the same bytes.
+		std::vector<uint64_t> order;
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			order.push_back(textures[i].name.offset);
+			for (const auto& subresource : mTextureSubresources[i])
+			{
+				order.push_back(subresource.data.offset);
+			}
+		}
+		for (const auto& primitive : primitives)
+		{
+			order.push_back(primitive.vertices.offset);
+			order.push_back(primitive.indices.offset);
+			order.push_back(primitive.meshlets.offset);
+		}
+		for (const auto& source : sources)
+		{
+			order.push_back(source.path.offset);
+		}
+
+		std::vector<uint64_t> offsets(mBlobs.size());
+		for (uint64_t blob : order)
+		{
+			size = AlignUp(size, BlobAlignment);
+			offsets[blob] = size;
+			size += mBlobs[blob].size();
+		}
+		header.fileSize = size;
+
+		auto resolve = [&offsets](Blob& blob) { blob.offset = offsets[blob.offset]; };
+		for (auto& texture : textures)
+		{
+			resolve(texture.name);
+		}
+		for (auto& subresource : subresources)
+		{
+			resolve(subresource.data);
+		}
+		for (auto& primitive : primitives)
+		{
+			resolve(primitive.vertices);
+			resolve(primitive.indices);
+			resolve(primitive.meshlets);
+		}
+		for (auto& source : sources)
+		{
+			resolve(source.path);
+		}
+
+		std::filesystem::path temporary = path;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			uint64_t written = 0;
+			auto write = [&file, &written](uint64_t offset, const void* data, size_t bytes)
+			{
+				static const char zeros[BlobAlignment] = {};
+				while (written < offset)
+				{
+					const size_t padding = static_cast<size_t>((std::min)(offset - written, BlobAlignment));
+					file.write(zeros, padding);
+					written += padding;
+				}
+				file.write(static_cast<const char*>(data), bytes);
+				written += bytes;
+			};
+
+			write(0, &header, sizeof(header));
+			write(header.samplers.offset, mSamplers.data(), header.samplers.size);
+			write(header.textures.offset, textures.data(), header.textures.size);
+			write(header.subresources.offset, subresources.data(), header.subresources.size);
+			write(header.materials.offset, mMaterials.data(), header.materials.size);
+			write(header.nodes.offset, mNodes.data(), header.nodes.size);
+			write(header.primitives.offset, primitives.data(), header.primitives.size);
+			write(header.sources.offset, sources.data(), header.sources.size);
+			for (uint64_t blob : order)
+			{
+				write(offsets[blob], mBlobs[blob].data(), mBlobs[blob].size());
+			}
+
+			file.close();
+			if (!file)
+				throw std::runtime_error("ScenePackage::Writer::Write Error");
+		}
+		std::filesystem::rename(temporary, path);
+	}
+
+	ScenePackage::ScenePackage(std::span<const uint8_t> bytes)
+		: mBytes(bytes)
+	{
+		if (bytes.size() < sizeof(Header) || reinterpret_cast<uintptr_t>(bytes.data()) % RecordAlignment != 0)
+			throw std::runtime_error("ScenePackage::ScenePackage Error");
+
+		mHeader = reinterpret_cast<const Header*>(bytes.data());
+		if (mHeader->magic != Magic || mHeader->version != Version || mHeader->headerSize != sizeof(Header)
+			|| mHeader->fileSize != bytes.size())
+			throw std::runtime_error("ScenePackage::ScenePackage Error");
+
+		mSamplers = GetArray<SamplerRecord>(mHeader->samplers);
+		mTextures = GetArray<TextureRecord>(mHeader->textures);
+		mSubresources = GetArray<SubresourceRecord>(mHeader->subresources);
+		mMaterials = GetArray<MaterialRecord>(mHeader->materials);
+		mNodes = GetArray<NodeRecord>(mHeader->nodes);
+		mPrimitives = GetArray<PrimitiveRecord>(mHeader->primitives);
+		mSources = GetArray<SourceRecord>(mHeader->sources);
+
+		for (const auto& texture : mTextures)
+		{
+			CheckBlob(texture.name, BlobAlignment);
+			if (texture.firstSubresource > mSubresources.size() || texture.subresourceCount > mSubresources.size() - texture.firstSubresource
+				|| (texture.subresourceCount != 0 && (texture.width == 0 || texture.height == 0
+					|| texture.subresourceCount != static_cast<uint64_t>(texture.arraySize) * texture.mipLevels)))
+				throw std::runtime_error("ScenePackage::ScenePackage Error");
+		}
+
+		for (const auto& subresource : mSubresources)
+		{
+			CheckBlob(subresource.data, BlobAlignment);
+			if (subresource.data.size != subresource.slicePitch || subresource.rowPitch > subresource.slicePitch)
+				throw std::runtime_error("ScenePackage::ScenePackage Error");
+		}
+
+		for (const auto& material : mMaterials)
+		{
+			if (material.sampler < -1 || material.sampler >= static_cast<int64_t>(mSamplers.size()))
+				throw std::runtime_error("ScenePackage::ScenePackage Error");
+			for (int32_t texture : material.textures)
+			{
+				if (texture < -1 || texture >= static_cast<int64_t>(mTextures.size()))
+					throw std::runtime_error("ScenePackage::ScenePackage Error");
+			}
+		}
+
+		for (size_t i = 0; i < mNodes.size(); ++i)
+		{
+			const auto& node = mNodes[i];
+			if (node.parent < -1 || node.parent >= static_cast<int64_t>(mNodes.size()) || node.parent == static_cast<int64_t>(i)
+				|| node.firstPrimitive > mPrimitives.size() || node.primitiveCount > mPrimitives.size() - node.firstPrimitive)
+				throw std::runtime_error("ScenePackage::ScenePackage Error");
+		}
+
+		for (const auto& primitive : mPrimitives)
+		{
+			CheckBlob(primitive.vertices, BlobAlignment);
+			CheckBlob(primitive.indices, BlobAlignment);
+			CheckBlob(primitive.meshlets, BlobAlignment);
+			if (primitive.material < -1 || primitive.material >= static_cast<int64_t>(mMaterials.size())
+				|| (primitive.indexSize != 2 && primitive.indexSize != 4) || primitive.indexCount % 3 != 0
+				|| primitive.vertices.size != static_cast<uint64_t>(primitive.vertexCount) * primitive.vertexStride
+				|| primitive.indices.size != static_cast<uint64_t>(primitive.indexCount) * primitive.indexSize
+				|| primitive.meshlets.size != static_cast<uint64_t>(primitive.meshletCount) * sizeof(MeshletBuilder::Meshlet))
+				throw std::runtime_error("ScenePackage::ScenePackage Error");
+
+			// Meshlets become draw ranges, they must stay inside the index buffer.
+			const auto* meshlets = reinterpret_cast<const MeshletBuilder::Meshlet*>(bytes.data() + primitive.meshlets.offset);
+			for (uint32_t i = 0; i < primitive.meshletCount; ++i)
+			{
+				if (meshlets[i].firstIndex > primitive.indexCount || meshlets[i].indexCount > primitive.indexCount - meshlets[i].firstIndex)
+					throw std::runtime_error("ScenePackage::ScenePackage Error");
+			}
+		}
+
+		for (const auto& source : mSources)
+		{
+			CheckBlob(source.path, BlobAlignment);
+		}
+	}
+
+	bool ScenePackage::GetStamp(const std::filesystem::path& path, uint64_t& size, uint64_t& time)
+	{
+		std::error_code error;
+		const auto fileSize = std::filesystem::file_size(path, error);
+		if (error)
+			return false;
+		const auto writeTime = std::filesystem::last_write_time(path, error);
+		if (error)
+			return false;
+
+		size = static_cast<uint64_t>(fileSize);
+		time = static_cast<uint64_t>(writeTime.time_since_epoch().count());
+		return true;
+	}
+
+	bool ScenePackage::IsCurrent(const std::filesystem::path& directory) const
+	{
+		for (const auto& source : mSources)
+		{
+			const std::string_view path = GetPath(source);
+			uint64_t size = 0;
+			uint64_t time = 0;
+			if (!GetStamp(directory / std::u8string(path.begin(), path.end()), size, time) || size != source.size || time != source.time)
+				return false;
+		}
+		return true;
+	}
+
+	template<class T>
+	std::span<const T> ScenePackage::GetArray(const Blob& blob) const
+	{
+		CheckBlob(blob, RecordAlignment);
+		if (blob.size % sizeof(T) != 0)
+			throw std::runtime_error("ScenePackage::GetArray Error");
+
+		return std::span<const T>(reinterpret_cast<const T*>(mBytes.data() + blob.offset), static_cast<size_t>(blob.size / sizeof(T)));
+	}
+
+	void ScenePackage::CheckBlob(const Blob& blob, uint64_t alignment) const
+	{
+		if (blob.offset > mBytes.size() || blob.size > mBytes.size() - blob.offset || blob.offset % alignment != 0)
+			throw std::runtime_error("ScenePackage::CheckBlob Error");
+	}
+}
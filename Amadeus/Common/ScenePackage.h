@@ -0,0 +1,256 @@
+#pragma once
+
+namespace Amadeus
+{
+	// A cooked scene in one file: a flat header, arrays of fixed size records and the blobs the records
+	// point at. Vertex and index buffers are in their final layout and textures carry every level, so
+	// loading is a matter of mapping the file and copying the blobs to the gpu. Blobs are aligned for
+	// texture placement and records refer to them by offset and size from the start of the file, to
+	// each other by index. A package with another version or another header size is not read at all.
+	class ScenePackage
+	{
+	public:
+		static constexpr uint32_t Magic = 0x4B504D41;
+		static constexpr uint32_t Version = 3;
+		static constexpr uint64_t BlobAlignment = 512;
+
+		// How the package was cooked, a loader only takes a package cooked like it would import the scene.
+		enum Flags : uint32_t
+		{
+			// Vertices are VertexPacking::PackedVertex, float vertices otherwise.
+			FLAG_QUANTIZED = 0x1,
+			FLAG_OPTIMIZED = 0x2,
+			FLAG_MESHLETS = 0x4,
+			FLAG_CPU_MIPS = 0x8,
+			FLAG_KAISER_MIPS = 0x10,
+			// Textures are block compressed, at the fast or the high quality unless neither is set.
+			FLAG_BLOCK_COMPRESSED = 0x20,
+			FLAG_COMPRESSED_FAST = 0x40,
+			FLAG_COMPRESSED_HIGH = 0x80,
+		};
+
+		struct Blob
+		{
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t headerSize;
+			uint32_t flags;
+			uint64_t fileSize;
+			float boundsMin[3];
+			float boundsMax[3];
+			// Record arrays.
+			Blob samplers;
+			Blob textures;
+			Blob subresources;
+			Blob materials;
+			Blob nodes;
+			Blob primitives;
+			Blob sources;
+		};
+
+		// One per file the scene was cooked from: the glTF or glb, then the buffers and images it refers
+		// to. A package is stale once any of them has another size or write time.
+		struct SourceRecord
+		{
+			// UTF-8, relative to the directory of the glTF.
+			Blob path;
+			uint64_t size;
+			uint64_t time;
+		};
+
+		// D3D12 filter and address modes, the other sampler fields are the same for every sampler.
+		struct SamplerRecord
+		{
+			uint32_t filter;
+			uint32_t addressU;
+			uint32_t addressV;
+			uint32_t reserved;
+		};
+
+		// One per texture of the scene, in the order materials refer to them. Textures of one image share
+		// the data of the first record with their name, the others have no subresources.
+		struct TextureRecord
+		{
+			// UTF-8, the name the texture manager knows the texture by.
+			Blob name;
+			uint32_t type;
+			uint32_t format;
+			uint32_t width;
+			uint32_t height;
+			uint32_t arraySize;
+			uint32_t mipLevels;
+			uint32_t bCubemap;
+			uint32_t firstSubresource;
+			uint32_t subresourceCount;
+			uint32_t reserved;
+		};
+
+		struct SubresourceRecord
+		{
+			Blob data;
+			uint64_t rowPitch;
+			uint64_t slicePitch;
+		};
+
+		struct MaterialRecord
+		{
+			// Base color, metallic roughness, normal, occlusion and emissive, -1 for none.
+			int32_t textures[5];
+			// Sampler record, -1 for DescriptorManager's default.
+			int32_t sampler;
+			float baseColorFactor[4];
+			float metallicFactor;
+			float roughnessFactor;
+			float normalScale;
+			float occlusionStrength;
+			float emissiveFactor[3];
+			float alphaCutoff;
+			uint32_t alphaMode;
+			uint32_t bDoubleSided;
+		};
+
+		// The nodes of the scene with the primitives of their mesh, which follow each other.
+		struct NodeRecord
+		{
+			int32_t parent;
+			uint32_t firstPrimitive;
+			uint32_t primitiveCount;
+			uint32_t reserved;
+			// Row-major, as the loader builds the model matrix.
+			float matrix[16];
+		};
+
+		struct PrimitiveRecord
+		{
+			int32_t material;
+			uint32_t vertexCount;
+			uint32_t vertexStride;
+			uint32_t indexCount;
+			// 2 or 4.
+			uint32_t indexSize;
+			uint32_t meshletCount;
+			// VertexPacking::Quantization, identity for float vertices.
+			float positionScale[3];
+			float positionOffset[3];
+			float texCoordScale[2];
+			float texCoordOffset[2];
+			Blob vertices;
+			Blob indices;
+			// MeshletBuilder::Meshlet.
+			Blob meshlets;
+		};
+
+		// Collects a scene and writes it as a package. Records may be added from several threads, the
+		// textures and primitives into slots so that their order does not depend on which comes first.
+		class Writer
+		{
+		public:
+			struct Subresource
+			{
+				const void* data;
+				uint64_t rowPitch;
+				uint64_t slicePitch;
+			};
+
+			Writer(size_t textureCount, size_t primitiveCount);
+
+			void SetHeader(uint32_t flags, const float boundsMin[3], const float boundsMax[3]);
+
+			void AddSource(std::string_view path, uint64_t size, uint64_t time);
+
+			void AddSampler(const SamplerRecord& record);
+
+			void AddMaterial(const MaterialRecord& record);
+
+			void AddNode(const NodeRecord& record);
+
+			// The blobs of the record are filled here, the data is copied.
+			void SetTexture(size_t index, TextureRecord record, std::string_view name, std::span<const Subresource> subresources);
+
+			void SetPrimitive(size_t index, PrimitiveRecord record, std::span<const uint8_t> vertices,
+				std::span<const uint8_t> indices, std::span<const uint8_t> meshlets);
+
+			// Writes next to the path first and renames, a package that exists is always complete.
+			void Write(const std::filesystem::path& path);
+
+		private:
+			// Blob offsets are blob ids until Write lays the file out.
+			Blob AddBlob(std::vector<uint8_t>&& data);
+
+			std::mutex mLock;
+			Header mHeader = {};
+			std::vector<SamplerRecord> mSamplers;
+			std::vector<TextureRecord> mTextures;
+			std::vector<std::vector<SubresourceRecord>> mTextureSubresources;
+			std::vector<MaterialRecord> mMaterials;
+			std::vector<NodeRecord> mNodes;
+			std::vector<PrimitiveRecord> mPrimitives;
+			std::vector<SourceRecord> mSources;
+			std::vector<std::vector<uint8_t>> mBlobs;
+		};
+
+		// Checks the header, that every array, blob and index of a record lies in range, throws
+		// otherwise. The bytes have to outlive the package.
+		explicit ScenePackage(std::span<const uint8_t> bytes);
+
+		// Size and last write time of a file as a package records its sources, false when the file
+		// can not be read.
+		static bool GetStamp(const std::filesystem::path& path, uint64_t& size, uint64_t& time);
+
+		// Whether every source still has the stamp it was cooked with, directory is the one of the glTF.
+		bool IsCurrent(const std::filesystem::path& directory) const;
+
+		const Header& GetHeader() const { return *mHeader; }
+
+		std::span<const SamplerRecord> GetSamplers() const { return mSamplers; }
+
+		std::span<const TextureRecord> GetTextures() const { return mTextures; }
+
+		std::span<const SubresourceRecord> GetSubresources(const TextureRecord& texture) const
+		{
+			return mSubresources.subspan(texture.firstSubresource, texture.subresourceCount);
+		}
+
+		std::span<const MaterialRecord> GetMaterials() const { return mMaterials; }
+
+		std::span<const NodeRecord> GetNodes() const { return mNodes; }
+
+		std::span<const PrimitiveRecord> GetPrimitives() const { return mPrimitives; }
+
+		std::span<const SourceRecord> GetSources() const { return mSources; }
+
+		std::span<const uint8_t> GetBlob(const Blob& blob) const { return mBytes.subspan(blob.offset, blob.size); }
+
+		std::string_view GetName(const TextureRecord& texture) const
+		{
+			return std::string_view(reinterpret_cast<const char*>(mBytes.data() + texture.name.offset), texture.name.size);
+		}
+
+		std::string_view GetPath(const SourceRecord& source) const
+		{
+			return std::string_view(reinterpret_cast<const char*>(mBytes.data() + source.path.offset), source.path.size);
+		}
+
+	private:
+		template<class T>
+		std::span<const T> GetArray(const Blob& blob) const;
+
+		void CheckBlob(const Blob& blob, uint64_t alignment) const;
+
+		std::span<const uint8_t> mBytes;
+		const Header* mHeader = nullptr;
+		std::span<const SamplerRecord> mSamplers;
+		std::span<const TextureRecord> mTextures;
+		std::span<const SubresourceRecord> mSubresources;
+		std::span<const MaterialRecord> mMaterials;
+		std::span<const NodeRecord> mNodes;
+		std::span<const PrimitiveRecord> mPrimitives;
+		std::span<const SourceRecord> mSources;
+	};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Items in the order of slots reserved up front and filled in any order. A load reserves a slot
+	// for every item in source order when it starts and fills it when the item finishes, so neither
+	// the order of the items nor their slots depend on which finished first. Filled items follow each
+	// other in slot order, empty slots take no place.
+	template<class T>
+	class SlotList
+	{
+	public:
+		// First of count slots in a row.
+		uint64_t Reserve(uint64_t count)
+		{
+			const uint64_t first = mSlotCount;
+			mSlotCount += count;
+			return first;
+		}
+
+		// Fills a reserved slot once, returns where the item went in the list.
+		size_t Set(uint64_t slot, T item)
+		{
+			auto position = std::lower_bound(mSlots.begin(), mSlots.end(), slot);
+			if (slot >= mSlotCount || (position != mSlots.end() && *position == slot))
+				throw std::runtime_error("SlotList::Set Error");
+
+			const size_t index = static_cast<size_t>(position - mSlots.begin());
+			mSlots.insert(position, slot);
+			mItems.insert(mItems.begin() + index, std::move(item));
+			return index;
+		}
+
+		// Reserves a slot after every other and fills it.
+		uint64_t Add(T item)
+		{
+			const uint64_t slot = Reserve(1);
+			mSlots.push_back(slot);
+			mItems.push_back(std::move(item));
+			return slot;
+		}
+
+		std::vector<T>& GetItems() { return mItems; }
+
+		const std::vector<T>& GetItems() const { return mItems; }
+
+		uint64_t GetSlot(size_t index) const { return mSlots[index]; }
+
+		size_t Size() const { return mItems.size(); }
+
+		uint64_t GetSlotCount() const { return mSlotCount; }
+
+		void Clear()
+		{
+			mItems.clear();
+			mSlots.clear();
+			mSlotCount = 0;
+		}
+
+	private:
+		std::vector<T> mItems;
+		// Slot of every item, ascending.
+		std::vector<uint64_t> mSlots;
+		uint64_t mSlotCount = 0;
+	};
+}
@@ -31,7 +31,9 @@ namespace Amadeus
             workers.emplace_back(
                 [this, name]
         {
+#ifdef _WIN32
             SetThreadDescription(GetCurrentThread(), name.c_str());
+#endif // _WIN32
 
             for (;;)
             {
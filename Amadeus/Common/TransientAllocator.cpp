@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "Common/TransientAllocator.h"
+
+namespace Amadeus
+{
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	TransientAllocator::Result TransientAllocator::Pack(const std::vector<Request>& requests)
+	{
+		struct Placement
+		{
+			uint64_t begin;
+			uint64_t end;
+			uint32_t first;
+			uint32_t last;
+		};
+
+		Result result;
+		result.offsets.resize(requests.size());
+
+		// Largest first, so that small resources fill the gaps between large ones.
+		std::vector<size_t> order(requests.size());
+		for (size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+			return requests[a].size > requests[b].size;
+		});
+
+		std::vector<Placement> placements;
+		std::vector<const Placement*> live;
+		placements.reserve(requests.size());
+		live.reserve(requests.size());
+
+		for (size_t index : order)
+		{
+			const Request& request = requests[index];
+			assert(request.first <= request.last);
+			assert(request.alignment > 0);
+
+			live.clear();
+			for (const auto& placement : placements)
+			{
+				if (placement.first <= request.last && request.first <= placement.last)
+					live.push_back(&placement);
+			}
+			std::sort(live.begin(), live.end(), [](const Placement* a, const Placement* b) {
+				return a->begin < b->begin;
+			});
+
+			// Lowest offset that does not overlap anything alive at the same time.
+			uint64_t offset = 0;
+			for (const auto& placement : live)
+			{
+				if (offset + request.size <= placement->begin)
+					break;
+				offset = (std::max)(offset, AlignUp(placement->end, request.alignment));
+			}
+
+			placements.push_back({ offset, offset + request.size, request.first, request.last });
+			result.offsets[index] = offset;
+			result.heapSize = (std::max)(result.heapSize, offset + request.size);
+			result.heapAlignment = (std::max)(result.heapAlignment, request.alignment);
+		}
+
+		// Placing large resources first may waste more on alignment than aliasing saves, the
+		// heap is never larger than the resources laid out one after the other.
+		if (GetUnaliasedSize(requests) < result.heapSize)
+		{
+			uint64_t offset = 0;
+			for (size_t i = 0; i < requests.size(); ++i)
+			{
+				offset = AlignUp(offset, requests[i].alignment);
+				result.offsets[i] = offset;
+				offset += requests[i].size;
+			}
+			result.heapSize = offset;
+		}
+
+		return result;
+	}
+
+	uint64_t TransientAllocator::GetUnaliasedSize(const std::vector<Request>& requests)
+	{
+		uint64_t size = 0;
+		for (const auto& request : requests)
+		{
+			size = AlignUp(size, request.alignment) + request.size;
+		}
+		return size;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Packs transient resources into a single heap. Lifetimes are inclusive ranges of
+	// levels in submission order, resources whose lifetimes do not overlap may
+	// share memory.
+	class TransientAllocator
+	{
+	public:
+		struct Request
+		{
+			uint64_t size;
+			uint64_t alignment;
+			uint32_t first;
+			uint32_t last;
+		};
+
+		struct Result
+		{
+			std::vector<uint64_t> offsets;	// One per request, in request order.
+			uint64_t heapSize = 0;
+			uint64_t heapAlignment = 1;
+		};
+
+		static Result Pack(const std::vector<Request>& requests);
+
+		// Memory needed without aliasing, for comparison.
+		static uint64_t GetUnaliasedSize(const std::vector<Request>& requests);
+	};
+}
@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "Common/UploadRing.h"
+
+namespace Amadeus
+{
+	void UploadRing::Reset(uint64_t capacity)
+	{
+		mCapacity = capacity;
+		mHead = 0;
+		mTail = 0;
+		mBatches.clear();
+	}
+
+	uint64_t UploadRing::Allocate(uint64_t size, uint64_t alignment)
+	{
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && mCapacity % alignment == 0);
+		if (size == 0 || size > mCapacity)
+			return InvalidOffset;
+
+		// Nothing in use, so the next range may as well start at the beginning of the buffer.
+		if (mHead == mTail)
+		{
+			mHead = (mHead + mCapacity - 1) / mCapacity * mCapacity;
+			mTail = mHead;
+		}
+
+		const uint64_t position = mHead % mCapacity;
+		uint64_t offset = (position + alignment - 1) & ~(alignment - 1);
+		// A range never straddles the end of the buffer, the rest of it is skipped.
+		if (offset + size > mCapacity)
+			offset = mCapacity;
+
+		const uint64_t head = mHead + (offset - position) + size;
+		if (head - mTail > mCapacity)
+			return InvalidOffset;
+
+		mHead = head;
+		return offset % mCapacity;
+	}
+
+	void UploadRing::Submit(uint64_t fenceValue)
+	{
+		if (mHead == (mBatches.empty() ? mTail : mBatches.back().end))
+			return;
+
+		assert(mBatches.empty() || mBatches.back().fenceValue < fenceValue);
+		mBatches.push_back({ fenceValue, mHead });
+	}
+
+	void UploadRing::Retire(uint64_t completedFenceValue)
+	{
+		while (!mBatches.empty() && mBatches.front().fenceValue <= completedFenceValue)
+		{
+			mTail = mBatches.front().end;
+			mBatches.pop_front();
+		}
+	}
+}
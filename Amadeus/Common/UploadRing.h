@@ -0,0 +1,45 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Byte ranges of a fixed upload buffer handed out in order and wrapped around. The ranges
+	// allocated between two Submit calls form a batch that is reclaimed once its fence value completes.
+	class UploadRing
+	{
+	public:
+		static constexpr uint64_t InvalidOffset = ~0ull;
+
+		void Reset(uint64_t capacity);
+
+		// Offset of size bytes, aligned to a power of two that divides the capacity, or InvalidOffset
+		// when they do not fit until older batches are retired.
+		uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+		// The ranges allocated since the last Submit stay in use until fenceValue completes.
+		void Submit(uint64_t fenceValue);
+
+		// Reclaims the batches whose fence value is at most completedFenceValue.
+		void Retire(uint64_t completedFenceValue);
+
+		uint64_t GetCapacity() const { return mCapacity; }
+
+		// Bytes in use, padding skipped for alignment and at the wrap included.
+		uint64_t GetUsed() const { return mHead - mTail; }
+
+		// Fence value of the oldest batch in flight, zero when there is none.
+		uint64_t GetOldestFenceValue() const { return mBatches.empty() ? 0 : mBatches.front().fenceValue; }
+
+	private:
+		struct Batch
+		{
+			uint64_t fenceValue;
+			uint64_t end;
+		};
+
+		uint64_t mCapacity = 0;
+		// Bytes count up without wrapping, the offset in the buffer is the count modulo the capacity.
+		uint64_t mHead = 0;
+		uint64_t mTail = 0;
+		std::deque<Batch> mBatches;
+	};
+}
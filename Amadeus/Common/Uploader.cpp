@@ -0,0 +1,270 @@
+#include "pch.h"
+#include "Common/Uploader.h"
+
+namespace Amadeus
+{
+	Uploader::Uploader(std::shared_ptr<DeviceResources> device, UINT64 capacity)
+		: mDevice(device->GetD3DDevice())
+		, mFenceValue(0)
+		, pRingData(nullptr)
+		, bRecording(false)
+	{
+		D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+		queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+		ThrowIfFailed(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&mCopyQueue)));
+		NAME_D3D12_OBJECT(mCopyQueue);
+
+		ThrowIfFailed(mDevice->CreateFence(mFenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+		mFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (mFenceEvent == nullptr)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+
+		const CD3DX12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&uploadHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&resourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mRingBuffer)));
+		NAME_D3D12_OBJECT(mRingBuffer);
+
+		// Written by the cpu only, so it stays mapped.
+		CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(mRingBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pRingData)));
+		mRing.Reset(capacity);
+	}
+
+	void Uploader::UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size)
+	{
+		if (size == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		ID3D12Resource* source = nullptr;
+		UINT64 sourceOffset = 0;
+		UINT8* sourceData = Reserve(size, 16, source, sourceOffset);
+		memcpy(sourceData, data, size);
+
+		mCommandList->CopyBufferRegion(destination, destinationOffset, source, sourceOffset, size);
+
+		++mStatistics.uploads;
+		mStatistics.bytes += size;
+	}
+
+	void Uploader::UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT count, const D3D12_SUBRESOURCE_DATA* subresources)
+	{
+		const D3D12_RESOURCE_DESC desc = destination->GetDesc();
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(count);
+		std::vector<UINT> numRows(count);
+		std::vector<UINT64> rowSizes(count);
+		UINT64 size = 0;
+		mDevice->GetCopyableFootprints(&desc, firstSubresource, count, 0, layouts.data(), numRows.data(), rowSizes.data(), &size);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		ID3D12Resource* source = nullptr;
+		UINT64 sourceOffset = 0;
+		UINT8* sourceData = Reserve(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, source, sourceOffset);
+
+		for (UINT i = 0; i < count; ++i)
+		{
+			const D3D12_MEMCPY_DEST destinationData = {
+				sourceData + layouts[i].Offset,
+				layouts[i].Footprint.RowPitch,
+				SIZE_T(layouts[i].Footprint.RowPitch) * SIZE_T(numRows[i]) };
+			MemcpySubresource(&destinationData, &subresources[i], static_cast<SIZE_T>(rowSizes[i]), numRows[i], layouts[i].Footprint.Depth);
+
+			layouts[i].Offset += sourceOffset;
+			const CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(destination, firstSubresource + i);
+			const CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(source, layouts[i]);
+			mCommandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+		}
+
+		++mStatistics.uploads;
+		mStatistics.bytes += size;
+	}
+
+	UINT64 Uploader::Flush()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (bRecording)
+			Submit();
+
+		return mFenceValue;
+	}
+
+	void Uploader::Wait(ID3D12CommandQueue* queue)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		ThrowIfFailed(queue->Wait(mFence.Get(), mFenceValue));
+	}
+
+	void Uploader::WaitForIdle()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (bRecording)
+			Submit();
+
+		WaitForFence(mFenceValue);
+		Retire();
+	}
+
+	Uploader::Statistics Uploader::GetStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		return mStatistics;
+	}
+
+	void Uploader::Destroy()
+	{
+		WaitForIdle();
+
+		mRingBuffer->Unmap(0, nullptr);
+		pRingData = nullptr;
+
+		mFreeAllocators.clear();
+		mAllocator.Reset();
+		mCommandList.Reset();
+		mRingBuffer.Reset();
+		mFence.Reset();
+		mCopyQueue.Reset();
+		mDevice.Reset();
+		CloseHandle(mFenceEvent);
+	}
+
+	UINT8* Uploader::Reserve(UINT64 size, UINT64 alignment, ID3D12Resource*& source, UINT64& sourceOffset)
+	{
+		Retire();
+
+		UINT8* data = nullptr;
+		if (size > mRing.GetCapacity())
+		{
+			const CD3DX12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+			const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+			DedicatedBuffer dedicated = {};
+			ThrowIfFailed(mDevice->CreateCommittedResource(
+				&uploadHeapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&resourceDesc,
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				nullptr,
+				IID_PPV_ARGS(&dedicated.buffer)));
+
+			CD3DX12_RANGE readRange(0, 0);
+			ThrowIfFailed(dedicated.buffer->Map(0, &readRange, reinterpret_cast<void**>(&data)));
+			// Released once the batch the copy is recorded into completes.
+			dedicated.fenceValue = mFenceValue + 1;
+			source = dedicated.buffer.Get();
+			sourceOffset = 0;
+			mDedicatedBuffers.push_back(std::move(dedicated));
+			++mStatistics.dedicated;
+		}
+		else
+		{
+			UINT64 offset = mRing.Allocate(size, alignment);
+			if (offset == UploadRing::InvalidOffset)
+			{
+				// The copies waiting in the list hold part of the ring too.
+				if (bRecording)
+					Submit();
+
+				++mStatistics.stalls;
+				while (offset == UploadRing::InvalidOffset)
+				{
+					const UINT64 fenceValue = mRing.GetOldestFenceValue();
+					if (fenceValue == 0)
+						throw std::runtime_error("Uploader::Reserve Error");
+
+					WaitForFence(fenceValue);
+					Retire();
+					offset = mRing.Allocate(size, alignment);
+				}
+			}
+
+			data = pRingData + offset;
+			source = mRingBuffer.Get();
+			sourceOffset = offset;
+		}
+
+		if (!bRecording)
+		{
+			if (!mFreeAllocators.empty())
+			{
+				mAllocator = std::move(mFreeAllocators.back());
+				mFreeAllocators.pop_back();
+				ThrowIfFailed(mAllocator->Reset());
+			}
+			else
+			{
+				ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&mAllocator)));
+			}
+
+			if (mCommandList == nullptr)
+			{
+				ThrowIfFailed(mDevice->CreateCommandList(
+					0, D3D12_COMMAND_LIST_TYPE_COPY, mAllocator.Get(), nullptr, IID_PPV_ARGS(&mCommandList)));
+				NAME_D3D12_OBJECT(mCommandList);
+			}
+			else
+			{
+				ThrowIfFailed(mCommandList->Reset(mAllocator.Get(), nullptr));
+			}
+			bRecording = true;
+		}
+
+		return data;
+	}
+
+	void Uploader::Submit()
+	{
+		ThrowIfFailed(mCommandList->Close());
+
+		ID3D12CommandList* ppCommandLists[] = { mCommandList.Get() };
+		mCopyQueue->ExecuteCommandLists(1, ppCommandLists);
+
+		++mFenceValue;
+		ThrowIfFailed(mCopyQueue->Signal(mFence.Get(), mFenceValue));
+
+		mRing.Submit(mFenceValue);
+		mBatches.push_back({ std::move(mAllocator), mFenceValue });
+		bRecording = false;
+		++mStatistics.batches;
+	}
+
+	void Uploader::Retire()
+	{
+		const UINT64 completedValue = mFence->GetCompletedValue();
+
+		mRing.Retire(completedValue);
+
+		while (!mBatches.empty() && mBatches.front().fenceValue <= completedValue)
+		{
+			mFreeAllocators.push_back(std::move(mBatches.front().allocator));
+			mBatches.pop_front();
+		}
+
+		while (!mDedicatedBuffers.empty() && mDedicatedBuffers.front().fenceValue <= completedValue)
+		{
+			mDedicatedBuffers.pop_front();
+		}
+	}
+
+	void Uploader::WaitForFence(UINT64 fenceValue)
+	{
+		if (mFence->GetCompletedValue() < fenceValue)
+		{
+			ThrowIfFailed(mFence->SetEventOnCompletion(fenceValue, mFenceEvent));
+			WaitForSingleObjectEx(mFenceEvent, INFINITE, FALSE);
+		}
+	}
+}
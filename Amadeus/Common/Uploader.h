@@ -0,0 +1,90 @@
+#pragma once
+#include "Common/UploadRing.h"
+
+namespace Amadeus
+{
+	// Upload buffer sub-allocated by every copy, a copy larger than it gets a buffer of its own.
+	static const UINT64 UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+
+	// Copies data into default heap resources on a copy queue of its own. Sources are written to one
+	// persistently mapped ring, copies are batched into a command list that is submitted on Flush or
+	// when the ring has to make room. Safe to call from the threads that load resources.
+	//
+	// Destinations are created in the common state. They decay back to it once the copy queue is
+	// done, and are promoted to the read state the direct queue first uses them in.
+	class Uploader
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t uploads = 0;
+			uint64_t bytes = 0;
+			uint64_t batches = 0;
+			// Copies that waited for the gpu to retire older batches.
+			uint64_t stalls = 0;
+			// Copies too large for the ring.
+			uint64_t dedicated = 0;
+		};
+
+		Uploader(std::shared_ptr<DeviceResources> device, UINT64 capacity = UPLOAD_RING_SIZE);
+
+		void UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size);
+
+		void UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT count, const D3D12_SUBRESOURCE_DATA* subresources);
+
+		// Submits the copies recorded so far and returns the fence value they complete with.
+		UINT64 Flush();
+
+		// Makes the queue wait on the gpu for every copy flushed so far.
+		void Wait(ID3D12CommandQueue* queue);
+
+		// Flushes and blocks until the copy queue is idle.
+		void WaitForIdle();
+
+		Statistics GetStatistics();
+
+		void Destroy();
+
+	private:
+		// Mapped source memory for a copy recorded right after, in the batch being recorded.
+		UINT8* Reserve(UINT64 size, UINT64 alignment, ID3D12Resource*& source, UINT64& sourceOffset);
+
+		void Submit();
+
+		void Retire();
+
+		void WaitForFence(UINT64 fenceValue);
+
+		struct Batch
+		{
+			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+			UINT64 fenceValue;
+		};
+
+		struct DedicatedBuffer
+		{
+			Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+			UINT64 fenceValue;
+		};
+
+		Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCopyQueue;
+		Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+		HANDLE mFenceEvent;
+		UINT64 mFenceValue;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> mRingBuffer;
+		UINT8* pRingData;
+		UploadRing mRing;
+
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mAllocator;
+		bool bRecording;
+		std::deque<Batch> mBatches;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> mFreeAllocators;
+		std::deque<DedicatedBuffer> mDedicatedBuffers;
+
+		std::mutex mMutex;
+		Statistics mStatistics;
+	};
+}
@@ -0,0 +1,378 @@
+#include "pch.h"
+#include "Common/VertexDecoder.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AMADEUS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+// gcc and clang only emit AVX2 in functions marked for it, the rest of the file stays SSE2.
+#define AMADEUS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Amadeus
+{
+	// Missing attributes read from here with a stride of 0.
+	alignas(16) static const uint8_t ZeroElement[16] = {};
+
+	static void CpuId(int info[4], int leaf)
+	{
+#ifdef _MSC_VER
+		__cpuidex(info, leaf, 0);
+#else
+		__cpuid_count(leaf, 0, info[0], info[1], info[2], info[3]);
+#endif
+	}
+
+	static uint64_t GetXcr0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+	}
+
+	static bool HasAvx2()
+	{
+		static const bool hasAvx2 = []
+		{
+			int info[4];
+			CpuId(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// The OS has to save the upper halves of the ymm registers.
+			CpuId(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			if (!osxsave || (GetXcr0() & 0x6) != 0x6)
+				return false;
+
+			CpuId(info, 7);
+			return (info[1] & (1 << 5)) != 0;
+		}();
+		return hasAvx2;
+	}
+
+	static VertexDecoder::Streams PrepareStreams(const VertexDecoder::Streams& streams)
+	{
+		VertexDecoder::Streams prepared = streams;
+		for (auto* stream : { &prepared.position, &prepared.normal, &prepared.tangent, &prepared.texCoord0 })
+		{
+			if (stream->data == nullptr)
+			{
+				stream->data = ZeroElement;
+				stream->stride = 0;
+			}
+		}
+		return prepared;
+	}
+
+	static VertexDecoder::Streams AdvanceStreams(const VertexDecoder::Streams& streams, size_t count)
+	{
+		VertexDecoder::Streams advanced = streams;
+		for (auto* stream : { &advanced.position, &advanced.normal, &advanced.tangent, &advanced.texCoord0 })
+		{
+			stream->data += stream->stride * count;
+		}
+		return advanced;
+	}
+
+	static void DecodeVerticesScalarPrepared(const VertexDecoder::Streams& streams, size_t count, VertexDecoder::Vertex* vertices)
+	{
+		const uint8_t* position = streams.position.data;
+		const uint8_t* normal = streams.normal.data;
+		const uint8_t* tangent = streams.tangent.data;
+		const uint8_t* texCoord0 = streams.texCoord0.data;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			VertexDecoder::Vertex& vertex = vertices[i];
+			memcpy(vertex.position, position, sizeof(vertex.position));
+			memcpy(vertex.normal, normal, sizeof(vertex.normal));
+			memcpy(vertex.tangent, tangent, sizeof(vertex.tangent));
+
+			switch (streams.texCoord0.format)
+			{
+			case VertexDecoder::Format::FLOAT:
+				memcpy(vertex.texCoord0, texCoord0, sizeof(vertex.texCoord0));
+				break;
+			case VertexDecoder::Format::UNORM8:
+				vertex.texCoord0[0] = texCoord0[0] / 255.0f;
+				vertex.texCoord0[1] = texCoord0[1] / 255.0f;
+				break;
+			case VertexDecoder::Format::UNORM16:
+			{
+				uint16_t uv[2];
+				memcpy(uv, texCoord0, sizeof(uv));
+				vertex.texCoord0[0] = uv[0] / 65535.0f;
+				vertex.texCoord0[1] = uv[1] / 65535.0f;
+				break;
+			}
+			}
+
+			position += streams.position.stride;
+			normal += streams.normal.stride;
+			tangent += streams.tangent.stride;
+			texCoord0 += streams.texCoord0.stride;
+		}
+	}
+
+	// Texture coordinates in the two low lanes.
+	template<VertexDecoder::Format Format>
+	static __m128 LoadTexCoord(const uint8_t* data)
+	{
+		if constexpr (Format == VertexDecoder::Format::FLOAT)
+		{
+			// Texture coordinates are only 4 byte aligned, _mm_loadl_epi64 has no alignment requirement.
+			return _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+		}
+		else if constexpr (Format == VertexDecoder::Format::UNORM8)
+		{
+			uint16_t uv;
+			memcpy(&uv, data, sizeof(uv));
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(uv), zero), zero);
+			return _mm_div_ps(_mm_cvtepi32_ps(widened), _mm_set1_ps(255.0f));
+		}
+		else
+		{
+			int32_t uv;
+			memcpy(&uv, data, sizeof(uv));
+			const __m128i widened = _mm_unpacklo_epi16(_mm_cvtsi32_si128(uv), _mm_setzero_si128());
+			return _mm_div_ps(_mm_cvtepi32_ps(widened), _mm_set1_ps(65535.0f));
+		}
+	}
+
+	// Vertex i + 1 exists, so the 16 byte loads of the float3 attributes stay inside the buffer.
+	template<VertexDecoder::Format Format>
+	static void DecodeVerticesSse2(const VertexDecoder::Streams& streams, size_t count, VertexDecoder::Vertex* vertices)
+	{
+		const uint8_t* position = streams.position.data;
+		const uint8_t* normal = streams.normal.data;
+		const uint8_t* tangent = streams.tangent.data;
+		const uint8_t* texCoord0 = streams.texCoord0.data;
+		float* out = vertices[0].position;
+
+		size_t i = 0;
+		for (; i + 1 < count; ++i)
+		{
+			const __m128 p = _mm_loadu_ps(reinterpret_cast<const float*>(position));
+			const __m128 n = _mm_loadu_ps(reinterpret_cast<const float*>(normal));
+			const __m128 t = _mm_loadu_ps(reinterpret_cast<const float*>(tangent));
+			const __m128 uv = LoadTexCoord<Format>(texCoord0);
+
+			// px py pz nx | ny nz tx ty | tz tw u v
+			const __m128 nxpz = _mm_shuffle_ps(n, p, _MM_SHUFFLE(2, 2, 0, 0));
+			_mm_storeu_ps(out, _mm_shuffle_ps(p, nxpz, _MM_SHUFFLE(0, 2, 1, 0)));
+			_mm_storeu_ps(out + 4, _mm_shuffle_ps(n, t, _MM_SHUFFLE(1, 0, 2, 1)));
+			_mm_storeu_ps(out + 8, _mm_shuffle_ps(t, uv, _MM_SHUFFLE(1, 0, 3, 2)));
+
+			position += streams.position.stride;
+			normal += streams.normal.stride;
+			tangent += streams.tangent.stride;
+			texCoord0 += streams.texCoord0.stride;
+			out += 12;
+		}
+
+		DecodeVerticesScalarPrepared(AdvanceStreams(streams, i), count - i, vertices + i);
+	}
+
+	template<VertexDecoder::Format Format>
+	AMADEUS_TARGET_AVX2 static __m256 LoadTexCoordPair(const uint8_t* first, const uint8_t* second)
+	{
+		if constexpr (Format == VertexDecoder::Format::FLOAT)
+		{
+			return _mm256_set_m128(LoadTexCoord<Format>(second), LoadTexCoord<Format>(first));
+		}
+		else if constexpr (Format == VertexDecoder::Format::UNORM8)
+		{
+			uint16_t uv[2];
+			memcpy(&uv[0], first, sizeof(uint16_t));
+			memcpy(&uv[1], second, sizeof(uint16_t));
+			const __m128i packed = _mm_set_epi32(0, 0, uv[1], uv[0]);
+			return _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(packed)), _mm256_set1_ps(255.0f));
+		}
+		else
+		{
+			int32_t uv[2];
+			memcpy(&uv[0], first, sizeof(int32_t));
+			memcpy(&uv[1], second, sizeof(int32_t));
+			const __m128i packed = _mm_set_epi32(0, uv[1], 0, uv[0]);
+			return _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(packed)), _mm256_set1_ps(65535.0f));
+		}
+	}
+
+	AMADEUS_TARGET_AVX2 static __m256 LoadPair(const uint8_t* first, const uint8_t* second)
+	{
+		return _mm256_set_m128(_mm_loadu_ps(reinterpret_cast<const float*>(second)), _mm_loadu_ps(reinterpret_cast<const float*>(first)));
+	}
+
+	// Same shuffles as the SSE2 kernel with one vertex per 128-bit lane.
+	template<VertexDecoder::Format Format>
+	AMADEUS_TARGET_AVX2 static void DecodeVerticesAvx2(const VertexDecoder::Streams& streams, size_t count, VertexDecoder::Vertex* vertices)
+	{
+		const size_t positionStride = streams.position.stride;
+		const size_t normalStride = streams.normal.stride;
+		const size_t tangentStride = streams.tangent.stride;
+		const size_t texCoord0Stride = streams.texCoord0.stride;
+		const uint8_t* position = streams.position.data;
+		const uint8_t* normal = streams.normal.data;
+		const uint8_t* tangent = streams.tangent.data;
+		const uint8_t* texCoord0 = streams.texCoord0.data;
+		float* out = vertices[0].position;
+
+		size_t i = 0;
+		for (; i + 2 < count; i += 2)
+		{
+			const __m256 p = LoadPair(position, position + positionStride);
+			const __m256 n = LoadPair(normal, normal + normalStride);
+			const __m256 t = LoadPair(tangent, tangent + tangentStride);
+			const __m256 uv = LoadTexCoordPair<Format>(texCoord0, texCoord0 + texCoord0Stride);
+
+			const __m256 nxpz = _mm256_shuffle_ps(n, p, _MM_SHUFFLE(2, 2, 0, 0));
+			const __m256 a = _mm256_shuffle_ps(p, nxpz, _MM_SHUFFLE(0, 2, 1, 0));
+			const __m256 b = _mm256_shuffle_ps(n, t, _MM_SHUFFLE(1, 0, 2, 1));
+			const __m256 c = _mm256_shuffle_ps(t, uv, _MM_SHUFFLE(1, 0, 3, 2));
+
+			// a0 b0 | c0 a1 | b1 c1
+			_mm256_storeu_ps(out, _mm256_permute2f128_ps(a, b, 0x20));
+			_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(c, a, 0x30));
+			_mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(b, c, 0x31));
+
+			position += 2 * positionStride;
+			normal += 2 * normalStride;
+			tangent += 2 * tangentStride;
+			texCoord0 += 2 * texCoord0Stride;
+			out += 24;
+		}
+		_mm256_zeroupper();
+
+		DecodeVerticesSse2<Format>(AdvanceStreams(streams, i), count - i, vertices + i);
+	}
+
+	void VertexDecoder::DecodeVertices(const Streams& streams, size_t count, Vertex* vertices)
+	{
+		if (count == 0)
+			return;
+
+		const Streams prepared = PrepareStreams(streams);
+		const bool avx2 = HasAvx2();
+		switch (prepared.texCoord0.format)
+		{
+		case Format::FLOAT:
+			avx2 ? DecodeVerticesAvx2<Format::FLOAT>(prepared, count, vertices) : DecodeVerticesSse2<Format::FLOAT>(prepared, count, vertices);
+			break;
+		case Format::UNORM8:
+			avx2 ? DecodeVerticesAvx2<Format::UNORM8>(prepared, count, vertices) : DecodeVerticesSse2<Format::UNORM8>(prepared, count, vertices);
+			break;
+		case Format::UNORM16:
+			avx2 ? DecodeVerticesAvx2<Format::UNORM16>(prepared, count, vertices) : DecodeVerticesSse2<Format::UNORM16>(prepared, count, vertices);
+			break;
+		}
+	}
+
+	void VertexDecoder::DecodeVerticesScalar(const Streams& streams, size_t count, Vertex* vertices)
+	{
+		DecodeVerticesScalarPrepared(PrepareStreams(streams), count, vertices);
+	}
+
+	static size_t WidenIndicesSse2(const uint8_t* data, size_t indexSize, size_t count, uint32_t* indices)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		if (indexSize == 1)
+		{
+			for (; i + 16 <= count; i += 16)
+			{
+				const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+				const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+				const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), _mm_unpacklo_epi16(lo, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i + 4), _mm_unpackhi_epi16(lo, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i + 8), _mm_unpacklo_epi16(hi, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i + 12), _mm_unpackhi_epi16(hi, zero));
+			}
+		}
+		else
+		{
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), _mm_unpacklo_epi16(shorts, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i + 4), _mm_unpackhi_epi16(shorts, zero));
+			}
+		}
+		return i;
+	}
+
+	AMADEUS_TARGET_AVX2 static size_t WidenIndicesAvx2(const uint8_t* data, size_t indexSize, size_t count, uint32_t* indices)
+	{
+		size_t i = 0;
+		if (indexSize == 1)
+		{
+			for (; i + 16 <= count; i += 16)
+			{
+				const __m128i lo = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i));
+				const __m128i hi = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i + 8));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i), _mm256_cvtepu8_epi32(lo));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i + 8), _mm256_cvtepu8_epi32(hi));
+			}
+		}
+		else
+		{
+			for (; i + 16 <= count; i += 16)
+			{
+				const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+				const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2 + 16));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i), _mm256_cvtepu16_epi32(lo));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i + 8), _mm256_cvtepu16_epi32(hi));
+			}
+		}
+		return i;
+	}
+
+	void VertexDecoder::DecodeIndices(const uint8_t* data, size_t indexSize, size_t count, uint32_t* indices)
+	{
+		assert(indexSize == 1 || indexSize == 2 || indexSize == 4);
+		if (count == 0)
+			return;
+
+		if (indexSize == 4)
+		{
+			memcpy(indices, data, count * sizeof(uint32_t));
+			return;
+		}
+
+		const size_t done = HasAvx2()
+			? WidenIndicesAvx2(data, indexSize, count, indices)
+			: WidenIndicesSse2(data, indexSize, count, indices);
+		DecodeIndicesScalar(data + done * indexSize, indexSize, count - done, indices + done);
+	}
+
+	void VertexDecoder::DecodeIndicesScalar(const uint8_t* data, size_t indexSize, size_t count, uint32_t* indices)
+	{
+		assert(indexSize == 1 || indexSize == 2 || indexSize == 4);
+		for (size_t i = 0; i < count; ++i)
+		{
+			switch (indexSize)
+			{
+			case 1:
+				indices[i] = data[i];
+				break;
+			case 2:
+			{
+				uint16_t index;
+				memcpy(&index, data + i * 2, sizeof(index));
+				indices[i] = index;
+				break;
+			}
+			default:
+				memcpy(&indices[i], data + i * 4, sizeof(uint32_t));
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace Amadeus
+{
+	// Decodes glTF accessors into interleaved vertices and 32-bit indices. The kernels use AVX2
+	// when the CPU has it and SSE2 otherwise, the scalar kernels are the reference for both.
+	class VertexDecoder
+	{
+	public:
+		enum class Format : uint8_t
+		{
+			FLOAT,
+			// Normalized unsigned integers, divided by their maximum value.
+			UNORM8,
+			UNORM16,
+		};
+
+		// One attribute. A missing attribute (null data) is written as zeros.
+		struct Stream
+		{
+			const uint8_t* data = nullptr;
+			size_t stride = 0;
+			Format format = Format::FLOAT;
+		};
+
+		// Position, normal and tangent are always float, only the texture coordinates may be normalized.
+		struct Streams
+		{
+			Stream position;
+			Stream normal;
+			Stream tangent;
+			Stream texCoord0;
+		};
+
+		// Same layout as Primitive::Vertex.
+		struct Vertex
+		{
+			float position[3];
+			float normal[3];
+			float tangent[4];
+			float texCoord0[2];
+		};
+		static_assert(sizeof(Vertex) == 48, "VertexDecoder::Vertex must be tightly packed");
+
+		// Writes every attribute of a vertex in a single pass. Each stream holds count elements.
+		static void DecodeVertices(const Streams& streams, size_t count, Vertex* vertices);
+
+		// Widens tightly packed 1, 2 or 4 byte indices.
+		static void DecodeIndices(const uint8_t* data, size_t indexSize, size_t count, uint32_t* indices);
+
+		static void DecodeVerticesScalar(const Streams& streams, size_t count, Vertex* vertices);
+
+		static void DecodeIndicesScalar(const uint8_t* data, size_t indexSize, size_t count, uint32_t* indices);
+	};
+}
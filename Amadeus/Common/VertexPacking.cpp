@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "Common/VertexPacking.h"
+
+namespace Amadeus
+{
+	static uint16_t QuantizeUnorm16(float value, float scale, float offset)
+	{
+		if (scale <= 0.0f)
+			return 0;
+
+		const float normalized = (std::min)((std::max)((value - offset) / scale, 0.0f), 1.0f);
+		return static_cast<uint16_t>(normalized * 65535.0f + 0.5f);
+	}
+
+	static int16_t QuantizeSnorm16(float value)
+	{
+		const float clamped = (std::min)((std::max)(value, -1.0f), 1.0f);
+		return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+	}
+
+	// The input assembler maps -32768 and -32767 both to -1.
+	static float DequantizeSnorm16(int16_t value)
+	{
+		return (std::max)(value / 32767.0f, -1.0f);
+	}
+
+	VertexPacking::Quantization VertexPacking::ComputeQuantization(const VertexDecoder::Vertex* vertices, size_t count)
+	{
+		float minimum[5];
+		float maximum[5];
+		for (int i = 0; i < 5; ++i)
+		{
+			minimum[i] = count > 0 ? (std::numeric_limits<float>::max)() : 0.0f;
+			maximum[i] = count > 0 ? std::numeric_limits<float>::lowest() : 0.0f;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float values[5] = { vertices[i].position[0], vertices[i].position[1], vertices[i].position[2],
+				vertices[i].texCoord0[0], vertices[i].texCoord0[1] };
+			for (int j = 0; j < 5; ++j)
+			{
+				minimum[j] = (std::min)(minimum[j], values[j]);
+				maximum[j] = (std::max)(maximum[j], values[j]);
+			}
+		}
+
+		Quantization quantization;
+		for (int i = 0; i < 3; ++i)
+		{
+			quantization.positionScale[i] = maximum[i] - minimum[i];
+			quantization.positionOffset[i] = minimum[i];
+		}
+		for (int i = 0; i < 2; ++i)
+		{
+			quantization.texCoordScale[i] = maximum[i + 3] - minimum[i + 3];
+			quantization.texCoordOffset[i] = minimum[i + 3];
+		}
+		return quantization;
+	}
+
+	void VertexPacking::Pack(const VertexDecoder::Vertex* vertices, size_t count,
+		const Quantization& quantization, PackedVertex* packed)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const VertexDecoder::Vertex& vertex = vertices[i];
+			PackedVertex& out = packed[i];
+
+			for (int j = 0; j < 3; ++j)
+			{
+				out.position[j] = QuantizeUnorm16(vertex.position[j], quantization.positionScale[j], quantization.positionOffset[j]);
+			}
+			out.position[3] = vertex.tangent[3] < 0.0f ? 0 : 65535;
+
+			EncodeOctahedral(vertex.normal, out.normal);
+			EncodeOctahedral(vertex.tangent, out.tangent);
+
+			for (int j = 0; j < 2; ++j)
+			{
+				out.texCoord0[j] = QuantizeUnorm16(vertex.texCoord0[j], quantization.texCoordScale[j], quantization.texCoordOffset[j]);
+			}
+		}
+	}
+
+	void VertexPacking::Unpack(const PackedVertex* packed, size_t count,
+		const Quantization& quantization, VertexDecoder::Vertex* vertices)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const PackedVertex& in = packed[i];
+			VertexDecoder::Vertex& vertex = vertices[i];
+
+			for (int j = 0; j < 3; ++j)
+			{
+				vertex.position[j] = in.position[j] / 65535.0f * quantization.positionScale[j] + quantization.positionOffset[j];
+			}
+
+			DecodeOctahedral(in.normal, vertex.normal);
+			DecodeOctahedral(in.tangent, vertex.tangent);
+			vertex.tangent[3] = in.position[3] / 65535.0f * 2.0f - 1.0f;
+
+			for (int j = 0; j < 2; ++j)
+			{
+				vertex.texCoord0[j] = in.texCoord0[j] / 65535.0f * quantization.texCoordScale[j] + quantization.texCoordOffset[j];
+			}
+		}
+	}
+
+	void VertexPacking::EncodeOctahedral(const float direction[3], int16_t encoded[2])
+	{
+		const float length = std::fabs(direction[0]) + std::fabs(direction[1]) + std::fabs(direction[2]);
+		if (length == 0.0f)
+		{
+			encoded[0] = 0;
+			encoded[1] = 0;
+			return;
+		}
+
+		float x = direction[0] / length;
+		float y = direction[1] / length;
+		if (direction[2] < 0.0f)
+		{
+			// Fold the lower hemisphere over the diagonals.
+			const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		encoded[0] = QuantizeSnorm16(x);
+		encoded[1] = QuantizeSnorm16(y);
+	}
+
+	void VertexPacking::DecodeOctahedral(const int16_t encoded[2], float direction[3])
+	{
+		float x = DequantizeSnorm16(encoded[0]);
+		float y = DequantizeSnorm16(encoded[1]);
+		const float z = 1.0f - std::fabs(x) - std::fabs(y);
+		const float t = (std::max)(-z, 0.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		const float length = std::sqrt(x * x + y * y + z * z);
+		direction[0] = x / length;
+		direction[1] = y / length;
+		direction[2] = z / length;
+	}
+
+	void VertexPacking::PackIndices(const uint32_t* indices, size_t count, uint16_t* packed)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			assert(indices[i] <= 0xFFFF);
+			packed[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+}
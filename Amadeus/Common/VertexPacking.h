@@ -0,0 +1,50 @@
+#pragma once
+#include "Common/VertexDecoder.h"
+
+namespace Amadeus
+{
+	// Packs decoded vertices into 20 bytes. Position and texture coordinates are unorm16 relative to
+	// the bounds of the primitive, normal and tangent are octahedral-encoded snorm16. Unpack does what
+	// the vertex shaders do after the input assembler has converted the formats.
+	class VertexPacking
+	{
+	public:
+		struct PackedVertex
+		{
+			// w is the tangent handedness, 0 for -1 and 65535 for +1.
+			uint16_t position[4];
+			int16_t normal[2];
+			int16_t tangent[2];
+			uint16_t texCoord0[2];
+		};
+		static_assert(sizeof(PackedVertex) == 20, "VertexPacking::PackedVertex must be tightly packed");
+
+		// Decoded value = unorm * scale + offset, the same constants work for float vertices
+		// with a scale of 1 and an offset of 0.
+		struct Quantization
+		{
+			float positionScale[3];
+			float positionOffset[3];
+			float texCoordScale[2];
+			float texCoordOffset[2];
+		};
+
+		static Quantization ComputeQuantization(const VertexDecoder::Vertex* vertices, size_t count);
+
+		static void Pack(const VertexDecoder::Vertex* vertices, size_t count,
+			const Quantization& quantization, PackedVertex* packed);
+
+		static void Unpack(const PackedVertex* packed, size_t count,
+			const Quantization& quantization, VertexDecoder::Vertex* vertices);
+
+		// Directions do not need to be normalized, a zero vector encodes as +Z.
+		static void EncodeOctahedral(const float direction[3], int16_t encoded[2]);
+
+		static void DecodeOctahedral(const int16_t encoded[2], float direction[3]);
+
+		// Index buffers use R16_UINT when every vertex can be addressed with 16 bits.
+		static bool FitsUInt16Indices(size_t vertexCount) { return vertexCount <= 65536; }
+
+		static void PackIndices(const uint32_t* indices, size_t count, uint16_t* packed);
+	};
+}
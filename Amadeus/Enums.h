@@ -10,4 +10,21 @@ namespace Amadeus
 		PixelShader = 3,
 		ComputeShader = 4,
 	};
+
+	// Frustums the primitives are culled against every frame, the light one feeds the shadow map.
+	enum class CullView
+	{
+		Camera = 0,
+		Light = 1,
+		Count = 2,
+	};
+
+	// Passes that draw primitives, in the order their draws are sorted in the draw list.
+	enum class DrawPass
+	{
+		Shadow = 0,
+		ZPre = 1,
+		GBuffer = 2,
+		Transparent = 3,
+	};
 }
\ No newline at end of file
@@ -38,21 +38,7 @@ namespace Amadeus
             &psoDesc, 
             IID_PPV_ARGS(&mPipelineState)));
 
-        for (UINT i = 0; i < FrameCount; ++i)
-        {
-            ComPtr<ID3D12GraphicsCommandList> commandList;
-
-            ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-                0,
-                D3D12_COMMAND_LIST_TYPE_DIRECT,
-                device->GetCommandAllocator(),
-                mPipelineState.Get(),
-                IID_PPV_ARGS(&commandList)));
-
-            mCommandLists.emplace_back(commandList);
-
-            ThrowIfFailed(commandList->Close());
-        }
+        CreateCommandLists(device);
 	}
 
     bool FinalPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -89,14 +75,16 @@ namespace Amadeus
                 "Sky",
                 FrameGraphResourceType::RENDER_TARGET,
                 DXGI_FORMAT_R8G8B8A8_UNORM,
-                fg, node);
+                fg, node,
+                FrameGraphResourceUsage::DEPENDENCY);
         }
 
         mTransparent = builder.Read(
             "Transparent",
             FrameGraphResourceType::RENDER_TARGET,
             DXGI_FORMAT_R8G8B8A8_UNORM,
-            fg, node);
+            fg, node,
+            FrameGraphResourceUsage::DEPENDENCY);
     }
 
     void FinalPass::RegisterResource(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache)
@@ -126,7 +114,7 @@ namespace Amadeus
             mCommandLists[curFrameIndex]->ClearDepthStencilView(depthStencilView, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
         }
 
-        CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle = mBaseColor->GetReadView(mCommandLists[curFrameIndex].Get());
+        CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle = mBaseColor->GetReadView();
         mCommandLists[curFrameIndex]->SetGraphicsRootDescriptorTable(5, srvHandle);
 
         mCommandLists[curFrameIndex]->IASetVertexBuffers(0, 0, nullptr);
@@ -143,9 +131,6 @@ namespace Amadeus
 
         ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
 
-        ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get() };
-        device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
-
         return true;
 	}
 
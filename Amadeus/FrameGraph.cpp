@@ -4,6 +4,7 @@
 #include <meta/meta.hpp>
 #include "RenderPassRegistry.h"
 #include "RenderSystem.h"
+#include "Common/TransientAllocator.h"
 
 namespace Amadeus
 {
@@ -28,6 +29,7 @@ namespace Amadeus
 		}
 
 		mPassNodes.emplace_back(passNode);
+		mScheduler.Invalidate();
 	}
 
 	void FrameGraph::PreCompute(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
@@ -101,67 +103,291 @@ namespace Amadeus
 
 	void FrameGraph::Compile(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache)
 	{
+		// The descriptor cache is reset every frame, so views are appended again.
+		mScheduler.Compile(GetPlanKey(device), mPlan.passes,
+			[&] { BuildPlan(device); },
+			[&](FrameGraphNode* passNode) { passNode->RegisterResource(device, descriptorCache); });
+	}
+
+	PassScheduler::Key FrameGraph::GetPlanKey(SharedPtr<DeviceResources> device) const
+	{
+		PassScheduler::Key key;
+		key.width = device->GetWindowWidth();
+		key.height = device->GetWindowHeight();
+		key.toggles = (EngineVar::TAA_Enable ? 1u : 0u) | (EngineVar::Draw_Sky ? 2u : 0u);
+		return key;
+	}
+
+	void FrameGraph::BuildPlan(SharedPtr<DeviceResources> device)
+	{
+		if (mTransientHeap)
+		{
+			// The resources are placed again below and may still be in use.
+			device->WaitForGpu();
+			for (auto& resource : mResourcesDict)
+			{
+				resource.second->UnregisterResource();
+			}
+			mTransientHeap.Reset();
+		}
+
+		// Declare the edges again, a toggle may change what a pass reads.
+		mGraph.ClearEdges();
+		for (auto& resource : mResourcesDict)
+		{
+			resource.second->Disconnect();
+		}
+		Setup();
+
+		if (!mGraph.IsAcyclic())
+		{
+			throw Exception("Frame Graph Has A Cycle.");
+		}
+
 		mGraph.Cull();
 
-		auto activePassNodesEnd = std::stable_partition(
-			mPassNodes.begin(), mPassNodes.end(), [](const auto& pPassNode) {
-			return !pPassNode->IsCulled();
-		});
+		mPlan.passes.clear();
+		for (const auto& passNode : mPassNodes)
+		{
+			if (!passNode->IsCulled())
+			{
+				mPlan.passes.emplace_back(passNode.get());
+			}
+		}
+
+		ComputeLevels();
 
-		auto first = mPassNodes.begin();
-		while (first != activePassNodesEnd)
+		const Vector<BarrierPlanner::Access> accesses = CollectAccesses();
+		const BarrierPlanner::Result barriers = BarrierPlanner::Plan(
+			static_cast<uint32_t>(mPlan.resources.size()), static_cast<uint32_t>(mPlan.levels.size()), accesses);
+
+		AllocateResources(device, accesses, barriers.initialStates);
+
+		ResolveBarriers(barriers);
+	}
+
+	static bool IsWriteUsage(FrameGraphResourceUsage usage)
+	{
+		return usage == FrameGraphResourceUsage::RENDER_TARGET || usage == FrameGraphResourceUsage::DEPTH_WRITE;
+	}
+
+	static D3D12_RESOURCE_STATES GetResourceState(FrameGraphResourceUsage usage)
+	{
+		switch (usage)
 		{
-			const auto& passNode = *first;
-			first++;
-			assert(!passNode->IsCulled());
+		case FrameGraphResourceUsage::RENDER_TARGET:
+			return D3D12_RESOURCE_STATE_RENDER_TARGET;
+		case FrameGraphResourceUsage::DEPTH_WRITE:
+			return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		case FrameGraphResourceUsage::DEPTH_READ:
+			return D3D12_RESOURCE_STATE_DEPTH_READ;
+		case FrameGraphResourceUsage::SHADER_RESOURCE:
+			return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		default:
+			throw Exception("Invaild Resource Usage.");
+		}
+	}
 
-			const auto& reads = mGraph.GetIncomingEdges(passNode.get());
-			for (const auto& edge : reads)
+	void FrameGraph::ComputeLevels()
+	{
+		Map<const DependencyGraph::Node*, uint32_t> passIndices;
+		for (uint32_t pass = 0; pass < mPlan.passes.size(); ++pass)
+		{
+			passIndices[mPlan.passes[pass]] = pass;
+		}
+
+		Vector<PassScheduler::Edge> edges;
+		for (uint32_t pass = 0; pass < mPlan.passes.size(); ++pass)
+		{
+			for (const auto& edge : mGraph.GetIncomingEdges(mPlan.passes[pass]))
 			{
-				auto pNode = static_cast<FrameGraphNode*>(mGraph.GetNode(edge->from));
-				pNode->RegisterResource(device, descriptorCache);
+				auto from = passIndices.find(mGraph.GetNode(edge->from));
+				if (from != passIndices.end())
+					edges.push_back({ from->second, pass });
 			}
+		}
 
-			auto const& writes = mGraph.GetOutgoingEdges(passNode.get());
-			for (auto const& edge : writes)
+		// The writer of a resource comes before its readers.
+		Vector<PassScheduler::Access> accesses;
+		uint32_t resourceIndex = 0;
+		for (const auto& resource : mResourcesDict)
+		{
+			auto writer = passIndices.find(resource.second->GetWriter());
+			if (writer != passIndices.end())
+				accesses.push_back({ writer->second, resourceIndex, true });
+
+			const auto& readers = resource.second->GetReaders();
+			const auto& usages = resource.second->GetReaderUsages();
+			for (size_t i = 0; i < readers.size(); ++i)
 			{
-				auto pNode = static_cast<FrameGraphNode*>(mGraph.GetNode(edge->to));
-				pNode->RegisterResource(device, descriptorCache);
+				auto reader = passIndices.find(readers[i]);
+				if (reader != passIndices.end() && usages[i] != FrameGraphResourceUsage::DEPENDENCY)
+					accesses.push_back({ reader->second, resourceIndex, IsWriteUsage(usages[i]) });
 			}
+			++resourceIndex;
+		}
+
+		const Vector<uint32_t> passLevels = PassScheduler::AssignLevels(
+			static_cast<uint32_t>(mPlan.passes.size()), edges, accesses);
+
+		mPlan.levels.clear();
+		for (uint32_t pass = 0; pass < mPlan.passes.size(); ++pass)
+		{
+			if (mPlan.levels.size() <= passLevels[pass])
+				mPlan.levels.resize(passLevels[pass] + 1);
+			mPlan.levels[passLevels[pass]].emplace_back(mPlan.passes[pass]);
 		}
 	}
 
-	void FrameGraph::Execute(
-		SharedPtr<DeviceResources> device, 
-		SharedPtr<DescriptorManager> descriptorManager,
-		SharedPtr<DescriptorCache> descriptorCache, 
-		SharedPtr<RenderSystem> renderer)
+	Vector<BarrierPlanner::Access> FrameGraph::CollectAccesses()
 	{
-		Vector<Future<bool>> results;
-		ThrowIfFailed(device->GetCommandAllocator()->Reset());
+		Map<const DependencyGraph::Node*, uint32_t> nodeLevels;
+		for (size_t level = 0; level < mPlan.levels.size(); ++level)
+		{
+			for (const auto& passNode : mPlan.levels[level])
+			{
+				nodeLevels[passNode] = static_cast<uint32_t>(level);
+			}
+		}
 
-		auto activePassNodesEnd = std::find_if(mPassNodes.begin(), mPassNodes.end(), [](const auto& pPassNode) {
-			return pPassNode->IsCulled();
-		});
+		Vector<BarrierPlanner::Access> accesses;
+		mPlan.resources.clear();
+		for (const auto& resource : mResourcesDict)
+		{
+			auto writer = nodeLevels.find(resource.second->GetWriter());
+			if (writer == nodeLevels.end())
+				continue;
+
+			const uint32_t index = static_cast<uint32_t>(mPlan.resources.size());
+			const FrameGraphResourceUsage writerUsage = resource.second->GetWriterUsage();
+			accesses.push_back({ index, writer->second, static_cast<uint32_t>(GetResourceState(writerUsage)), true });
 
-		auto iter = mPassNodes.begin();
-		for (; iter != activePassNodesEnd; ++iter)
+			const auto& readers = resource.second->GetReaders();
+			const auto& usages = resource.second->GetReaderUsages();
+			for (size_t i = 0; i < readers.size(); ++i)
+			{
+				auto reader = nodeLevels.find(readers[i]);
+				if (reader == nodeLevels.end() || usages[i] == FrameGraphResourceUsage::DEPENDENCY)
+					continue;
+				accesses.push_back({ index, reader->second, static_cast<uint32_t>(GetResourceState(usages[i])), IsWriteUsage(usages[i]) });
+			}
+
+			mPlan.resources.emplace_back(resource.second.get());
+		}
+		return accesses;
+	}
+
+	void FrameGraph::AllocateResources(SharedPtr<DeviceResources> device,
+		const Vector<BarrierPlanner::Access>& accesses, const Vector<uint32_t>& initialStates)
+	{
+		// Lifetimes are measured in levels, the barriers of a level are issued before any of
+		// its passes, so resources used on the same level may never share memory.
+		Vector<TransientAllocator::Request> requests(mPlan.resources.size());
+		for (size_t i = 0; i < mPlan.resources.size(); ++i)
 		{
-			assert(!(*iter)->IsCulled());
+			const D3D12_RESOURCE_DESC resourceDesc = mPlan.resources[i]->GetResourceDesc(device);
+			const D3D12_RESOURCE_ALLOCATION_INFO info = device->GetD3DDevice()->GetResourceAllocationInfo(0, 1, &resourceDesc);
+			requests[i] = { info.SizeInBytes, info.Alignment, UINT32_MAX, 0 };
+		}
+		for (const auto& access : accesses)
+		{
+			auto& request = requests[access.resource];
+			request.first = (std::min)(request.first, access.level);
+			request.last = (std::max)(request.last, access.level);
+		}
 
-#ifdef AMADEUS_CONCURRENCY
-			results.emplace_back(
-				renderer->Execute(&FrameGraphNode::Execute, iter->get(), device, descriptorManager, descriptorCache));
-#else
-			pass->Execute(device, descriptorManager, descriptorCache);
-#endif // AMADEUS_CONCURRENCY
+		const TransientAllocator::Result result = TransientAllocator::Pack(requests);
+		if (result.heapSize == 0)
+			return;
+
+#ifdef _DEBUG
+		char message[128];
+		if (sprintf_s(message, "Transient heap %.1f MiB, %.1f MiB without aliasing\n",
+			result.heapSize / 1048576.0, TransientAllocator::GetUnaliasedSize(requests) / 1048576.0) > 0)
+		{
+			OutputDebugStringA(message);
 		}
+#endif // _DEBUG
 
-		for (auto&& res : results)
+		const CD3DX12_HEAP_DESC heapDesc(
+			result.heapSize, D3D12_HEAP_TYPE_DEFAULT, result.heapAlignment, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+		ThrowIfFailed(device->GetD3DDevice()->CreateHeap(&heapDesc, IID_PPV_ARGS(&mTransientHeap)));
+		SetName(mTransientHeap.Get(), L"FrameGraphTransientHeap");
+
+		for (size_t i = 0; i < mPlan.resources.size(); ++i)
 		{
-			if (!res.get())
-				throw RuntimeError("FrameGraphPass::Execute Error");
+			mPlan.resources[i]->PlaceResource(device, mTransientHeap.Get(), result.offsets[i],
+				static_cast<D3D12_RESOURCE_STATES>(initialStates[i]));
 		}
+	}
+
+	void FrameGraph::ResolveBarriers(const BarrierPlanner::Result& barriers)
+	{
+		for (size_t level = 0; level < mPlan.levels.size(); ++level)
+		{
+			Vector<D3D12_RESOURCE_BARRIER> resolved;
+			Vector<ID3D12Resource*> discards;
+			for (const auto& barrier : barriers.batches[level])
+			{
+				ID3D12Resource* resource = mPlan.resources[barrier.resource]->GetResource();
+				const D3D12_RESOURCE_STATES before = static_cast<D3D12_RESOURCE_STATES>(barrier.before);
+				const D3D12_RESOURCE_STATES after = static_cast<D3D12_RESOURCE_STATES>(barrier.after);
+				switch (barrier.type)
+				{
+				case BarrierPlanner::BarrierType::ALIASING:
+					// Wait for whatever used the memory before, the content is undefined from here on.
+					resolved.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, resource));
+					if (after == D3D12_RESOURCE_STATE_RENDER_TARGET || after == D3D12_RESOURCE_STATE_DEPTH_WRITE)
+						discards.push_back(resource);
+					break;
+				case BarrierPlanner::BarrierType::TRANSITION:
+					resolved.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after));
+					break;
+				case BarrierPlanner::BarrierType::BEGIN_ONLY:
+					resolved.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after,
+						D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+					break;
+				case BarrierPlanner::BarrierType::END_ONLY:
+					resolved.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after,
+						D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+					break;
+				}
+			}
+
+			const auto& passes = mPlan.levels[level];
+			passes.front()->SetBarriers(std::move(resolved), std::move(discards));
+			for (size_t i = 1; i < passes.size(); ++i)
+			{
+				passes[i]->SetBarriers({}, {});
+			}
+		}
+	}
+
+	void FrameGraph::Execute(
+		SharedPtr<DeviceResources> device, 
+		SharedPtr<DescriptorManager> descriptorManager,
+		SharedPtr<DescriptorCache> descriptorCache, 
+		SharedPtr<RenderSystem> renderer)
+	{
+		// The calling thread records passes as well while it waits for a level.
+		Vector<ID3D12CommandList*> commandLists;
+		const bool bRecorded = PassScheduler::Execute(&renderer->GetJobSystem(), mPlan.levels,
+			[&](FrameGraphNode* passNode)
+			{
+				return passNode->Execute(device, descriptorManager, descriptorCache);
+			},
+			[&](const Vector<FrameGraphNode*>& level)
+			{
+				// Submit in declaration order so that the queue sees a topological order.
+				commandLists.clear();
+				for (const auto& passNode : level)
+				{
+					commandLists.emplace_back(passNode->GetCommandList(device));
+				}
+				device->GetCommandQueue()->ExecuteCommandLists(static_cast<UINT>(commandLists.size()), commandLists.data());
+			});
+		if (!bRecorded)
+			throw RuntimeError("FrameGraphPass::Execute Error");
 
 		renderer->Render(device);
 	}
@@ -173,12 +399,16 @@ namespace Amadeus
 			pass->Destroy();
 		}
 		mPassNodes.clear();
+		mPlan = FrameGraphPlan();
+		mScheduler.Invalidate();
 
+		mGraph.ClearEdges();
 		for (auto& resource : mResourcesDict)
 		{
 			resource.second->Destroy();
 		}
 		mResourcesDict.clear();
+		mTransientHeap.Reset();
 	}
 
 	FrameGraphNode* FrameGraphBuilder::DeclarePass(FrameGraph& fg, FrameGraphPass* pass)
@@ -187,19 +417,21 @@ namespace Amadeus
 	}
 
 	SharedPtr<FrameGraphResource> FrameGraphBuilder::Write(
-		String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* from)
+		String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* from,
+		UINT64 width, UINT height)
 	{
 		auto iter = fg.mResourcesDict.find(name);
 		if (iter == fg.mResourcesDict.end())
 		{
-			fg.mResourcesDict[name] = std::make_shared<FrameGraphResource>(name, type, format, from);
+			fg.mResourcesDict[name] = std::make_shared<FrameGraphResource>(name, type, format, from, width, height);
 		}
 
 		return fg.mResourcesDict[name];
 	}
 
 	SharedPtr<FrameGraphResource> FrameGraphBuilder::Read(
-		String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* to)
+		String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* to,
+		FrameGraphResourceUsage usage)
 	{
 		auto iter = fg.mResourcesDict.find(name);
 		if (iter == fg.mResourcesDict.end())
@@ -209,7 +441,7 @@ namespace Amadeus
 		else
 		{
 			auto& resource = iter->second;
-			resource->Connect(fg.mGraph, to);
+			resource->Connect(fg.mGraph, to, usage);
 		}
 
 		return fg.mResourcesDict[name];
@@ -248,6 +480,16 @@ namespace Amadeus
 		return mPass->Execute(device, descriptorManager, descriptorCache);
 	}
 
+	ID3D12GraphicsCommandList* FrameGraphNode::GetCommandList(SharedPtr<DeviceResources> device)
+	{
+		return mPass->GetCommandList(device);
+	}
+
+	void FrameGraphNode::SetBarriers(Vector<D3D12_RESOURCE_BARRIER>&& barriers, Vector<ID3D12Resource*>&& discards)
+	{
+		mPass->SetBarriers(std::move(barriers), std::move(discards));
+	}
+
 	void FrameGraphNode::Destroy()
 	{
 		mPass->Destroy();
@@ -1,8 +1,10 @@
 #pragma once
 #include "Prerequisites.h"
-#include "DependencyGraph.h"
+#include "Common/DependencyGraph.h"
 #include "FrameGraphPass.h"
 #include "FrameGraphResource.h"
+#include "Common/BarrierPlanner.h"
+#include "Common/PassScheduler.h"
 
 namespace Amadeus
 {
@@ -15,11 +17,14 @@ namespace Amadeus
 	public:
 		FrameGraphNode* DeclarePass(FrameGraph& fg, FrameGraphPass* pass);
 
+		// A width or height of 0 follows the window size.
 		SharedPtr<FrameGraphResource> Write(
-			String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* from);
+			String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* from,
+			UINT64 width = 0, UINT height = 0);
 
 		SharedPtr<FrameGraphResource> Read(
-			String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* to);
+			String&& name, FrameGraphResourceType type, DXGI_FORMAT format, FrameGraph& fg, FrameGraphNode* to,
+			FrameGraphResourceUsage usage = FrameGraphResourceUsage::SHADER_RESOURCE);
 	};
 
 	class FrameGraphNode
@@ -39,12 +44,30 @@ namespace Amadeus
 		bool Execute(
 			SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager, SharedPtr<DescriptorCache> descriptorCache);
 
+		ID3D12GraphicsCommandList* GetCommandList(SharedPtr<DeviceResources> device);
+
+		void SetBarriers(Vector<D3D12_RESOURCE_BARRIER>&& barriers, Vector<ID3D12Resource*>&& discards);
+
 		void Destroy();
 
 	private:
 		UniquePtr<FrameGraphPass> mPass;
 	};
 
+	// Everything Compile derives from the pass setup. It is only rebuilt when the pass
+	// set, the resolution or one of the EngineVar toggles changes.
+	struct FrameGraphPlan
+	{
+		// Live passes in declaration order, and the same passes grouped by level.
+		// Passes of the same level do not depend on each other and are recorded in parallel,
+		// the first pass of a level records the barriers of the whole level.
+		Vector<FrameGraphNode*> passes;
+		Vector<Vector<FrameGraphNode*>> levels;
+
+		// Resources used by live passes, placed in the transient heap.
+		Vector<FrameGraphResource*> resources;
+	};
+
 	class FrameGraph
 	{
 	public:
@@ -65,14 +88,34 @@ namespace Amadeus
 
 		void Destroy();
 
+		void Invalidate() { mScheduler.Invalidate(); }
+
 	private:
 		friend class FrameGraphBuilder;
 		friend class FrameGraphNode;
 
+		PassScheduler::Key GetPlanKey(SharedPtr<DeviceResources> device) const;
+
+		void BuildPlan(SharedPtr<DeviceResources> device);
+
+		void ComputeLevels();
+
+		// Fills the plan's resources and returns how the live passes access them.
+		Vector<BarrierPlanner::Access> CollectAccesses();
+
+		void AllocateResources(SharedPtr<DeviceResources> device,
+			const Vector<BarrierPlanner::Access>& accesses, const Vector<uint32_t>& initialStates);
+
+		void ResolveBarriers(const BarrierPlanner::Result& barriers);
+
 		DependencyGraph mGraph;
 
 		FrameGraphBuilder mBuilder;
 		Vector<SharedPtr<FrameGraphNode>> mPassNodes;
 		Map<String, SharedPtr<FrameGraphResource>> mResourcesDict;
+
+		FrameGraphPlan mPlan;
+		PassScheduler mScheduler;
+		ComPtr<ID3D12Heap> mTransientHeap;
 	};
 }
\ No newline at end of file
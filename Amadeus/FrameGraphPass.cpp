@@ -17,7 +17,9 @@ namespace Amadeus
     {
 		UINT curFrameIndex = device->GetCurrentFrameIndex();
 		auto& commandList = mCommandLists[curFrameIndex];
-		ThrowIfFailed(commandList->Reset(device->GetCommandAllocator(), mPipelineState.Get()));
+		ThrowIfFailed(mCommandAllocators[curFrameIndex]->Reset());
+		ThrowIfFailed(commandList->Reset(mCommandAllocators[curFrameIndex].Get(), mPipelineState.Get()));
+		RecordBarriers(commandList.Get());
 		commandList->SetGraphicsRootSignature(mRootSignature.Get());
 
 		ID3D12DescriptorHeap* ppHeaps[] = { descriptorCache->GetCbvSrvUavCache(device), descriptorManager->GetSamplerHeap() };
@@ -30,4 +32,43 @@ namespace Amadeus
 
 		return true;
     }
+
+	void FrameGraphPass::RecordBarriers(ID3D12GraphicsCommandList* commandList)
+	{
+		if (!mBarriers.empty())
+		{
+			commandList->ResourceBarrier(static_cast<UINT>(mBarriers.size()), mBarriers.data());
+		}
+
+		for (const auto& resource : mDiscards)
+		{
+			commandList->DiscardResource(resource, nullptr);
+		}
+	}
+
+	void FrameGraphPass::CreateCommandLists(SharedPtr<DeviceResources> device)
+	{
+		for (UINT i = 0; i < FrameCount; ++i)
+		{
+			ComPtr<ID3D12CommandAllocator> commandAllocator;
+
+			ThrowIfFailed(device->GetD3DDevice()->CreateCommandAllocator(
+				D3D12_COMMAND_LIST_TYPE_DIRECT,
+				IID_PPV_ARGS(&commandAllocator)));
+
+			ComPtr<ID3D12GraphicsCommandList> commandList;
+
+			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
+				0,
+				D3D12_COMMAND_LIST_TYPE_DIRECT,
+				commandAllocator.Get(),
+				mPipelineState.Get(),
+				IID_PPV_ARGS(&commandList)));
+
+			mCommandAllocators.emplace_back(commandAllocator);
+			mCommandLists.emplace_back(commandList);
+
+			ThrowIfFailed(commandList->Close());
+		}
+	}
 }
\ No newline at end of file
@@ -26,14 +26,40 @@ namespace Amadeus
 		virtual void Destroy()
 		{
 			mCommandLists.clear();
+			mCommandAllocators.clear();
+			mBarriers.clear();
+			mDiscards.clear();
 		}
 
 		bool IsTarget() { return bTarget; }
 
+		// Execute only records and closes the list, the frame graph submits it.
+		ID3D12GraphicsCommandList* GetCommandList(SharedPtr<DeviceResources> device)
+		{
+			return mCommandLists[device->GetCurrentFrameIndex()].Get();
+		}
+
+		// Barriers the frame graph planned for the start of this pass, and the resources
+		// discarded after them because their memory was just taken over.
+		void SetBarriers(Vector<D3D12_RESOURCE_BARRIER>&& barriers, Vector<ID3D12Resource*>&& discards)
+		{
+			mBarriers = std::move(barriers);
+			mDiscards = std::move(discards);
+		}
+
 	protected:
+		// Called right after the command list is reset.
+		void RecordBarriers(ID3D12GraphicsCommandList* commandList);
+
+		// One allocator per frame so that passes can record on different threads.
+		void CreateCommandLists(SharedPtr<DeviceResources> device);
+
 		ComPtr<ID3D12RootSignature> mRootSignature;
 		ComPtr<ID3D12PipelineState> mPipelineState;
+		Vector<ComPtr<ID3D12CommandAllocator>> mCommandAllocators;
 		Vector<ComPtr<ID3D12GraphicsCommandList>> mCommandLists;
+		Vector<D3D12_RESOURCE_BARRIER> mBarriers;
+		Vector<ID3D12Resource*> mDiscards;
 
 		bool bTarget;
 		bool bUploaded;
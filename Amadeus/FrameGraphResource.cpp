@@ -4,13 +4,14 @@
 namespace Amadeus
 {
     FrameGraphResource::FrameGraphResource(
-		const String& name, FrameGraphResourceType type, DXGI_FORMAT format, DependencyGraph::Node* from)
+		const String& name, FrameGraphResourceType type, DXGI_FORMAT format, DependencyGraph::Node* from,
+		UINT64 width, UINT height)
 		: mName(name)
 		, mType(type)
 		, mFormat(format)
+		, mWidth(width)
+		, mHeight(height)
 		, bRegistered(false)
-		, bWritten(false)
-		, bEarlyZ(false)
 		, mFrom(from)
 	{
 
@@ -18,189 +19,85 @@ namespace Amadeus
 
 	void FrameGraphResource::RegisterResource(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache)
 	{
-		if (!bRegistered)
-		{
-			switch (mType)
-			{
-			case FrameGraphResourceType::RENDER_TARGET:
-				RegisterRenderTarget(device);
-				break;
-			case FrameGraphResourceType::DEPTH:
-			case FrameGraphResourceType::STENCIL:
-				RegisterDepthStencil(device);
-				break;
-			default:
-				throw Exception("Invaild View Type.");
-			}
-
-			bRegistered = true;
-		}
-
+		assert(bRegistered);
 		AppendWriteView(device, cache);
 		AppendReadView(device, cache);
 	}
 
-	void FrameGraphResource::RegisterResource(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache, UINT64 width, UINT height)
+	void FrameGraphResource::PlaceResource(
+		SharedPtr<DeviceResources> device, ID3D12Heap* heap, UINT64 offset, D3D12_RESOURCE_STATES state)
 	{
-		if (!bRegistered)
-		{
-			switch (mType)
-			{
-			case FrameGraphResourceType::RENDER_TARGET:
-				RegisterRenderTarget(device, width, height);
-				break;
-			case FrameGraphResourceType::DEPTH:
-			case FrameGraphResourceType::STENCIL:
-				RegisterDepthStencil(device, width, height);
-				break;
-			default:
-				throw Exception("Invaild View Type.");
-			}
+		assert(!bRegistered);
 
-			bRegistered = true;
-		}
-
-		AppendWriteView(device, cache);
-		AppendReadView(device, cache);
+		const D3D12_RESOURCE_DESC resourceDesc = GetResourceDesc(device);
+		const D3D12_CLEAR_VALUE clearValue = GetClearValue();
+		ThrowIfFailed(device->GetD3DDevice()->CreatePlacedResource(
+			heap,
+			offset,
+			&resourceDesc,
+			state,
+			&clearValue,
+			IID_PPV_ARGS(&mResource)
+		));
+		SetName(mResource.Get(), String2WString(mName).c_str());
+		bRegistered = true;
 	}
 
 	void FrameGraphResource::UnregisterResource()
 	{
-
-	}
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE FrameGraphResource::GetWriteView(ID3D12GraphicsCommandList* commandList)
-	{
-		assert(bRegistered);
-		if (bRead)
+		if (bRegistered)
 		{
-			CD3DX12_RESOURCE_BARRIER transition;
-
-			switch (mType)
-			{
-			case FrameGraphResourceType::RENDER_TARGET:
-				if (mResourceState == D3D12_RESOURCE_STATE_RENDER_TARGET)
-				{
-					break;
-				}
-				transition = CD3DX12_RESOURCE_BARRIER::Transition(
-					mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_RENDER_TARGET);
-				commandList->ResourceBarrier(1, &transition);
-				mResourceState = D3D12_RESOURCE_STATE_RENDER_TARGET;
-				break;
-			case FrameGraphResourceType::DEPTH:
-			case FrameGraphResourceType::STENCIL:
-				if (bEarlyZ)
-				{
-					if (mResourceState == D3D12_RESOURCE_STATE_DEPTH_WRITE)
-					{
-						break;
-					}
-					transition = CD3DX12_RESOURCE_BARRIER::Transition(
-						mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-					commandList->ResourceBarrier(1, &transition);
-					mResourceState = D3D12_RESOURCE_STATE_DEPTH_WRITE;
-				}
-				else
-				{
-					if (mResourceState == D3D12_RESOURCE_STATE_DEPTH_WRITE)
-					{
-						break;
-					}
-					transition = CD3DX12_RESOURCE_BARRIER::Transition(
-						mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-					commandList->ResourceBarrier(1, &transition);
-					mResourceState = D3D12_RESOURCE_STATE_DEPTH_WRITE;
-				}
-				break;
-			default:
-				throw Exception("Invaild View Type.");
-			}
+			mResource.Reset();
+			bRegistered = false;
 		}
-
-		bRead = false;
-		bEarlyZ = false;
-
-		return mWriteHandle;
 	}
 
-	CD3DX12_GPU_DESCRIPTOR_HANDLE FrameGraphResource::GetReadView(ID3D12GraphicsCommandList* commandList)
+	D3D12_RESOURCE_DESC FrameGraphResource::GetResourceDesc(SharedPtr<DeviceResources> device) const
 	{
-		assert(bRegistered);
-		CD3DX12_RESOURCE_BARRIER transition;
+		D3D12_RESOURCE_DESC resourceDesc;
+		resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		resourceDesc.Alignment = 0;
+		resourceDesc.Width = mWidth ? mWidth : device->GetWindowWidth();
+		resourceDesc.Height = mHeight ? mHeight : device->GetWindowHeight();
+		resourceDesc.DepthOrArraySize = 1;
+		resourceDesc.MipLevels = 1;
+		resourceDesc.Format = mFormat;
+		resourceDesc.SampleDesc.Count = 1;
+		resourceDesc.SampleDesc.Quality = 0;
+		resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 
 		switch (mType)
 		{
 		case FrameGraphResourceType::RENDER_TARGET:
-			if (mResourceState == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
-			{
-				break;
-			}
-			transition = CD3DX12_RESOURCE_BARRIER::Transition(
-				mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-			commandList->ResourceBarrier(1, &transition);
-			mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+			resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 			break;
 		case FrameGraphResourceType::DEPTH:
 		case FrameGraphResourceType::STENCIL:
-			if (bEarlyZ)
-			{
-				if (mResourceState == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
-				{
-					break;
-				}
-				transition = CD3DX12_RESOURCE_BARRIER::Transition(
-					mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				commandList->ResourceBarrier(1, &transition);
-				mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			}
-			else
-			{
-				if (mResourceState == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
-				{
-					break;
-				}
-				transition = CD3DX12_RESOURCE_BARRIER::Transition(
-					mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				commandList->ResourceBarrier(1, &transition);
-				mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			}
+			resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 			break;
 		default:
 			throw Exception("Invaild View Type.");
 		}
 
-		bRead = true;
-		bEarlyZ = false;
-
-		return mReadHandle;
+		return resourceDesc;
 	}
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE FrameGraphResource::GetDepthStencilView(ID3D12GraphicsCommandList* commandList)
+	CD3DX12_CPU_DESCRIPTOR_HANDLE FrameGraphResource::GetWriteView() const
 	{
 		assert(bRegistered);
-		CD3DX12_RESOURCE_BARRIER transition;
-
-		switch (mType)
-		{
-		case FrameGraphResourceType::DEPTH:
-		case FrameGraphResourceType::STENCIL:
-			if (mResourceState == D3D12_RESOURCE_STATE_DEPTH_READ)
-			{
-				break;
-			}
-			transition = CD3DX12_RESOURCE_BARRIER::Transition(
-				mResource.Get(), mResourceState, D3D12_RESOURCE_STATE_DEPTH_READ);
-			commandList->ResourceBarrier(1, &transition);
-			mResourceState = D3D12_RESOURCE_STATE_DEPTH_READ;
-			break;
-		default:
-			throw Exception("Invaild View Type.");
-		}
+		return mWriteHandle;
+	}
 
-		bRead = true;
-		bEarlyZ = true;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE FrameGraphResource::GetReadView() const
+	{
+		assert(bRegistered);
+		return mReadHandle;
+	}
 
+	CD3DX12_CPU_DESCRIPTOR_HANDLE FrameGraphResource::GetDepthStencilView() const
+	{
+		assert(bRegistered);
+		assert(mType != FrameGraphResourceType::RENDER_TARGET);
 		return mWriteHandle;
 	}
 
@@ -247,21 +144,47 @@ namespace Amadeus
 		return mResource.Get();
 	}
 
-	void FrameGraphResource::Connect(DependencyGraph& graph, DependencyGraph::Node* to)
+	FrameGraphResourceUsage FrameGraphResource::GetWriterUsage() const
+	{
+		switch (mType)
+		{
+		case FrameGraphResourceType::RENDER_TARGET:
+			return FrameGraphResourceUsage::RENDER_TARGET;
+		case FrameGraphResourceType::DEPTH:
+		case FrameGraphResourceType::STENCIL:
+			return FrameGraphResourceUsage::DEPTH_WRITE;
+		default:
+			throw Exception("Invaild View Type.");
+		}
+	}
+
+	void FrameGraphResource::Connect(DependencyGraph& graph, DependencyGraph::Node* to, FrameGraphResourceUsage usage)
 	{
 		auto iter = std::find(mTo.begin(), mTo.end(), to);
 		if (iter == mTo.end())
 		{
 			mTo.emplace_back(to);
+			mToUsages.emplace_back(usage);
 			DependencyGraph::Edge* edge = new DependencyGraph::Edge(graph, mFrom, to);
 			mEdges.emplace_back(std::move(edge));
 		}
 	}
 
+	void FrameGraphResource::Disconnect()
+	{
+		for (auto& edge : mEdges)
+		{
+			delete edge;
+		}
+		mEdges.clear();
+		mTo.clear();
+		mToUsages.clear();
+	}
+
 	void FrameGraphResource::Destroy()
 	{
-		if (bRegistered)
-			mResource->Release();
+		UnregisterResource();
+		Disconnect();
 	}
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE FrameGraphResource::AppendRenderTargetView(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache)
@@ -287,135 +210,20 @@ namespace Amadeus
 		return mWriteHandle;
 	}
 
-	void FrameGraphResource::RegisterRenderTarget(SharedPtr<DeviceResources> device)
-	{
-		D3D12_RESOURCE_DESC renderTargetDesc;
-		renderTargetDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		renderTargetDesc.Alignment = 0;
-		renderTargetDesc.Width = device->GetWindowWidth();
-		renderTargetDesc.Height = device->GetWindowHeight();
-		renderTargetDesc.DepthOrArraySize = 1;
-		renderTargetDesc.MipLevels = 1;
-		renderTargetDesc.Format = mFormat;
-		renderTargetDesc.SampleDesc.Count = 1;
-		renderTargetDesc.SampleDesc.Quality = 0;
-		renderTargetDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		renderTargetDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-
-		D3D12_CLEAR_VALUE clearValue = {};
-		memcpy(clearValue.Color, BackgroundColor, sizeof(BackgroundColor));
-		clearValue.Format = mFormat;
-
-		const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&renderTargetDesc,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			&clearValue,
-			IID_PPV_ARGS(&mResource)
-		));
-		mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-		SetName(mResource.Get(), String2WString(mName).c_str());
-	}
-
-	void FrameGraphResource::RegisterDepthStencil(SharedPtr<DeviceResources> device)
-	{
-		D3D12_RESOURCE_DESC depthStencilDesc;
-		depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		depthStencilDesc.Alignment = 0;
-		depthStencilDesc.Width = device->GetWindowWidth();
-		depthStencilDesc.Height = device->GetWindowHeight();
-		depthStencilDesc.DepthOrArraySize = 1;
-		depthStencilDesc.MipLevels = 1;
-		depthStencilDesc.Format = mFormat;
-		depthStencilDesc.SampleDesc.Count = 1;
-		depthStencilDesc.SampleDesc.Quality = 0;
-		depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-		D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
-		depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-		depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
-		depthOptimizedClearValue.DepthStencil.Stencil = 0;
-
-		const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&depthStencilDesc,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			&depthOptimizedClearValue,
-			IID_PPV_ARGS(&mResource)
-		));
-		mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-		SetName(mResource.Get(), String2WString(mName).c_str());
-	}
-
-	void FrameGraphResource::RegisterRenderTarget(SharedPtr<DeviceResources> device, UINT64 width, UINT height)
+	D3D12_CLEAR_VALUE FrameGraphResource::GetClearValue() const
 	{
-		D3D12_RESOURCE_DESC renderTargetDesc;
-		renderTargetDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		renderTargetDesc.Alignment = 0;
-		renderTargetDesc.Width = width;
-		renderTargetDesc.Height = height;
-		renderTargetDesc.DepthOrArraySize = 1;
-		renderTargetDesc.MipLevels = 1;
-		renderTargetDesc.Format = mFormat;
-		renderTargetDesc.SampleDesc.Count = 1;
-		renderTargetDesc.SampleDesc.Quality = 0;
-		renderTargetDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		renderTargetDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-
 		D3D12_CLEAR_VALUE clearValue = {};
-		memcpy(clearValue.Color, BackgroundColor, sizeof(BackgroundColor));
-		clearValue.Format = mFormat;
-
-		const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&renderTargetDesc,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			&clearValue,
-			IID_PPV_ARGS(&mResource)
-		));
-		mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-		SetName(mResource.Get(), String2WString(mName).c_str());
-	}
-
-	void FrameGraphResource::RegisterDepthStencil(SharedPtr<DeviceResources> device, UINT64 width, UINT height)
-	{
-		D3D12_RESOURCE_DESC depthStencilDesc;
-		depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		depthStencilDesc.Alignment = 0;
-		depthStencilDesc.Width = width;
-		depthStencilDesc.Height = height;
-		depthStencilDesc.DepthOrArraySize = 1;
-		depthStencilDesc.MipLevels = 1;
-		depthStencilDesc.Format = mFormat;
-		depthStencilDesc.SampleDesc.Count = 1;
-		depthStencilDesc.SampleDesc.Quality = 0;
-		depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-		D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
-		depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-		depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
-		depthOptimizedClearValue.DepthStencil.Stencil = 0;
-
-		const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&depthStencilDesc,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			&depthOptimizedClearValue,
-			IID_PPV_ARGS(&mResource)
-		));
-		mResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-		SetName(mResource.Get(), String2WString(mName).c_str());
+		if (mType == FrameGraphResourceType::RENDER_TARGET)
+		{
+			memcpy(clearValue.Color, BackgroundColor, sizeof(BackgroundColor));
+			clearValue.Format = mFormat;
+		}
+		else
+		{
+			clearValue.Format = DXGI_FORMAT_D32_FLOAT;
+			clearValue.DepthStencil.Depth = 1.0f;
+			clearValue.DepthStencil.Stencil = 0;
+		}
+		return clearValue;
 	}
-
-
 }
\ No newline at end of file
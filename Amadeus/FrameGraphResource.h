@@ -1,6 +1,6 @@
 #pragma once
 #include "Prerequisites.h"
-#include "DependencyGraph.h"
+#include "Common/DependencyGraph.h"
 
 namespace Amadeus
 {
@@ -11,24 +11,42 @@ namespace Amadeus
 		STENCIL,
 	};
 
+	// How a pass uses a resource, the frame graph derives the barriers from it.
+	enum class FrameGraphResourceUsage
+	{
+		RENDER_TARGET,
+		DEPTH_WRITE,
+		DEPTH_READ,
+		SHADER_RESOURCE,
+		// Only orders the passes, the resource itself is not accessed.
+		DEPENDENCY,
+	};
+
 	class FrameGraphResource
 	{
 	public:
-		FrameGraphResource(const String& name, FrameGraphResourceType type, DXGI_FORMAT format, DependencyGraph::Node* from);
+		// A width or height of 0 follows the window size.
+		FrameGraphResource(const String& name, FrameGraphResourceType type, DXGI_FORMAT format, DependencyGraph::Node* from,
+			UINT64 width = 0, UINT height = 0);
 
+		// Appends this frame's views, the frame graph places the resource when it builds the plan.
 		void RegisterResource(
 			SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache);
 
-		void RegisterResource(
-			SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache, UINT64 width, UINT height);
+		// Creates the resource at offset in a heap shared with resources whose lifetimes do not overlap.
+		// The state is the one the planned barriers expect at the start of a frame.
+		void PlaceResource(SharedPtr<DeviceResources> device, ID3D12Heap* heap, UINT64 offset, D3D12_RESOURCE_STATES state);
 
 		void UnregisterResource();
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE GetWriteView(ID3D12GraphicsCommandList* commandList);
+		D3D12_RESOURCE_DESC GetResourceDesc(SharedPtr<DeviceResources> device) const;
+
+		// The frame graph has transitioned the resource before the pass is recorded.
+		CD3DX12_CPU_DESCRIPTOR_HANDLE GetWriteView() const;
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE GetReadView(ID3D12GraphicsCommandList* commandList);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE GetReadView() const;
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView(ID3D12GraphicsCommandList* commandList);
+		CD3DX12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView() const;
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE AppendWriteView(
 			SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache);
@@ -38,7 +56,18 @@ namespace Amadeus
 
 		ID3D12Resource* GetResource();
 
-		void Connect(DependencyGraph& graph, DependencyGraph::Node* to);
+		void Connect(DependencyGraph& graph, DependencyGraph::Node* to, FrameGraphResourceUsage usage);
+
+		void Disconnect();
+
+		DependencyGraph::Node* GetWriter() const { return mFrom; }
+
+		const Vector<DependencyGraph::Node*>& GetReaders() const { return mTo; }
+
+		FrameGraphResourceUsage GetWriterUsage() const;
+
+		// One per reader.
+		const Vector<FrameGraphResourceUsage>& GetReaderUsages() const { return mToUsages; }
 
 		void Destroy();
 
@@ -49,30 +78,23 @@ namespace Amadeus
 		CD3DX12_CPU_DESCRIPTOR_HANDLE AppendDepthStencilView(
 			SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> cache);
 
-		void RegisterRenderTarget(SharedPtr<DeviceResources> device);
-
-		void RegisterDepthStencil(SharedPtr<DeviceResources> device);
-
-		void RegisterRenderTarget(SharedPtr<DeviceResources> device, UINT64 width, UINT height);
-
-		void RegisterDepthStencil(SharedPtr<DeviceResources> device, UINT64 width, UINT height);
+		D3D12_CLEAR_VALUE GetClearValue() const;
 
 		String mName;
 		FrameGraphResourceType mType;
 		DXGI_FORMAT mFormat;
+		UINT64 mWidth;
+		UINT mHeight;
 
 		ComPtr<ID3D12Resource> mResource;
 		CD3DX12_CPU_DESCRIPTOR_HANDLE mWriteHandle;
 		CD3DX12_GPU_DESCRIPTOR_HANDLE mReadHandle;
-		D3D12_RESOURCE_STATES mResourceState;
 
 		bool bRegistered;
-		bool bWritten;
-		bool bRead;
-		bool bEarlyZ;
 
 		DependencyGraph::Node* mFrom;
 		Vector<DependencyGraph::Node*> mTo;
+		Vector<FrameGraphResourceUsage> mToUsages;
 		Vector<DependencyGraph::Edge*> mEdges;
 	};
 }
\ No newline at end of file
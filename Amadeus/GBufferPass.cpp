@@ -11,27 +11,22 @@ namespace Amadeus
 		: FrameGraphPass::FrameGraphPass(false)
     {
 		ProgramManager& shaders = ProgramManager::Instance();
+		// Only the bindless variants declare the unbounded texture table.
+		const String rootSignature = EngineVar::Bindless_Materials ? "BindlessRS.cso" : "Common.cso";
+		const String pixelShader = EngineVar::Bindless_Materials ? "GBufferBindless.cso" : "GBuffer.cso";
 
 		ThrowIfFailed(device->GetD3DDevice()->CreateRootSignature(
 			0,
-			shaders.Get("Common.cso")->GetBufferPointer(),
-			shaders.GetBufferSize("Common.cso"),
+			shaders.Get(rootSignature)->GetBufferPointer(),
+			shaders.GetBufferSize(rootSignature),
 			IID_PPV_ARGS(&mRootSignature)
 		));
 
-		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
-
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+		psoDesc.InputLayout = Primitive::GetInputLayout();
 		psoDesc.pRootSignature = mRootSignature.Get();
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(shaders.Get("Model.cso"));
-		psoDesc.PS = CD3DX12_SHADER_BYTECODE(shaders.Get("GBuffer.cso"));
+		psoDesc.PS = CD3DX12_SHADER_BYTECODE(shaders.Get(pixelShader));
 		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 		psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -51,21 +46,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
     }
 
 	bool GBufferPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -107,7 +88,8 @@ namespace Amadeus
 			"ZPreDepth",
 			FrameGraphResourceType::DEPTH,
 			DXGI_FORMAT_D32_FLOAT,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::DEPTH_READ);
 
 		mShadowMap = builder.Read(
 			"ShadowMap",
@@ -137,13 +119,13 @@ namespace Amadeus
 		UINT curFrameIndex = device->GetCurrentFrameIndex();
 		auto& commandList = mCommandLists[curFrameIndex];
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = mDepth->GetDepthStencilView(commandList.Get());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = mDepth->GetDepthStencilView();
 		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle[] =
 		{
-			mNormal->GetWriteView(commandList.Get()),
-			mBaseColor->GetWriteView(commandList.Get()),
-			mMetallicSpecularRoughness->GetWriteView(commandList.Get()),
-			mVelocity->GetWriteView(commandList.Get())
+			mNormal->GetWriteView(),
+			mBaseColor->GetWriteView(),
+			mMetallicSpecularRoughness->GetWriteView(),
+			mVelocity->GetWriteView()
 		};
 
 		commandList->ClearRenderTargetView(rtvHandle[0], BackgroundColor, 0, nullptr);
@@ -153,22 +135,21 @@ namespace Amadeus
 
 		commandList->OMSetRenderTargets(4, &rtvHandle[0], FALSE, &dsvHandle);
 
+		// Every material binds its own sampler, the default covers whatever is drawn before them.
 		commandList->SetGraphicsRootDescriptorTable(
-			COMMON_SAMPLER_ROOT_TABLE_INDEX, descriptorManager->GetSamplerHeap()->GetGPUDescriptorHandleForHeapStart());
+			COMMON_SAMPLER_ROOT_TABLE_INDEX, descriptorManager->GetSamplerTable(DEFAULT_SAMPLER_SLOT));
 
 		commandList->SetGraphicsRootDescriptorTable(
-			COMMON_RENDER_TARGET_SHADOW_TABLE_INDEX, mShadowMap->GetReadView(commandList.Get()));
+			COMMON_RENDER_TARGET_SHADOW_TABLE_INDEX, mShadowMap->GetReadView());
 
 		commandList->SetGraphicsRootDescriptorTable(
-			COMMON_RENDER_TARGET_SSAO_TABLE_INDEX, mSSAO->GetReadView(commandList.Get()));
+			COMMON_RENDER_TARGET_SSAO_TABLE_INDEX, mSSAO->GetReadView());
 
 		Texture* skybox = TextureManager::Instance().GetTexture(EngineVar::CUBEMAP_ENNIS_ID);
 		Texture* lut = TextureManager::Instance().GetTexture(EngineVar::TEXTURE_BRDF_LUT_ID);
-		CD3DX12_GPU_DESCRIPTOR_HANDLE iblHandle[] = {
-			descriptorCache->AppendSrvCache(device, lut->GetDescriptorHandle()),
-			descriptorCache->AppendSrvCache(device, skybox->GetDescriptorHandle()),
-		};
-		commandList->SetGraphicsRootDescriptorTable(7, *iblHandle);
+		// t7 and t8 are one table, the two descriptors have to be next to each other.
+		D3D12_CPU_DESCRIPTOR_HANDLE iblHandles[] = { lut->GetDescriptorHandle(), skybox->GetDescriptorHandle() };
+		commandList->SetGraphicsRootDescriptorTable(7, descriptorCache->AppendSrvTable(device, iblHandles, _countof(iblHandles)));
 
 		// GBuffer Render
 		GBufferRender params = {};
@@ -183,8 +164,6 @@ namespace Amadeus
 		}
 
 		ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
-		ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get() };
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
 
 		return true;
 	}
@@ -10,27 +10,22 @@ namespace Amadeus
 		: FrameGraphPass::FrameGraphPass(false)
 	{
 		ProgramManager& shaders = ProgramManager::Instance();
+		// Only the bindless variants declare the unbounded texture table.
+		const String rootSignature = EngineVar::Bindless_Materials ? "BindlessRS.cso" : "Common.cso";
+		const String pixelShader = EngineVar::Bindless_Materials ? "GBufferTransparentBindless.cso" : "GBufferTransparent.cso";
 
 		ThrowIfFailed(device->GetD3DDevice()->CreateRootSignature(
 			0,
-			shaders.Get("Common.cso")->GetBufferPointer(),
-			shaders.GetBufferSize("Common.cso"),
+			shaders.Get(rootSignature)->GetBufferPointer(),
+			shaders.GetBufferSize(rootSignature),
 			IID_PPV_ARGS(&mRootSignature)
 		));
 
-		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
-
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+		psoDesc.InputLayout = Primitive::GetInputLayout();
 		psoDesc.pRootSignature = mRootSignature.Get();
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(shaders.Get("Model.cso"));
-		psoDesc.PS = CD3DX12_SHADER_BYTECODE(shaders.Get("GBufferTransparent.cso"));
+		psoDesc.PS = CD3DX12_SHADER_BYTECODE(shaders.Get(pixelShader));
 		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 		psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -49,21 +44,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
 	}
 
 	bool GBufferTransparentPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -87,31 +68,36 @@ namespace Amadeus
 			"Normal",
 			FrameGraphResourceType::RENDER_TARGET,
 			DXGI_FORMAT_R10G10B10A2_UNORM,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::RENDER_TARGET);
 
 		mBaseColor = builder.Read(
 			"BaseColor",
 			FrameGraphResourceType::RENDER_TARGET,
 			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::RENDER_TARGET);
 
 		mMetallicSpecularRoughness = builder.Read(
 			"MetallicSpecularRoughness",
 			FrameGraphResourceType::RENDER_TARGET,
 			DXGI_FORMAT_R8G8B8A8_UNORM,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::RENDER_TARGET);
 
 		mVelocity = builder.Read(
 			"Velocity",
 			FrameGraphResourceType::RENDER_TARGET,
 			DXGI_FORMAT_R16G16_FLOAT,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::RENDER_TARGET);
 
 		mDepth = builder.Read(
 			"ZPreDepth",
 			FrameGraphResourceType::DEPTH,
 			DXGI_FORMAT_D32_FLOAT,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::DEPTH_READ);
 	}
 
 	void GBufferTransparentPass::RegisterResource(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache)
@@ -125,27 +111,26 @@ namespace Amadeus
 		UINT curFrameIndex = device->GetCurrentFrameIndex();
 		auto& commandList = mCommandLists[curFrameIndex];
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = mDepth->GetDepthStencilView(commandList.Get());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = mDepth->GetDepthStencilView();
 		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle[] =
 		{
-			mNormal->GetWriteView(commandList.Get()),
-			mBaseColor->GetWriteView(commandList.Get()),
-			mMetallicSpecularRoughness->GetWriteView(commandList.Get()),
-			mVelocity->GetWriteView(commandList.Get())
+			mNormal->GetWriteView(),
+			mBaseColor->GetWriteView(),
+			mMetallicSpecularRoughness->GetWriteView(),
+			mVelocity->GetWriteView()
 		};
 
 		commandList->OMSetRenderTargets(4, &rtvHandle[0], FALSE, &dsvHandle);
 
+		// Every material binds its own sampler, the default covers whatever is drawn before them.
 		commandList->SetGraphicsRootDescriptorTable(
-			COMMON_SAMPLER_ROOT_TABLE_INDEX, descriptorManager->GetSamplerHeap()->GetGPUDescriptorHandleForHeapStart());
+			COMMON_SAMPLER_ROOT_TABLE_INDEX, descriptorManager->GetSamplerTable(DEFAULT_SAMPLER_SLOT));
 
 		Texture* skybox = TextureManager::Instance().GetTexture(EngineVar::CUBEMAP_ENNIS_ID);
 		Texture* lut = TextureManager::Instance().GetTexture(EngineVar::TEXTURE_BRDF_LUT_ID);
-		CD3DX12_GPU_DESCRIPTOR_HANDLE iblHandle[] = {
-			descriptorCache->AppendSrvCache(device, lut->GetDescriptorHandle()),
-			descriptorCache->AppendSrvCache(device, skybox->GetDescriptorHandle()),
-		};
-		commandList->SetGraphicsRootDescriptorTable(7, *iblHandle);
+		// t7 and t8 are one table, the two descriptors have to be next to each other.
+		D3D12_CPU_DESCRIPTOR_HANDLE iblHandles[] = { lut->GetDescriptorHandle(), skybox->GetDescriptorHandle() };
+		commandList->SetGraphicsRootDescriptorTable(7, descriptorCache->AppendSrvTable(device, iblHandles, _countof(iblHandles)));
 
 		// GBuffer Transparent Render
 		GBufferTransparentRender params = {};
@@ -160,8 +145,6 @@ namespace Amadeus
 		}
 
 		ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
-		ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get() };
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
 
 		return true;
 	}
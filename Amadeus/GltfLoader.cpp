@@ -7,11 +7,118 @@
 #include "tinygltf/tiny_gltf.h"
 #include "ResourceManagers.h"
 #include "GltfLoader.h"
+#include "RenderSystem.h"
+#include "Common/MappedFile.h"
+#include "Common/VertexDecoder.h"
+#include "Common/LoadPipeline.h"
+#include "Common/ScenePackage.h"
+#include "Common/DerivedDataCache.h"
 
 namespace Amadeus
 {
-	void LoadSampler(tinygltf::Model& model, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+	// A parsed document together with its buffers. Buffers point straight into the mapped
+	// files, tinygltf only parses the JSON and never sees the buffer data.
+	struct GltfAsset
 	{
+		tinygltf::Model model;
+		Vector<std::span<const uint8_t>> buffers;
+		// Per image, the buffer view holding the encoded image, or -1 for a file next to the asset.
+		Vector<INT> imageBufferViews;
+		// UTF-8 paths of the buffer and image files the document refers to, relative to it.
+		Vector<String> sources;
+
+		Vector<UniquePtr<MappedFile>> files;
+		Vector<Vector<uint8_t>> decodedBuffers;
+
+		std::span<const uint8_t> GetBuffer(INT index) const
+		{
+			if (index < 0 || static_cast<size_t>(index) >= buffers.size())
+			{
+				throw OutOfRange("BufferView references a buffer that does not exist.");
+			}
+			return buffers[index];
+		}
+
+		std::span<const uint8_t> GetBufferView(INT index) const
+		{
+			if (index < 0 || static_cast<size_t>(index) >= model.bufferViews.size())
+			{
+				throw OutOfRange("BufferView does not exist.");
+			}
+
+			const auto& bufferView = model.bufferViews[index];
+			const auto buffer = GetBuffer(bufferView.buffer);
+			if (bufferView.byteOffset + bufferView.byteLength > buffer.size())
+			{
+				throw OutOfRange("BufferView goes out of range of buffer.");
+			}
+			return buffer.subspan(bufferView.byteOffset, bufferView.byteLength);
+		}
+	};
+
+	// What the tasks loading one file share, the files stay mapped until the last of them is done.
+	struct GltfLoad
+	{
+		WString fileName;
+		WString fullPath;
+		GltfAsset asset;
+		SharedPtr<DerivedDataCache> cache;
+		Boundary boundary;
+
+		// Primitives that have not joined the scene, only touched by the main thread.
+		size_t remainingPrimitives = 0;
+
+		WString packagePath;
+		// Size and write time of the file when the load began, a package cooked from it carries them
+		// along with those of every buffer and image the file refers to.
+		bool bStamped = false;
+		UINT64 sourceSize = 0;
+		UINT64 sourceTime = 0;
+
+		// Set when the scene comes from its package, which stays mapped until the last item is done.
+		UniquePtr<MappedFile> packageFile;
+		UniquePtr<ScenePackage> package;
+
+		// Collects the package while the glTF loads, whichever cook finishes last writes it.
+		UniquePtr<ScenePackage::Writer> writer;
+		Atomic<size_t> remainingCooks{ 0 };
+#ifdef _DEBUG
+		double before[2] = {};
+		double after[2] = {};
+		size_t triangles = 0;
+#endif // _DEBUG
+	};
+
+	// A texture or a primitive on its way through the stages, an item that is dropped frees it.
+	template<class T>
+	struct Staged
+	{
+		SharedPtr<GltfLoad> load;
+		UniquePtr<T> result;
+	};
+
+	// Cooked samplers only keep the filter and address modes, the rest is the same for every sampler.
+	D3D12_SAMPLER_DESC CreateSamplerDesc(D3D12_FILTER filter, D3D12_TEXTURE_ADDRESS_MODE addressU, D3D12_TEXTURE_ADDRESS_MODE addressV)
+	{
+		D3D12_SAMPLER_DESC samplerDesc = {};
+		samplerDesc.Filter = filter;
+		samplerDesc.AddressU = addressU;
+		samplerDesc.AddressV = addressV;
+		samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		samplerDesc.MinLOD = 0;
+		samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
+		samplerDesc.MipLODBias = 0.0f;
+		samplerDesc.MaxAnisotropy = 1;
+		samplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+		return samplerDesc;
+	}
+
+	// Slots of the samplers in the DescriptorManager heap, in the order of the file.
+	Vector<UINT> LoadSampler(tinygltf::Model& model, ScenePackage::Writer* writer, SharedPtr<DeviceResources> device,
+		SharedPtr<DescriptorManager> descriptorManager)
+	{
+		Vector<UINT> slots;
+		slots.reserve(model.samplers.size());
 		for (const auto& sampler : model.samplers)
 		{
 			int magFilter = sampler.magFilter;
@@ -25,10 +132,9 @@ namespace Amadeus
 			int warpS = sampler.wrapS;
 			int warpT = sampler.wrapT;
 
-			D3D12_SAMPLER_DESC samplerDesc = {};
-			D3D12_FILTER& filter = samplerDesc.Filter;
-			D3D12_TEXTURE_ADDRESS_MODE& addressU = samplerDesc.AddressU;
-			D3D12_TEXTURE_ADDRESS_MODE& addressV = samplerDesc.AddressV;
+			D3D12_FILTER filter = {};
+			D3D12_TEXTURE_ADDRESS_MODE addressU = {};
+			D3D12_TEXTURE_ADDRESS_MODE addressV = {};
 
 			if (magFilter == TINYGLTF_TEXTURE_FILTER_NEAREST
 				&& minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST) {
@@ -87,40 +193,234 @@ namespace Amadeus
 				addressV = D3D12_TEXTURE_ADDRESS_MODE_MIRROR;
 			}
 
-			samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-			samplerDesc.MinLOD = 0;
-			samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
-			samplerDesc.MipLODBias = 0.0f;
-			samplerDesc.MaxAnisotropy = 1;
-			samplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+			if (writer)
+			{
+				writer->AddSampler({ static_cast<UINT32>(filter), static_cast<UINT32>(addressU), static_cast<UINT32>(addressV), 0 });
+			}
+
+			slots.push_back(descriptorManager->AllocateSampler(device, CreateSamplerDesc(filter, addressU, addressV)));
+		}
+		return slots;
+	}
 
-			descriptorManager->AllocateSamplerHeap(device, samplerDesc);
+	Vector<UINT> LoadSampler(const ScenePackage& package, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+	{
+		Vector<UINT> slots;
+		slots.reserve(package.GetSamplers().size());
+		for (const auto& sampler : package.GetSamplers())
+		{
+			slots.push_back(descriptorManager->AllocateSampler(device, CreateSamplerDesc(static_cast<D3D12_FILTER>(sampler.filter),
+				static_cast<D3D12_TEXTURE_ADDRESS_MODE>(sampler.addressU), static_cast<D3D12_TEXTURE_ADDRESS_MODE>(sampler.addressV))));
 		}
+		return slots;
 	}
 
-	void LoadTexture(WString&& fileName, tinygltf::Model& model, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+	// Materials bind one sampler, the one of the base color texture or else of the first texture that has
+	// one. -1 for the default sampler.
+	INT GetSamplerId(const tinygltf::Model& model, const tinygltf::Material& material)
 	{
+		const INT textures[] = { material.pbrMetallicRoughness.baseColorTexture.index,
+			material.pbrMetallicRoughness.metallicRoughnessTexture.index, material.normalTexture.index,
+			material.occlusionTexture.index, material.emissiveTexture.index };
+		for (INT texture : textures)
+		{
+			if (texture < 0 || texture >= static_cast<INT>(model.textures.size()))
+				continue;
+			const INT sampler = model.textures[texture].sampler;
+			if (sampler >= 0 && sampler < static_cast<INT>(model.samplers.size()))
+				return sampler;
+		}
+		return -1;
+	}
+
+	void SetMaterialSampler(Material* dstMaterial, INT sampler, const Vector<UINT>& samplers,
+		SharedPtr<DescriptorManager> descriptorManager)
+	{
+		const UINT slot = sampler > -1 ? samplers.at(sampler) : DEFAULT_SAMPLER_SLOT;
+		dstMaterial->SetSampler(slot, descriptorManager->GetSamplerTable(slot));
+	}
+
+	// The last cook of a load writes the package. A load that failed somewhere never gets here and leaves
+	// no package behind, the next start imports the glTF again.
+	void FinishCook(GltfLoad& load)
+	{
+		if (--load.remainingCooks != 0)
+			return;
+
+		try
+		{
+			load.writer->Write(load.packagePath);
+		}
+		catch (const Exception& e)
+		{
+			char message[320];
+			if (sprintf_s(message, "Scene package not written: %s\n", e.what()) > 0)
+			{
+				OutputDebugStringA(message);
+			}
+		}
+		load.writer.reset();
+	}
+
+	LoadPipeline::Task UploadTexture(SharedPtr<Staged<Texture>> staged, SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
+	{
+		return { LoadPipeline::Stage::Upload, false, [=]
+		{
+			staged->result->Upload(device, renderer->GetUploader());
+		} };
+	}
+
+	LoadPipeline::Task CookTexture(SharedPtr<Staged<Texture>> staged, size_t index, const WString& name, SharedPtr<DeviceResources> device)
+	{
+		++staged->load->remainingCooks;
+		return { LoadPipeline::Stage::Cook, false, [=]
+		{
+			staged->result->Cook(device, *staged->load->writer, index, WString2String(name));
+			FinishCook(*staged->load);
+		} };
+	}
+
+	LoadPipeline::Task CommitTexture(SharedPtr<Staged<Texture>> staged, const WString& name, SharedPtr<DeviceResources> device,
+		SharedPtr<DescriptorCache> descriptorCache, SharedPtr<RenderSystem> renderer)
+	{
+		return { LoadPipeline::Stage::Commit, true, [=]
+		{
+			// The copies land before the mips are generated and the materials sample it.
+			renderer->Flush(device);
+			TextureManager& textures = TextureManager::Instance();
+			textures.Add(name, staged->result.release());
+			textures.PreCompute(device);
+			MaterialManager::Instance().UpdateAll(device, descriptorCache);
+		} };
+	}
+
+	void LoadTexture(SharedPtr<GltfLoad> load, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+		SharedPtr<DescriptorCache> descriptorCache, SharedPtr<RenderSystem> renderer, LoadPipeline& pipeline)
+	{
+		const tinygltf::Model& model = load->asset.model;
+		const WString& fileName = load->fileName;
 		TextureManager& textureManager = TextureManager::Instance();
 		assert(textureManager.Empty());
 
-		Set<INT> baseColors;
-		for (auto& mat : model.materials)
+		// The slot an image is sampled in picks how it is compressed. An image in several slots keeps
+		// what they all need: base color wins, occlusion packed with metallic roughness keeps all three
+		// channels and any other mix is left uncompressed.
+		Vector<TextureType> imageTypes(model.images.size(), TextureType::NUM_TEXTURE_TYPE);
+		auto assign = [&](INT texture, TextureType type)
+		{
+			if (texture < 0 || texture >= static_cast<INT>(model.textures.size()) || model.textures[texture].source < 0
+				|| model.textures[texture].source >= static_cast<INT>(model.images.size()))
+				return;
+			TextureType& assigned = imageTypes[model.textures[texture].source];
+			if (assigned == TextureType::NUM_TEXTURE_TYPE || assigned == type)
+				assigned = type;
+			else if (assigned == TextureType::BASE_COLOR || type == TextureType::BASE_COLOR)
+				assigned = TextureType::BASE_COLOR;
+			else if ((assigned == TextureType::METALLIC_ROUGHNESS || assigned == TextureType::OCCLUSION)
+				&& (type == TextureType::METALLIC_ROUGHNESS || type == TextureType::OCCLUSION))
+				assigned = TextureType::METALLIC_ROUGHNESS;
+			else
+				assigned = TextureType::OTHER;
+		};
+		for (const auto& mat : model.materials)
 		{
-			INT baseColorId = mat.pbrMetallicRoughness.baseColorTexture.index;
-			baseColors.insert(baseColorId);
+			assign(mat.pbrMetallicRoughness.baseColorTexture.index, TextureType::BASE_COLOR);
+			assign(mat.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureType::METALLIC_ROUGHNESS);
+			assign(mat.normalTexture.index, TextureType::NORMAL);
+			assign(mat.occlusionTexture.index, TextureType::OCCLUSION);
+			assign(mat.emissiveTexture.index, TextureType::EMISSIVE);
 		}
 
-		for (auto& tex : model.textures)
+		// Ids are reserved in the order of the textures, the materials refer to them before they load.
+		Set<WString> names;
+		for (size_t index = 0; index < model.textures.size(); ++index)
 		{
-			auto& image = model.images[tex.source];
-			TextureType type = TextureType::OTHER;
+			const auto& tex = model.textures[index];
+			// A texture without an image keeps its id, the materials using it fall back to their factors.
+			if (tex.source < 0 || tex.source >= static_cast<INT>(model.images.size()))
+			{
+				const WString name = L"Models\\" + fileName + L"\\" + fileName + L"#texture" + std::to_wstring(index);
+				textureManager.Reserve(name);
+				if (load->writer)
+				{
+					ScenePackage::TextureRecord record = {};
+					record.type = static_cast<UINT32>(TextureType::OTHER);
+					load->writer->SetTexture(index, record, WString2String(name), {});
+				}
+				continue;
+			}
+
+			const TextureType type = imageTypes[tex.source] == TextureType::NUM_TEXTURE_TYPE ? TextureType::OTHER : imageTypes[tex.source];
 
-			auto iter = baseColors.find(tex.source);
-			if (iter != baseColors.end())
-				type = TextureType::BASE_COLOR;
+			const auto& image = model.images[tex.source];
+			const INT bufferView = load->asset.imageBufferViews[tex.source];
+			const WString name = bufferView == -1
+				? WString(L"Models\\" + fileName + L"\\" + String2WString(image.uri))
+				: WString(L"Models\\" + fileName + L"\\" + fileName + L"#" + std::to_wstring(tex.source));
 
-			textureManager.LoadFromFile(
-				WString(L"Models\\" + fileName + L"\\" + String2WString(image.uri)), type, device, descriptorManager);
+			textureManager.Reserve(name);
+			// Textures of one image share the texture of the first.
+			if (!names.insert(name).second)
+			{
+				if (load->writer)
+				{
+					ScenePackage::TextureRecord record = {};
+					record.type = static_cast<UINT32>(type);
+					load->writer->SetTexture(index, record, WString2String(name), {});
+				}
+				continue;
+			}
+
+			auto staged = std::make_shared<Staged<Texture>>();
+			staged->load = load;
+			Vector<LoadPipeline::Task> tasks = {
+				{ LoadPipeline::Stage::DecodeTexture, false, [=]
+				{
+					// Embedded images are decoded straight from the mapped file.
+					if (bufferView == -1)
+						staged->result.reset(new Texture(WString(name), type, device, descriptorManager, staged->load->cache.get(),
+							&renderer->GetJobSystem()));
+					else
+						staged->result.reset(new Texture(staged->load->asset.GetBufferView(bufferView), type, device, descriptorManager,
+							staged->load->cache.get(), &renderer->GetJobSystem()));
+				} },
+				UploadTexture(staged, device, renderer),
+			};
+			if (load->writer)
+			{
+				tasks.push_back(CookTexture(staged, index, name, device));
+			}
+			tasks.push_back(CommitTexture(staged, name, device, descriptorCache, renderer));
+			pipeline.Add(std::move(tasks));
+		}
+	}
+
+	// Cooked textures are created from the mapped levels, the upload copies straight out of the package.
+	void LoadTexture(SharedPtr<GltfLoad> load, const ScenePackage& package, SharedPtr<DeviceResources> device,
+		SharedPtr<DescriptorManager> descriptorManager, SharedPtr<DescriptorCache> descriptorCache, SharedPtr<RenderSystem> renderer,
+		LoadPipeline& pipeline)
+	{
+		TextureManager& textureManager = TextureManager::Instance();
+		assert(textureManager.Empty());
+
+		for (const auto& texture : package.GetTextures())
+		{
+			const WString name = String2WString(String(package.GetName(texture)));
+			textureManager.Reserve(name);
+			if (texture.subresourceCount == 0)
+				continue;
+
+			const ScenePackage::TextureRecord* record = &texture;
+			auto staged = std::make_shared<Staged<Texture>>();
+			staged->load = load;
+			pipeline.Add({
+				{ LoadPipeline::Stage::DecodeTexture, false, [=]
+				{
+					staged->result.reset(new Texture(*staged->load->package, *record, device, descriptorManager));
+				} },
+				UploadTexture(staged, device, renderer),
+				CommitTexture(staged, name, device, descriptorCache, renderer),
+			});
 		}
 	}
 
@@ -184,15 +484,25 @@ namespace Amadeus
 		dstMaterial->SetEmissive(std::move(emissiveFactor));
 	}
 
-	void LoadMaterial(tinygltf::Model& model)
+	// Textures without an image are left out of the material.
+	Material::TextureId GetTextureId(const tinygltf::Model& model, INT texture)
+	{
+		if (texture < 0 || texture >= static_cast<INT>(model.textures.size()))
+			return -1;
+		const INT source = model.textures[texture].source;
+		return source < 0 || source >= static_cast<INT>(model.images.size()) ? -1 : texture;
+	}
+
+	void LoadMaterial(tinygltf::Model& model, ScenePackage::Writer* writer, const Vector<UINT>& samplers,
+		SharedPtr<DescriptorManager> descriptorManager)
 	{
 		for (auto& mat : model.materials)
 		{
-			Material::TextureId baseColorId			= mat.pbrMetallicRoughness.baseColorTexture.index;
-			Material::TextureId metallicRoughnessId = mat.pbrMetallicRoughness.metallicRoughnessTexture.index;
-			Material::TextureId normalId			= mat.normalTexture.index;
-			Material::TextureId occlusionId			= mat.occlusionTexture.index;
-			Material::TextureId emissiveId			= mat.emissiveTexture.index;
+			Material::TextureId baseColorId			= GetTextureId(model, mat.pbrMetallicRoughness.baseColorTexture.index);
+			Material::TextureId metallicRoughnessId = GetTextureId(model, mat.pbrMetallicRoughness.metallicRoughnessTexture.index);
+			Material::TextureId normalId			= GetTextureId(model, mat.normalTexture.index);
+			Material::TextureId occlusionId			= GetTextureId(model, mat.occlusionTexture.index);
+			Material::TextureId emissiveId			= GetTextureId(model, mat.emissiveTexture.index);
 			UINT64 index = MaterialManager::Instance().CreateMaterial(
 				baseColorId, metallicRoughnessId, normalId, occlusionId, emissiveId);
 			Material* pMaterial = MaterialManager::Instance().GetMaterial(index);
@@ -223,13 +533,60 @@ namespace Amadeus
 			pMaterial->SetAlphaMode(alphaCutoff, alphaMode);
 
 			pMaterial->SetDoubleSided(mat.doubleSided);
+
+			const INT samplerId = GetSamplerId(model, mat);
+			SetMaterialSampler(pMaterial, samplerId, samplers, descriptorManager);
+
+			if (writer)
+			{
+				ScenePackage::MaterialRecord record = {};
+				record.textures[0] = baseColorId;
+				record.textures[1] = metallicRoughnessId;
+				record.textures[2] = normalId;
+				record.textures[3] = occlusionId;
+				record.textures[4] = emissiveId;
+				record.sampler = samplerId;
+				std::fill(std::begin(record.baseColorFactor), std::end(record.baseColorFactor), 1.0f);
+				std::copy(mat.pbrMetallicRoughness.baseColorFactor.begin(), mat.pbrMetallicRoughness.baseColorFactor.end(), record.baseColorFactor);
+				record.metallicFactor = static_cast<float>(mat.pbrMetallicRoughness.metallicFactor);
+				record.roughnessFactor = static_cast<float>(mat.pbrMetallicRoughness.roughnessFactor);
+				record.normalScale = static_cast<float>(mat.normalTexture.scale);
+				record.occlusionStrength = static_cast<float>(mat.occlusionTexture.strength);
+				std::copy(mat.emissiveFactor.begin(), mat.emissiveFactor.end(), record.emissiveFactor);
+				record.alphaCutoff = alphaCutoff;
+				record.alphaMode = static_cast<UINT32>(alphaMode);
+				record.bDoubleSided = mat.doubleSided;
+				writer->AddMaterial(record);
+			}
+		}
+	}
+
+	void LoadMaterial(const ScenePackage& package, const Vector<UINT>& samplers, SharedPtr<DescriptorManager> descriptorManager)
+	{
+		MaterialManager& materialManager = MaterialManager::Instance();
+		for (const auto& material : package.GetMaterials())
+		{
+			UINT64 index = materialManager.CreateMaterial(
+				material.textures[0], material.textures[1], material.textures[2], material.textures[3], material.textures[4]);
+			Material* pMaterial = materialManager.GetMaterial(index);
+
+			pMaterial->SetPBRMetallicRoughness(
+				Vector<float>(std::begin(material.baseColorFactor), std::end(material.baseColorFactor)),
+				material.metallicFactor,
+				material.roughnessFactor);
+			pMaterial->SetNormal(material.normalScale);
+			pMaterial->SetOcclusion(material.occlusionStrength);
+			pMaterial->SetEmissive(Vector<float>(std::begin(material.emissiveFactor), std::end(material.emissiveFactor)));
+			pMaterial->SetAlphaMode(material.alphaCutoff, static_cast<Material::MATERIAL_ALPHA_MODE>(material.alphaMode));
+			pMaterial->SetDoubleSided(material.bDoubleSided != 0);
+			SetMaterialSampler(pMaterial, material.sampler, samplers, descriptorManager);
 		}
 	}
 
 	// Validate that an accessor does not go out of bounds of the buffer view that it references and that the buffer view does not exceed
 	// the bounds of the buffer that it references.
 	void ValidateAccessor(const tinygltf::Accessor& accessor, const tinygltf::BufferView& bufferView,
-		const Vector<uint8_t>& buffer, size_t byteStride, size_t elementSize)
+		std::span<const uint8_t> buffer, size_t byteStride, size_t elementSize)
 	{
 		// Make sure the accessor does not go out of range of the buffer view.
 		if (accessor.byteOffset + (accessor.count - 1) * byteStride + elementSize > bufferView.byteLength)
@@ -244,122 +601,33 @@ namespace Amadeus
 		}
 	}
 
-	void CreatePrimitivePositionDesc(const tinygltf::Model& model,
-		const tinygltf::Accessor& accessor, Vector<Primitive::Vertex>& vertices)
-	{
-		const auto& bufferView = model.bufferViews[accessor.bufferView];
-		if (bufferView.target != TINYGLTF_TARGET_ARRAY_BUFFER && bufferView.target != 0)
-		{
-			throw Exception("Primitive position info(Buffer View Target) is invalid.");
-		}
-
-		const auto& buffer = model.buffers[bufferView.buffer].data;
-		constexpr size_t PackedSize = sizeof(XMFLOAT3);
-		const size_t stride = bufferView.byteStride == 0 ? PackedSize : bufferView.byteStride;
-		ValidateAccessor(accessor, bufferView, buffer, stride, PackedSize);
-
-		const uint8_t* bufferPtr = buffer.data() + bufferView.byteOffset + accessor.byteOffset;
-		for (uint32_t i = 0; i < accessor.count; ++i, bufferPtr += stride)
-		{
-			vertices[i].position = *reinterpret_cast<const XMFLOAT3*>(bufferPtr);
-		}
-	}
-
-	void CreatePrimitiveNormalDesc(const tinygltf::Model& model,
-		const tinygltf::Accessor& accessor, Vector<Primitive::Vertex>& vertices)
-	{
-		const auto& bufferView = model.bufferViews[accessor.bufferView];
-		if (bufferView.target != TINYGLTF_TARGET_ARRAY_BUFFER && bufferView.target != 0)
-		{
-			throw Exception("Primitive normal info(Buffer View Target) is invalid.");
-		}
-
-		const auto& buffer = model.buffers[bufferView.buffer].data;
-		constexpr size_t PackedSize = sizeof(XMFLOAT3);
-		const size_t stride = bufferView.byteStride == 0 ? PackedSize : bufferView.byteStride;
-		ValidateAccessor(accessor, bufferView, buffer, stride, PackedSize);
-
-		const uint8_t* bufferPtr = buffer.data() + bufferView.byteOffset + accessor.byteOffset;
-		for (uint32_t i = 0; i < accessor.count; ++i, bufferPtr += stride)
-		{
-			vertices[i].normal = *reinterpret_cast<const XMFLOAT3*>(bufferPtr);
-		}
-	}
-
-	void CreatePrimitiveTangentDesc(const tinygltf::Model& model,
-		const tinygltf::Accessor& accessor, Vector<Primitive::Vertex>& vertices)
-	{
-		const auto& bufferView = model.bufferViews[accessor.bufferView];
-		if (bufferView.target != TINYGLTF_TARGET_ARRAY_BUFFER && bufferView.target != 0)
-		{
-			throw Exception("Primitive tangent info(Buffer View Target) is invalid.");
-		}
-
-		const auto& buffer = model.buffers[bufferView.buffer].data;
-		constexpr size_t PackedSize = sizeof(XMFLOAT4);
-		const size_t stride = bufferView.byteStride == 0 ? PackedSize : bufferView.byteStride;
-		ValidateAccessor(accessor, bufferView, buffer, stride, PackedSize);
-
-		const uint8_t* bufferPtr = buffer.data() + bufferView.byteOffset + accessor.byteOffset;
-		for (uint32_t i = 0; i < accessor.count; ++i, bufferPtr += stride)
-		{
-			vertices[i].tangent = *reinterpret_cast<const XMFLOAT4*>(bufferPtr);
-		}
-	}
-
-	template<typename T>
-	void CreatePrimitiveTexCoordDesc(const tinygltf::Model& model,
-		const tinygltf::Accessor& accessor, Vector<Primitive::Vertex>& vertices)
-	{
-		const auto& bufferView = model.bufferViews[accessor.bufferView];
-		if (bufferView.target != TINYGLTF_TARGET_ARRAY_BUFFER && bufferView.target != 0)
-		{
-			throw Exception("Primitive texture coordinate 0 info(Buffer View Target) is invalid.");
-		}
-
-		const auto& buffer = model.buffers[bufferView.buffer].data;
-		constexpr size_t PackedSize = 2 * sizeof(T);
-		const size_t stride = bufferView.byteStride == 0 ? PackedSize : bufferView.byteStride;
-		ValidateAccessor(accessor, bufferView, buffer, stride, PackedSize);
-
-		const uint8_t* bufferPtr = buffer.data() + bufferView.byteOffset + accessor.byteOffset;
-		for (uint32_t i = 0; i < accessor.count; ++i, bufferPtr += stride)
-		{
-			vertices[i].texCoord0.x = *reinterpret_cast<const T*>(bufferPtr) / (float)(NumericLimits<T>::max)();
-			vertices[i].texCoord0.y = *reinterpret_cast<const T*>(bufferPtr + sizeof(T)) / (float)(NumericLimits<T>::max)();
-		}
-	}
-
-	template<>
-	void CreatePrimitiveTexCoordDesc<float>(const tinygltf::Model& model,
-		const tinygltf::Accessor& accessor, Vector<Primitive::Vertex>& vertices)
+	VertexDecoder::Stream CreatePrimitiveStreamDesc(const GltfAsset& asset, const tinygltf::Accessor& accessor,
+		size_t packedSize, VertexDecoder::Format format, const char* targetError)
 	{
-		const auto& bufferView = model.bufferViews[accessor.bufferView];
+		const auto& bufferView = asset.model.bufferViews[accessor.bufferView];
 		if (bufferView.target != TINYGLTF_TARGET_ARRAY_BUFFER && bufferView.target != 0)
 		{
-			throw Exception("Primitive texture coordinate 0 info(Buffer View Target) is invalid.");
+			throw Exception(targetError);
 		}
 
-		const auto& buffer = model.buffers[bufferView.buffer].data;
-		constexpr size_t PackedSize = 2 * sizeof(float);
-		const size_t stride = bufferView.byteStride == 0 ? PackedSize : bufferView.byteStride;
-		ValidateAccessor(accessor, bufferView, buffer, stride, PackedSize);
+		const auto buffer = asset.GetBuffer(bufferView.buffer);
+		const size_t stride = bufferView.byteStride == 0 ? packedSize : bufferView.byteStride;
+		ValidateAccessor(accessor, bufferView, buffer, stride, packedSize);
 
-		const uint8_t* bufferPtr = buffer.data() + bufferView.byteOffset + accessor.byteOffset;
-		for (uint32_t i = 0; i < accessor.count; ++i, bufferPtr += stride)
-		{
-			vertices[i].texCoord0.x = *reinterpret_cast<const float*>(bufferPtr);
-			vertices[i].texCoord0.y = *reinterpret_cast<const float*>(bufferPtr + sizeof(float));
-		}
+		return { buffer.data() + bufferView.byteOffset + accessor.byteOffset, stride, format };
 	}
 
-	void CreatePrimitiveVerticesDesc(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+	void CreatePrimitiveVerticesDesc(const GltfAsset& asset, const tinygltf::Primitive& primitive,
 		Vector<Primitive::Vertex>& vertices, bool& hasNormals, bool& hasTangents)
 	{
+		// Every attribute is gathered in a single pass once all of them are validated.
+		VertexDecoder::Streams streams;
+		size_t count = 0;
+
 		/* Create position of vertices. */
 		if (primitive.attributes.find("POSITION") != primitive.attributes.end())
 		{
-			const auto& accessor = model.accessors[primitive.attributes.find("POSITION")->second];
+			const auto& accessor = asset.model.accessors[primitive.attributes.find("POSITION")->second];
 
 			if (accessor.type != TINYGLTF_TYPE_VEC3)
 			{
@@ -375,9 +643,10 @@ namespace Amadeus
 			}
 
 			// Postionʱȷverticesռ䣬ʼռ
-			vertices.resize(accessor.count);
+			count = accessor.count;
 
-			CreatePrimitivePositionDesc(model, accessor, vertices);
+			streams.position = CreatePrimitiveStreamDesc(asset, accessor, sizeof(XMFLOAT3), VertexDecoder::Format::FLOAT,
+				"Primitive position info(Buffer View Target) is invalid.");
 		}
 		else
 		{
@@ -387,7 +656,7 @@ namespace Amadeus
 		/* Create normal of vertices. */
 		if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
 		{
-			const auto& accessor = model.accessors[primitive.attributes.find("NORMAL")->second];
+			const auto& accessor = asset.model.accessors[primitive.attributes.find("NORMAL")->second];
 
 			if (accessor.type != TINYGLTF_TYPE_VEC3)
 			{
@@ -402,7 +671,13 @@ namespace Amadeus
 				throw Exception("Primitive normal info (Buffer View) is invalid.");
 			}
 
-			CreatePrimitiveNormalDesc(model, accessor, vertices);
+			if (accessor.count != count)
+			{
+				throw Exception("Primitive normal info (Accessor Count) is invalid.");
+			}
+
+			streams.normal = CreatePrimitiveStreamDesc(asset, accessor, sizeof(XMFLOAT3), VertexDecoder::Format::FLOAT,
+				"Primitive normal info(Buffer View Target) is invalid.");
 
 			hasNormals = true;
 		}
@@ -414,7 +689,7 @@ namespace Amadeus
 		/* Create tangent of vertices. */
 		if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
 		{
-			const auto& accessor = model.accessors[primitive.attributes.find("TANGENT")->second];
+			const auto& accessor = asset.model.accessors[primitive.attributes.find("TANGENT")->second];
 
 			if (accessor.type != TINYGLTF_TYPE_VEC4)
 			{
@@ -429,7 +704,13 @@ namespace Amadeus
 				throw Exception("Primitive tangent info (Buffer View) is invalid.");
 			}
 
-			CreatePrimitiveTangentDesc(model, accessor, vertices);
+			if (accessor.count != count)
+			{
+				throw Exception("Primitive tangent info (Accessor Count) is invalid.");
+			}
+
+			streams.tangent = CreatePrimitiveStreamDesc(asset, accessor, sizeof(XMFLOAT4), VertexDecoder::Format::FLOAT,
+				"Primitive tangent info(Buffer View Target) is invalid.");
 
 			hasTangents = true;
 		}
@@ -442,7 +723,7 @@ namespace Amadeus
 		if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
 		{
 			//throw Exception("Primitive texture coordinate 0 info (Accessor) is invalid.");
-			const auto& accessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
+			const auto& accessor = asset.model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
 			if (accessor.type != TINYGLTF_TYPE_VEC2)
 			{
 				throw Exception("Primitive texture coordinate 0 info (Accessor Type) is invalid (VEC2 expected).");
@@ -451,6 +732,12 @@ namespace Amadeus
 			{
 				throw Exception("Primitive texture coordinate 0 info (Buffer View) is invalid.");
 			}
+			if (accessor.count != count)
+			{
+				throw Exception("Primitive texture coordinate 0 info (Accessor Count) is invalid.");
+			}
+
+			const char* targetError = "Primitive texture coordinate 0 info(Buffer View Target) is invalid.";
 			if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
 			{
 				if (!accessor.normalized)
@@ -458,7 +745,7 @@ namespace Amadeus
 					throw Exception("Accessor for TEXCOORD_n unsigned byte must be normalized.");
 				}
 
-				CreatePrimitiveTexCoordDesc<uint8_t>(model, accessor, vertices);
+				streams.texCoord0 = CreatePrimitiveStreamDesc(asset, accessor, 2 * sizeof(uint8_t), VertexDecoder::Format::UNORM8, targetError);
 			}
 			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
 			{
@@ -467,52 +754,49 @@ namespace Amadeus
 					throw Exception("Accessor for TEXCOORD_n unsigned short must be normalized.");
 				}
 
-				CreatePrimitiveTexCoordDesc<uint8_t>(model, accessor, vertices);
+				streams.texCoord0 = CreatePrimitiveStreamDesc(asset, accessor, 2 * sizeof(uint16_t), VertexDecoder::Format::UNORM16, targetError);
 			}
 			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
 			{
-				CreatePrimitiveTexCoordDesc<float>(model, accessor, vertices);
+				streams.texCoord0 = CreatePrimitiveStreamDesc(asset, accessor, 2 * sizeof(float), VertexDecoder::Format::FLOAT, targetError);
 			}
 			else
 			{
 				throw Exception("Primitive normal info (Accessor Component Type) is invalid.");
 			}
 		}
+
+		vertices.resize(count);
+		VertexDecoder::DecodeVertices(streams, count, reinterpret_cast<VertexDecoder::Vertex*>(vertices.data()));
 	}
 
-	template<typename T>
-	void CreatePrimitiveIndicesDesc(const tinygltf::Model& model,
-		const tinygltf::Accessor& accessor, Vector<uint32_t>& indices)
+	void CreatePrimitiveIndicesDesc(const GltfAsset& asset,
+		const tinygltf::Accessor& accessor, size_t indexSize, Vector<uint32_t>& indices)
 	{
-		const auto& bufferView = model.bufferViews[accessor.bufferView];
+		const auto& bufferView = asset.model.bufferViews[accessor.bufferView];
 		if (bufferView.target != TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER && bufferView.target != 0)
 		{
 			throw Exception("Primitive indices info(Buffer View Target) is invalid.");
 		}
-		if (bufferView.byteStride != 0 && bufferView.byteStride != sizeof(T))
+		if (bufferView.byteStride != 0 && bufferView.byteStride != indexSize)
 		{
 			throw Exception("Primitive indices info(Buffer View Byte Stride) is invalid.");
 		}
 
-		const auto& buffer = model.buffers[bufferView.buffer].data;
-		constexpr size_t PackedSize = sizeof(T);
-		const size_t stride = bufferView.byteStride == 0 ? PackedSize : bufferView.byteStride;
-		ValidateAccessor(accessor, bufferView, buffer, stride, PackedSize);
+		const auto buffer = asset.GetBuffer(bufferView.buffer);
+		ValidateAccessor(accessor, bufferView, buffer, indexSize, indexSize);
 
 		const uint8_t* bufferPtr = buffer.data() + bufferView.byteOffset + accessor.byteOffset;
-		indices.reserve(accessor.count);
-		for (uint32_t i = 0; i < accessor.count; ++i, bufferPtr += stride)
-		{
-			indices.emplace_back(*reinterpret_cast<const T*>(bufferPtr));
-		}
+		indices.resize(accessor.count);
+		VertexDecoder::DecodeIndices(bufferPtr, indexSize, accessor.count, indices.data());
 	}
 
-	void CreatePrimitiveIndicesDesc(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+	void CreatePrimitiveIndicesDesc(const GltfAsset& asset, const tinygltf::Primitive& primitive,
 		const Vector<Primitive::Vertex>& vertices, Vector<uint32_t>& indices)
 	{
 		if (primitive.indices != -1)
 		{
-			auto& accessor = model.accessors[primitive.indices];
+			auto& accessor = asset.model.accessors[primitive.indices];
 			if (accessor.type != TINYGLTF_TYPE_SCALAR)
 			{
 				throw Exception("Primitive indices info (Accessor Type) is invalid (SCALAR expected).");
@@ -529,15 +813,15 @@ namespace Amadeus
 
 			if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
 			{
-				CreatePrimitiveIndicesDesc<uint8_t>(model, accessor, indices);
+				CreatePrimitiveIndicesDesc(asset, accessor, sizeof(uint8_t), indices);
 			}
 			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
 			{
-				CreatePrimitiveIndicesDesc<uint16_t>(model, accessor, indices);
+				CreatePrimitiveIndicesDesc(asset, accessor, sizeof(uint16_t), indices);
 			}
 			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
 			{
-				CreatePrimitiveIndicesDesc<uint32_t>(model, accessor, indices);
+				CreatePrimitiveIndicesDesc(asset, accessor, sizeof(uint32_t), indices);
 			}
 			else
 			{
@@ -609,59 +893,523 @@ namespace Amadeus
 		}
 	}
 
-	void LoadMesh(tinygltf::Model& model, SharedPtr<DeviceResources> device)
+	Primitive* ImportPrimitive(const GltfAsset& asset, const tinygltf::Primitive& primitive, XMMATRIX modelMatrix, DerivedDataCache* cache)
+	{
+		if (primitive.mode != TINYGLTF_MODE_TRIANGLES)
+		{
+			throw Exception("Primitive topology mode is invalid.");
+		}
+		INT material = primitive.material;
+		bool hasNormals = false;
+		bool hasTangents = false;
+
+		Vector<Primitive::Vertex> vertices;
+		Vector<UINT> indices;
+
+		CreatePrimitiveVerticesDesc(asset, primitive, vertices, hasNormals, hasTangents);
+
+		CreatePrimitiveIndicesDesc(asset, primitive, vertices, indices);
+
+		// Missing normals and tangents are generated in the constructor.
+		return new Primitive(std::move(vertices), std::move(indices), modelMatrix, material, hasNormals, hasTangents,
+			D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, cache);
+	}
+
+	// The optimizer report of the file, triangle weighted over its primitives, once the last one joined.
+	void ReportPrimitive(GltfLoad& load, const Primitive& primitive)
+	{
+		--load.remainingPrimitives;
+#ifdef _DEBUG
+		if (!EngineVar::Mesh_Optimize)
+			return;
+
+		const auto& report = primitive.GetOptimizationReport();
+		load.before[0] += report.before.acmr * report.triangleCount;
+		load.before[1] += report.before.atvr * report.triangleCount;
+		load.after[0] += report.after.acmr * report.triangleCount;
+		load.after[1] += report.after.atvr * report.triangleCount;
+		load.triangles += report.triangleCount;
+
+		char message[160];
+		if (load.remainingPrimitives == 0 && load.triangles > 0
+			&& sprintf_s(message, "Mesh optimizer: %zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", load.triangles,
+				load.before[0] / load.triangles, load.after[0] / load.triangles, load.before[1] / load.triangles, load.after[1] / load.triangles) > 0)
+		{
+			OutputDebugStringA(message);
+		}
+#endif // _DEBUG
+	}
+
+	// World bounds of the scene from the min and max the position accessors carry, known before any
+	// primitive is decoded. Positions without them are left out.
+	Boundary LoadBoundary(const tinygltf::Model& model)
 	{
+		Boundary boundary;
+		for (const auto& node : model.nodes)
+		{
+			if (node.mesh < 0)
+				continue;
+
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, CreateNodeTransform(node));
+			for (const auto& primitive : model.meshes[node.mesh].primitives)
+			{
+				auto position = primitive.attributes.find("POSITION");
+				if (position == primitive.attributes.end())
+					continue;
+
+				const auto& accessor = model.accessors[position->second];
+				if (accessor.minValues.size() < 3 || accessor.maxValues.size() < 3)
+					continue;
+
+				const float localMinimum[3] = {
+					static_cast<float>(accessor.minValues[0]), static_cast<float>(accessor.minValues[1]), static_cast<float>(accessor.minValues[2]) };
+				const float localMaximum[3] = {
+					static_cast<float>(accessor.maxValues[0]), static_cast<float>(accessor.maxValues[1]), static_cast<float>(accessor.maxValues[2]) };
+				float minimum[3];
+				float maximum[3];
+				FrustumCuller::TransformBox(world.m, localMinimum, localMaximum, minimum, maximum);
+
+				boundary.xMin = (std::min)(boundary.xMin, minimum[0]);
+				boundary.yMin = (std::min)(boundary.yMin, minimum[1]);
+				boundary.zMin = (std::min)(boundary.zMin, minimum[2]);
+				boundary.xMax = (std::max)(boundary.xMax, maximum[0]);
+				boundary.yMax = (std::max)(boundary.yMax, maximum[1]);
+				boundary.zMax = (std::max)(boundary.zMax, maximum[2]);
+			}
+		}
+		return boundary;
+	}
+
+	LoadPipeline::Task UploadPrimitive(SharedPtr<Staged<Primitive>> staged, SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
+	{
+		return { LoadPipeline::Stage::Upload, false, [=]
+		{
+			if (!staged->result->Upload(device, renderer->GetUploader()))
+				throw RuntimeError("Gltf::LoadMesh Error");
+		} };
+	}
+
+	LoadPipeline::Task CookPrimitive(SharedPtr<Staged<Primitive>> staged, size_t index)
+	{
+		++staged->load->remainingCooks;
+		return { LoadPipeline::Stage::Cook, false, [=]
+		{
+			staged->result->Cook(*staged->load->writer, index);
+			FinishCook(*staged->load);
+		} };
+	}
+
+	// Fills the id reserved for the primitive when its mesh was created.
+	LoadPipeline::Task CommitPrimitive(SharedPtr<Staged<Primitive>> staged, Mesh* pMesh, UINT64 id,
+		SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
+	{
+		return { LoadPipeline::Stage::Commit, true, [=]
+		{
+			renderer->Flush(device);
+			ReportPrimitive(*staged->load, *staged->result);
+			pMesh->SetPrimitive(id, staged->result.release());
+		} };
+	}
+
+	void LoadMesh(SharedPtr<GltfLoad> load, SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer,
+		LoadPipeline& pipeline)
+	{
+		const tinygltf::Model& model = load->asset.model;
 		MeshManager& meshManager = MeshManager::Instance();
 
-		for (auto& node : model.nodes)
+		Vector<INT> parents(model.nodes.size(), -1);
+		for (size_t i = 0; i < model.nodes.size(); ++i)
 		{
+			for (INT child : model.nodes[i].children)
+			{
+				if (child >= 0 && static_cast<size_t>(child) < parents.size())
+					parents[child] = static_cast<INT>(i);
+			}
+		}
+
+		// Meshes are created up front and reserve their primitive ids in source order, so that neither
+		// depends on which primitive finishes first. Decoding and tangent generation only touch the
+		// primitive itself.
+		size_t slot = 0;
+		for (size_t nodeIndex = 0; nodeIndex < model.nodes.size(); ++nodeIndex)
+		{
+			const auto& node = model.nodes[nodeIndex];
+			if (load->writer)
+			{
+				ScenePackage::NodeRecord record = {};
+				record.parent = parents[nodeIndex];
+				record.firstPrimitive = static_cast<UINT32>(slot);
+				record.primitiveCount = node.mesh > -1 ? static_cast<UINT32>(model.meshes[node.mesh].primitives.size()) : 0;
+				XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(record.matrix), CreateNodeTransform(node));
+				load->writer->AddNode(record);
+			}
+
 			if (node.mesh > -1)
 			{
-				auto& mesh = model.meshes[node.mesh];
+				const auto& mesh = model.meshes[node.mesh];
 
-				UINT64 meshId = MeshManager::Instance().CreateMesh(CreateNodeTransform(node));
-				Mesh* pMesh = MeshManager::Instance().GetMesh(meshId);
+				UINT64 meshId = meshManager.CreateMesh(CreateNodeTransform(node));
+				Mesh* pMesh = meshManager.GetMesh(meshId);
+				UINT64 id = pMesh->ReservePrimitives(mesh.primitives.size());
 
-				for (auto& primitive : mesh.primitives)
+				for (const auto& primitive : mesh.primitives)
 				{
-					if (primitive.mode != TINYGLTF_MODE_TRIANGLES)
+					const tinygltf::Primitive* source = &primitive;
+					auto staged = std::make_shared<Staged<Primitive>>();
+					staged->load = load;
+					++load->remainingPrimitives;
+
+					Vector<LoadPipeline::Task> tasks = {
+						{ LoadPipeline::Stage::DecodeGeometry, false, [=]
+						{
+							staged->result.reset(ImportPrimitive(staged->load->asset, *source, pMesh->GetModelMatrix(), staged->load->cache.get()));
+						} },
+						UploadPrimitive(staged, device, renderer),
+					};
+					if (load->writer)
 					{
-						throw Exception("Primitive topology mode is invalid.");
+						tasks.push_back(CookPrimitive(staged, slot));
 					}
-					INT material = primitive.material;
-					bool hasNormals = false;
-					bool hasTangents = false;
+					tasks.push_back(CommitPrimitive(staged, pMesh, id++, device, renderer));
+					pipeline.Add(std::move(tasks));
+					++slot;
+				}
+			}
+		}
+	}
 
-					Vector<Primitive::Vertex> vertices;
-					Vector<UINT> indices;
+	// Cooked primitives skip the import, their buffers upload straight out of the package.
+	void LoadMesh(SharedPtr<GltfLoad> load, const ScenePackage& package, SharedPtr<DeviceResources> device,
+		SharedPtr<RenderSystem> renderer, LoadPipeline& pipeline)
+	{
+		MeshManager& meshManager = MeshManager::Instance();
+		const auto primitives = package.GetPrimitives();
 
-					CreatePrimitiveVerticesDesc(model, primitive, vertices, hasNormals, hasTangents);
+		for (const auto& node : package.GetNodes())
+		{
+			if (node.primitiveCount == 0)
+				continue;
 
-					CreatePrimitiveIndicesDesc(model, primitive, vertices, indices);
+			UINT64 meshId = meshManager.CreateMesh(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(node.matrix)));
+			Mesh* pMesh = meshManager.GetMesh(meshId);
+			UINT64 firstId = pMesh->ReservePrimitives(node.primitiveCount);
 
-					pMesh->CreatrPrimitive(std::move(vertices), std::move(indices), material, hasNormals, hasTangents);
-				}
+			for (UINT32 i = 0; i < node.primitiveCount; ++i)
+			{
+				const ScenePackage::PrimitiveRecord* record = &primitives[node.firstPrimitive + i];
+				auto staged = std::make_shared<Staged<Primitive>>();
+				staged->load = load;
+				++load->remainingPrimitives;
+
+				pipeline.Add({
+					{ LoadPipeline::Stage::DecodeGeometry, false, [=]
+					{
+						const ScenePackage& source = *staged->load->package;
+						const auto meshlets = source.GetBlob(record->meshlets);
+						staged->result.reset(new Primitive(*record, source.GetBlob(record->vertices), source.GetBlob(record->indices),
+							{ reinterpret_cast<const MeshletBuilder::Meshlet*>(meshlets.data()), record->meshletCount },
+							pMesh->GetModelMatrix()));
+					} },
+					UploadPrimitive(staged, device, renderer),
+					CommitPrimitive(staged, pMesh, firstId + i, device, renderer),
+				});
 			}
 		}
 	}
 
-	void Gltf::LoadGltf(WString&& fileName, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+	// Splits a .glb into its JSON chunk and its binary chunk.
+	void ParseGlb(std::span<const uint8_t> file, std::span<const uint8_t>& json, std::span<const uint8_t>& bin)
 	{
-		tinygltf::Model model;
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t length;
+		};
+		struct ChunkHeader
+		{
+			uint32_t length;
+			uint32_t type;
+		};
+		constexpr uint32_t ChunkJson = 0x4E4F534A;
+		constexpr uint32_t ChunkBin = 0x004E4942;
+
+		Header header;
+		memcpy(&header, file.data(), sizeof(header));
+		if (header.version != 2 || header.length > file.size())
+		{
+			throw Exception("Glb header is invalid.");
+		}
+
+		size_t offset = sizeof(Header);
+		while (offset + sizeof(ChunkHeader) <= header.length)
+		{
+			ChunkHeader chunk;
+			memcpy(&chunk, file.data() + offset, sizeof(chunk));
+			offset += sizeof(ChunkHeader);
+			if (chunk.length > header.length - offset)
+			{
+				throw OutOfRange("Glb chunk goes out of range of file.");
+			}
+
+			// The JSON chunk comes first, at most one binary chunk follows. Unknown chunks are skipped.
+			const auto data = file.subspan(offset, chunk.length);
+			if (chunk.type == ChunkJson && json.empty())
+				json = data;
+			else if (chunk.type == ChunkBin && bin.empty())
+				bin = data;
+
+			offset += (static_cast<size_t>(chunk.length) + 3) & ~static_cast<size_t>(3);
+		}
+
+		if (json.empty())
+		{
+			throw Exception("Glb has no JSON chunk.");
+		}
+	}
+
+	void LoadGltfAsset(const WString& fullPath, GltfAsset& asset)
+	{
+		asset.files.emplace_back(std::make_unique<MappedFile>(fullPath));
+		const auto file = asset.files.back()->GetBytes();
+
+		std::span<const uint8_t> json;
+		std::span<const uint8_t> bin;
+		if (file.size() >= 12 && memcmp(file.data(), "glTF", 4) == 0)
+		{
+			ParseGlb(file, json, bin);
+		}
+		else
+		{
+			json = file;
+		}
+
+		const WString baseDir = fullPath.substr(0, fullPath.find_last_of(L"\\/") + 1);
+		nlohmann::json document = nlohmann::json::parse(json.begin(), json.end());
+
+		auto buffers = document.find("buffers");
+		if (buffers != document.end())
+		{
+			for (const auto& buffer : *buffers)
+			{
+				const size_t byteLength = buffer.at("byteLength").get<size_t>();
+
+				std::span<const uint8_t> data;
+				auto uri = buffer.find("uri");
+				if (uri == buffer.end())
+				{
+					// The binary chunk of a .glb.
+					data = bin;
+				}
+				else if (tinygltf::IsDataURI(uri->get<String>()))
+				{
+					String mimeType;
+					auto& decoded = asset.decodedBuffers.emplace_back();
+					if (!tinygltf::DecodeDataURI(&decoded, mimeType, uri->get<String>(), byteLength, true))
+					{
+						throw RuntimeError("Failed to decode buffer uri.");
+					}
+					data = decoded;
+				}
+				else
+				{
+					const String& path = asset.sources.emplace_back(tinygltf::dlib::urldecode(uri->get<String>()));
+					asset.files.emplace_back(std::make_unique<MappedFile>(baseDir + String2WString(path)));
+					data = asset.files.back()->GetBytes();
+				}
+
+				if (byteLength > data.size())
+				{
+					throw OutOfRange("Buffer goes out of range of its data.");
+				}
+				asset.buffers.emplace_back(data.first(byteLength));
+			}
+
+			// tinygltf would copy every buffer into the model.
+			document.erase(buffers);
+		}
+
+		auto images = document.find("images");
+		if (images != document.end())
+		{
+			for (auto& image : *images)
+			{
+				// tinygltf would decode embedded images with stb_image, the texture loader takes them instead.
+				auto bufferView = image.find("bufferView");
+				if (bufferView != image.end())
+				{
+					asset.imageBufferViews.emplace_back(bufferView->get<INT>());
+					image.erase(bufferView);
+					image["uri"] = "";
+				}
+				else
+				{
+					asset.imageBufferViews.emplace_back(-1);
+					auto uri = image.find("uri");
+					if (uri != image.end() && !uri->get<String>().empty() && !tinygltf::IsDataURI(uri->get<String>()))
+						asset.sources.emplace_back(uri->get<String>());
+				}
+			}
+		}
+
+		const String text = document.dump();
 		tinygltf::TinyGLTF loader;
 		String err;
 		String warn;
-
-		String fullPath = WString2String(GetAssetFullPath(L"..\\..\\Assets\\Models\\" + fileName + L"\\" + fileName + L".gltf"));
-		bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, fullPath);
+		bool ret = loader.LoadASCIIFromString(
+			&asset.model, &err, &warn, text.c_str(), static_cast<unsigned int>(text.size()), WString2String(baseDir));
 
 		if (!err.empty()) {
 			throw(RuntimeError(err));
 		}
+		if (!ret) {
+			throw(RuntimeError("Failed to parse glTF."));
+		}
+	}
+
+	UINT32 GetPackageFlags()
+	{
+		UINT32 flags = 0;
+		if (EngineVar::Vertex_Quantize)
+			flags |= ScenePackage::FLAG_QUANTIZED;
+		if (EngineVar::Mesh_Optimize)
+			flags |= ScenePackage::FLAG_OPTIMIZED;
+		if (EngineVar::Meshlet_Cull)
+			flags |= ScenePackage::FLAG_MESHLETS;
+		if (EngineVar::Texture_CpuMips)
+			flags |= ScenePackage::FLAG_CPU_MIPS;
+		if (EngineVar::Texture_KaiserMips)
+			flags |= ScenePackage::FLAG_KAISER_MIPS;
+		if (EngineVar::Texture_Compress)
+		{
+			flags |= ScenePackage::FLAG_BLOCK_COMPRESSED;
+			if (EngineVar::Texture_CompressQuality == 0)
+				flags |= ScenePackage::FLAG_COMPRESSED_FAST;
+			else if (EngineVar::Texture_CompressQuality >= 2)
+				flags |= ScenePackage::FLAG_COMPRESSED_HIGH;
+		}
+		return flags;
+	}
+
+	// Maps the package if it was cooked from the file and every buffer and image it refers to as they
+	// are now and the way the engine would import it, a stale or broken package is left to be cooked
+	// again. A package cooked from the .gltf is stale once a .glb is loaded in its place.
+	bool OpenPackage(GltfLoad& load)
+	{
+		if (GetFileAttributesW(load.packagePath.c_str()) == INVALID_FILE_ATTRIBUTES)
+			return false;
+
+		try
+		{
+			load.packageFile = std::make_unique<MappedFile>(load.packagePath);
+			load.package = std::make_unique<ScenePackage>(load.packageFile->GetBytes());
+
+			const std::filesystem::path path(load.fullPath);
+			const auto sources = load.package->GetSources();
+			if (load.package->GetHeader().flags == GetPackageFlags() && !sources.empty()
+				&& load.package->GetPath(sources[0]) == WString2String(path.filename().wstring())
+				&& load.package->IsCurrent(path.parent_path()))
+				return true;
+		}
+		catch (const Exception&)
+		{
+		}
+
+		load.package.reset();
+		load.packageFile.reset();
+		return false;
+	}
+
+	// Stamps the buffers and images the glTF refers to, a scene with one of them missing is not cooked.
+	void BeginCook(GltfLoad& load)
+	{
+		const std::filesystem::path path(load.fullPath);
+		Vector<ScenePackage::SourceRecord> stamps(load.asset.sources.size());
+		for (size_t i = 0; i < stamps.size(); ++i)
+		{
+			if (!ScenePackage::GetStamp(path.parent_path() / String2WString(load.asset.sources[i]), stamps[i].size, stamps[i].time))
+				return;
+		}
+
+		const tinygltf::Model& model = load.asset.model;
+		size_t primitives = 0;
+		for (const auto& node : model.nodes)
+		{
+			if (node.mesh > -1)
+				primitives += model.meshes[node.mesh].primitives.size();
+		}
+
+		load.writer = std::make_unique<ScenePackage::Writer>(model.textures.size(), primitives);
+		const float boundsMin[3] = { load.boundary.xMin, load.boundary.yMin, load.boundary.zMin };
+		const float boundsMax[3] = { load.boundary.xMax, load.boundary.yMax, load.boundary.zMax };
+		load.writer->SetHeader(GetPackageFlags(), boundsMin, boundsMax);
+		load.writer->AddSource(WString2String(path.filename().wstring()), load.sourceSize, load.sourceTime);
+		for (size_t i = 0; i < stamps.size(); ++i)
+		{
+			load.writer->AddSource(load.asset.sources[i], stamps[i].size, stamps[i].time);
+		}
+
+		// Held by the parse commit until every item is added.
+		load.remainingCooks = 1;
+	}
+
+	void Gltf::LoadGltf(WString&& fileName, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+		SharedPtr<DescriptorCache> descriptorCache, SharedPtr<RenderSystem> renderer, SharedPtr<DerivedDataCache> cache,
+		LoadPipeline& pipeline)
+	{
+		// Binary glTF is preferred when both are present.
+		const WString basePath = GetAssetFullPath(L"..\\..\\Assets\\Models\\" + fileName + L"\\" + fileName);
+		const bool binary = GetFileAttributesW((basePath + L".glb").c_str()) != INVALID_FILE_ATTRIBUTES;
+
+		auto load = std::make_shared<GltfLoad>();
+		load->fileName = std::move(fileName);
+		load->fullPath = basePath + (binary ? L".glb" : L".gltf");
+		load->cache = std::move(cache);
+		load->packagePath = basePath + L".ampk";
+
+		pipeline.Add({
+			{ LoadPipeline::Stage::Parse, false, [load]
+			{
+				// An up to date package replaces the whole import.
+				load->bStamped = EngineVar::Package_Scenes && ScenePackage::GetStamp(load->fullPath, load->sourceSize, load->sourceTime);
+				if (load->bStamped && OpenPackage(*load))
+				{
+					const auto& header = load->package->GetHeader();
+					load->boundary = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2],
+						header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+					return;
+				}
+
+				LoadGltfAsset(load->fullPath, load->asset);
+				load->boundary = LoadBoundary(load->asset.model);
+			} },
+			{ LoadPipeline::Stage::Parse, true, [load, device, descriptorManager, descriptorCache, renderer, &pipeline]
+			{
+				if (load->package)
+				{
+					const Vector<UINT> samplers = LoadSampler(*load->package, device, descriptorManager);
+					LoadTexture(load, *load->package, device, descriptorManager, descriptorCache, renderer, pipeline);
+					LoadMaterial(*load->package, samplers, descriptorManager);
+					LoadMesh(load, *load->package, device, renderer, pipeline);
+				}
+				else
+				{
+					if (load->bStamped)
+						BeginCook(*load);
+
+					const Vector<UINT> samplers = LoadSampler(load->asset.model, load->writer.get(), device, descriptorManager);
+					LoadTexture(load, device, descriptorManager, descriptorCache, renderer, pipeline);
+					LoadMaterial(load->asset.model, load->writer.get(), samplers, descriptorManager);
+					LoadMesh(load, device, renderer, pipeline);
+
+					if (load->writer)
+						FinishCook(*load);
+				}
 
-		LoadSampler(model, device, descriptorManager);
-		LoadTexture(std::move(fileName), model, device, descriptorManager);
-		LoadMaterial(model);
-		LoadMesh(model, device);
+				if (!load->boundary.IsEmpty())
+					MeshManager::Instance().SetBoundary(load->boundary);
+			} },
+		});
 	}
 }
\ No newline at end of file
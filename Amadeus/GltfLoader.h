@@ -3,8 +3,19 @@
 
 namespace Amadeus
 {
+	class LoadPipeline;
+	class DerivedDataCache;
+
 	namespace Gltf
 	{
-		void LoadGltf(WString&& fileName, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
+		// Adds the file to the pipeline. It is parsed on a worker, its samplers, materials and meshes are
+		// created when the parse commits, then every texture and primitive decodes and uploads on its own
+		// and joins the scene in its commit. Until then materials sample the white and black fallbacks.
+		// A package next to the file that was cooked from it as it is now is loaded instead, otherwise one is
+		// cooked from what the load imports and written once every texture and primitive is in it. The
+		// cache, which may be null, keeps what the import derives between runs.
+		void LoadGltf(WString&& fileName, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+			SharedPtr<DescriptorCache> descriptorCache, SharedPtr<RenderSystem> renderer, SharedPtr<DerivedDataCache> cache,
+			LoadPipeline& pipeline);
 	}
 }
\ No newline at end of file
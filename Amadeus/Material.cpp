@@ -30,18 +30,6 @@ namespace Amadeus
 		mMetallicFactor = metallicFactor;
 		mRoughnessFactor = roughnessFactor;
 
-		if (mType & MATERIAL_TYPE_BASECOLOR)
-		{
-			mBaseColor = TextureManager::Instance().GetTexture(mBaseColorId);
-			bInitialized = bInitialized | MATERIAL_TYPE_BASECOLOR;
-		}
-
-		if (mType & MATERIAL_TYPE_METALLIC_ROUGHNESS)
-		{
-			mMetallicRoughness = TextureManager::Instance().GetTexture(mMetallicRoughnessId);
-			bInitialized = bInitialized | MATERIAL_TYPE_METALLIC_ROUGHNESS;
-		}
-
 		mMaterialConstantBuffer.baseColorFactor = XMFLOAT4(mBaseColorFactor.data());
 		mMaterialConstantBuffer.metallicFactor = mMetallicFactor;
 		mMaterialConstantBuffer.roughnessFactor = mRoughnessFactor;
@@ -51,12 +39,6 @@ namespace Amadeus
 	{
 		mNormalScale = normalScale;
 
-		if (mType & MATERIAL_TYPE_NORMAL)
-		{
-			mNormal = TextureManager::Instance().GetTexture(mNormalId);
-			bInitialized = bInitialized | MATERIAL_TYPE_NORMAL;
-		}
-
 		mMaterialConstantBuffer.normalScale = mNormalScale;
 	}
 
@@ -64,12 +46,6 @@ namespace Amadeus
 	{
 		mOcclusionStrength = occlusionStrength;
 
-		if (mType & MATERIAL_TYPE_OCCLUSION)
-		{
-			mOcclusion = TextureManager::Instance().GetTexture(mOcclusionId);
-			bInitialized = bInitialized | MATERIAL_TYPE_OCCLUSION;
-		}
-
 		mMaterialConstantBuffer.occlusionStrength = mOcclusionStrength;
 	}
 
@@ -77,12 +53,6 @@ namespace Amadeus
 	{
 		mEmissiveFactor.swap(emissiveFactor);
 
-		if (mType & MATERIAL_TYPE_EMISSIVE)
-		{
-			mEmissive = TextureManager::Instance().GetTexture(mEmissiveId);
-			bInitialized = bInitialized | MATERIAL_TYPE_EMISSIVE;
-		}
-
 		mMaterialConstantBuffer.emissiveFactor = XMFLOAT3(mEmissiveFactor.data());
 	}
 
@@ -97,105 +67,102 @@ namespace Amadeus
 		bDoubleSided = bDouble;
 	}
 
-	bool Material::Upload(SharedPtr<DeviceResources> device)
+	void Material::SetSampler(UINT slot, const CD3DX12_GPU_DESCRIPTOR_HANDLE& table)
 	{
-		if (bUploaded)
-			return true;
-
-		mMaterialConstantBuffer.materialType = mType;
-
-		const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(mMaterialConstantBufferSize);
-
-		ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&resourceDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&mMaterialConstants)));
-		NAME_D3D12_OBJECT(mMaterialConstants);
-
-		// Map and initialize the constant buffer. We don't unmap this until the
-		// app closes. Keeping things mapped for the lifetime of the resource is okay.
-		CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-		ThrowIfFailed(mMaterialConstants->Map(0, &readRange, reinterpret_cast<void**>(&pMaterialCbvDataBegin)));
-		memcpy(pMaterialCbvDataBegin, &mMaterialConstantBuffer, mMaterialConstantBufferSize);
-		mMaterialConstants->Unmap(0, 0);
-
-		bUploaded = true;
-		return true;
+		mSamplerSlot = slot;
+		mSamplerTable = table;
 	}
 
-	void Material::Render(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+	bool Material::Upload(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache,
+		Texture* whiteTexture, Texture* blackTexture, D3D12_GPU_VIRTUAL_ADDRESS constantsAddress)
 	{
-		Texture* whiteTexture = TextureManager::Instance().GetTexture(EngineVar::TEXTURE_WHITE_ID);
-		Texture* blackTexture = TextureManager::Instance().GetTexture(EngineVar::TEXTURE_BLACK_ID);
-
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = mMaterialConstants->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = sizeof(MaterialConstantBuffer);
-
-		CD3DX12_GPU_DESCRIPTOR_HANDLE constantHandle = descriptorCache->AppendCbvCache(device, cbvDesc);
-		commandList->SetGraphicsRootConstantBufferView(COMMON_MATERIAL_ROOT_CBV_INDEX, cbvDesc.BufferLocation);
-
-		CD3DX12_GPU_DESCRIPTOR_HANDLE materialHandle = {};
-		if (mType & MATERIAL_TYPE_BASECOLOR
-			&& bInitialized & MATERIAL_TYPE_BASECOLOR)
-		{
-			materialHandle = descriptorCache->AppendSrvCache(device, mBaseColor->GetDescriptorHandle());
-		}
-		else
-		{
-			materialHandle = descriptorCache->AppendSrvCache(device, whiteTexture->GetDescriptorHandle());
-		}
-
-		if (mType & MATERIAL_TYPE_METALLIC_ROUGHNESS
-			&& bInitialized & MATERIAL_TYPE_METALLIC_ROUGHNESS)
-		{
-			descriptorCache->AppendSrvCache(device, mMetallicRoughness->GetDescriptorHandle());
-		}
-		else
-		{
-			descriptorCache->AppendSrvCache(device, whiteTexture->GetDescriptorHandle());
-		}
-
-		if (mType & MATERIAL_TYPE_OCCLUSION
-			&& bInitialized & MATERIAL_TYPE_OCCLUSION)
-		{
-			descriptorCache->AppendSrvCache(device, mOcclusion->GetDescriptorHandle());
-		}
-		else
-		{
-			descriptorCache->AppendSrvCache(device, whiteTexture->GetDescriptorHandle());
-		}
+		// Textures that are still loading are not in the manager yet, a later call picks them up.
+		TextureManager& textureManager = TextureManager::Instance();
+		const UINT32 initialized = bInitialized;
+		auto resolve = [&](UINT32 type, TextureId id, Texture*& texture)
+		{
+			if ((mType & type) && !(bInitialized & type))
+			{
+				texture = textureManager.FindTexture(id);
+				if (texture)
+					bInitialized = bInitialized | type;
+			}
+		};
+		resolve(MATERIAL_TYPE_BASECOLOR, mBaseColorId, mBaseColor);
+		resolve(MATERIAL_TYPE_METALLIC_ROUGHNESS, mMetallicRoughnessId, mMetallicRoughness);
+		resolve(MATERIAL_TYPE_NORMAL, mNormalId, mNormal);
+		resolve(MATERIAL_TYPE_OCCLUSION, mOcclusionId, mOcclusion);
+		resolve(MATERIAL_TYPE_EMISSIVE, mEmissiveId, mEmissive);
+
+		if (bUploaded && initialized == bInitialized)
+			return true;
 
-		if (mType & MATERIAL_TYPE_EMISSIVE
-			&& bInitialized & MATERIAL_TYPE_EMISSIVE)
-		{
-			descriptorCache->AppendSrvCache(device, mEmissive->GetDescriptorHandle());
+		auto select = [this](UINT32 type, Texture* texture, Texture* fallback)
+		{
+			return (mType & type && bInitialized & type) ? texture : fallback;
+		};
+		Texture* textures[TEXTURE_TABLE_SIZE] =
+		{
+			select(MATERIAL_TYPE_BASECOLOR, mBaseColor, whiteTexture),
+			select(MATERIAL_TYPE_METALLIC_ROUGHNESS, mMetallicRoughness, whiteTexture),
+			select(MATERIAL_TYPE_OCCLUSION, mOcclusion, whiteTexture),
+			select(MATERIAL_TYPE_EMISSIVE, mEmissive, blackTexture),
+			select(MATERIAL_TYPE_NORMAL, mNormal, whiteTexture),
+		};
+
+		if (EngineVar::Bindless_Materials)
+		{
+			// Textures are keyed by their address, materials sharing one share its index. Only the slots
+			// whose texture arrived change, frames in flight read either index of them.
+			UINT32* indices[TEXTURE_TABLE_SIZE] =
+			{
+				&mMaterialConstantBuffer.baseColorIndex,
+				&mMaterialConstantBuffer.metallicRoughnessIndex,
+				&mMaterialConstantBuffer.occlusionIndex,
+				&mMaterialConstantBuffer.emissiveIndex,
+				&mMaterialConstantBuffer.normalIndex,
+			};
+			for (UINT i = 0; i < TEXTURE_TABLE_SIZE; ++i)
+			{
+				if (textures[i] == mBoundTextures[i])
+					continue;
+
+				*indices[i] = descriptorCache->AcquireBindlessIndex(
+					device, reinterpret_cast<UINT64>(textures[i]), textures[i]->GetDescriptorHandle());
+				if (mBoundTextures[i])
+					descriptorCache->ReleaseBindlessIndex(reinterpret_cast<UINT64>(mBoundTextures[i]));
+			}
+			mType = mType | MATERIAL_TYPE_BINDLESS;
 		}
 		else
 		{
-			descriptorCache->AppendSrvCache(device, blackTexture->GetDescriptorHandle());
+			D3D12_CPU_DESCRIPTOR_HANDLE handles[TEXTURE_TABLE_SIZE];
+			for (UINT i = 0; i < TEXTURE_TABLE_SIZE; ++i)
+			{
+				handles[i] = textures[i]->GetDescriptorHandle();
+			}
+			// Frames in flight may still bind the table being replaced.
+			if (bUploaded)
+				descriptorCache->RetirePersistentTable(device, mTextureTable, TEXTURE_TABLE_SIZE);
+			mTextureTable = descriptorCache->AllocatePersistentTable(device, handles, TEXTURE_TABLE_SIZE);
 		}
+		std::copy(std::begin(textures), std::end(textures), std::begin(mBoundTextures));
 
-		if (mType & MATERIAL_TYPE_NORMAL
-			&& bInitialized & MATERIAL_TYPE_NORMAL)
-		{
-			descriptorCache->AppendSrvCache(device, mNormal->GetDescriptorHandle());
-		}
-		else
-		{
-			descriptorCache->AppendSrvCache(device, whiteTexture->GetDescriptorHandle());
-		}
+		mMaterialConstantBuffer.materialType = mType;
+		mMaterialConstantsAddress = constantsAddress;
 
-		commandList->SetGraphicsRootDescriptorTable(COMMON_MATERIAL_ROOT_TABLE_INDEX, materialHandle);
+		bUploaded = true;
+		return true;
 	}
 
-	void Material::Destroy()
+	void Material::Render(ID3D12GraphicsCommandList* commandList)
 	{
-		mMaterialConstants->Release();
+		commandList->SetGraphicsRootConstantBufferView(COMMON_MATERIAL_ROOT_CBV_INDEX, mMaterialConstantsAddress);
+		commandList->SetGraphicsRootDescriptorTable(COMMON_SAMPLER_ROOT_TABLE_INDEX, mSamplerTable);
+		if (!(mType & MATERIAL_TYPE_BINDLESS))
+		{
+			commandList->SetGraphicsRootDescriptorTable(COMMON_MATERIAL_ROOT_TABLE_INDEX, mTextureTable);
+		}
 	}
 
 	Optional<Material::BaseColor> Material::GetBaseColor() const
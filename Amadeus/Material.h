@@ -9,12 +9,17 @@ namespace Amadeus
 	static constexpr UINT32 MATERIAL_TYPE_NORMAL				= 0x04;
 	static constexpr UINT32 MATERIAL_TYPE_OCCLUSION				= 0x08;
 	static constexpr UINT32 MATERIAL_TYPE_EMISSIVE				= 0x10;
+	// Textures are read through the indices in the constants, see EngineVar::Bindless_Materials.
+	static constexpr UINT32 MATERIAL_TYPE_BINDLESS				= 0x20;
 
 	class Texture;
 
 	class Material
 	{
 	public:
+		// Base color, metallic roughness, occlusion, emissive and normal, in the order of the root table.
+		static constexpr UINT TEXTURE_TABLE_SIZE = 5;
+
 		struct MaterialConstantBuffer
 		{
 			XMFLOAT4 baseColorFactor;
@@ -24,7 +29,13 @@ namespace Amadeus
 			float occlusionStrength;
 			XMFLOAT3 emissiveFactor;
 			UINT32 materialType;
-			float padding[52];
+			// Bindless indices, fallbacks included.
+			UINT32 baseColorIndex;
+			UINT32 metallicRoughnessIndex;
+			UINT32 occlusionIndex;
+			UINT32 emissiveIndex;
+			UINT32 normalIndex;
+			float padding[47];
 		};
 		static_assert((sizeof(MaterialConstantBuffer) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
 
@@ -58,11 +69,22 @@ namespace Amadeus
 
 		void SetDoubleSided(bool bDouble);
 
-		bool Upload(SharedPtr<DeviceResources> device);
+		// Slot of the sampler in the DescriptorManager heap and the table Render binds for it.
+		void SetSampler(UINT slot, const CD3DX12_GPU_DESCRIPTOR_HANDLE& table);
+
+		UINT GetSamplerSlot() const { return mSamplerSlot; }
+
+		// Writes the texture table or, in bindless mode, puts the texture indices in the constants.
+		// Textures the material lacks or that are not loaded yet are replaced by the fallbacks, calling
+		// it again after more textures arrived rebinds them. The constants are read from constantsAddress,
+		// where the caller copies GetConstantBuffer after this.
+		bool Upload(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache,
+			Texture* whiteTexture, Texture* blackTexture, D3D12_GPU_VIRTUAL_ADDRESS constantsAddress);
 
-		void Render(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// Binds the constants, the sampler and, unless bindless, the texture table written by Upload.
+		void Render(ID3D12GraphicsCommandList* commandList);
 
-		void Destroy();
+		const MaterialConstantBuffer& GetConstantBuffer() const { return mMaterialConstantBuffer; }
 
 		struct BaseColor
 		{
@@ -102,42 +124,42 @@ namespace Amadeus
 
 		UINT32 Type() { return mType; }
 
-		ID3D12Resource* GetD3D12Resource() { return mMaterialConstants.Get(); }
-
 		bool IsTransparent() { return mAlphaMode == MATERIAL_ALPHA_MODE::MATERIAL_BLEND; }
 
 		bool IsAlphaMask() { return mAlphaMode == MATERIAL_ALPHA_MODE::MATERIAL_MASK; }
 
+		bool IsDoubleSided() { return bDoubleSided; }
+
 	private:
 		// Type Flag
 		UINT32 mType = 0;
 
 		// PBR Metallic Roughness
-		Texture* mBaseColor;
+		Texture* mBaseColor = nullptr;
 		TextureId mBaseColorId = -1;
 		TexCoord mBaseColorCoord = 0; // Note: This implementation does not currently support glTF 2's TexCoord1 attributes.
 		Vector<float> mBaseColorFactor = { 1.0f ,1.0f, 1.0f, 1.0f };
 
-		Texture* mMetallicRoughness;
+		Texture* mMetallicRoughness = nullptr;
 		TextureId mMetallicRoughnessId = -1;
 		TexCoord mMetallicRoughnessCoord = 0; // Note: This implementation does not currently support glTF 2's TexCoord1 attributes.
 		float mMetallicFactor = 1.0f;
 		float mRoughnessFactor = 1.0f;
 
 		// Normal
-		Texture* mNormal;
+		Texture* mNormal = nullptr;
 		TextureId mNormalId = -1;
 		TexCoord mNormalCoord = 0; // Note: This implementation does not currently support glTF 2's TexCoord1 attributes.
 		float mNormalScale = 1.0f;
 
 		// Occlusion
-		Texture* mOcclusion;
+		Texture* mOcclusion = nullptr;
 		TextureId mOcclusionId = -1;
 		TexCoord mOcclusionCoord = 0; // Note: This implementation does not currently support glTF 2's TexCoord1 attributes.
 		float mOcclusionStrength = 1.0f;
 
 		// Emissive
-		Texture* mEmissive;
+		Texture* mEmissive = nullptr;
 		TextureId mEmissiveId = -1;
 		TexCoord mEmissiveCoord = 0; // Note: This implementation does not currently support glTF 2's TexCoord1 attributes.
 		Vector<float> mEmissiveFactor = { 0.0f, 0.0f, 0.0f };
@@ -148,15 +170,18 @@ namespace Amadeus
 
 		// Other
 		bool bDoubleSided = false;
+		UINT mSamplerSlot = 0;
+		CD3DX12_GPU_DESCRIPTOR_HANDLE mSamplerTable = {};
 
-		// Flag
+		// Flag, bInitialized has the bits of the textures found loaded.
 		UINT32 bInitialized = 0;
 		UINT32 bUploaded = 0;
 
 		// D3D12 Resource
-		ComPtr<ID3D12Resource> mMaterialConstants;
-		MaterialConstantBuffer mMaterialConstantBuffer;
-		UINT8* pMaterialCbvDataBegin;
-		const UINT mMaterialConstantBufferSize = sizeof(MaterialConstantBuffer);
+		MaterialConstantBuffer mMaterialConstantBuffer = {};
+		D3D12_GPU_VIRTUAL_ADDRESS mMaterialConstantsAddress = 0;
+		CD3DX12_GPU_DESCRIPTOR_HANDLE mTextureTable = {};
+		// Textures or fallbacks the table or the bindless indices point at.
+		Texture* mBoundTextures[TEXTURE_TABLE_SIZE] = {};
 	};
 }
\ No newline at end of file
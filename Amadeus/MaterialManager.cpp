@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "MaterialManager.h"
+#include "TextureManager.h"
 
 namespace Amadeus
 {
@@ -49,12 +50,87 @@ namespace Amadeus
 			->SetDoubleSided(bDouble);
 	}
 
+	void MaterialManager::UploadAll(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache)
+	{
+		// Fallbacks are looked up by name once for all materials.
+		mWhiteTexture = TextureManager::Instance().GetTexture(EngineVar::TEXTURE_WHITE_ID);
+		mBlackTexture = TextureManager::Instance().GetTexture(EngineVar::TEXTURE_BLACK_ID);
+
+		// Bindless passes still declare the material table, it points at the fallbacks.
+		const D3D12_CPU_DESCRIPTOR_HANDLE fallbacks[Material::TEXTURE_TABLE_SIZE] =
+		{
+			mWhiteTexture->GetDescriptorHandle(),
+			mWhiteTexture->GetDescriptorHandle(),
+			mWhiteTexture->GetDescriptorHandle(),
+			mBlackTexture->GetDescriptorHandle(),
+			mWhiteTexture->GetDescriptorHandle(),
+		};
+		mFallbackTable = descriptorCache->AllocatePersistentTable(device, fallbacks, Material::TEXTURE_TABLE_SIZE);
+
+		if (EngineVar::Bindless_Materials)
+		{
+			// Materials release a fallback once their texture arrives, its index must not be recycled
+			// while frames in flight still read it.
+			descriptorCache->AcquireBindlessIndex(
+				device, reinterpret_cast<UINT64>(mWhiteTexture), mWhiteTexture->GetDescriptorHandle());
+			descriptorCache->AcquireBindlessIndex(
+				device, reinterpret_cast<UINT64>(mBlackTexture), mBlackTexture->GetDescriptorHandle());
+		}
+
+		// The constants of every material are packed into one buffer, each at its 256 byte aligned record.
+		const UINT stride = sizeof(Material::MaterialConstantBuffer);
+		const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(stride * (mMaterialList.size() + 1));
+
+		ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&resourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mMaterialConstants)));
+		NAME_D3D12_OBJECT(mMaterialConstants);
+
+		CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
+		ThrowIfFailed(mMaterialConstants->Map(0, &readRange, reinterpret_cast<void**>(&pMaterialCbvDataBegin)));
+
+		const D3D12_GPU_VIRTUAL_ADDRESS constantsAddress = mMaterialConstants->GetGPUVirtualAddress();
+		for (UINT64 i = 0; i <= mMaterialList.size(); ++i)
+		{
+			Material* material = i < mMaterialList.size() ? mMaterialList[i] : &mDefaultMaterial;
+			material->Upload(device, descriptorCache, mWhiteTexture, mBlackTexture, constantsAddress + i * stride);
+			memcpy(pMaterialCbvDataBegin + i * stride, &material->GetConstantBuffer(), stride);
+		}
+	}
+
+	void MaterialManager::UpdateAll(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache)
+	{
+		if (!pMaterialCbvDataBegin)
+			return;
+
+		// Only the texture indices of a record change, a frame in flight reads the old or the new one.
+		const UINT stride = sizeof(Material::MaterialConstantBuffer);
+		const D3D12_GPU_VIRTUAL_ADDRESS constantsAddress = mMaterialConstants->GetGPUVirtualAddress();
+		for (UINT64 i = 0; i <= mMaterialList.size(); ++i)
+		{
+			Material* material = i < mMaterialList.size() ? mMaterialList[i] : &mDefaultMaterial;
+			material->Upload(device, descriptorCache, mWhiteTexture, mBlackTexture, constantsAddress + i * stride);
+			memcpy(pMaterialCbvDataBegin + i * stride, &material->GetConstantBuffer(), stride);
+		}
+	}
+
 	void MaterialManager::Destroy()
 	{
 		for (auto& material : mMaterialList)
 		{
-			material->Destroy();
+			delete material;
 		}
 		mMaterialList.clear();
+		if (pMaterialCbvDataBegin)
+		{
+			mMaterialConstants->Unmap(0, nullptr);
+			pMaterialCbvDataBegin = nullptr;
+		}
+		mMaterialConstants.Reset();
 	}
 }
\ No newline at end of file
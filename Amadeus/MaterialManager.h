@@ -30,6 +30,19 @@ namespace Amadeus
 
 		Material* GetMaterial(UINT64 index) { return mMaterialList.at(index); }
 
+		// Material of the primitives that have none, its constants follow the records of the list.
+		Material* GetDefaultMaterial() { return &mDefaultMaterial; }
+
+		// Creates the constants and texture tables of every material, textures that are not loaded yet
+		// are bound as the fallbacks.
+		void UploadAll(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache);
+
+		// Rebinds the materials that use textures loaded since the last call, between frames.
+		void UpdateAll(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache);
+
+		// Texture table of a material without textures.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE GetFallbackTable() const { return mFallbackTable; }
+
 		void Destroy();
 
 	private:
@@ -37,5 +50,13 @@ namespace Amadeus
 
 		typedef Vector<Material*> MaterialList;
 		MaterialList mMaterialList;
+		Material mDefaultMaterial{ -1, -1, -1, -1, -1 };
+
+		ComPtr<ID3D12Resource> mMaterialConstants;
+		// Stays mapped, materials rewrite their records when their textures arrive.
+		UINT8* pMaterialCbvDataBegin = nullptr;
+		CD3DX12_GPU_DESCRIPTOR_HANDLE mFallbackTable = {};
+		Texture* mWhiteTexture = nullptr;
+		Texture* mBlackTexture = nullptr;
 	};
 }
\ No newline at end of file
@@ -6,164 +6,70 @@ namespace Amadeus
 {
 	UINT64 Mesh::CreatrPrimitive(Vector<Primitive::Vertex>&& vertices, Vector<UINT>&& indices, INT material, bool normalsProvided, bool tangentsProvided, D3D12_PRIMITIVE_TOPOLOGY mode)
 	{
-		UINT64 id = mPrimitiveList.size();
-		Primitive* primitive = new Primitive(
+		return AddPrimitive(new Primitive(
 			std::move(vertices),
 			std::move(indices),
-			XMLoadFloat4x4(&mModelMatrix),
+			GetModelMatrix(),
 			material,
 			normalsProvided,
 			tangentsProvided,
-			mode);
+			mode));
+	}
 
-		mPrimitiveList.emplace_back(primitive);
+	UINT64 Mesh::AddPrimitive(Primitive* primitive)
+	{
+		UINT64 id = mPrimitiveList.Add(primitive);
 		StatBoundary(primitive);
 		return id;
 	}
 
-	void Mesh::UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
+	void Mesh::SetPrimitive(UINT64 id, Primitive* primitive)
 	{
-		Vector<ID3D12Resource*> uploadHeaps;
-		Vector<ID3D12GraphicsCommandList*> commandLists;
-		Vector<ID3D12CommandAllocator*> commandAllocators;
-
-		UINT64 size = mPrimitiveList.size();
-		for (int i = 0; i < size; ++i)
-		{
-			ID3D12CommandAllocator* commandAllocator = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandAllocator(
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				IID_PPV_ARGS(&commandAllocator)));
-
-			ID3D12GraphicsCommandList* commandList = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				commandAllocator,
-				nullptr,
-				IID_PPV_ARGS(&commandList)));
-
-			commandAllocators.emplace_back(commandAllocator);
-			commandLists.emplace_back(commandList);
-		}
+		mPrimitiveList.Set(id, primitive);
+		StatBoundary(primitive);
+	}
 
-		const CD3DX12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	void Mesh::UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
+	{
+		Uploader& uploader = renderer->GetUploader();
 
 		Vector<Future<bool>> results;
-		int i = 0;
-		for (auto& primitive : mPrimitiveList)
+		for (auto& primitive : mPrimitiveList.GetItems())
 		{
-			const CD3DX12_RESOURCE_DESC verticesDesc = CD3DX12_RESOURCE_DESC::Buffer(primitive->GetVertexDataSize());
-
-			ID3D12Resource* verticesUploadHeap = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-				&uploadHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&verticesDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&verticesUploadHeap)));
-			uploadHeaps.emplace_back(verticesUploadHeap);
-
-			const CD3DX12_RESOURCE_DESC indicesDesc = CD3DX12_RESOURCE_DESC::Buffer(primitive->GetIndexDataSize());
-
-			ID3D12Resource* indicesUploadHeap = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-				&uploadHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&indicesDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&indicesUploadHeap)));
-			uploadHeaps.emplace_back(indicesUploadHeap);
-
 #ifdef AMADEUS_CONCURRENCY
-			results.emplace_back(renderer->Submit(
-				&Primitive::Upload, primitive, device, verticesUploadHeap, indicesUploadHeap, commandLists[i]));
+			results.emplace_back(renderer->Submit([=, &uploader] { return primitive->Upload(device, uploader); }));
 #else
-			primitive->Upload(device, verticesUploadHeap, indicesUploadHeap, commandLists[i]);
+			primitive->Upload(device, uploader);
 #endif // AMADEUS_CONCURRENCY
-
-			++i;
 		}
 
 		for (auto&& res : results)
 		{
 			if (!res.get())
-				throw RuntimeError("TextureManager::UploadAll Error");
-		}
-
-		renderer->Upload(device);
-
-		for (auto&& uploadHeap : uploadHeaps)
-		{
-			uploadHeap->Release();
-		}
-		uploadHeaps.clear();
-
-		for (auto&& commandAllocator : commandAllocators)
-		{
-			commandAllocator->Release();
-		}
-		commandAllocators.clear();
-
-		for (auto&& commandList : commandLists)
-		{
-			commandList->Release();
-		}
-		commandLists.clear();
-	}
-
-	void Mesh::RenderShadow(
-		SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
-	{
-		for (auto& primitive : mPrimitiveList)
-		{
-			if (primitive->IsTransparent())
-			{
-				continue;
-			}
-			primitive->RenderShadow(device, descriptorCache, commandList);
+				throw RuntimeError("Mesh::UploadAll Error");
 		}
-	}
 
-	void Mesh::Render(
-		SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
-	{
-		for (auto& primitive : mPrimitiveList)
-		{
-			if (primitive->IsTransparent())
-			{
-				continue;
-			}
-			primitive->Render(device, descriptorCache, commandList);
-		}
+		renderer->Flush(device);
 	}
 
-	void Mesh::RenderTransparent(
-		SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+	void Mesh::Cull(const ClusterCuller::View& view, ClusterCuller::Statistics& statistics)
 	{
-		for (auto& primitive : mPrimitiveList)
+		for (auto& primitive : mPrimitiveList.GetItems())
 		{
-			if (!primitive->IsTransparent())
+			if (primitive->IsVisible(CullView::Camera))
 			{
-				continue;
+				primitive->Cull(view, statistics);
 			}
-			primitive->Render(device, descriptorCache, commandList);
 		}
 	}
 
 	void Mesh::Destroy()
 	{
-		for (auto& primitive : mPrimitiveList)
+		for (auto& primitive : mPrimitiveList.GetItems())
 		{
 			primitive->Destroy();
 		}
-		mPrimitiveList.clear();
+		mPrimitiveList.Clear();
 	}
 
 	void Mesh::StatBoundary(Primitive* primitive)
@@ -1,6 +1,7 @@
 #pragma once
 #include "Prerequisites.h"
 #include "Primitive.h"
+#include "Common/SlotList.h"
 
 namespace Amadeus
 {
@@ -18,29 +19,37 @@ namespace Amadeus
 		UINT64 CreatrPrimitive(Vector<Primitive::Vertex>&& vertices, Vector<UINT>&& indices, INT material = -1,
 			bool normalsProvided = true, bool tangentsProvided = true, D3D12_PRIMITIVE_TOPOLOGY mode = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		Vector<Primitive*>& GetPrimitives() { return mPrimitiveList; }
+		// Takes ownership of a primitive built with this mesh's model matrix.
+		UINT64 AddPrimitive(Primitive* primitive);
 
-		Primitive* GetPrimitive(UINT64 index) { return mPrimitiveList.at(index); }
+		// Reserves ids for count primitives in a row, returns the first. Primitives loaded in parallel
+		// reserve theirs in source order and set them as they finish, so ids and order do not depend on
+		// which finished first.
+		UINT64 ReservePrimitives(UINT64 count) { return mPrimitiveList.Reserve(count); }
 
-		UINT64 GetPrimitiveSize() { return mPrimitiveList.size(); }
+		// Takes ownership of a primitive for an id reserved before.
+		void SetPrimitive(UINT64 id, Primitive* primitive);
 
-		void UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer);
+		XMMATRIX GetModelMatrix() const { return XMLoadFloat4x4(&mModelMatrix); }
+
+		Vector<Primitive*>& GetPrimitives() { return mPrimitiveList.GetItems(); }
+
+		Primitive* GetPrimitive(UINT64 index) { return mPrimitiveList.GetItems().at(index); }
 
-		void RenderShadow(SharedPtr<DeviceResources> device, 
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		UINT64 GetPrimitiveSize() { return mPrimitiveList.Size(); }
+
+		void UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer);
 
-		void Render(SharedPtr<DeviceResources> device, 
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// Culls the meshlets of the primitives left visible to the camera.
+		void Cull(const ClusterCuller::View& view, ClusterCuller::Statistics& statistics);
 
-		void RenderTransparent(SharedPtr<DeviceResources> device,
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
 		
 		void Destroy();
 
 		const Boundary& GetBoundary() { return mBoundary; }
 
 	private:
-		typedef Vector<Primitive*> PrimitiveList;
+		typedef SlotList<Primitive*> PrimitiveList;
 		PrimitiveList mPrimitiveList;
 
 		XMFLOAT4X4 mModelMatrix;
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "MeshManager.h"
 #include "RenderSystem.h"
+#include "Camera.h"
+#include "Light.h"
+#include "MaterialManager.h"
 
 namespace Amadeus
 {
@@ -10,28 +13,28 @@ namespace Amadeus
 			[&](ShadowMapRender params)
 			{
 				params.commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST); 
-				MeshManager::Instance().RenderShadow(params.device, params.descriptorCache, params.commandList);
+				MeshManager::Instance().Render(params.device, params.descriptorCache, params.commandList, DrawPass::Shadow);
 			});
 
 		listen<ZPreRender>("ZPreRender",
 			[&](ZPreRender params)
 			{
 				params.commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				MeshManager::Instance().RenderShadow(params.device, params.descriptorCache, params.commandList);
+				MeshManager::Instance().Render(params.device, params.descriptorCache, params.commandList, DrawPass::ZPre);
 			});
 
 		listen<GBufferRender>("GBufferRender",
 			[&](GBufferRender params)
 			{
 				params.commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				MeshManager::Instance().Render(params.device, params.descriptorCache, params.commandList);
+				MeshManager::Instance().Render(params.device, params.descriptorCache, params.commandList, DrawPass::GBuffer);
 			});
 
 		listen<GBufferTransparentRender>("GBufferTransparentRender",
 			[&](GBufferTransparentRender params)
 			{
 				params.commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				MeshManager::Instance().RenderTransparent(params.device, params.descriptorCache, params.commandList);
+				MeshManager::Instance().Render(params.device, params.descriptorCache, params.commandList, DrawPass::Transparent);
 			});
 	}
 
@@ -54,133 +57,185 @@ namespace Amadeus
 
 	void MeshManager::UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
 	{
-		Vector<ID3D12Resource*> uploadHeaps;
-		Vector<ID3D12GraphicsCommandList*> commandLists;
-		Vector<ID3D12CommandAllocator*> commandAllocators;
+		// Every primitive records its copies into the batches of the one uploader.
+		Uploader& uploader = renderer->GetUploader();
 
-		UINT64 size = 0;
-		for (auto& mesh : mMeshList)
-		{
-			size += mesh->GetPrimitiveSize();
-		}
-
-		for (int i = 0; i < size; ++i)
-		{
-			ID3D12CommandAllocator* commandAllocator = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandAllocator(
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				IID_PPV_ARGS(&commandAllocator)));
-
-			ID3D12GraphicsCommandList* commandList = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				commandAllocator,
-				nullptr,
-				IID_PPV_ARGS(&commandList)));
-
-			commandAllocators.emplace_back(commandAllocator);
-			commandLists.emplace_back(commandList);
-		}
-
-		const CD3DX12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-
-		Vector<Future<bool>> results;
-		int i = 0;
+#ifdef AMADEUS_CONCURRENCY
+		JobSystem& jobs = renderer->GetJobSystem();
+		Job* root = jobs.CreateJob([] {});
+		Atomic<bool> failed = false;
+#endif // AMADEUS_CONCURRENCY
 		for (auto& mesh : mMeshList)
 		{
 			for (auto& primitive : mesh->GetPrimitives())
 			{
-				const CD3DX12_RESOURCE_DESC verticesDesc = CD3DX12_RESOURCE_DESC::Buffer(primitive->GetVertexDataSize());
-
-				ID3D12Resource* verticesUploadHeap = {};
-
-				ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-					&uploadHeapProperties,
-					D3D12_HEAP_FLAG_NONE,
-					&verticesDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&verticesUploadHeap)));
-				uploadHeaps.emplace_back(verticesUploadHeap);
-
-				const CD3DX12_RESOURCE_DESC indicesDesc = CD3DX12_RESOURCE_DESC::Buffer(primitive->GetIndexDataSize());
-
-				ID3D12Resource* indicesUploadHeap = {};
-
-				ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-					&uploadHeapProperties,
-					D3D12_HEAP_FLAG_NONE,
-					&indicesDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&indicesUploadHeap)));
-				uploadHeaps.emplace_back(indicesUploadHeap);
-
 #ifdef AMADEUS_CONCURRENCY
-				results.emplace_back(renderer->Submit(
-					&Primitive::Upload, primitive, device, verticesUploadHeap, indicesUploadHeap, commandLists[i]));
+				jobs.Run(jobs.CreateChildJob(root, [=, &uploader, &failed]
+				{
+					if (!primitive->Upload(device, uploader))
+						failed.store(true, std::memory_order_relaxed);
+				}));
 #else
-				primitive->Upload(device, verticesUploadHeap, indicesUploadHeap, commandLists[i]);
+				primitive->Upload(device, uploader);
 #endif // DEBUG
-
-				++i;
 			}
 		}
 
-		for (auto&& res : results)
-		{
-			if (!res.get())
-				throw RuntimeError("TextureManager::UploadAll Error");
-		}
+#ifdef AMADEUS_CONCURRENCY
+		jobs.Run(root);
+		jobs.Wait(root);
+		if (failed.load())
+			throw RuntimeError("MeshManager::UploadAll Error");
+#endif // AMADEUS_CONCURRENCY
 
-		renderer->Upload(device);
+		renderer->Flush(device);
+	}
 
-		for (auto&& uploadHeap : uploadHeaps)
+	void MeshManager::Cull(Camera& camera, Light& light)
+	{
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, camera.GetViewProjectionMatrix());
+		XMFLOAT3 position;
+		XMStoreFloat3(&position, camera.GetPosition());
+		const ClusterCuller::View view = ClusterCuller::CreateView(viewProjection.m, &position.x);
+
+		UpdateScene();
+		if (EngineVar::Frustum_Cull)
 		{
-			uploadHeap->Release();
-		}
-		uploadHeaps.clear();
+			CullFrustum(view.frustum, CullView::Camera);
 
-		for (auto&& commandAllocator : commandAllocators)
+			XMFLOAT4X4 lightViewProjection;
+			XMStoreFloat4x4(&lightViewProjection, XMMatrixMultiply(light.GetViewMatrix(), light.GetProjectionMatrix()));
+			CullFrustum(FrustumCuller::CreateFrustum(lightViewProjection.m), CullView::Light);
+		}
+		else
 		{
-			commandAllocator->Release();
+			for (auto& mesh : mMeshList)
+			{
+				for (auto& primitive : mesh->GetPrimitives())
+				{
+					primitive->SetVisible(CullView::Camera, true);
+					primitive->SetVisible(CullView::Light, true);
+				}
+			}
+			mFrustumCulled[static_cast<int>(CullView::Camera)] = 0;
+			mFrustumCulled[static_cast<int>(CullView::Light)] = 0;
 		}
-		commandAllocators.clear();
 
-		for (auto&& commandList : commandLists)
+		mCullStatistics = {};
+		for (auto& mesh : mMeshList)
 		{
-			commandList->Release();
+			mesh->Cull(view, mCullStatistics);
 		}
-		commandLists.clear();
+
+		BuildDrawList(camera, light);
 	}
 
-	void MeshManager::RenderShadow(
-		SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+	void MeshManager::BuildDrawList(Camera& camera, Light& light)
 	{
-		for (auto& mesh : mMeshList)
+		const XMVECTOR eye = camera.GetPosition();
+		const XMVECTOR look = camera.GetLookDirection();
+		const XMMATRIX lightView = light.GetViewMatrix();
+		const UINT32 materialMask = (1u << DrawList::MaterialBits) - 1;
+
+		mDrawList.Clear();
+		for (UINT64 item = 0; item < mPrimitives.size(); ++item)
 		{
-			mesh->RenderShadow(device, descriptorCache, commandList);
+			Primitive* primitive = mPrimitives[item];
+			Material* material = primitive->GetMaterial();
+			const bool bCamera = primitive->IsVisible(CullView::Camera);
+			const bool bLight = primitive->IsVisible(CullView::Light);
+			// Alpha tested materials have no pass yet.
+			if ((!bCamera && !bLight) || material->IsAlphaMask())
+			{
+				continue;
+			}
+
+			const Boundary& boundary = primitive->GetBoundary();
+			const XMVECTOR center = XMVectorSet((boundary.xMin + boundary.xMax) * 0.5f,
+				(boundary.yMin + boundary.yMax) * 0.5f, (boundary.zMin + boundary.zMax) * 0.5f, 1.0f);
+			const float depth = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, eye), look));
+			const UINT32 materialKey = static_cast<UINT32>(primitive->GetMaterialId() + 1) & materialMask;
+			const UINT32 index = static_cast<UINT32>(item);
+
+			if (material->IsTransparent())
+			{
+				if (bCamera)
+				{
+					mDrawList.Add(DrawList::MakeBackToFrontKey(static_cast<UINT32>(DrawPass::Transparent), 0, materialKey, depth), index);
+				}
+				continue;
+			}
+
+			if (bLight)
+			{
+				const float lightDepth = XMVectorGetZ(XMVector3Transform(center, lightView));
+				mDrawList.Add(DrawList::MakeKey(static_cast<UINT32>(DrawPass::Shadow), 0, 0, lightDepth), index);
+			}
+			if (bCamera)
+			{
+				mDrawList.Add(DrawList::MakeKey(static_cast<UINT32>(DrawPass::ZPre), 0, 0, depth), index);
+				mDrawList.Add(DrawList::MakeKey(static_cast<UINT32>(DrawPass::GBuffer), 0, materialKey, depth), index);
+			}
 		}
+		mDrawList.Sort();
 	}
 
-	void MeshManager::Render(
-		SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+	Primitive* MeshManager::Pick(Camera& camera, float x, float y)
 	{
-		for (auto& mesh : mMeshList)
-		{
-			mesh->Render(device, descriptorCache, commandList);
-		}
+		UpdateScene();
+
+		// From the near to the far plane through the point in normalized device coordinates.
+		const XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, camera.GetViewProjectionMatrix());
+		const XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), inverseViewProjection);
+		const XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), inverseViewProjection);
+		XMFLOAT3 origin;
+		XMFLOAT3 direction;
+		XMStoreFloat3(&origin, nearPoint);
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSubtract(farPoint, nearPoint)));
+
+		float distance = (NumericLimits<float>::max)();
+		const uint32_t item = mScene.Raycast(&origin.x, &direction.x, distance,
+			[&](uint32_t candidate, float& closest) { return mPrimitives[candidate]->Raycast(&origin.x, &direction.x, closest); });
+		mPicked = item == ~0u ? nullptr : mPrimitives[item];
+		return mPicked;
 	}
 
-	void MeshManager::RenderTransparent(
-		SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+	void MeshManager::Render(SharedPtr<DeviceResources> device,
+		SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList, DrawPass pass)
 	{
-		for (auto& mesh : mMeshList)
+		const bool bDepthOnly = pass == DrawPass::Shadow || pass == DrawPass::ZPre;
+		const auto range = mDrawList.GetRange(static_cast<uint32_t>(pass));
+		const auto& items = mDrawList.GetItems();
+
+		if (!bDepthOnly)
 		{
-			mesh->RenderTransparent(device, descriptorCache, commandList);
+			// The bindless root signature has both tables, bindless materials still bind the fallbacks.
+			if (EngineVar::Bindless_Materials)
+			{
+				commandList->SetGraphicsRootDescriptorTable(COMMON_BINDLESS_ROOT_TABLE_INDEX, descriptorCache->GetBindlessTable());
+			}
+			commandList->SetGraphicsRootDescriptorTable(COMMON_MATERIAL_ROOT_TABLE_INDEX, MaterialManager::Instance().GetFallbackTable());
+		}
+
+		// Draws of a material are next to each other, its constants and table are bound once per run.
+		Material* boundMaterial = nullptr;
+		for (size_t i = range.first; i < range.second; ++i)
+		{
+			Primitive* primitive = mPrimitives[items[i]];
+			if (bDepthOnly)
+			{
+				primitive->DrawDepth(commandList);
+				continue;
+			}
+
+			Material* material = primitive->GetMaterial();
+			if (material != boundMaterial)
+			{
+				material->Render(commandList);
+				boundMaterial = material;
+			}
+			primitive->Draw(commandList);
 		}
 	}
 
@@ -198,6 +253,12 @@ namespace Amadeus
 		return mBoundary;
 	}
 
+	void MeshManager::SetBoundary(const Boundary& boundary)
+	{
+		mBoundary = boundary;
+		bBoundaryInitiated = true;
+	}
+
 	XMVECTOR MeshManager::GetCentralLocation()
 	{
 		if (!bBoundaryInitiated)
@@ -210,6 +271,76 @@ namespace Amadeus
 		return std::move(XMLoadFloat3(&center));
 	}
 
+	void MeshManager::UpdateScene()
+	{
+		UINT64 primitiveCount = 0;
+		for (auto& mesh : mMeshList)
+		{
+			primitiveCount += mesh->GetPrimitiveSize();
+		}
+
+		// Empty bounds stay inverted, no frustum or ray ever reaches them.
+		auto setBox = [&](UINT64 item) {
+			const Boundary& boundary = mPrimitives[item]->GetBoundary();
+			mPrimitiveBoxes.minX[item] = boundary.xMin;
+			mPrimitiveBoxes.minY[item] = boundary.yMin;
+			mPrimitiveBoxes.minZ[item] = boundary.zMin;
+			mPrimitiveBoxes.maxX[item] = boundary.xMax;
+			mPrimitiveBoxes.maxY[item] = boundary.yMax;
+			mPrimitiveBoxes.maxZ[item] = boundary.zMax;
+		};
+
+		if (mPrimitives.size() != primitiveCount)
+		{
+			mPrimitives.clear();
+			mPrimitiveBoxes.Clear();
+			for (auto& mesh : mMeshList)
+			{
+				for (auto& primitive : mesh->GetPrimitives())
+				{
+					const Boundary& boundary = primitive->GetBoundary();
+					const float minimum[3] = { boundary.xMin, boundary.yMin, boundary.zMin };
+					const float maximum[3] = { boundary.xMax, boundary.yMax, boundary.zMax };
+					primitive->ConsumeBoundaryChanged();
+					mPrimitives.emplace_back(primitive);
+					mPrimitiveBoxes.Add(minimum, maximum);
+				}
+			}
+			mScene.Build(mPrimitiveBoxes);
+			return;
+		}
+
+		mMovedItems.clear();
+		for (UINT64 item = 0; item < mPrimitives.size(); ++item)
+		{
+			if (mPrimitives[item]->ConsumeBoundaryChanged())
+			{
+				setBox(item);
+				mMovedItems.emplace_back(static_cast<uint32_t>(item));
+			}
+		}
+		if (!mMovedItems.empty())
+		{
+			mScene.Refit(mPrimitiveBoxes, mMovedItems.data(), mMovedItems.size());
+		}
+	}
+
+	void MeshManager::CullFrustum(const FrustumCuller::Frustum& frustum, CullView view)
+	{
+		for (auto& primitive : mPrimitives)
+		{
+			primitive->SetVisible(view, false);
+		}
+
+		mVisibleItems.clear();
+		mScene.Cull(frustum, mVisibleItems);
+		for (uint32_t item : mVisibleItems)
+		{
+			mPrimitives[item]->SetVisible(view, true);
+		}
+		mFrustumCulled[static_cast<int>(view)] = mPrimitives.size() - mVisibleItems.size();
+	}
+
 	void MeshManager::StatBoundary(Mesh* mesh)
 	{
 		const auto& boundary = mesh->GetBoundary();
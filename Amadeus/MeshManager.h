@@ -1,9 +1,14 @@
 #pragma once
 #include "Prerequisites.h"
 #include "Mesh.h"
+#include "Common/BoundingVolumeHierarchy.h"
+#include "Common/DrawList.h"
 
 namespace Amadeus
 {
+	class Camera;
+	class Light;
+
 	class MeshManager : public Observer
 	{
 	public:
@@ -26,14 +31,24 @@ namespace Amadeus
 
 		void UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer);
 
-		void RenderShadow(SharedPtr<DeviceResources> device, 
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// Culls once per frame, before the passes record. The scene hierarchy over the world bounds of
+		// the primitives is queried with the camera and the light frustum, the meshlets of the primitives
+		// left for the camera are culled against the camera. The draws left are sorted into the draw list.
+		void Cull(Camera& camera, Light& light);
 
-		void Render(SharedPtr<DeviceResources> device, 
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// Nearest primitive under a point in normalized device coordinates, or nullptr.
+		Primitive* Pick(Camera& camera, float x, float y);
+
+		Primitive* GetPickedPrimitive() const { return mPicked; }
+
+		const ClusterCuller::Statistics& GetCullStatistics() const { return mCullStatistics; }
 
-		void RenderTransparent(SharedPtr<DeviceResources> device,
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// Primitives the frustum test of a view rejected in the last Cull.
+		UINT64 GetFrustumCulled(CullView view) const { return mFrustumCulled[static_cast<int>(view)]; }
+
+		// Walks the draws of a pass in the order of the draw list Cull built.
+		void Render(SharedPtr<DeviceResources> device, 
+			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList, DrawPass pass);
 
 		Mesh* GetMesh(UINT64 index) { return mMeshList.at(index); }
 
@@ -41,6 +56,10 @@ namespace Amadeus
 
 		const Boundary& GetBoundary();
 
+		// Bounds the scene is expected to have before its primitives are loaded, e.g. read from the
+		// accessors of a file. GetBoundary then returns them instead of the bounds of the primitives.
+		void SetBoundary(const Boundary& boundary);
+
 		XMVECTOR GetCentralLocation();
 
 	private:
@@ -52,6 +71,28 @@ namespace Amadeus
 		bool bBoundaryInitiated;
 		Boundary mBoundary;
 
+		ClusterCuller::Statistics mCullStatistics;
+
+		// Every primitive, mesh by mesh, is an item of the scene hierarchy. The hierarchy is built again
+		// when primitives are added and refit for the ones that moved.
+		Vector<Primitive*> mPrimitives;
+		FrustumCuller::Boxes mPrimitiveBoxes;
+		BoundingVolumeHierarchy mScene;
+		Vector<uint32_t> mMovedItems;
+		Vector<uint32_t> mVisibleItems;
+		UINT64 mFrustumCulled[static_cast<int>(CullView::Count)] = {};
+
+		Primitive* mPicked = nullptr;
+
+		// Items are indices into mPrimitives.
+		DrawList mDrawList;
+
 		void StatBoundary(Mesh* mesh);
+
+		void UpdateScene();
+
+		void BuildDrawList(Camera& camera, Light& light);
+
+		void CullFrustum(const FrustumCuller::Frustum& frustum, CullView view);
 	};
 }
\ No newline at end of file
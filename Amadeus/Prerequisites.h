@@ -27,6 +27,7 @@ namespace Amadeus
 	template<typename T> using UniqueLock = std::unique_lock<T>;
 	template<typename T> using LockGuard = std::lock_guard<T>;
 	template<typename T> using Optional = std::optional<T>;
+	template<typename T> using Atomic = std::atomic<T>;
 
 	using namespace DirectX;
 	using namespace Microsoft::WRL;
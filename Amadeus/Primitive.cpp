@@ -2,11 +2,23 @@
 #include "Primitive.h"
 #include "MikkTSpace/mikktspace.h"
 #include "MaterialManager.h"
+#include "Common/Hash.h"
 
 namespace Amadeus
 {
     static constexpr int TRIANGLE_VERTEX_COUNT = 3;
 
+    // Bumped whenever Derive or the layout of its cached data changes.
+    static constexpr UINT32 DERIVED_DATA_VERSION = 1;
+
+    struct DerivedDataHeader
+    {
+        UINT64 vertexCount;
+        UINT64 indexCount;
+        UINT64 meshletCount;
+        MeshOptimizer::Report report;
+    };
+
     Primitive::Primitive(
         Vector<Vertex>&& vertices, 
         Vector<uint32_t>&& indices, 
@@ -14,38 +26,114 @@ namespace Amadeus
         INT material, 
         bool normalsProvided, 
         bool tangentsProvided, 
-        D3D12_PRIMITIVE_TOPOLOGY mode)
+        D3D12_PRIMITIVE_TOPOLOGY mode,
+        DerivedDataCache* cache)
         : mVertices(std::move(vertices))
         , mIndices(std::move(indices))
         , mMaterialId(material)
         , mMode(mode)
+        , bQuantized(EngineVar::Vertex_Quantize)
     {
-        if (!normalsProvided)
+        if (!cache)
         {
-            ComputeTriangleNormals();
+            Derive(normalsProvided, tangentsProvided);
+        }
+        else
+        {
+            Vector<UINT8> data;
+            const UINT64 key = GetDerivedDataKey(normalsProvided, tangentsProvided);
+            const bool bHit = cache->Fetch(key, data, [&](Vector<UINT8>& derived)
+            {
+                Derive(normalsProvided, tangentsProvided);
+                SaveDerivedData(derived);
+            });
+            if (bHit && !LoadDerivedData(data))
+            {
+                cache->Remove(key);
+                Derive(normalsProvided, tangentsProvided);
+            }
         }
 
-        if (!tangentsProvided)
+        // Positions and texture coordinates are quantized against the bounds of this primitive.
+        mQuantization = { { 1.0f, 1.0f, 1.0f }, {}, { 1.0f, 1.0f }, {} };
+        if (bQuantized)
         {
-            ComputeTriangleTangents();
+            mQuantization = VertexPacking::ComputeQuantization(
+                reinterpret_cast<const VertexDecoder::Vertex*>(mVertices.data()), mVertices.size());
         }
 
+        Initialize(modelMatrix);
+    }
+
+    Primitive::Primitive(
+        const ScenePackage::PrimitiveRecord& record,
+        std::span<const UINT8> vertices,
+        std::span<const UINT8> indices,
+        std::span<const MeshletBuilder::Meshlet> meshlets,
+        XMMATRIX modelMatrix)
+        : mMaterialId(record.material)
+        , mMode(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+        , bQuantized(EngineVar::Vertex_Quantize)
+        , mCookedVertices(vertices)
+        , mCookedIndices(indices)
+        , mMeshlets(meshlets.begin(), meshlets.end())
+    {
+        if (record.vertexStride != GetVertexStride() || record.indexSize != (VertexPacking::FitsUInt16Indices(record.vertexCount) ? sizeof(UINT16) : sizeof(UINT32)))
+        {
+            throw RuntimeError("Primitive::Primitive Error");
+        }
+
+        memcpy(mQuantization.positionScale, record.positionScale, sizeof(mQuantization.positionScale));
+        memcpy(mQuantization.positionOffset, record.positionOffset, sizeof(mQuantization.positionOffset));
+        memcpy(mQuantization.texCoordScale, record.texCoordScale, sizeof(mQuantization.texCoordScale));
+        memcpy(mQuantization.texCoordOffset, record.texCoordOffset, sizeof(mQuantization.texCoordOffset));
+
+        // The cpu copies are only read for the bounds and picking, they are restored from the final buffers.
+        mVertices.resize(record.vertexCount);
+        if (bQuantized)
+        {
+            VertexPacking::Unpack(reinterpret_cast<const VertexPacking::PackedVertex*>(vertices.data()), record.vertexCount,
+                mQuantization, reinterpret_cast<VertexDecoder::Vertex*>(mVertices.data()));
+        }
+        else
+        {
+            memcpy(mVertices.data(), vertices.data(), vertices.size());
+        }
+
+        mIndices.resize(record.indexCount);
+        VertexDecoder::DecodeIndices(indices.data(), record.indexSize, record.indexCount, mIndices.data());
+        if (!mIndices.empty() && *std::max_element(mIndices.begin(), mIndices.end()) >= record.vertexCount)
+        {
+            throw RuntimeError("Primitive::Primitive Error");
+        }
+
+        Initialize(modelMatrix);
+    }
+
+    void Primitive::Initialize(XMMATRIX modelMatrix)
+    {
         XMStoreFloat4x4(&mPrimitiveConstantBuffer.model, modelMatrix);
-        if (mMaterialId > -1)
-            SetMaterial();
+
+        mPrimitiveConstantBuffer.bQuantized = bQuantized;
+        mPrimitiveConstantBuffer.positionScale = XMFLOAT3(mQuantization.positionScale);
+        mPrimitiveConstantBuffer.positionOffset = XMFLOAT3(mQuantization.positionOffset);
+        mPrimitiveConstantBuffer.texCoordScale = XMFLOAT2(mQuantization.texCoordScale);
+        mPrimitiveConstantBuffer.texCoordOffset = XMFLOAT2(mQuantization.texCoordOffset);
+
+        SetMaterial();
 
         StatBoundary();
     }
 
-    bool Primitive::Upload(
-        SharedPtr<DeviceResources> device, 
-        ID3D12Resource* verticesUploadHeap, 
-        ID3D12Resource* indicesUploadHeap, 
-        ID3D12GraphicsCommandList* commandList)
+    bool Primitive::Upload(SharedPtr<DeviceResources> device, Uploader& uploader)
     {
-        UploadVertices(device, verticesUploadHeap, commandList);
+        UploadVertices(device, uploader);
+
+        UploadIndices(device, uploader);
 
-        UploadIndices(device, indicesUploadHeap, commandList);
+        // The cooked buffers are not kept, they point into a package that is unmapped after the load.
+        mCookedVertices = {};
+        mCookedIndices = {};
 
         const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
         const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(mPrimitiveConstantBufferSize);
@@ -66,24 +154,50 @@ namespace Amadeus
         memcpy(pPrimitiveCbvDataBegin, &mPrimitiveConstantBuffer, mPrimitiveConstantBufferSize);
         mPrimitiveConstants->Unmap(0, 0);
 
-        mMaterial->Upload(device);
-
-        commandList->Close();
-
-        ID3D12CommandList* ppCommandLists[] = { commandList };
-        device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandLists);
-
         return true;
     }
 
-    void Primitive::RenderShadow(
-        SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+    void Primitive::Cook(ScenePackage::Writer& writer, size_t index) const
+    {
+        Vector<UINT8> vertexStorage;
+        Vector<UINT8> indexStorage;
+        const auto vertices = GetVertexData(vertexStorage);
+        const auto indices = GetIndexData(indexStorage);
+
+        ScenePackage::PrimitiveRecord record = {};
+        record.material = mMaterialId;
+        record.vertexCount = static_cast<UINT32>(mVertices.size());
+        record.vertexStride = GetVertexStride();
+        record.indexCount = static_cast<UINT32>(mIndices.size());
+        record.indexSize = GetIndexSize();
+        record.meshletCount = static_cast<UINT32>(mMeshlets.size());
+        memcpy(record.positionScale, mQuantization.positionScale, sizeof(record.positionScale));
+        memcpy(record.positionOffset, mQuantization.positionOffset, sizeof(record.positionOffset));
+        memcpy(record.texCoordScale, mQuantization.texCoordScale, sizeof(record.texCoordScale));
+        memcpy(record.texCoordOffset, mQuantization.texCoordOffset, sizeof(record.texCoordOffset));
+
+        writer.SetPrimitive(index, record, vertices, indices,
+            { reinterpret_cast<const UINT8*>(mMeshlets.data()), mMeshlets.size() * sizeof(MeshletBuilder::Meshlet) });
+    }
+
+    void Primitive::Cull(const ClusterCuller::View& view, ClusterCuller::Statistics& statistics)
     {
-        if (mMaterial->IsAlphaMask())
+        if (mMeshlets.empty())
         {
             return;
         }
 
+        // The constant buffer holds the transposed model matrix.
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, XMMatrixTranspose(XMLoadFloat4x4(&mPrimitiveConstantBuffer.model)));
+
+        mDrawRanges.clear();
+        ClusterCuller::Cull(mMeshlets.data(), mMeshlets.size(), world.m, view,
+            !GetMaterial()->IsDoubleSided(), ClusterCuller::DefaultMergeGap, mDrawRanges, statistics);
+    }
+
+    void Primitive::DrawDepth(ID3D12GraphicsCommandList* commandList)
+    {
         commandList->IASetIndexBuffer(&mIndexBufferView);
         commandList->IASetVertexBuffers(0, 1, &mVertexBufferView);
         commandList->SetGraphicsRootConstantBufferView(COMMON_PRIMITIVE_ROOT_CBV_INDEX, mPrimitiveConstants->GetGPUVirtualAddress());
@@ -91,21 +205,16 @@ namespace Amadeus
         commandList->DrawIndexedInstanced(mNumIndices, 1, 0, 0, 0);
     }
 
-    void Primitive::Render(
-        SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList)
+    void Primitive::Draw(ID3D12GraphicsCommandList* commandList)
     {
-        if (mMaterial->IsAlphaMask())
-        {
-            return;
-        }
-
         commandList->IASetIndexBuffer(&mIndexBufferView);
         commandList->IASetVertexBuffers(0, 1, &mVertexBufferView);
         commandList->SetGraphicsRootConstantBufferView(COMMON_PRIMITIVE_ROOT_CBV_INDEX, mPrimitiveConstants->GetGPUVirtualAddress());
 
-        mMaterial->Render(device, descriptorCache, commandList);
-
-        commandList->DrawIndexedInstanced(mNumIndices, 1, 0, 0, 0);
+        for (const auto& range : mDrawRanges)
+        {
+            commandList->DrawIndexedInstanced(range.indexCount, 1, range.firstIndex, 0, 0);
+        }
     }
 
     void Primitive::Destroy()
@@ -115,14 +224,86 @@ namespace Amadeus
         mPrimitiveConstants->Release();
     }
 
+    void Primitive::SetModelMatrix(XMFLOAT4X4 model)
+    {
+        mPrimitiveConstantBuffer.model = model;
+        StatBoundary();
+        bBoundaryChanged = true;
+    }
+
+    bool Primitive::Raycast(const float origin[3], const float direction[3], float& distance) const
+    {
+        if (mMode != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+        {
+            return false;
+        }
+
+        // Into object space, an affine transform keeps the distance along the ray.
+        const XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&mPrimitiveConstantBuffer.model));
+        XMVECTOR determinant;
+        const XMMATRIX inverse = XMMatrixInverse(&determinant, world);
+        if (XMVectorGetX(determinant) == 0.0f)
+        {
+            return false;
+        }
+
+        XMFLOAT3 localOrigin;
+        XMFLOAT3 localDirection;
+        XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMVectorSet(origin[0], origin[1], origin[2], 1.0f), inverse));
+        XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMVectorSet(direction[0], direction[1], direction[2], 0.0f), inverse));
+        const XMVECTOR rayOrigin = XMLoadFloat3(&localOrigin);
+        const XMVECTOR rayDirection = XMLoadFloat3(&localDirection);
+
+        // Moller-Trumbore, both faces count.
+        bool hit = false;
+        for (size_t i = 0; i + 2 < mIndices.size(); i += TRIANGLE_VERTEX_COUNT)
+        {
+            const XMVECTOR p0 = XMLoadFloat3(&mVertices[mIndices[i + 0]].position);
+            const XMVECTOR edge1 = XMVectorSubtract(XMLoadFloat3(&mVertices[mIndices[i + 1]].position), p0);
+            const XMVECTOR edge2 = XMVectorSubtract(XMLoadFloat3(&mVertices[mIndices[i + 2]].position), p0);
+
+            const XMVECTOR p = XMVector3Cross(rayDirection, edge2);
+            const float det = XMVectorGetX(XMVector3Dot(edge1, p));
+            if (det == 0.0f)
+            {
+                continue;
+            }
+
+            const float inverseDet = 1.0f / det;
+            const XMVECTOR s = XMVectorSubtract(rayOrigin, p0);
+            const float u = XMVectorGetX(XMVector3Dot(s, p)) * inverseDet;
+            if (u < 0.0f || u > 1.0f)
+            {
+                continue;
+            }
+
+            const XMVECTOR q = XMVector3Cross(s, edge1);
+            const float v = XMVectorGetX(XMVector3Dot(rayDirection, q)) * inverseDet;
+            if (v < 0.0f || u + v > 1.0f)
+            {
+                continue;
+            }
+
+            const float t = XMVectorGetX(XMVector3Dot(edge2, q)) * inverseDet;
+            if (t >= 0.0f && t < distance)
+            {
+                distance = t;
+                hit = true;
+            }
+        }
+        return hit;
+    }
+
     void Primitive::SetMaterial()
     {
-        mMaterial = MaterialManager::Instance().GetMaterial(mMaterialId);
+        // Primitives without a material use the glTF default, single-sided and opaque.
+        MaterialManager& materialManager = MaterialManager::Instance();
+        mMaterial = mMaterialId > -1 ? materialManager.GetMaterial(mMaterialId) : materialManager.GetDefaultMaterial();
     }
 
     Material* Primitive::GetMaterial() const
     {
-        return mMaterial;
+        return mMaterial ? mMaterial : MaterialManager::Instance().GetDefaultMaterial();
     }
 
     D3D12_CONSTANT_BUFFER_VIEW_DESC Primitive::GetCbvDesc(SharedPtr<DeviceResources> device)
@@ -135,11 +316,12 @@ namespace Amadeus
 
     bool Primitive::IsTransparent()
     {
-        return mMaterial->IsTransparent();
+        return GetMaterial()->IsTransparent();
     }
 
     void Primitive::StatBoundary()
     {
+        mBoundary = {};
         XMFLOAT3 maximum = { mBoundary.xMax, mBoundary.yMax, mBoundary.zMax };
         XMFLOAT3 minimum = { mBoundary.xMin ,mBoundary.yMin, mBoundary.zMin };
 
@@ -156,9 +338,18 @@ namespace Amadeus
             maximum.z = z > maximum.z ? z : maximum.z;
         }
 
-        XMMATRIX modelMatrix = XMLoadFloat4x4(&mPrimitiveConstantBuffer.model);
-        XMStoreFloat3(&maximum, XMVector3Transform(XMLoadFloat3(&maximum), modelMatrix));
-        XMStoreFloat3(&minimum, XMVector3Transform(XMLoadFloat3(&minimum), modelMatrix));
+        if (minimum.x > maximum.x)
+        {
+            return;
+        }
+
+        // Transforming only the two extreme corners breaks under rotation, the world bounds have to
+        // enclose all eight. The constant buffer holds the transposed model matrix.
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, XMMatrixTranspose(XMLoadFloat4x4(&mPrimitiveConstantBuffer.model)));
+        const XMFLOAT3 localMinimum = minimum;
+        const XMFLOAT3 localMaximum = maximum;
+        FrustumCuller::TransformBox(world.m, &localMinimum.x, &localMaximum.x, &minimum.x, &maximum.x);
 
         mBoundary.xMin = minimum.x;
         mBoundary.yMin = minimum.y;
@@ -168,6 +359,140 @@ namespace Amadeus
         mBoundary.zMax = maximum.z;
     }
 
+    void Primitive::Derive(bool normalsProvided, bool tangentsProvided)
+    {
+        if (!normalsProvided)
+        {
+            ComputeTriangleNormals();
+        }
+
+        if (!tangentsProvided)
+        {
+            ComputeTriangleTangents();
+        }
+
+        if (EngineVar::Mesh_Optimize)
+        {
+            Optimize();
+        }
+        else if (EngineVar::Meshlet_Cull)
+        {
+            BuildMeshlets();
+        }
+    }
+
+    UINT64 Primitive::GetDerivedDataKey(bool normalsProvided, bool tangentsProvided) const
+    {
+        const UINT32 settings[] = {
+            DERIVED_DATA_VERSION, normalsProvided, tangentsProvided, EngineVar::Mesh_Optimize, EngineVar::Meshlet_Cull };
+
+        // Salted so that no texture shares a key with a primitive.
+        UINT64 hash = HashBytes("Primitive", 9);
+        hash = HashBytes(mVertices.data(), mVertices.size() * sizeof(Vertex), hash);
+        hash = HashBytes(mIndices.data(), mIndices.size() * sizeof(UINT), hash);
+        return HashBytes(settings, sizeof(settings), hash);
+    }
+
+    void Primitive::SaveDerivedData(Vector<UINT8>& data) const
+    {
+        const DerivedDataHeader header = { mVertices.size(), mIndices.size(), mMeshlets.size(), mOptimizationReport };
+        const size_t vertexBytes = mVertices.size() * sizeof(Vertex);
+        const size_t indexBytes = mIndices.size() * sizeof(UINT);
+        const size_t meshletBytes = mMeshlets.size() * sizeof(MeshletBuilder::Meshlet);
+
+        data.resize(sizeof(header) + vertexBytes + indexBytes + meshletBytes);
+        UINT8* destination = data.data();
+        memcpy(destination, &header, sizeof(header));
+        memcpy(destination += sizeof(header), mVertices.data(), vertexBytes);
+        memcpy(destination += vertexBytes, mIndices.data(), indexBytes);
+        memcpy(destination += indexBytes, mMeshlets.data(), meshletBytes);
+    }
+
+    bool Primitive::LoadDerivedData(const Vector<UINT8>& data)
+    {
+        DerivedDataHeader header;
+        if (data.size() < sizeof(header))
+        {
+            return false;
+        }
+        memcpy(&header, data.data(), sizeof(header));
+
+        const UINT64 vertexBytes = header.vertexCount * sizeof(Vertex);
+        const UINT64 indexBytes = header.indexCount * sizeof(UINT);
+        const UINT64 meshletBytes = header.meshletCount * sizeof(MeshletBuilder::Meshlet);
+        if (header.vertexCount > data.size() || header.indexCount > data.size() || header.meshletCount > data.size()
+            || data.size() != sizeof(header) + vertexBytes + indexBytes + meshletBytes || header.indexCount % TRIANGLE_VERTEX_COUNT != 0)
+        {
+            return false;
+        }
+
+        Vector<Vertex> vertices(header.vertexCount);
+        Vector<UINT> indices(header.indexCount);
+        Vector<MeshletBuilder::Meshlet> meshlets(header.meshletCount);
+        const UINT8* source = data.data() + sizeof(header);
+        memcpy(vertices.data(), source, vertexBytes);
+        memcpy(indices.data(), source += vertexBytes, indexBytes);
+        memcpy(meshlets.data(), source += indexBytes, meshletBytes);
+
+        // Whatever is drawn has to stay inside the buffers.
+        for (UINT index : indices)
+        {
+            if (index >= vertices.size())
+                return false;
+        }
+        for (const auto& meshlet : meshlets)
+        {
+            if (meshlet.firstIndex > indices.size() || meshlet.indexCount > indices.size() - meshlet.firstIndex)
+                return false;
+        }
+
+        mVertices = std::move(vertices);
+        mIndices = std::move(indices);
+        mMeshlets = std::move(meshlets);
+        mOptimizationReport = header.report;
+        return true;
+    }
+
+    void Primitive::Optimize()
+    {
+        assert((mIndices.size() % TRIANGLE_VERTEX_COUNT) == 0); // Only triangles are supported.
+        if (mIndices.empty())
+        {
+            return;
+        }
+
+        const size_t vertexCount = mVertices.size();
+        mOptimizationReport.triangleCount = mIndices.size() / TRIANGLE_VERTEX_COUNT;
+        mOptimizationReport.before = MeshOptimizer::AnalyzeVertexCache(mIndices.data(), mIndices.size(), vertexCount);
+
+        // Cache order first, the overdraw pass only moves whole clusters of it.
+        Vector<UINT> cacheOrder(mIndices.size());
+        MeshOptimizer::OptimizeVertexCache(mIndices.data(), mIndices.size(), vertexCount, cacheOrder.data());
+        MeshOptimizer::OptimizeOverdraw(cacheOrder.data(), cacheOrder.size(),
+            &mVertices.data()->position.x, sizeof(Vertex), vertexCount,
+            MeshOptimizer::DefaultOverdrawThreshold, mIndices.data());
+
+        // Meshlets regroup the triangles, the vertex fetch order has to follow them.
+        if (EngineVar::Meshlet_Cull)
+        {
+            BuildMeshlets();
+        }
+
+        mVertices.resize(MeshOptimizer::OptimizeVertexFetch(mIndices.data(), mIndices.size(), mVertices.data(), vertexCount, sizeof(Vertex)));
+        mOptimizationReport.after = MeshOptimizer::AnalyzeVertexCache(mIndices.data(), mIndices.size(), mVertices.size());
+    }
+
+    void Primitive::BuildMeshlets()
+    {
+        if (mIndices.empty())
+        {
+            return;
+        }
+
+        mMeshlets = MeshletBuilder::Build(mIndices.data(), mIndices.size(),
+            &mVertices.data()->position.x, sizeof(Vertex), mVertices.size());
+    }
+
     void Primitive::ComputeTriangleNormals()
     {
         assert((mIndices.size() % TRIANGLE_VERTEX_COUNT) == 0); // Only triangles are supported.
@@ -250,9 +575,74 @@ namespace Amadeus
         }
     }
 
-    void Primitive::UploadVertices(SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList)
+    D3D12_INPUT_LAYOUT_DESC Primitive::GetInputLayout()
+    {
+        static const D3D12_INPUT_ELEMENT_DESC floatElementDescs[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        };
+
+        // See VertexPacking::PackedVertex, the vertex shaders decode the normal and the tangent.
+        static const D3D12_INPUT_ELEMENT_DESC packedElementDescs[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        };
+
+        if (EngineVar::Vertex_Quantize)
+            return { packedElementDescs, _countof(packedElementDescs) };
+        return { floatElementDescs, _countof(floatElementDescs) };
+    }
+
+    UINT Primitive::GetVertexStride() const
+    {
+        return bQuantized ? sizeof(VertexPacking::PackedVertex) : sizeof(Vertex);
+    }
+
+    std::span<const UINT8> Primitive::GetVertexData(Vector<UINT8>& storage) const
+    {
+        if (!mCookedVertices.empty())
+        {
+            return mCookedVertices;
+        }
+
+        if (!bQuantized)
+        {
+            return { reinterpret_cast<const UINT8*>(mVertices.data()), mVertices.size() * sizeof(Vertex) };
+        }
+
+        storage.resize(mVertices.size() * sizeof(VertexPacking::PackedVertex));
+        VertexPacking::Pack(reinterpret_cast<const VertexDecoder::Vertex*>(mVertices.data()), mVertices.size(),
+            mQuantization, reinterpret_cast<VertexPacking::PackedVertex*>(storage.data()));
+        return storage;
+    }
+
+    std::span<const UINT8> Primitive::GetIndexData(Vector<UINT8>& storage) const
+    {
+        if (!mCookedIndices.empty())
+        {
+            return mCookedIndices;
+        }
+
+        // Half the size whenever the vertex count allows it.
+        if (GetIndexSize() == sizeof(UINT32))
+        {
+            return { reinterpret_cast<const UINT8*>(mIndices.data()), mIndices.size() * sizeof(UINT32) };
+        }
+
+        storage.resize(mIndices.size() * sizeof(UINT16));
+        VertexPacking::PackIndices(mIndices.data(), mIndices.size(), reinterpret_cast<UINT16*>(storage.data()));
+        return storage;
+    }
+
+    void Primitive::UploadVertices(SharedPtr<DeviceResources> device, Uploader& uploader)
     {
-        UINT vertexDataSize = static_cast<UINT>(mVertices.size() * sizeof(Vertex));
+        UINT vertexDataSize = GetVertexDataSize();
         const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
         const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexDataSize);
 
@@ -260,29 +650,22 @@ namespace Amadeus
             &heapProperties,
             D3D12_HEAP_FLAG_NONE,
             &resourceDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&mVertexBuffer)));
         NAME_D3D12_OBJECT(mVertexBuffer);
 
-        D3D12_SUBRESOURCE_DATA vertexData = {};
-        vertexData.pData = mVertices.data();
-        vertexData.RowPitch = vertexDataSize;
-        vertexData.SlicePitch = vertexData.RowPitch;
-
-        UpdateSubresources<1>(commandList, mVertexBuffer.Get(), uploadHeap, 0, 0, 1, &vertexData);
-        CD3DX12_RESOURCE_BARRIER resourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            mVertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-        commandList->ResourceBarrier(1, &resourceBarrier);
+        Vector<UINT8> storage;
+        uploader.UploadBuffer(mVertexBuffer.Get(), 0, GetVertexData(storage).data(), vertexDataSize);
 
         mVertexBufferView.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
-        mVertexBufferView.StrideInBytes = static_cast<UINT>(sizeof(Vertex));
+        mVertexBufferView.StrideInBytes = GetVertexStride();
         mVertexBufferView.SizeInBytes = vertexDataSize;
     }
 
-    void Primitive::UploadIndices(SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList)
+    void Primitive::UploadIndices(SharedPtr<DeviceResources> device, Uploader& uploader)
     {
-        UINT indexDataSize = static_cast<UINT>(mIndices.size() * sizeof(UINT32));
+        UINT indexDataSize = GetIndexDataSize();
         const CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
         const CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(indexDataSize);
 
@@ -290,31 +673,21 @@ namespace Amadeus
             &heapProperties,
             D3D12_HEAP_FLAG_NONE,
             &resourceDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&mIndexBuffer)));
         NAME_D3D12_OBJECT(mIndexBuffer);
 
-        D3D12_SUBRESOURCE_DATA indexData = {};
-        indexData.pData = mIndices.data();
-        indexData.RowPitch = indexDataSize;
-        indexData.SlicePitch = indexDataSize;
-
-        UpdateSubresources<1>(commandList, mIndexBuffer.Get(), uploadHeap, 0, 0, 1, &indexData);
-        CD3DX12_RESOURCE_BARRIER resourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            mIndexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
-        commandList->ResourceBarrier(1, &resourceBarrier);
+        const bool shortIndices = GetIndexSize() == sizeof(UINT16);
+        Vector<UINT8> storage;
+        uploader.UploadBuffer(mIndexBuffer.Get(), 0, GetIndexData(storage).data(), indexDataSize);
 
         // Describe the index buffer view.
         mIndexBufferView.BufferLocation = mIndexBuffer->GetGPUVirtualAddress();
-        mIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+        mIndexBufferView.Format = shortIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
         mIndexBufferView.SizeInBytes = indexDataSize;
 
-        mNumIndices = indexDataSize / 4;    // R32_UINT (SampleAssets::StandardIndexFormat) = 4 bytes each.
-    }
-
-    void Primitive::UploadMaterial(SharedPtr<DeviceResources> device)
-    {
-        mMaterial->Upload(device);
+        mNumIndices = static_cast<UINT>(mIndices.size());
+        mDrawRanges = { { mNumIndices, 0 } };
     }
 }
\ No newline at end of file
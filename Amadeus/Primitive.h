@@ -1,5 +1,11 @@
 #pragma once
 #include "Prerequisites.h"
+#include "Common/VertexPacking.h"
+#include "Common/MeshOptimizer.h"
+#include "Common/ClusterCuller.h"
+#include "Common/Uploader.h"
+#include "Common/ScenePackage.h"
+#include "Common/DerivedDataCache.h"
 
 namespace Amadeus
 {
@@ -10,9 +16,11 @@ namespace Amadeus
 		float xMin = (NumericLimits<float>::max)();
 		float yMin = (NumericLimits<float>::max)();
 		float zMin = (NumericLimits<float>::max)();
-		float xMax = (NumericLimits<float>::min)();
-		float yMax = (NumericLimits<float>::min)();
-		float zMax = (NumericLimits<float>::min)();
+		float xMax = NumericLimits<float>::lowest();
+		float yMax = NumericLimits<float>::lowest();
+		float zMax = NumericLimits<float>::lowest();
+
+		bool IsEmpty() const { return xMin > xMax || yMin > yMax || zMin > zMax; }
 	};
 
 	class Primitive
@@ -26,11 +34,23 @@ namespace Amadeus
 			XMFLOAT2 texCoord0;
 			// Note: This implementation does not currently support glTF 2's Color0 and TexCoord1 attributes.
 		};
+		static_assert(sizeof(Vertex) == sizeof(VertexDecoder::Vertex)
+			&& offsetof(Vertex, normal) == offsetof(VertexDecoder::Vertex, normal)
+			&& offsetof(Vertex, tangent) == offsetof(VertexDecoder::Vertex, tangent)
+			&& offsetof(Vertex, texCoord0) == offsetof(VertexDecoder::Vertex, texCoord0),
+			"VertexDecoder and VertexPacking work on Primitive::Vertex directly");
 
 		struct PrimitiveConstantBuffer
 		{
 			XMFLOAT4X4 model;
-			float padding[48];
+			// Dequantization of packed vertices, identity for float vertices.
+			XMFLOAT3 positionScale;
+			UINT bQuantized;
+			XMFLOAT3 positionOffset;
+			float padding0;
+			XMFLOAT2 texCoordScale;
+			XMFLOAT2 texCoordOffset;
+			float padding[36];
 		};
 		static_assert((sizeof(PrimitiveConstantBuffer) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
 
@@ -45,32 +65,61 @@ namespace Amadeus
 			INT material = -1,
 			bool normalsProvided = true, 
 			bool tangentsProvided = true, 
-			D3D12_PRIMITIVE_TOPOLOGY mode = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			D3D12_PRIMITIVE_TOPOLOGY mode = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
+			DerivedDataCache* cache = nullptr);
+
+		// A primitive cooked into a package, its buffers are uploaded as they are. They are read until
+		// Upload, which is the last time they have to be valid.
+		Primitive(
+			const ScenePackage::PrimitiveRecord& record,
+			std::span<const UINT8> vertices,
+			std::span<const UINT8> indices,
+			std::span<const MeshletBuilder::Meshlet> meshlets,
+			XMMATRIX modelMatrix);
 		~Primitive() = default;
 
-		bool Upload(
-			SharedPtr<DeviceResources> device, 
-			ID3D12Resource* verticesUploadHeap, 
-			ID3D12Resource* indicesUploadHeap, 
-			ID3D12GraphicsCommandList* commandList);
+		// Records the copies of the vertices and indices, they land once the uploader is flushed.
+		bool Upload(SharedPtr<DeviceResources> device, Uploader& uploader);
+
+		// Puts the buffers as Upload would copy them into the slot of the package.
+		void Cook(ScenePackage::Writer& writer, size_t index) const;
+
+		// Picks the index ranges Render draws this frame. Without meshlets everything is drawn.
+		void Cull(const ClusterCuller::View& view, ClusterCuller::Statistics& statistics);
 
-		void RenderShadow(SharedPtr<DeviceResources> device, 
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// Every index, for the depth-only passes. The material is bound by the caller for the other passes.
+		void DrawDepth(ID3D12GraphicsCommandList* commandList);
 
-		void Render(SharedPtr<DeviceResources> device, 
-			SharedPtr<DescriptorCache> descriptorCache, ID3D12GraphicsCommandList* commandList);
+		// The index ranges left by Cull.
+		void Draw(ID3D12GraphicsCommandList* commandList);
 
 		void Destroy();
 
-		void SetModelMatrix(XMFLOAT4X4 model) { mPrimitiveConstantBuffer.model = model; }
+		// Takes the transposed model matrix, like the constant buffer, and moves the bounds with it.
+		void SetModelMatrix(XMFLOAT4X4 model);
+
+		// Whether the bounds moved since the last call, MeshManager refits the scene for the ones that did.
+		bool ConsumeBoundaryChanged() { return std::exchange(bBoundaryChanged, false); }
+
+		// Nearest hit of a world-space ray with the triangles, closer than distance, which it then shortens.
+		bool Raycast(const float origin[3], const float direction[3], float& distance) const;
 
 		void SetMaterial();
 
 		Material* GetMaterial() const;
 
-		UINT GetVertexDataSize() { return static_cast<UINT>(mVertices.size() * sizeof(Vertex)); }
+		INT GetMaterialId() const { return mMaterialId; }
+
+		// Packed or float vertices, chosen by EngineVar::Vertex_Quantize.
+		static D3D12_INPUT_LAYOUT_DESC GetInputLayout();
 
-		UINT GetIndexDataSize() { return static_cast<UINT>(mIndices.size() * sizeof(UINT)); }
+		UINT GetVertexStride() const;
+
+		UINT GetVertexDataSize() const { return static_cast<UINT>(mVertices.size() * GetVertexStride()); }
+
+		UINT GetIndexDataSize() const { return static_cast<UINT>(mIndices.size() * GetIndexSize()); }
+
+		UINT GetIndexSize() const { return VertexPacking::FitsUInt16Indices(mVertices.size()) ? sizeof(UINT16) : sizeof(UINT32); }
 
 		const D3D12_VERTEX_BUFFER_VIEW* GetVertexBufferView() const { return &mVertexBufferView; }
 
@@ -82,18 +131,35 @@ namespace Amadeus
 
 		D3D12_CONSTANT_BUFFER_VIEW_DESC GetCbvDesc(SharedPtr<DeviceResources> device);
 
+		// World-space bounds, tight around the transformed bounds of the vertices.
 		const Boundary& GetBoundary() { return mBoundary; }
 
+		// Written by MeshManager::Cull, a primitive is visible until it has been culled once.
+		void SetVisible(CullView view, bool visible) { bVisible[static_cast<int>(view)] = visible; }
+
+		bool IsVisible(CullView view) const { return bVisible[static_cast<int>(view)]; }
+
 		bool IsTransparent();
 
+		// Empty unless EngineVar::Mesh_Optimize was set when the primitive was created.
+		const MeshOptimizer::Report& GetOptimizationReport() const { return mOptimizationReport; }
+
+		// Empty unless EngineVar::Meshlet_Cull was set when the primitive was created.
+		const Vector<MeshletBuilder::Meshlet>& GetMeshlets() const { return mMeshlets; }
+
 	private:
 		typedef D3D12_PRIMITIVE_TOPOLOGY PrimitiveMode;
 		PrimitiveMode mMode;
 
 		INT mMaterialId;
-		Material* mMaterial;
+		Material* mMaterial = nullptr;
 
+		bool bQuantized;
+		VertexPacking::Quantization mQuantization;
 		Vector<Vertex> mVertices;
+		// Final buffers of a cooked primitive until they are uploaded.
+		std::span<const UINT8> mCookedVertices;
+		std::span<const UINT8> mCookedIndices;
 		ComPtr<ID3D12Resource> mVertexBuffer;
 		D3D12_VERTEX_BUFFER_VIEW mVertexBufferView;
 
@@ -109,17 +175,47 @@ namespace Amadeus
 		UINT mNumIndices;
 
 		Boundary mBoundary;
+		bool bBoundaryChanged = false;
+
+		bool bVisible[static_cast<int>(CullView::Count)] = { true, true };
+
+		MeshOptimizer::Report mOptimizationReport;
+
+		Vector<MeshletBuilder::Meshlet> mMeshlets;
+		Vector<ClusterCuller::DrawRange> mDrawRanges;
+
+		// The constants, the material and the bounds, once the vertices are final.
+		void Initialize(XMMATRIX modelMatrix);
 
 		void StatBoundary();
 
+		// Generates what was not provided, then optimizes and splits into meshlets as the settings ask.
+		void Derive(bool normalsProvided, bool tangentsProvided);
+
+		// The vertices and indices as imported and every setting Derive reads.
+		UINT64 GetDerivedDataKey(bool normalsProvided, bool tangentsProvided) const;
+
+		void SaveDerivedData(Vector<UINT8>& data) const;
+
+		// False for data that does not describe a valid primitive.
+		bool LoadDerivedData(const Vector<UINT8>& data);
+
+		void Optimize();
+
+		void BuildMeshlets();
+
 		void ComputeTriangleNormals();
 
 		void ComputeTriangleTangents();
 
-		void UploadVertices(SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList);
+		// The vertex buffer as it is uploaded, packed into storage unless it can be returned as it is.
+		std::span<const UINT8> GetVertexData(Vector<UINT8>& storage) const;
+
+		// The index buffer as it is uploaded, narrowed into storage unless it can be returned as it is.
+		std::span<const UINT8> GetIndexData(Vector<UINT8>& storage) const;
 
-		void UploadIndices(SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList);
+		void UploadVertices(SharedPtr<DeviceResources> device, Uploader& uploader);
 
-		void UploadMaterial(SharedPtr<DeviceResources> device);
+		void UploadIndices(SharedPtr<DeviceResources> device, Uploader& uploader);
 	};
 }
\ No newline at end of file
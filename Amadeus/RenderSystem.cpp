@@ -6,6 +6,7 @@ namespace Amadeus
 	RenderSystem::RenderSystem(SharedPtr<DeviceResources> device, size_t jobs)
 		: mRenderThread(1, L"RenderThread")
 		, mJobSystem(jobs, L"JobThread")
+		, mUploader(device)
 		, mJobs(jobs)
 	{
 	}
@@ -15,12 +16,24 @@ namespace Amadeus
 		device->Present();
 	}
 
+	void RenderSystem::Flush(SharedPtr<DeviceResources> device)
+	{
+		const UINT64 fenceValue = mUploader.Flush();
+		if (fenceValue == mUploadFenceValue)
+			return;
+
+		mUploadFenceValue = fenceValue;
+		mUploader.Wait(device->GetCommandQueue());
+	}
+
 	void RenderSystem::Upload(SharedPtr<DeviceResources> device)
 	{
+		Flush(device);
 		device->WaitForGpu();
 	}
 
 	void RenderSystem::Destroy()
 	{
+		mUploader.Destroy();
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Prerequisites.h"
+#include "Common/Uploader.h"
 
 namespace Amadeus
 {
@@ -18,15 +19,25 @@ namespace Amadeus
 
 		void Render(SharedPtr<DeviceResources> device);
 
+		// Submits the copies recorded so far, the direct queue waits for them on the gpu.
+		void Flush(SharedPtr<DeviceResources> device);
+
+		// Flushes and blocks until the direct queue is done with everything submitted so far.
 		void Upload(SharedPtr<DeviceResources> device);
 
 		void Destroy();
 
 		size_t GetJobs() { return mJobs; }
 
+		JobSystem& GetJobSystem() { return mJobSystem; }
+
+		Uploader& GetUploader() { return mUploader; }
+
 	private:
 		ThreadPool mRenderThread;
-		ThreadPool mJobSystem;
+		JobSystem mJobSystem;
+		Uploader mUploader;
+		UINT64 mUploadFenceValue = 0;
 
 		size_t mJobs;
 	};
@@ -41,6 +52,6 @@ namespace Amadeus
 	template<class F, class ...Args>
 	inline auto RenderSystem::Submit(F&& f, Args && ...args) -> Future<typename std::invoke_result<F, Args ...>::type>
 	{
-		return mJobSystem.enqueue(std::forward<F>(f), std::forward<Args>(args)...);
+		return mJobSystem.Enqueue(std::forward<F>(f), std::forward<Args>(args)...);
 	}
 }
\ No newline at end of file
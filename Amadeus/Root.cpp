@@ -5,9 +5,14 @@
 #include "RenderSystem.h"
 #include "ResourceManagers.h"
 #include "GltfLoader.h"
+#include "Common/LoadPipeline.h"
+#include "Common/DerivedDataCache.h"
 
 namespace Amadeus
 {
+	// Loaded textures and primitives joined to the scene per frame, a texture waits for its mips.
+	static const size_t LOAD_COMMITS_PER_FRAME = 8;
+
 	Root::Root(const wchar_t* title, unsigned int width, unsigned int height, HWND hwnd)
 		: mTitle(title)
 		, mWidth(width)
@@ -27,13 +32,39 @@ namespace Amadeus
 
 	void Root::Init()
 	{
+		QueryPerformanceCounter(&mLoadStart);
+
 		GetDeviceResources();
+
+		// Unbounded texture tables need resource binding tier 2.
+		D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+		if (FAILED(mDeviceResources->GetD3DDevice()->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)))
+			|| options.ResourceBindingTier < D3D12_RESOURCE_BINDING_TIER_2)
+		{
+			EngineVar::Bindless_Materials = false;
+		}
+
 		mDescriptorManager.reset(new DescriptorManager(mDeviceResources));
+		MaterialManager::Instance().GetDefaultMaterial()->SetSampler(
+			DEFAULT_SAMPLER_SLOT, mDescriptorManager->GetSamplerTable(DEFAULT_SAMPLER_SLOT));
 		mDescriptorCache.reset(new DescriptorCache(mDeviceResources));
 
 		size_t jobs = max(std::thread::hardware_concurrency() - 1, 0);
 		mRenderer.reset(new RenderSystem(mDeviceResources, jobs));
 
+		// Worker threads pick the decode and upload tasks up between the jobs of the frames.
+		mLoadPipeline.reset(new LoadPipeline([this](std::function<void()> task)
+		{
+			JobSystem& jobSystem = mRenderer->GetJobSystem();
+			jobSystem.RunBackground(jobSystem.CreateJob(std::move(task)));
+		}));
+
+		if (EngineVar::DerivedData_Cache)
+		{
+			mDerivedDataCache.reset(new DerivedDataCache(GetAssetFullPath(L"DerivedDataCache"),
+				static_cast<UINT64>(EngineVar::DerivedData_CacheMegabytes) << 20));
+		}
+
 		ProgramManager& programManager = ProgramManager::Instance();
 		programManager.Init();
 
@@ -66,6 +97,10 @@ namespace Amadeus
 	void Root::PreRender()
 	{
 		mStepTimer->Tick([]() {});
+
+		// Textures and primitives that finished loading join the scene before the frame records.
+		mLoadPipeline->Poll(LOAD_COMMITS_PER_FRAME);
+
 		CameraManager::Instance().PreRender(mStepTimer->GetElapsedSeconds());
 		LightManager::Instance().PreRender(mStepTimer->GetElapsedSeconds());
 	}
@@ -74,8 +109,7 @@ namespace Amadeus
 	{
 		CameraManager::Instance().Render();
 		LightManager::Instance().Render();
-
-		mFrameGraph->Setup();
+		MeshManager::Instance().Cull(CameraManager::Instance().GetDefaultCamera(), LightManager::Instance().GetSunLight());
 
 		mFrameGraph->Compile(mDeviceResources, mDescriptorCache);
 
@@ -87,10 +121,59 @@ namespace Amadeus
 		mDescriptorCache->Reset(mDeviceResources);
 		CameraManager::Instance().PostRender();
 		LightManager::Instance().PostRender();
+
+		if (!bFirstFrameReported || (!bFullQualityReported && mLoadPipeline->Idle()))
+		{
+			LARGE_INTEGER now;
+			LARGE_INTEGER frequency;
+			QueryPerformanceCounter(&now);
+			QueryPerformanceFrequency(&frequency);
+			const double seconds = static_cast<double>(now.QuadPart - mLoadStart.QuadPart) / frequency.QuadPart;
+
+			char message[160];
+			if (!bFirstFrameReported)
+			{
+				bFirstFrameReported = true;
+				if (sprintf_s(message, "Loader: first frame after %.3f s\n", seconds) > 0)
+					OutputDebugStringA(message);
+			}
+			// The last commits ran in this frame's PreRender.
+			if (!bFullQualityReported && mLoadPipeline->Idle())
+			{
+				bFullQualityReported = true;
+				if (sprintf_s(message, "Loader: full quality after %.3f s, %zu primitives and %zu textures\n", seconds,
+					mLoadPipeline->GetCompleted(LoadPipeline::Stage::DecodeGeometry),
+					mLoadPipeline->GetCompleted(LoadPipeline::Stage::DecodeTexture)) > 0)
+				{
+					OutputDebugStringA(message);
+				}
+
+				// Totals of the load, the uploader keeps counting afterwards.
+				const Uploader::Statistics uploads = mRenderer->GetUploader().GetStatistics();
+				if (sprintf_s(message, "Uploader: %llu copies, %llu bytes in %llu batches, %llu stalls, %llu dedicated\n",
+					uploads.uploads, uploads.bytes, uploads.batches, uploads.stalls, uploads.dedicated) > 0)
+				{
+					OutputDebugStringA(message);
+				}
+
+				if (mDerivedDataCache)
+				{
+					const auto statistics = mDerivedDataCache->GetStatistics();
+					if (sprintf_s(message, "Derived data cache: %llu hits, %llu misses, %.3f s saved, %.1f MB read, %.1f MB written\n",
+						statistics.hits, statistics.misses, statistics.secondsSaved,
+						statistics.bytesRead / 1048576.0, statistics.bytesWritten / 1048576.0) > 0)
+					{
+						OutputDebugStringA(message);
+					}
+				}
+			}
+		}
 	}
 
 	void Root::Destroy()
 	{
+		// Tasks still on the workers finish before the renderer goes, the rest are dropped.
+		mLoadPipeline->Cancel();
 		mRenderer->Destroy();
 		mDeviceResources->WaitForGpu();
 		mFrameGraph->Destroy();
@@ -153,6 +236,13 @@ namespace Amadeus
 		params.x = x;
 		params.y = y;
 
+		if ((button & 0x01) && mWidth > 0 && mHeight > 0)
+		{
+			const float ndcX = 2.0f * x / mWidth - 1.0f;
+			const float ndcY = 1.0f - 2.0f * y / mHeight;
+			MeshManager::Instance().Pick(CameraManager::Instance().GetDefaultCamera(), ndcX, ndcY);
+		}
+
 		Subject<MouseButtonDown>* mouseButtonDown = Registry::instance().query<MouseButtonDown>("MouseButtonDown");
 		if (mouseButtonDown)
 		{
@@ -179,12 +269,22 @@ namespace Amadeus
 		LightManager& lightMananger = LightManager::Instance();
 		lightMananger.Init();
 
-		Gltf::LoadGltf(L"DamagedHelmet", mDeviceResources, mDescriptorManager);
+		Gltf::LoadGltf(L"DamagedHelmet", mDeviceResources, mDescriptorManager, mDescriptorCache, mRenderer, mDerivedDataCache, *mLoadPipeline);
 
-		TextureManager::Instance().LoadFromFile(EngineVar::TEXTURE_WHITE_ID, TextureType::DEFAULT, mDeviceResources, mDescriptorManager);
-		TextureManager::Instance().LoadFromFile(EngineVar::TEXTURE_BLACK_ID, TextureType::DEFAULT, mDeviceResources, mDescriptorManager);
-		TextureManager::Instance().LoadFromFile(EngineVar::CUBEMAP_ENNIS_ID, TextureType::CUBE_MAP, mDeviceResources, mDescriptorManager);
-		TextureManager::Instance().LoadFromFile(EngineVar::TEXTURE_BRDF_LUT_ID, TextureType::DEFAULT, mDeviceResources, mDescriptorManager);
+		// The textures of the file take the first ids and the camera is placed from the bounds the parse
+		// reads, so only the parse is waited for. Its textures and primitives load while frames render.
+		while (mLoadPipeline->GetPending(LoadPipeline::Stage::Parse) > 0)
+		{
+			if (mLoadPipeline->Poll(1) == 0)
+				std::this_thread::yield();
+		}
+
+		TextureManager::Instance().LoadFromFiles({
+			{ EngineVar::TEXTURE_WHITE_ID, TextureType::DEFAULT },
+			{ EngineVar::TEXTURE_BLACK_ID, TextureType::DEFAULT },
+			{ EngineVar::CUBEMAP_ENNIS_ID, TextureType::CUBE_MAP },
+			{ EngineVar::TEXTURE_BRDF_LUT_ID, TextureType::DEFAULT },
+		}, mDeviceResources, mDescriptorManager, mRenderer);
 
 		MeshManager& meshManager = MeshManager::Instance();
 		meshManager.Init();
@@ -204,6 +304,8 @@ namespace Amadeus
 		TextureManager::Instance().UploadAll(mDeviceResources, mRenderer);
 
 		MeshManager::Instance().UploadAll(mDeviceResources, mRenderer);
+
+		MaterialManager::Instance().UploadAll(mDeviceResources, mDescriptorCache);
 	}
 
 	void Root::PreCompute()
@@ -9,6 +9,8 @@ namespace Amadeus
 	class DescriptorCache;
 	class FrameGraph;
 	class RenderSystem;
+	class LoadPipeline;
+	class DerivedDataCache;
 
 	class _AmadeusExport Root
 	{
@@ -54,5 +56,13 @@ namespace Amadeus
 		std::unique_ptr<FrameGraph> mFrameGraph;
 
 		std::unique_ptr<StepTimer> mStepTimer;
+
+		// Streams the scene in while frames render, its commits run in PreRender.
+		std::unique_ptr<LoadPipeline> mLoadPipeline;
+
+		std::shared_ptr<DerivedDataCache> mDerivedDataCache;
+		LARGE_INTEGER mLoadStart = {};
+		bool bFirstFrameReported = false;
+		bool bFullQualityReported = false;
 	};
 }
\ No newline at end of file
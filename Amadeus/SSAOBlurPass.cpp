@@ -36,21 +36,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
 	}
 
 	bool SSAOBlurPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -88,13 +74,13 @@ namespace Amadeus
 		UINT curFrameIndex = device->GetCurrentFrameIndex();
 		auto& commandList = mCommandLists[curFrameIndex];
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = mSSAOBlur->GetWriteView(commandList.Get());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = mSSAOBlur->GetWriteView();
 		commandList->ClearRenderTargetView(rtvHandle, BackgroundColor, 0, nullptr);
 
 		commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
 
 		commandList->SetGraphicsRootDescriptorTable(
-			SSAO_SHADER_RESOURCE_SSAO_INDEX, mSSAO->GetReadView(commandList.Get()));
+			SSAO_SHADER_RESOURCE_SSAO_INDEX, mSSAO->GetReadView());
 
 		commandList->IASetVertexBuffers(0, 0, nullptr);
 		commandList->IASetIndexBuffer(nullptr);
@@ -102,8 +88,6 @@ namespace Amadeus
 		commandList->DrawInstanced(6, 1, 0, 0);
 
 		ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
-		ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get() };
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
 
 		return true;
 	}
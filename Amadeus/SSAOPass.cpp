@@ -37,21 +37,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
     }
 
     bool SSAOPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -190,7 +176,7 @@ namespace Amadeus
 		UINT curFrameIndex = device->GetCurrentFrameIndex();
 		auto& commandList = mCommandLists[curFrameIndex];
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = mSSAO->GetWriteView(commandList.Get());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = mSSAO->GetWriteView();
 		commandList->ClearRenderTargetView(rtvHandle, BackgroundColor, 0, nullptr);
 
 		commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
@@ -198,9 +184,9 @@ namespace Amadeus
         commandList->SetGraphicsRootConstantBufferView(
             SSAO_CONSTANT_BUFFER_KERNEL_INDEX, mSSAOConstantBuffer->GetGPUVirtualAddress());
 		commandList->SetGraphicsRootDescriptorTable(
-            SSAO_SHADER_RESOURCE_POSITION_INDEX, mZPrePosition->GetReadView(commandList.Get()));
+            SSAO_SHADER_RESOURCE_POSITION_INDEX, mZPrePosition->GetReadView());
 		commandList->SetGraphicsRootDescriptorTable(
-            SSAO_SHADER_RESOURCE_NORMAL_INDEX, mZPreNormal->GetReadView(commandList.Get()));
+            SSAO_SHADER_RESOURCE_NORMAL_INDEX, mZPreNormal->GetReadView());
 
         D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
         srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -229,8 +215,6 @@ namespace Amadeus
         commandList->DrawInstanced(6, 1, 0, 0);
 
 		ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
-		ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get() };
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
 
         return true;
     }
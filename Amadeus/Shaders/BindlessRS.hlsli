@@ -0,0 +1,3 @@
+// Renderer_RootSig with the unbounded bindless texture table, for devices of resource binding tier 2.
+#define BINDLESS_MATERIALS
+#include "Common.hlsli"
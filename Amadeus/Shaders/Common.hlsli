@@ -1,4 +1,4 @@
-#define Renderer_RootSig \
+#define Renderer_RootSig_Tables \
     "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT), " \
     "CBV(b0), " \
     "CBV(b1), " \
@@ -9,6 +9,8 @@
     "DescriptorTable(SRV(t6, numDescriptors = 1), visibility = SHADER_VISIBILITY_PIXEL)," \
     "DescriptorTable(SRV(t7, numDescriptors = 2), visibility = SHADER_VISIBILITY_PIXEL)," \
     "DescriptorTable(Sampler(s0, numDescriptors = 1), visibility = SHADER_VISIBILITY_PIXEL)," \
+
+#define Renderer_RootSig_Samplers \
     "StaticSampler(s1, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s2, visibility = SHADER_VISIBILITY_PIXEL," \
         "addressU = TEXTURE_ADDRESS_CLAMP," \
@@ -16,9 +18,47 @@
         "addressW = TEXTURE_ADDRESS_CLAMP," \
         "comparisonFunc = COMPARISON_LESS_EQUAL," \
         "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)," \
-    "StaticSampler(s3, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)" \
+    "StaticSampler(s3, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)"
+
+// The unbounded table needs resource binding tier 2, only the bindless shaders declare it, see
+// EngineVar::Bindless_Materials.
+#ifdef BINDLESS_MATERIALS
+#define Renderer_RootSig \
+    Renderer_RootSig_Tables \
+    "DescriptorTable(SRV(t0, space = 1, numDescriptors = unbounded, flags = DESCRIPTORS_VOLATILE), visibility = SHADER_VISIBILITY_PIXEL)," \
+    Renderer_RootSig_Samplers
+#else
+#define Renderer_RootSig Renderer_RootSig_Tables Renderer_RootSig_Samplers
+#endif
 
 // Common (static) samplers
 SamplerState defaultSampler : register(s1);
 SamplerComparisonState shadowSampler : register(s2);
-SamplerState cubeMapSampler : register(s3);
\ No newline at end of file
+SamplerState cubeMapSampler : register(s3);
+
+#ifdef BINDLESS_MATERIALS
+// Every texture a bindless material can index, see DescriptorCache::GetBindlessTable.
+Texture2D<float4> bindlessTextures[] : register(t0, space1);
+#endif
+
+// Material::MATERIAL_TYPE_BINDLESS
+static const uint MATERIAL_TYPE_BINDLESS = 0x20;
+
+// Bindless materials carry the index of their texture, the others have it bound.
+float4 SampleMaterialTexture(Texture2D<float4> boundTexture, uint index, uint materialType, SamplerState samplerState, float2 uv)
+{
+#ifdef BINDLESS_MATERIALS
+    if (materialType & MATERIAL_TYPE_BINDLESS)
+        return bindlessTextures[index].Sample(samplerState, uv);
+#endif
+    return boundTexture.Sample(samplerState, uv);
+}
+
+// Inverse of VertexPacking::EncodeOctahedral.
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-direction.z);
+    direction.xy += direction.xy >= 0.0f ? -t : t;
+    return normalize(direction);
+}
\ No newline at end of file
@@ -21,6 +21,12 @@ cbuffer MaterialConstants : register(b2)
     float normalScale;
     float occlusionStrength;
     float3 emissiveFactor;
+    uint materialType;
+    uint baseColorIndex;
+    uint metallicRoughnessIndex;
+    uint occlusionIndex;
+    uint emissiveIndex;
+    uint normalIndex;
 };
 
 SamplerState modelSampler : register(s0);
@@ -144,11 +150,12 @@ GBuffer main(VSOutput input) : SV_TARGET
     float3 R = 2 * dot(V, N) * N - V;
     float NoV = max(dot(N, V), 0.0);
 
-    float3 albedo = baseColorFactor.rgb * baseColorTexture.Sample(defaultSampler, input.uv).rgb;
-    float metallic = metallicFactor * metallicRoughnessTexture.Sample(defaultSampler, input.uv).b;
-    float roughness = roughnessFactor * metallicRoughnessTexture.Sample(defaultSampler, input.uv).g;
-    float3 emissive = emissiveFactor * emissiveTexture.Sample(defaultSampler, input.uv).rgb;
-    float occlusion = occlusionStrength * occlusionTexture.Sample(defaultSampler, input.uv).r;
+    float4 metallicRoughnessSample = SampleMaterialTexture(metallicRoughnessTexture, metallicRoughnessIndex, materialType, defaultSampler, input.uv);
+    float3 albedo = baseColorFactor.rgb * SampleMaterialTexture(baseColorTexture, baseColorIndex, materialType, defaultSampler, input.uv).rgb;
+    float metallic = metallicFactor * metallicRoughnessSample.b;
+    float roughness = roughnessFactor * metallicRoughnessSample.g;
+    float3 emissive = emissiveFactor * SampleMaterialTexture(emissiveTexture, emissiveIndex, materialType, defaultSampler, input.uv).rgb;
+    float occlusion = occlusionStrength * SampleMaterialTexture(occlusionTexture, occlusionIndex, materialType, defaultSampler, input.uv).r;
 
     float3 F0 = float3(0.04, 0.04, 0.04);
     F0 = lerp(F0, albedo, metallic);
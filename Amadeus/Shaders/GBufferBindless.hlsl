@@ -0,0 +1,3 @@
+// GBuffer.hlsl reading bindless materials, compiled against BindlessRS.hlsli.
+#define BINDLESS_MATERIALS
+#include "GBuffer.hlsl"
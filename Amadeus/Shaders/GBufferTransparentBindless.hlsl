@@ -0,0 +1,3 @@
+// GBufferTransparent.hlsl reading bindless materials, compiled against BindlessRS.hlsli.
+#define BINDLESS_MATERIALS
+#include "GBufferTransparent.hlsl"
@@ -1,9 +1,11 @@
 #include "Common.hlsli"
 
+// Float vertices, or packed ones with a unorm position, the tangent handedness in position.w
+// and octahedral normal and tangent. See Primitive::GetInputLayout.
 struct VSInput
 {
-    float3 position : POSITION;
-    float3 normal : NORMAL;
+    float4 position : POSITION;
+    float4 normal : NORMAL;
     float4 tangent : TANGENT;
     float2 uv : TEXCOORD;
 };
@@ -48,6 +50,11 @@ cbuffer LightConstants : register(b1)
 cbuffer ModelConstants : register(b2)
 {
     float4x4 modelMatrix;
+    float3 positionScale;
+    uint bQuantized;
+    float3 positionOffset;
+    float2 texCoordScale;
+    float2 texCoordOffset;
 };
 
 [RootSignature(Renderer_RootSig)]
@@ -55,20 +62,24 @@ VSOutput main(VSInput input)
 {
     VSOutput output;
 
+    float3 position = input.position.xyz * positionScale + positionOffset;
+    float3 normal = bQuantized ? DecodeOctahedral(input.normal.xy) : input.normal.xyz;
+    float3 tangent = bQuantized ? DecodeOctahedral(input.tangent.xy) : input.tangent.xyz;
+
     float4x4 modelViewMatrix = mul(modelMatrix, cameraViewMatrix);
     float4x4 modelToShadow = mul(mul(modelMatrix, lightViewMatrix), lightProjectionMatrix);
     float4x4 modelToPrev = mul(modelMatrix, cameraPrevViewProjectionMatrix);
 
-    float4 posW = mul(float4(input.position, 1.0f), modelViewMatrix);
+    float4 posW = mul(float4(position, 1.0f), modelViewMatrix);
     output.positionW = posW.xyz;
     output.position = mul(posW, cameraProjectionMatrix);
     output.curCoord = mul(posW, cameraUnjitteredProjectionMatrix);
-    output.prevCoord = mul(float4(input.position, 1.0f), modelToPrev);
+    output.prevCoord = mul(float4(position, 1.0f), modelToPrev);
 
-    output.normal = mul(input.normal, (float3x3)modelMatrix);
-    output.tangent = mul(input.tangent.xyz, (float3x3)modelMatrix);
-    output.uv = input.uv;
-    output.shadowCoord = mul(float4(input.position, 1.0f), modelToShadow);
+    output.normal = mul(normal, (float3x3)modelMatrix);
+    output.tangent = mul(tangent, (float3x3)modelMatrix);
+    output.uv = input.uv * texCoordScale + texCoordOffset;
+    output.shadowCoord = mul(float4(position, 1.0f), modelToShadow);
 
 	return output;
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include "Common.hlsli"
 
+// Float vertices, or packed ones with a unorm position, the tangent handedness in position.w
+// and octahedral normal and tangent. See Primitive::GetInputLayout.
 struct VSInput
 {
-    float3 position : POSITION;
-    float3 normal : NORMAL;
+    float4 position : POSITION;
+    float4 normal : NORMAL;
     float4 tangent : TANGENT;
     float2 uv : TEXCOORD;
 };
@@ -28,6 +30,11 @@ cbuffer LightConstants : register(b1)
 cbuffer ModelConstants : register(b2)
 {
     float4x4 modelMatrix;
+    float3 positionScale;
+    uint bQuantized;
+    float3 positionOffset;
+    float2 texCoordScale;
+    float2 texCoordOffset;
 };
 
 [RootSignature(Renderer_RootSig)]
@@ -37,7 +44,8 @@ VSOutput main(VSInput input)
 
     float4x4 modelViewMatrix = mul(modelMatrix, viewMatrix);
     float4x4 modelViewProjectionMatrix = mul(modelViewMatrix, projectionMatrix);
-    output.position = mul(float4(input.position, 1.0f), modelViewProjectionMatrix);
+    float3 position = input.position.xyz * positionScale + positionOffset;
+    output.position = mul(float4(position, 1.0f), modelViewProjectionMatrix);
 
 	return output;
 }
\ No newline at end of file
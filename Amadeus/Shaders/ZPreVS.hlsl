@@ -1,9 +1,11 @@
 #include "Common.hlsli"
 
+// Float vertices, or packed ones with a unorm position, the tangent handedness in position.w
+// and octahedral normal and tangent. See Primitive::GetInputLayout.
 struct VSInput
 {
-    float3 position : POSITION;
-    float3 normal : NORMAL;
+    float4 position : POSITION;
+    float4 normal : NORMAL;
     float4 tangent : TANGENT;
     float2 uv : TEXCOORD;
 };
@@ -32,6 +34,11 @@ cbuffer CameraConstants : register(b0)
 cbuffer ModelConstants : register(b2)
 {
     float4x4 modelMatrix;
+    float3 positionScale;
+    uint bQuantized;
+    float3 positionOffset;
+    float2 texCoordScale;
+    float2 texCoordOffset;
 };
 
 [RootSignature(Renderer_RootSig)]
@@ -39,14 +46,17 @@ VSOutput main(VSInput input)
 {
     VSOutput output;
 
+    float3 position = input.position.xyz * positionScale + positionOffset;
+    float3 normal = bQuantized ? DecodeOctahedral(input.normal.xy) : input.normal.xyz;
+
     float4x4 modelViewMatrix = mul(modelMatrix, cameraViewMatrix);
 
-    float4 posW = mul(float4(input.position, 1.0f), modelViewMatrix);
+    float4 posW = mul(float4(position, 1.0f), modelViewMatrix);
     output.positionW = posW.xyz;
     output.position = mul(posW, cameraProjectionMatrix);
 
-    output.normal = mul(input.normal, (float3x3)modelViewMatrix);
-    output.uv = input.uv;
+    output.normal = mul(normal, (float3x3)modelViewMatrix);
+    output.uv = input.uv * texCoordScale + texCoordOffset;
 
     return output;
 }
\ No newline at end of file
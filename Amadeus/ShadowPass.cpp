@@ -17,16 +17,8 @@ namespace Amadeus
 			IID_PPV_ARGS(&mRootSignature)
 		));
 
-		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
-
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+		psoDesc.InputLayout = Primitive::GetInputLayout();
 		psoDesc.pRootSignature = mRootSignature.Get();
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(shaders.Get("ShadowMapVS.cso"));
 		psoDesc.PS = CD3DX12_SHADER_BYTECODE(shaders.Get("ShadowMapPS.cso"));
@@ -45,21 +37,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
 	}
 
 	bool ShadowPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -77,12 +55,13 @@ namespace Amadeus
 			"ShadowMap",
 			FrameGraphResourceType::DEPTH,
 			DXGI_FORMAT_D32_FLOAT,
-			fg, node);
+			fg, node,
+			mWidth, mHeight);
 	}
 
 	void ShadowPass::RegisterResource(SharedPtr<DeviceResources> device, SharedPtr<DescriptorCache> descriptorCache)
 	{
-		mShadowMap->RegisterResource(device, descriptorCache, mWidth, mHeight);
+		mShadowMap->RegisterResource(device, descriptorCache);
 	}
 
 	bool ShadowPass::Execute(SharedPtr<DeviceResources> device, 
@@ -90,7 +69,9 @@ namespace Amadeus
 	{
 		UINT curFrameIndex = device->GetCurrentFrameIndex();
 		auto& commandList = mCommandLists[curFrameIndex];
-		ThrowIfFailed(commandList->Reset(device->GetCommandAllocator(), mPipelineState.Get()));
+		ThrowIfFailed(mCommandAllocators[curFrameIndex]->Reset());
+		ThrowIfFailed(commandList->Reset(mCommandAllocators[curFrameIndex].Get(), mPipelineState.Get()));
+		RecordBarriers(commandList.Get());
 		commandList->SetGraphicsRootSignature(mRootSignature.Get());
 
 		ID3D12DescriptorHeap* ppHeaps[] = { descriptorCache->GetCbvSrvUavCache(device), descriptorManager->GetSamplerHeap() };
@@ -101,7 +82,7 @@ namespace Amadeus
 		commandList->RSSetViewports(1, &screenViewPort);
 		commandList->RSSetScissorRects(1, &scissorRect);
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = mShadowMap->GetWriteView(commandList.Get());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = mShadowMap->GetWriteView();
 		commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
 		commandList->OMSetRenderTargets(0, nullptr, FALSE, &dsvHandle);
@@ -119,8 +100,6 @@ namespace Amadeus
 		}
 
 		ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
-		ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get() };
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
 
 		return true;
 	}
@@ -37,21 +37,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
 	}
 
 	bool SkyboxPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -69,13 +55,15 @@ namespace Amadeus
 			"BaseColor",
 			FrameGraphResourceType::RENDER_TARGET,
 			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::RENDER_TARGET);
 
 		mDepth = builder.Read(
 			"ZPreDepth",
 			FrameGraphResourceType::DEPTH,
 			DXGI_FORMAT_D32_FLOAT,
-			fg, node);
+			fg, node,
+			FrameGraphResourceUsage::DEPTH_READ);
 
 		mSky = builder.Write(
 			"Sky",
@@ -102,8 +90,8 @@ namespace Amadeus
 				D3D12_RESOURCE_STATE_RENDER_TARGET);
 		commandList->ResourceBarrier(1, &Present2RenderTarget);
 
-		D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView = mBaseColor->GetWriteView(commandList.Get());
-		D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = mDepth->GetDepthStencilView(commandList.Get());;
+		D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView = mBaseColor->GetWriteView();
+		D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = mDepth->GetDepthStencilView();;
 		commandList->OMSetRenderTargets(1, &renderTargetView, false, &depthStencilView);
 
 		Texture* skybox = TextureManager::Instance().GetTexture(EngineVar::CUBEMAP_ENNIS_ID);
@@ -136,9 +124,6 @@ namespace Amadeus
 
 		ThrowIfFailed(commandList->Close());
 
-		ID3D12CommandList* ppCommandList[] = { commandList.Get() };
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
-
 		return true;
 	}
 
@@ -38,21 +38,7 @@ namespace Amadeus
 			&psoDesc,
 			IID_PPV_ARGS(&mPipelineState)));
 
-		for (UINT i = 0; i < FrameCount; ++i)
-		{
-			ComPtr<ID3D12GraphicsCommandList> commandList;
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				device->GetCommandAllocator(),
-				mPipelineState.Get(),
-				IID_PPV_ARGS(&commandList)));
-
-			mCommandLists.emplace_back(commandList);
-
-			ThrowIfFailed(commandList->Close());
-		}
+		CreateCommandLists(device);
 	}
 
 	bool TAAPass::PreCompute(SharedPtr<DeviceResources> device, ID3D12GraphicsCommandList* commandList)
@@ -134,20 +120,20 @@ namespace Amadeus
 		lastFrameSrvDesc.Texture2D.MostDetailedMip = 0;
 		lastFrameSrvHanle = descriptorCache->AppendSrvCache(device, mLastFrame.Get(), lastFrameSrvDesc);
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = mTAA->GetWriteView(commandList.Get());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = mTAA->GetWriteView();
 
 		commandList->ClearRenderTargetView(rtvHandle, BackgroundColor, 0, nullptr);
 
 		commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
 
 		commandList->SetGraphicsRootDescriptorTable(
-			TAA_SHADER_RESOURCE_CURR_FRAME_INDEX, mPresentFrame->GetReadView(commandList.Get()));
+			TAA_SHADER_RESOURCE_CURR_FRAME_INDEX, mPresentFrame->GetReadView());
 		commandList->SetGraphicsRootDescriptorTable(
 			TAA_SHADER_RESOURCE_PREV_FRAME_INDEX, lastFrameSrvHanle);
 		commandList->SetGraphicsRootDescriptorTable(
-			TAA_SHADER_RESOURCE_VELOCITY_INDEX, mVelocity->GetReadView(commandList.Get()));
+			TAA_SHADER_RESOURCE_VELOCITY_INDEX, mVelocity->GetReadView());
 		commandList->SetGraphicsRootDescriptorTable(
-			TAA_SHADER_RESOURCE_DEPTH_INDEX, mDepth->GetReadView(commandList.Get()));
+			TAA_SHADER_RESOURCE_DEPTH_INDEX, mDepth->GetReadView());
 
 		// TAA Render
 		TAARender params = {};
@@ -195,8 +181,6 @@ namespace Amadeus
 		commandList->ResourceBarrier(1, &CopyDest2ShaderResource);
 
 		ThrowIfFailed(mCommandLists[curFrameIndex]->Close());
-		ID3D12CommandList* ppCommandList[] = { mCommandLists[curFrameIndex].Get()};
-		device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandList);
 
 
 		bFirstFrame = false;
@@ -1,73 +1,77 @@
 #include "pch.h"
 #include "Texture.h"
+#include "Common/MipGenerator.h"
+#include "Common/MappedFile.h"
+#include "Common/Hash.h"
+#include "Common/BlockCompressor.h"
 
 namespace Amadeus
 {
-    Texture::Texture(WString&& fileName, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+    // Bumped whenever the decode, the cpu mips, the block encoder or the layout of the cached data changes.
+    static constexpr UINT32 DERIVED_DATA_VERSION = 2;
+
+    // Block rows of a level encoded by one job.
+    static constexpr uint32_t COMPRESS_BAND_ROWS = 8;
+
+    Texture::Texture(WString&& fileName, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+        DerivedDataCache* cache, JobSystem* jobs)
         : bFiltered(true)
         , mType(type)
         , mName(fileName)
+        , mDescriptorManager(descriptorManager)
     {
-        CreateFromFile(std::move(fileName));
+        LoadFromFile(std::move(fileName), cache, jobs);
 
-        if (mType == TextureType::BASE_COLOR && !mMetadata.IsCubemap() && mMetadata.mipLevels == 1)
-        {
-            bFiltered = false;
-            mMetadata.mipLevels = GetMipLevels();
-        }
+        Initialize(device, descriptorManager);
+    }
 
-        // Ƿ֧ԶMipmaps
-        ResourceUploadBatch upload(device->GetD3DDevice());
-        if (!upload.IsSupportedForGenerateMips(mMetadata.format))
+    Texture::Texture(std::span<const UINT8> image, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+        DerivedDataCache* cache, JobSystem* jobs)
+        : bFiltered(true)
+        , mType(type)
+        , mDescriptorManager(descriptorManager)
+    {
+        LoadFromMemory(image, cache, jobs);
+
+        Initialize(device, descriptorManager);
+    }
+
+    Texture::Texture(const ScenePackage& package, const ScenePackage::TextureRecord& record, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+        : bFiltered(true)
+        , mType(static_cast<TextureType>(record.type))
+        , mName(String2WString(String(package.GetName(record))))
+        , mDescriptorManager(descriptorManager)
+    {
+        if (record.type >= static_cast<UINT32>(TextureType::NUM_TEXTURE_TYPE) || record.subresourceCount == 0)
         {
-            bFiltered = true;
-            mMetadata.mipLevels = 1;
+            throw RuntimeError("Texture::Texture Error");
         }
 
-        D3D12_RESOURCE_DESC textureDesc = {};
-        textureDesc.MipLevels = mMetadata.mipLevels;
-        textureDesc.Format = mMetadata.format;
-        textureDesc.Width = mMetadata.width;
-        textureDesc.Height = mMetadata.height;
-        textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-        textureDesc.DepthOrArraySize = mMetadata.arraySize;
-        textureDesc.SampleDesc.Count = 1;
-        textureDesc.SampleDesc.Quality = 0;
-        textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-
-        const CD3DX12_HEAP_PROPERTIES defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-            &defaultHeapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&mTextureResource)));
-        NAME_D3D12_OBJECT(mTextureResource);
+        mMetadata.width = record.width;
+        mMetadata.height = record.height;
+        mMetadata.depth = 1;
+        mMetadata.arraySize = record.arraySize;
+        mMetadata.mipLevels = record.mipLevels;
+        mMetadata.format = static_cast<DXGI_FORMAT>(record.format);
+        mMetadata.dimension = TEX_DIMENSION_TEXTURE2D;
+        mMetadata.miscFlags = record.bCubemap ? TEX_MISC_TEXTURECUBE : 0;
 
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Format = mMetadata.format;
-        if (mMetadata.IsCubemap()) {
-            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-            srvDesc.TextureCube.MipLevels = mMetadata.mipLevels;
-        }
-        else {
-            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-            srvDesc.Texture2D.MipLevels = mMetadata.mipLevels;
+        for (const auto& subresource : package.GetSubresources(record))
+        {
+            D3D12_SUBRESOURCE_DATA data = {};
+            data.pData = package.GetBlob(subresource.data).data();
+            data.RowPitch = static_cast<LONG_PTR>(subresource.rowPitch);
+            data.SlicePitch = static_cast<LONG_PTR>(subresource.slicePitch);
+            mCookedSubresources.push_back(data);
         }
-        mHandle = descriptorManager->AllocateSrvHeap(device, mTextureResource.Get(), srvDesc);
 
-        LoadFromFile(std::move(fileName));
+        Initialize(device, descriptorManager);
     }
 
-    Texture::Texture(Vector<UINT8>&& image, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
-        : bFiltered(true)
-        , mType(type)
+    void Texture::Initialize(SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
     {
-        CreateFromMemory(std::move(image));
-
-        if (mType == TextureType::BASE_COLOR && !mMetadata.IsCubemap() && mMetadata.mipLevels == 1)
+        // A cached image already carries its cpu mips.
+        if (NeedsMips() && (!EngineVar::Texture_CpuMips || !GenerateMips()))
         {
             bFiltered = false;
             mMetadata.mipLevels = GetMipLevels();
@@ -75,7 +79,7 @@ namespace Amadeus
 
         // Ƿ֧ԶMipmaps
         ResourceUploadBatch upload(device->GetD3DDevice());
-        if (!upload.IsSupportedForGenerateMips(mMetadata.format))
+        if (!bFiltered && !upload.IsSupportedForGenerateMips(mMetadata.format))
         {
             bFiltered = true;
             mMetadata.mipLevels = 1;
@@ -97,7 +101,7 @@ namespace Amadeus
             &defaultHeapProperties,
             D3D12_HEAP_FLAG_NONE,
             &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&mTextureResource)));
         NAME_D3D12_OBJECT(mTextureResource);
@@ -114,53 +118,38 @@ namespace Amadeus
             srvDesc.Texture2D.MipLevels = mMetadata.mipLevels;
         }
         mHandle = descriptorManager->AllocateSrvHeap(device, mTextureResource.Get(), srvDesc);
-
-        LoadFromMemory(std::move(image));
     }
 
-    bool Texture::Upload(SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList)
+    bool Texture::Upload(SharedPtr<DeviceResources> device, Uploader& uploader)
     {
-        //commandList->Reset(device->GetCommandAllocator(), nullptr);
+        const auto subresources = GetSubresources(device);
+        uploader.UploadTexture(mTextureResource.Get(), 0, static_cast<UINT>(subresources.size()), subresources.data());
 
-        if (mMetadata.IsCubemap())
-        {
-            ThrowIfFailed(PrepareUpload(device->GetD3DDevice(), mImage.GetImages(), mImage.GetImageCount(), mMetadata, mSubresources));
-            UINT64 uploadBufferSize = GetRequiredIntermediateSize(mTextureResource.Get(), 0, static_cast<UINT>(mSubresources.size()));
-
-            const CD3DX12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+        // The cooked levels point into a package that is unmapped after the load.
+        mCookedSubresources.clear();
 
-            ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-                &uploadHeapProperties,
-                D3D12_HEAP_FLAG_NONE,
-                &resourceDesc,
-                D3D12_RESOURCE_STATE_GENERIC_READ,
-                nullptr,
-                IID_PPV_ARGS(&mUploadHeap)));
+        return true;
+    }
 
-            UpdateSubresources(commandList, mTextureResource.Get(), mUploadHeap.Get(), 0, 0, mSubresources.size(), mSubresources.data());
-        }
-        else
+    void Texture::Cook(SharedPtr<DeviceResources> device, ScenePackage::Writer& writer, size_t index, std::string_view name) const
+    {
+        const auto subresources = GetSubresources(device);
+        Vector<ScenePackage::Writer::Subresource> data;
+        for (const auto& subresource : subresources)
         {
-            const auto& images = mImage.GetImages();
-            D3D12_SUBRESOURCE_DATA textureData = {};
-            textureData.pData = mImage.GetPixels();
-            textureData.RowPitch = images->rowPitch;
-            textureData.SlicePitch = images->slicePitch;
-
-            UpdateSubresources<1>(commandList, mTextureResource.Get(), uploadHeap, 0, 0, 1, &textureData);
+            data.push_back({ subresource.pData, static_cast<UINT64>(subresource.RowPitch), static_cast<UINT64>(subresource.SlicePitch) });
         }
 
-        const CD3DX12_RESOURCE_BARRIER resourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            mTextureResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        commandList->ResourceBarrier(1, &resourceBarrier);
-
-        commandList->Close();
-
-        ID3D12CommandList* ppCommandLists[] = { commandList };
-        device->GetCommandQueue()->ExecuteCommandLists(1, ppCommandLists);
-
-        return true;
+        // Levels the gpu fills after the upload are not in the package either.
+        ScenePackage::TextureRecord record = {};
+        record.type = static_cast<UINT32>(mType);
+        record.format = static_cast<UINT32>(mMetadata.format);
+        record.width = static_cast<UINT32>(mMetadata.width);
+        record.height = static_cast<UINT32>(mMetadata.height);
+        record.arraySize = static_cast<UINT32>(mMetadata.arraySize);
+        record.mipLevels = static_cast<UINT32>(subresources.size() / mMetadata.arraySize);
+        record.bCubemap = mMetadata.IsCubemap();
+        writer.SetTexture(index, record, name, data);
     }
 
     bool Texture::PreCompute(ResourceUploadBatch& uploadBatch)
@@ -170,6 +159,8 @@ namespace Amadeus
 
         if (uploadBatch.IsSupportedForGenerateMips(mMetadata.format))
         {
+            // The copy queue left the texture in the common state.
+            uploadBatch.Transition(mTextureResource.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
             uploadBatch.GenerateMips(mTextureResource.Get());
         }
 
@@ -183,13 +174,9 @@ namespace Amadeus
 
     void Texture::Destroy()
     {
-        if (mMetadata.IsCubemap())
-        {
-            mUploadHeap->Release();
-            mSubresources.clear();
-        }
-
         mTextureResource->Release();
+
+        mDescriptorManager->FreeSrvHeap(mHandle);
     }
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE Texture::GetDescriptorHandle() 
@@ -198,54 +185,289 @@ namespace Amadeus
         return mHandle; 
     }
 
-    void Texture::CreateFromFile(WString&& fileName)
+    void Texture::LoadFromFile(WString&& fileName, DerivedDataCache* cache, JobSystem* jobs)
     {
         WString fullPath = GetAssetFullPath(L"..\\..\\Assets\\" + fileName);
         WString suffix = WString(fileName, fileName.find(L"."));
         std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::towupper);
 
         if (suffix == L".BMP" || suffix == L".PNG" || suffix == L".GIF" || suffix == L".TIFF" || suffix == L".JPEG" || suffix == L".JPG") {
-            ThrowIfFailed(GetMetadataFromWICFile(fullPath.c_str(), WIC_FLAGS_DEFAULT_SRGB, mMetadata));
+            // Mapped rather than handed to WIC by name, the cache keys on the bytes.
+            MappedFile file(fullPath);
+            LoadFromMemory(file.GetBytes(), cache, jobs);
+            return;
         }
         else if (suffix == L".DDS") {
-            ThrowIfFailed(GetMetadataFromDDSFile(fullPath.c_str(), DDS_FLAGS_NONE, mMetadata));
+            ThrowIfFailed(LoadFromDDSFile(fullPath.c_str(), DDS_FLAGS_NONE, nullptr, mImage));
         }
+
+        // The decoded image carries the metadata, the file is only read once.
+        mMetadata = mImage.GetMetadata();
     }
 
-    void Texture::CreateFromMemory(Vector<UINT8>&& image)
+    void Texture::LoadFromMemory(std::span<const UINT8> image, DerivedDataCache* cache, JobSystem* jobs)
     {
-        ThrowIfFailed(GetMetadataFromWICMemory(image.data(), image.size(), WIC_FLAGS_NONE, mMetadata));
+        if (!cache)
+        {
+            Derive(image, jobs);
+            return;
+        }
+
+        Vector<UINT8> data;
+        const UINT64 key = GetDerivedDataKey(image);
+        const bool bHit = cache->Fetch(key, data, [&](Vector<UINT8>& derived)
+        {
+            Derive(image, jobs);
+            SaveDerivedData(derived);
+        });
+        if (bHit && !LoadDerivedData(data))
+        {
+            cache->Remove(key);
+            Derive(image, jobs);
+        }
     }
 
-    void Texture::LoadFromFile(WString&& fileName)
+    void Texture::Derive(std::span<const UINT8> image, JobSystem* jobs)
     {
-        WString fullPath = GetAssetFullPath(L"..\\..\\Assets\\" + fileName);
-        WString suffix = WString(fileName, fileName.find(L"."));
-        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::towupper);
+        Decode(image);
+        if (NeedsMips() && EngineVar::Texture_CpuMips)
+        {
+            GenerateMips();
+        }
+        Compress(jobs);
+    }
 
-        if (suffix == L".BMP" || suffix == L".PNG" || suffix == L".GIF" || suffix == L".TIFF" || suffix == L".JPEG" || suffix == L".JPG") {
-            ThrowIfFailed(LoadFromWICFile(fullPath.c_str(), WIC_FLAGS_DEFAULT_SRGB, nullptr, mImage));
+    void Texture::Decode(std::span<const UINT8> image)
+    {
+        ThrowIfFailed(LoadFromWICMemory(image.data(), image.size(), WIC_FLAGS_DEFAULT_SRGB, nullptr, mImage));
+
+        mMetadata = mImage.GetMetadata();
+    }
+
+    UINT64 Texture::GetDerivedDataKey(std::span<const UINT8> image) const
+    {
+        const UINT32 settings[] = {
+            DERIVED_DATA_VERSION, static_cast<UINT32>(mType), EngineVar::Texture_CpuMips, EngineVar::Texture_KaiserMips,
+            EngineVar::Texture_Compress, EngineVar::Texture_CompressQuality };
+
+        // Salted so that no primitive shares a key with a texture.
+        UINT64 hash = HashBytes("Texture", 7);
+        hash = HashBytes(image.data(), image.size(), hash);
+        return HashBytes(settings, sizeof(settings), hash);
+    }
+
+    void Texture::SaveDerivedData(Vector<UINT8>& data) const
+    {
+        const TexMetadata& metadata = mImage.GetMetadata();
+        data.resize(sizeof(metadata) + mImage.GetPixelsSize());
+        memcpy(data.data(), &metadata, sizeof(metadata));
+        memcpy(data.data() + sizeof(metadata), mImage.GetPixels(), mImage.GetPixelsSize());
+    }
+
+    bool Texture::LoadDerivedData(const Vector<UINT8>& data)
+    {
+        TexMetadata metadata;
+        if (data.size() < sizeof(metadata))
+        {
+            return false;
         }
-        else if (suffix == L".DDS") {
-            ThrowIfFailed(LoadFromDDSFile(fullPath.c_str(), DDS_FLAGS_NONE, nullptr, mImage));
+        memcpy(&metadata, data.data(), sizeof(metadata));
+
+        // Only what a decode can produce, a single 2D image and its levels.
+        if (metadata.dimension != TEX_DIMENSION_TEXTURE2D || metadata.depth != 1 || metadata.arraySize != 1 || metadata.miscFlags != 0
+            || metadata.mipLevels == 0 || metadata.mipLevels > MipGenerator::GetLevelCount(static_cast<uint32_t>(metadata.width), static_cast<uint32_t>(metadata.height))
+            || metadata.width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || metadata.height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+        {
+            return false;
+        }
+
+        ScratchImage image;
+        if (FAILED(image.Initialize(metadata)) || image.GetPixelsSize() != data.size() - sizeof(metadata))
+        {
+            return false;
+        }
+        memcpy(image.GetPixels(), data.data() + sizeof(metadata), image.GetPixelsSize());
+
+        mImage = std::move(image);
+        mMetadata = mImage.GetMetadata();
+        return true;
+    }
+
+    bool Texture::NeedsMips() const
+    {
+        return mType == TextureType::BASE_COLOR && !mMetadata.IsCubemap() && mMetadata.mipLevels == 1;
+    }
+
+    Vector<D3D12_SUBRESOURCE_DATA> Texture::GetSubresources(SharedPtr<DeviceResources> device) const
+    {
+        if (!mCookedSubresources.empty())
+        {
+            return mCookedSubresources;
+        }
+
+        Vector<D3D12_SUBRESOURCE_DATA> subresources;
+        if (mMetadata.IsCubemap())
+        {
+            ThrowIfFailed(PrepareUpload(device->GetD3DDevice(), mImage.GetImages(), mImage.GetImageCount(), mMetadata, subresources));
         }
+        else
+        {
+            // The image holds every level unless the gpu fills them after the upload.
+            const size_t levels = (std::min)(mImage.GetMetadata().mipLevels, mMetadata.mipLevels);
+            subresources.resize(levels);
+            for (size_t level = 0; level < levels; ++level)
+            {
+                const auto* image = mImage.GetImage(level, 0, 0);
+                subresources[level].pData = image->pixels;
+                subresources[level].RowPitch = image->rowPitch;
+                subresources[level].SlicePitch = image->slicePitch;
+            }
+        }
+        return subresources;
     }
 
-    void Texture::LoadFromMemory(Vector<UINT8>&& image)
+    bool Texture::GenerateMips()
     {
-        ThrowIfFailed(LoadFromWICMemory(image.data(), image.size(), WIC_FLAGS_NONE, nullptr, mImage));
+        const DXGI_FORMAT format = mMetadata.format;
+        if (mImage.GetImageCount() == 0)
+            return false;
+        if (format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB &&
+            format != DXGI_FORMAT_B8G8R8A8_UNORM && format != DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+            return false;
+
+        ScratchImage chain;
+        ThrowIfFailed(chain.Initialize2D(format, mMetadata.width, mMetadata.height, 1, GetMipLevels()));
+
+        const auto* source = mImage.GetImage(0, 0, 0);
+        const auto* base = chain.GetImage(0, 0, 0);
+        for (size_t y = 0; y < source->height; ++y)
+        {
+            memcpy(base->pixels + y * base->rowPitch, source->pixels + y * source->rowPitch, source->width * 4);
+        }
+
+        // Each level is filtered from the one above, in the decode job rather than on the gpu.
+        const auto filter = EngineVar::Texture_KaiserMips ? MipGenerator::Filter::KAISER : MipGenerator::Filter::BOX;
+        for (size_t level = 1; level < chain.GetMetadata().mipLevels; ++level)
+        {
+            const auto* above = chain.GetImage(level - 1, 0, 0);
+            const auto* below = chain.GetImage(level, 0, 0);
+            MipGenerator::Downsample(
+                { static_cast<uint32_t>(above->width), static_cast<uint32_t>(above->height), above->rowPitch, above->pixels },
+                { static_cast<uint32_t>(below->width), static_cast<uint32_t>(below->height), below->rowPitch, below->pixels },
+                filter, IsSRGB(format));
+        }
+
+        mImage = std::move(chain);
+        mMetadata = mImage.GetMetadata();
+        return true;
     }
 
-    UINT16 Texture::GetMipLevels()
+    bool Texture::Compress(JobSystem* jobs)
     {
-        UINT16 mipLevels = 1;
-        size_t size = mMetadata.width;
-        while (size >> 1)
+        const DXGI_FORMAT format = mMetadata.format;
+        if (!EngineVar::Texture_Compress || NeedsMips() || mImage.GetImageCount() == 0 || mMetadata.IsCubemap() || mMetadata.arraySize != 1)
+            return false;
+        if (format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB &&
+            format != DXGI_FORMAT_B8G8R8A8_UNORM && format != DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+            return false;
+        // D3D12 takes block compressed textures only in whole blocks, the levels below may be smaller.
+        if (mMetadata.width % 4 != 0 || mMetadata.height % 4 != 0)
+            return false;
+
+        const auto quality = static_cast<BlockCompressor::Quality>((std::min)(EngineVar::Texture_CompressQuality, 2u));
+        const bool bSrgb = IsSRGB(format);
+        BlockCompressor::Format blockFormat;
+        DXGI_FORMAT compressedFormat;
+        switch (mType)
+        {
+        case TextureType::BASE_COLOR:
+        case TextureType::EMISSIVE:
+            // Color stays sRGB, the fast setting trades BC7 for BC1 or BC3 which encode several times faster.
+            if (quality != BlockCompressor::Quality::FAST)
+            {
+                blockFormat = BlockCompressor::Format::BC7;
+                compressedFormat = bSrgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+            }
+            else if (mImage.IsAlphaAllOpaque())
+            {
+                blockFormat = BlockCompressor::Format::BC1;
+                compressedFormat = bSrgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+            }
+            else
+            {
+                blockFormat = BlockCompressor::Format::BC3;
+                compressedFormat = bSrgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+            }
+            break;
+        case TextureType::NORMAL:
+            // Only x and y are kept, z is rebuilt from them where the normal is sampled.
+            blockFormat = BlockCompressor::Format::BC5;
+            compressedFormat = DXGI_FORMAT_BC5_UNORM;
+            break;
+        case TextureType::METALLIC_ROUGHNESS:
+            // Roughness and metallic in green and blue vary independently, occlusion may be packed into red.
+            blockFormat = BlockCompressor::Format::BC7;
+            compressedFormat = DXGI_FORMAT_BC7_UNORM;
+            break;
+        case TextureType::OCCLUSION:
+            blockFormat = BlockCompressor::Format::BC4;
+            compressedFormat = DXGI_FORMAT_BC4_UNORM;
+            break;
+        default:
+            return false;
+        }
+
+        ScratchImage blocks;
+        ThrowIfFailed(blocks.Initialize2D(compressedFormat, mMetadata.width, mMetadata.height, 1, mMetadata.mipLevels));
+
+        const bool bBgra = format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+        auto compressBand = [&](size_t level, uint32_t firstRow)
         {
-            size >>= 1;
-            mipLevels++;
+            const auto* source = mImage.GetImage(level, 0, 0);
+            const auto* destination = blocks.GetImage(level, 0, 0);
+            const uint32_t rows = BlockCompressor::GetBlockCount(static_cast<uint32_t>(source->height));
+            BlockCompressor::Compress(
+                { static_cast<uint32_t>(source->width), static_cast<uint32_t>(source->height), source->rowPitch, source->pixels, bBgra },
+                blockFormat, quality, firstRow, (std::min)(COMPRESS_BAND_ROWS, rows - firstRow),
+                destination->pixels + firstRow * destination->rowPitch, destination->rowPitch);
+        };
+
+        // Every block is encoded on its own, bands of block rows of all levels at once.
+#ifdef AMADEUS_CONCURRENCY
+        Job* root = jobs ? jobs->CreateJob([] {}) : nullptr;
+#endif // AMADEUS_CONCURRENCY
+        for (size_t level = 0; level < mMetadata.mipLevels; ++level)
+        {
+            const uint32_t rows = BlockCompressor::GetBlockCount(static_cast<uint32_t>(mImage.GetImage(level, 0, 0)->height));
+            for (uint32_t firstRow = 0; firstRow < rows; firstRow += COMPRESS_BAND_ROWS)
+            {
+#ifdef AMADEUS_CONCURRENCY
+                if (root)
+                {
+                    jobs->Run(jobs->CreateChildJob(root, [&compressBand, level, firstRow] { compressBand(level, firstRow); }));
+                    continue;
+                }
+#endif // AMADEUS_CONCURRENCY
+                compressBand(level, firstRow);
+            }
+        }
+#ifdef AMADEUS_CONCURRENCY
+        if (root)
+        {
+            jobs->Run(root);
+            jobs->Wait(root);
         }
-        return mipLevels;
+#endif // AMADEUS_CONCURRENCY
+
+        mImage = std::move(blocks);
+        mMetadata = mImage.GetMetadata();
+        return true;
+    }
+
+    UINT16 Texture::GetMipLevels()
+    {
+        return static_cast<UINT16>(MipGenerator::GetLevelCount(
+            static_cast<uint32_t>(mMetadata.width), static_cast<uint32_t>(mMetadata.height)));
     }
 
 }
\ No newline at end of file
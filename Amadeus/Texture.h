@@ -1,5 +1,8 @@
 #pragma once
 #include "Prerequisites.h"
+#include "Common/Uploader.h"
+#include "Common/ScenePackage.h"
+#include "Common/DerivedDataCache.h"
 
 namespace Amadeus
 {
@@ -9,19 +12,34 @@ namespace Amadeus
         CUBE_MAP,
         OTHER,
         DEFAULT,
+        // Material slots of an imported scene, each block compressed into the format that suits it.
+        NORMAL,
+        METALLIC_ROUGHNESS,
+        OCCLUSION,
+        EMISSIVE,
         NUM_TEXTURE_TYPE,
     };
 
 	class Texture
 	{
     public:
-        Texture(WString&& fileName, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
+        // With a cache the decoded image, its cpu mips and its blocks are looked up by the encoded bytes,
+        // DDS files are copied as they are and never cached. With jobs the blocks are encoded on them.
+        Texture(WString&& fileName, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+            DerivedDataCache* cache = nullptr, JobSystem* jobs = nullptr);
 
-        Texture(Vector<UINT8>&& image, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
+        Texture(std::span<const UINT8> image, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager,
+            DerivedDataCache* cache = nullptr, JobSystem* jobs = nullptr);
 
-        UINT64 GetUploadBufferSize() { return GetRequiredIntermediateSize(mTextureResource.Get(), 0, 1); }
+        // A texture cooked into a package, its levels are uploaded as they are and have to stay valid
+        // until Upload.
+        Texture(const ScenePackage& package, const ScenePackage::TextureRecord& record, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
 
-        bool Upload(SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList);
+        // Records the copy of the image, it lands once the uploader is flushed.
+        bool Upload(SharedPtr<DeviceResources> device, Uploader& uploader);
+
+        // Puts the levels Upload would copy into the slot of the package.
+        void Cook(SharedPtr<DeviceResources> device, ScenePackage::Writer& writer, size_t index, std::string_view name) const;
 
         bool PreCompute(ResourceUploadBatch& uploadBatch);
 
@@ -33,16 +51,44 @@ namespace Amadeus
 
         void SetFiltered(bool filtered) { bFiltered = filtered; }
 
+        bool IsFiltered() const { return bFiltered; }
+
         TextureType GetType() { return mType; }
 
 	private:
-        void CreateFromFile(WString&& fileName);
+        // Creates the resource and its view for the decoded image.
+        void Initialize(SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
+
+        void LoadFromFile(WString&& fileName, DerivedDataCache* cache, JobSystem* jobs);
+
+        void LoadFromMemory(std::span<const UINT8> image, DerivedDataCache* cache, JobSystem* jobs);
+
+        // Decodes the image, filters its cpu mips and compresses every level.
+        void Derive(std::span<const UINT8> image, JobSystem* jobs);
+
+        void Decode(std::span<const UINT8> image);
 
-        void CreateFromMemory(Vector<UINT8>&& image);
+        // The encoded bytes and every setting the decoded levels depend on.
+        UINT64 GetDerivedDataKey(std::span<const UINT8> image) const;
 
-        void LoadFromFile(WString&& fileName);
+        void SaveDerivedData(Vector<UINT8>& data) const;
 
-        void LoadFromMemory(Vector<UINT8>&& image);
+        // False for data that does not describe a valid image.
+        bool LoadDerivedData(const Vector<UINT8>& data);
+
+        // A single level base color, its chain is filtered on the cpu or the gpu.
+        bool NeedsMips() const;
+
+        // Every level of the image unless the gpu fills them after the upload.
+        Vector<D3D12_SUBRESOURCE_DATA> GetSubresources(SharedPtr<DeviceResources> device) const;
+
+        // Replaces the single level image with its full chain filtered on the cpu, false for formats it
+        // cannot filter, which are left to the gpu pass of PreCompute.
+        bool GenerateMips();
+
+        // Replaces the 8-bit levels with BlockCompressor blocks in the format of the slot, false for
+        // slots, formats and sizes it leaves uncompressed and for levels the gpu still has to fill.
+        bool Compress(JobSystem* jobs);
 
         UINT16 GetMipLevels();
 
@@ -50,15 +96,14 @@ namespace Amadeus
 
         TexMetadata mMetadata;
 		ScratchImage mImage;
+        // Levels of a cooked texture until they are uploaded.
+        Vector<D3D12_SUBRESOURCE_DATA> mCookedSubresources;
 
 		ComPtr<ID3D12Resource> mTextureResource;
 		CD3DX12_CPU_DESCRIPTOR_HANDLE mHandle;
+		SharedPtr<DescriptorManager> mDescriptorManager;
 
         bool bFiltered = true;
         WString mName;
-
-        // Cube Map
-        ComPtr<ID3D12Resource> mUploadHeap;
-        Vector<D3D12_SUBRESOURCE_DATA> mSubresources;
 	};
 }
\ No newline at end of file
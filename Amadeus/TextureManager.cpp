@@ -19,14 +19,96 @@ namespace Amadeus
 		return id;
 	}
 
-	bool TextureManager::Upload(
-		WString&& fileName, SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList)
+	void TextureManager::LoadFromFiles(Vector<Pair<WString, TextureType>>&& files, SharedPtr<DeviceResources> device,
+		SharedPtr<DescriptorManager> descriptorManager, SharedPtr<RenderSystem> renderer)
+	{
+#ifdef AMADEUS_CONCURRENCY
+		Vector<Future<Texture*>> results;
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			results.emplace_back(renderer->Submit([&files, &device, &descriptorManager, i]
+			{
+				return new Texture(WString(files[i].first), files[i].second, device, descriptorManager);
+			}));
+		}
+
+		// Every job is waited for before a failure leaves, they refer to the files.
+		Vector<Texture*> textures;
+		std::exception_ptr exception;
+		for (auto&& res : results)
+		{
+			try
+			{
+				textures.push_back(res.get());
+			}
+			catch (...)
+			{
+				if (!exception)
+					exception = std::current_exception();
+			}
+		}
+		if (exception)
+		{
+			for (auto texture : textures)
+			{
+				texture->Destroy();
+			}
+			std::rethrow_exception(exception);
+		}
+#endif // AMADEUS_CONCURRENCY
+
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+#ifdef AMADEUS_CONCURRENCY
+			Texture* texture = textures[i];
+#else
+			Texture* texture = new Texture(WString(files[i].first), files[i].second, device, descriptorManager);
+#endif // AMADEUS_CONCURRENCY
+
+			mTextureIndices.emplace_back(files[i].first);
+			if (!mTextureMap.emplace(files[i].first, texture).second)
+			{
+				texture->Destroy();
+			}
+		}
+	}
+
+	UINT64 TextureManager::LoadFromMemory(
+		WString&& name, std::span<const UINT8> image, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager)
+	{
+		UINT64 id = mTextureIndices.size();
+
+		auto textureIter = mTextureMap.find(name);
+
+		if (textureIter == mTextureMap.end())
+		{
+			mTextureMap[name] = new Texture(image, type, device, descriptorManager);
+			mTextureIndices.emplace_back(name);
+		}
+
+		return id;
+	}
+
+	UINT64 TextureManager::Reserve(const WString& name)
+	{
+		UINT64 id = mTextureIndices.size();
+		mTextureIndices.emplace_back(name);
+		return id;
+	}
+
+	void TextureManager::Add(const WString& name, Texture* texture)
+	{
+		assert(mTextureMap.find(name) == mTextureMap.end());
+		mTextureMap[name] = texture;
+	}
+
+	bool TextureManager::Upload(WString&& fileName, SharedPtr<DeviceResources> device, Uploader& uploader)
 	{
 		auto textureIter = mTextureMap.find(fileName);
 
 		if (textureIter != mTextureMap.end())
 		{
-			textureIter->second->Upload(device, uploadHeap, commandList);
+			textureIter->second->Upload(device, uploader);
 		}
 		else
 		{
@@ -36,15 +118,14 @@ namespace Amadeus
 		return true;
 	}
 
-	bool TextureManager::Upload(
-		UINT64 index, SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList)
+	bool TextureManager::Upload(UINT64 index, SharedPtr<DeviceResources> device, Uploader& uploader)
 	{
 		auto name = mTextureIndices.at(index);
 		auto textureIter = mTextureMap.find(name);
 
 		if (textureIter != mTextureMap.end())
 		{
-			textureIter->second->Upload(device, uploadHeap, commandList);
+			textureIter->second->Upload(device, uploader);
 		}
 		else
 		{
@@ -56,60 +137,18 @@ namespace Amadeus
 
 	void TextureManager::UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer)
 	{
-		Vector<ID3D12Resource*> uploadHeaps;
-		Vector<ID3D12GraphicsCommandList*> commandLists;
-		Vector<ID3D12CommandAllocator*> commandAllocators;
-
-		UINT64 size = mTextureMap.size();
-		for (int i = 0; i < size; ++i)
-		{
-			ID3D12CommandAllocator* commandAllocator = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandAllocator(
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				IID_PPV_ARGS(&commandAllocator)));
-
-			ID3D12GraphicsCommandList* commandList = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				commandAllocator,
-				nullptr,
-				IID_PPV_ARGS(&commandList)));
-
-			commandAllocators.emplace_back(commandAllocator);
-			commandLists.emplace_back(commandList);
-		}
-
-		const CD3DX12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		Uploader& uploader = renderer->GetUploader();
 
 		Vector<Future<bool>> results;
-		int i = 0;
 		for (auto& item : mTextureMap)
 		{
 			auto& texture = item.second;
-			CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(texture->GetUploadBufferSize());
-
-			ID3D12Resource* uploadHeap = {};
-
-			ThrowIfFailed(device->GetD3DDevice()->CreateCommittedResource(
-				&uploadHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&resourceDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&uploadHeap)));
-
-			uploadHeaps.emplace_back(uploadHeap);
 
 #ifdef AMADEUS_CONCURRENCY
-			results.emplace_back(renderer->Submit(&Texture::Upload, texture, device, uploadHeap, commandLists[i]));
+			results.emplace_back(renderer->Submit([=, &uploader] { return texture->Upload(device, uploader); }));
 #else
-			texture->Upload(device, uploadHeap, commandLists[i]);
+			texture->Upload(device, uploader);
 #endif // AMADEUS_CONCURRENCY
-			
-			++i;
 		}
 
 		for (auto&& res : results)
@@ -118,29 +157,17 @@ namespace Amadeus
 				throw RuntimeError("TextureManager::UploadAll Error");
 		}
 
-		renderer->Upload(device);
-
-		for (auto&& uploadHeap : uploadHeaps)
-		{
-			uploadHeap->Release();
-		}
-		uploadHeaps.clear();
-
-		for (auto&& commandAllocator : commandAllocators)
-		{
-			commandAllocator->Release();
-		}
-		commandAllocators.clear();
-
-		for (auto&& commandList : commandLists)
-		{
-			commandList->Release();
-		}
-		commandLists.clear();
+		renderer->Flush(device);
 	}
 
 	void TextureManager::PreCompute(SharedPtr<DeviceResources> device)
 	{
+		// Textures added while loading come one by one, most calls have nothing to do.
+		const bool bPending = std::any_of(mTextureMap.begin(), mTextureMap.end(),
+			[](const auto& item) { return !item.second->IsFiltered(); });
+		if (!bPending)
+			return;
+
 		ResourceUploadBatch upload(device->GetD3DDevice());
 
 		upload.Begin();
@@ -268,5 +295,10 @@ namespace Amadeus
 		return nullptr;
 	}
 
+	Texture* TextureManager::FindTexture(UINT64 index)
+	{
+		auto textureIter = mTextureMap.find(mTextureIndices.at(index));
 
+		return textureIter != mTextureMap.end() ? textureIter->second : nullptr;
+	}
 }
\ No newline at end of file
@@ -16,12 +16,27 @@ namespace Amadeus
 
 		UINT64 LoadFromFile(WString&& fileName, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
 
-		bool Upload(WString&& fileName, SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList);
+		// Decodes the files as jobs in parallel, their ids follow the order of the files.
+		void LoadFromFiles(Vector<Pair<WString, TextureType>>&& files, SharedPtr<DeviceResources> device,
+			SharedPtr<DescriptorManager> descriptorManager, SharedPtr<RenderSystem> renderer);
 
-		bool Upload(UINT64 index, SharedPtr<DeviceResources> device, ID3D12Resource* uploadHeap, ID3D12GraphicsCommandList* commandList);
+		// The image is decoded before this returns, name only identifies the texture.
+		UINT64 LoadFromMemory(WString&& name, std::span<const UINT8> image, TextureType type, SharedPtr<DeviceResources> device, SharedPtr<DescriptorManager> descriptorManager);
+
+		// Takes the next id for a texture loaded elsewhere and joined later with Add. Names may repeat,
+		// ids of one name share its texture.
+		UINT64 Reserve(const WString& name);
+
+		// Joins a texture of a reserved name once its copies are flushed, PreCompute fills its mips.
+		void Add(const WString& name, Texture* texture);
+
+		bool Upload(WString&& fileName, SharedPtr<DeviceResources> device, Uploader& uploader);
+
+		bool Upload(UINT64 index, SharedPtr<DeviceResources> device, Uploader& uploader);
 
 		void UploadAll(SharedPtr<DeviceResources> device, SharedPtr<RenderSystem> renderer);
 
+		// Generates the mips of the textures that have none yet, blocking until the gpu is done.
 		void PreCompute(SharedPtr<DeviceResources> device);
 
 		void Unload(WString&& fileName);
@@ -40,9 +55,12 @@ namespace Amadeus
 
 		Texture* GetTexture(UINT64 index);
 
+		// The texture of the id, or nullptr while it is reserved and not added yet.
+		Texture* FindTexture(UINT64 index);
+
 		bool Empty()
 		{
-			assert(mTextureIndices.size() == mTextureMap.size());
+			assert(mTextureIndices.size() >= mTextureMap.size());
 			return mTextureIndices.empty();
 		}
 
@@ -12,8 +12,15 @@
 #include <functional>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <deque>
 #include <condition_variable>
 #include <future>
+#include <span>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
 
 #include <windows.h>
 #include <wrl.h>
@@ -37,4 +44,5 @@
 #include "Common/RootSignature.h"
 #include "Common/DescriptorManager.h"
 #include "Common/DescriptorCache.h"
-#include "Common/ThreadPool.h"
\ No newline at end of file
+#include "Common/ThreadPool.h"
+#include "Common/JobSystem.h"
\ No newline at end of file
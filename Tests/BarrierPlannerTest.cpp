@@ -0,0 +1,223 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/BarrierPlanner.h"
+#include <random>
+
+using namespace Amadeus;
+
+using Type = BarrierPlanner::BarrierType;
+
+// State bits as D3D12 defines them.
+enum : uint32_t { RENDER_TARGET = 0x4, DEPTH_WRITE = 0x10, DEPTH_READ = 0x20, PIXEL_SHADER_RESOURCE = 0x80 };
+
+static size_t Count(const std::vector<BarrierPlanner::Barrier>& batch, Type type, uint32_t resource)
+{
+	return std::count_if(batch.begin(), batch.end(), [&](const BarrierPlanner::Barrier& barrier) {
+		return barrier.type == type && barrier.resource == resource;
+	});
+}
+
+// Replays the batches level by level for two frames, starting from the initial states: every
+// barrier starts from the state the resource is in, a split barrier ends before the resource is
+// touched, and every access finds the state it asked for.
+static bool Replay(uint32_t resourceCount, uint32_t levelCount,
+	const std::vector<BarrierPlanner::Access>& accesses, const BarrierPlanner::Result& result)
+{
+	if (result.batches.size() != levelCount || result.initialStates.size() != resourceCount)
+		return false;
+
+	std::vector<uint32_t> states = result.initialStates;
+	std::vector<bool> pending(resourceCount, false);
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		for (uint32_t level = 0; level < levelCount; ++level)
+		{
+			for (const auto& barrier : result.batches[level])
+			{
+				switch (barrier.type)
+				{
+				case Type::ALIASING:
+					break;
+				case Type::TRANSITION:
+					if (pending[barrier.resource] || states[barrier.resource] != barrier.before)
+						return false;
+					states[barrier.resource] = barrier.after;
+					break;
+				case Type::BEGIN_ONLY:
+					if (pending[barrier.resource] || states[barrier.resource] != barrier.before)
+						return false;
+					pending[barrier.resource] = true;
+					states[barrier.resource] = barrier.after;
+					break;
+				case Type::END_ONLY:
+					if (!pending[barrier.resource] || states[barrier.resource] != barrier.after)
+						return false;
+					pending[barrier.resource] = false;
+					break;
+				}
+			}
+			for (const auto& access : accesses)
+			{
+				if (access.level == level && (pending[access.resource] || (states[access.resource] & access.state) != access.state))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+// A transition with a level in between is split: begun on the level after the last access in
+// the old state, ended on the level of the first access in the new one.
+static void TestSplit()
+{
+	const std::vector<BarrierPlanner::Access> accesses = {
+		{ 0, 0, RENDER_TARGET, true }, { 0, 3, PIXEL_SHADER_RESOURCE, false },
+		{ 1, 0, RENDER_TARGET, true }, { 1, 1, PIXEL_SHADER_RESOURCE, false } };
+	const auto result = BarrierPlanner::Plan(2, 4, accesses);
+	CHECK(Replay(2, 4, accesses, result));
+
+	CHECK(Count(result.batches[1], Type::BEGIN_ONLY, 0) == 1);
+	CHECK(Count(result.batches[3], Type::END_ONLY, 0) == 1);
+	CHECK(Count(result.batches[2], Type::END_ONLY, 0) == 0);
+	// The only plain transition takes the resource back to where the frame starts.
+	CHECK(Count(result.batches[0], Type::TRANSITION, 0) == 1);
+	for (uint32_t level = 1; level < 4; ++level)
+		CHECK(Count(result.batches[level], Type::TRANSITION, 0) == 0);
+
+	// Nothing to overlap with on adjacent levels, a plain transition.
+	CHECK(Count(result.batches[1], Type::TRANSITION, 1) == 1);
+	for (const auto& batch : result.batches)
+	{
+		CHECK(Count(batch, Type::BEGIN_ONLY, 1) == 0);
+		CHECK(Count(batch, Type::END_ONLY, 1) == 0);
+	}
+}
+
+// Every resource takes over its memory on the level it is first touched, in the state of that
+// access, and a resource that ends the frame in another state goes back with a plain transition.
+static void TestAliasing()
+{
+	const std::vector<BarrierPlanner::Access> accesses = {
+		{ 0, 1, RENDER_TARGET, true }, { 0, 2, PIXEL_SHADER_RESOURCE, false },
+		{ 1, 2, DEPTH_WRITE, true }, { 1, 3, DEPTH_WRITE, true },
+		{ 2, 0, PIXEL_SHADER_RESOURCE, false } };
+	const auto result = BarrierPlanner::Plan(4, 4, accesses);
+	CHECK(Replay(4, 4, accesses, result));
+
+	const uint32_t firstLevels[] = { 1, 2, 0 };
+	const uint32_t firstStates[] = { RENDER_TARGET, DEPTH_WRITE, PIXEL_SHADER_RESOURCE };
+	for (uint32_t resource = 0; resource < 3; ++resource)
+	{
+		for (uint32_t level = 0; level < 4; ++level)
+			CHECK(Count(result.batches[level], Type::ALIASING, resource) == (level == firstLevels[resource] ? 1u : 0u));
+		for (const auto& barrier : result.batches[firstLevels[resource]])
+		{
+			if (barrier.type == Type::ALIASING && barrier.resource == resource)
+				CHECK(barrier.after == firstStates[resource]);
+		}
+	}
+
+	CHECK(result.initialStates[0] == PIXEL_SHADER_RESOURCE);
+	CHECK(Count(result.batches[1], Type::TRANSITION, 0) == 1);
+	// Written twice in the same state, no transition at all.
+	CHECK(result.initialStates[1] == DEPTH_WRITE);
+	CHECK(Count(result.batches[2], Type::TRANSITION, 1) == 0);
+	CHECK(Count(result.batches[3], Type::TRANSITION, 1) == 0);
+	// A resource nobody touches gets no barrier.
+	for (const auto& batch : result.batches)
+	{
+		for (const auto& barrier : batch)
+			CHECK(barrier.resource != 3);
+	}
+}
+
+// Consecutive reads share one combined state, the second read needs no barrier.
+static void TestCombinedReads()
+{
+	const std::vector<BarrierPlanner::Access> accesses = {
+		{ 0, 0, DEPTH_WRITE, true }, { 0, 1, PIXEL_SHADER_RESOURCE, false }, { 0, 2, DEPTH_READ, false }, { 0, 3, DEPTH_WRITE, true } };
+	const auto result = BarrierPlanner::Plan(1, 4, accesses);
+	CHECK(Replay(1, 4, accesses, result));
+	CHECK(result.batches[1].size() == 1);
+	CHECK(result.batches[1][0].after == (PIXEL_SHADER_RESOURCE | DEPTH_READ));
+	CHECK(result.batches[2].empty());
+	CHECK(result.batches[3].size() == 1);
+}
+
+// The default frame graph: one batch per level holding the barriers of all passes of that level,
+// and the plan holds up over two frames.
+static void TestDefaultPipeline()
+{
+	enum : uint32_t { Shadow, ZPos, ZNorm, ZDepth, SSAO, SSAOBlur, Normal, Base, MSR, Vel, TAA, Sky, Transparent, ResourceCount };
+	const uint32_t RT = RENDER_TARGET, SRV = PIXEL_SHADER_RESOURCE, DW = DEPTH_WRITE, DR = DEPTH_READ;
+	const std::vector<BarrierPlanner::Access> accesses = {
+		{ Shadow, 0, DW, true }, { ZPos, 0, RT, true }, { ZNorm, 0, RT, true }, { ZDepth, 0, DW, true },
+		{ SSAO, 1, RT, true }, { ZPos, 1, SRV, false }, { ZNorm, 1, SRV, false },
+		{ SSAO, 2, SRV, false }, { SSAOBlur, 2, RT, true },
+		{ Normal, 3, RT, true }, { Base, 3, RT, true }, { MSR, 3, RT, true }, { Vel, 3, RT, true },
+		{ ZDepth, 3, DR, false }, { Shadow, 3, SRV, false }, { SSAOBlur, 3, SRV, false },
+		{ TAA, 4, RT, true }, { Base, 4, SRV, false }, { Vel, 4, SRV, false }, { ZDepth, 4, SRV, false },
+		{ Base, 5, RT, true }, { ZDepth, 5, DR, false }, { Sky, 5, RT, true },
+		{ Transparent, 6, RT, true }, { Normal, 6, RT, true }, { Base, 6, RT, true }, { MSR, 6, RT, true },
+		{ Vel, 6, RT, true }, { ZDepth, 6, DR, false },
+		{ TAA, 7, SRV, false } };
+	const auto result = BarrierPlanner::Plan(ResourceCount, 8, accesses);
+	CHECK(Replay(ResourceCount, 8, accesses, result));
+
+	// The four GBuffer targets alias on level 3, in one batch.
+	CHECK(result.batches[3].size() >= 4);
+	for (uint32_t resource : { Normal, Base, MSR, Vel })
+		CHECK(Count(result.batches[3], Type::ALIASING, resource) == 1);
+
+	// The shadow map waits from level 1 to level 3, its transition overlaps SSAO.
+	CHECK(Count(result.batches[1], Type::BEGIN_ONLY, Shadow) == 1);
+	CHECK(Count(result.batches[3], Type::END_ONLY, Shadow) == 1);
+
+	// Depth is read as depth and as a texture from level 3 on, one combined read state reached
+	// by a single split barrier.
+	CHECK(Count(result.batches[1], Type::BEGIN_ONLY, ZDepth) == 1);
+	CHECK(Count(result.batches[3], Type::END_ONLY, ZDepth) == 1);
+	for (uint32_t level = 4; level < 8; ++level)
+		CHECK(Count(result.batches[level], Type::TRANSITION, ZDepth) == 0);
+
+	size_t barriers = 0;
+	for (const auto& batch : result.batches)
+		barriers += batch.size();
+	std::printf("default frame graph: %zu barriers in %zu batches\n", barriers, result.batches.size());
+}
+
+// Random levels of one write followed by reads, replayed.
+static void TestRandom()
+{
+	std::mt19937 random(7);
+	const uint32_t states[] = { RENDER_TARGET, DEPTH_WRITE, DEPTH_READ, PIXEL_SHADER_RESOURCE };
+	for (int iteration = 0; iteration < 1000; ++iteration)
+	{
+		const uint32_t resourceCount = random() % 8 + 1;
+		const uint32_t levelCount = random() % 12 + 1;
+		std::vector<BarrierPlanner::Access> accesses;
+		for (uint32_t resource = 0; resource < resourceCount; ++resource)
+		{
+			for (uint32_t level = 0; level < levelCount; ++level)
+			{
+				const uint32_t choice = random() % 4;
+				if (choice == 0)
+					accesses.push_back({ resource, level, states[random() % 2], true });
+				else if (choice == 1)
+					accesses.push_back({ resource, level, states[2 + random() % 2], false });
+			}
+		}
+		std::shuffle(accesses.begin(), accesses.end(), random);
+		CHECK(Replay(resourceCount, levelCount, accesses, BarrierPlanner::Plan(resourceCount, levelCount, accesses)));
+	}
+}
+
+int main()
+{
+	TestSplit();
+	TestAliasing();
+	TestCombinedReads();
+	TestDefaultPipeline();
+	TestRandom();
+	return Test::Result();
+}
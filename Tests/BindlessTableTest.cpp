@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/BindlessTable.h"
+#include <random>
+
+using namespace Amadeus;
+
+static void TestAssignment()
+{
+	BindlessTable table(4);
+	bool bAssigned = false;
+
+	// New keys get the next free index, their descriptor has to be written.
+	CHECK(table.Acquire(100, bAssigned) == 0);
+	CHECK(bAssigned);
+	CHECK(table.Acquire(200, bAssigned) == 1);
+	CHECK(bAssigned);
+
+	// A key acquired again keeps its index, the descriptor is already there.
+	CHECK(table.Acquire(100, bAssigned) == 0);
+	CHECK(!bAssigned);
+	CHECK(table.Size() == 2);
+	CHECK(table.Find(200) == 1);
+	CHECK(table.Find(300) == BindlessTable::InvalidIndex);
+
+	// Every reference has to be released before the index is given up.
+	CHECK(!table.Release(100));
+	CHECK(table.Find(100) == 0);
+	CHECK(table.Release(100));
+	CHECK(table.Find(100) == BindlessTable::InvalidIndex);
+	CHECK(table.Size() == 1);
+}
+
+static void TestExhaustion()
+{
+	BindlessTable table(3);
+	bool bAssigned = false;
+	for (uint64_t key = 0; key < 3; ++key)
+		CHECK(table.Acquire(key, bAssigned) == key);
+
+	CHECK(table.Acquire(3, bAssigned) == BindlessTable::InvalidIndex);
+	CHECK(!bAssigned);
+	CHECK(table.Find(3) == BindlessTable::InvalidIndex);
+	CHECK(table.Size() == 3);
+
+	// Keys that already have an index still get it when the range is full.
+	CHECK(table.Acquire(1, bAssigned) == 1);
+	CHECK(!bAssigned);
+
+	table.Reset(8);
+	CHECK(table.Size() == 0);
+	CHECK(table.GetCapacity() == 8);
+	CHECK(table.Acquire(3, bAssigned) == 0);
+	CHECK(bAssigned);
+}
+
+// Released indices go back to the free list and are handed out before the untouched ones.
+static void TestReuse()
+{
+	BindlessTable table(8);
+	bool bAssigned = false;
+	for (uint64_t key = 0; key < 4; ++key)
+		table.Acquire(key, bAssigned);
+
+	CHECK(table.Release(1));
+	CHECK(table.Release(2));
+	CHECK(table.Acquire(10, bAssigned) == 1);
+	CHECK(bAssigned);
+	CHECK(table.Acquire(11, bAssigned) == 2);
+	CHECK(table.Acquire(12, bAssigned) == 4);
+}
+
+// Random acquires and releases against a model of the references: indices stay unique and inside
+// the range, and a key only loses its index with its last reference.
+static void TestRandom()
+{
+	const uint32_t capacity = 64;
+	BindlessTable table(capacity);
+	std::map<uint64_t, std::pair<uint32_t, uint32_t>> model;
+	std::mt19937 random(11);
+	size_t exhausted = 0;
+
+	for (int step = 0; step < 100000; ++step)
+	{
+		const uint64_t key = random() % 96;
+		auto entry = model.find(key);
+		if (entry == model.end() || random() % 2)
+		{
+			bool bAssigned = false;
+			const uint32_t index = table.Acquire(key, bAssigned);
+			if (entry != model.end())
+			{
+				CHECK(index == entry->second.first && !bAssigned);
+				++entry->second.second;
+			}
+			else if (model.size() == capacity)
+			{
+				CHECK(index == BindlessTable::InvalidIndex && !bAssigned);
+				++exhausted;
+			}
+			else
+			{
+				CHECK(index < capacity && bAssigned);
+				for (const auto& [other, value] : model)
+					CHECK(value.first != index);
+				model.emplace(key, std::make_pair(index, 1u));
+			}
+		}
+		else
+		{
+			const bool bLast = --entry->second.second == 0;
+			CHECK(table.Release(key) == bLast);
+			if (bLast)
+				model.erase(entry);
+		}
+		CHECK(table.Size() == model.size());
+	}
+	CHECK(exhausted > 0);
+}
+
+int main()
+{
+	TestAssignment();
+	TestExhaustion();
+	TestReuse();
+	TestRandom();
+	return Test::Result();
+}
@@ -0,0 +1,289 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/BlockCompressor.h"
+#include <random>
+
+using namespace Amadeus;
+
+using Format = BlockCompressor::Format;
+using Quality = BlockCompressor::Quality;
+
+static const Format Formats[] = { Format::BC1, Format::BC3, Format::BC4, Format::BC5, Format::BC7 };
+
+// A tightly packed RGBA image.
+struct Buffer
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+
+	Buffer(uint32_t width, uint32_t height)
+		: width(width)
+		, height(height)
+		, pixels(static_cast<size_t>(width) * height * 4)
+	{
+	}
+};
+
+// Smooth gradients with some noise and a few hard edges, closer to a texture than white noise.
+static Buffer CreateImage(uint32_t width, uint32_t height, std::mt19937& random)
+{
+	Buffer image(width, height);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint8_t* texel = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+			const uint32_t edge = (x / 13 + y / 11) % 2 ? 60 : 0;
+			texel[0] = static_cast<uint8_t>(x * 2 + edge + random() % 6);
+			texel[1] = static_cast<uint8_t>(y * 3 + random() % 6);
+			texel[2] = static_cast<uint8_t>(128 + edge + random() % 6);
+			texel[3] = static_cast<uint8_t>(255 - (x + y) - random() % 6);
+		}
+	}
+	return image;
+}
+
+// Block rows handed out in bands of bandRows to threadCount threads, the way Texture encodes levels.
+static std::vector<uint8_t> Compress(const Buffer& image, Format format, Quality quality, uint32_t threadCount = 1,
+	uint32_t bandRows = 2, bool bBgra = false)
+{
+	const uint32_t rows = BlockCompressor::GetBlockCount(image.height);
+	const size_t rowPitch = BlockCompressor::GetBlockCount(image.width) * BlockCompressor::GetBlockSize(format);
+	std::vector<uint8_t> blocks(rowPitch * rows);
+	const BlockCompressor::Image source = { image.width, image.height, static_cast<size_t>(image.width) * 4, image.pixels.data(), bBgra };
+
+	std::atomic<uint32_t> next{ 0 };
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&]
+		{
+			for (uint32_t band; (band = next.fetch_add(bandRows)) < rows;)
+			{
+				const uint32_t count = (std::min)(bandRows, rows - band);
+				BlockCompressor::Compress(source, format, quality, band, count, blocks.data() + band * rowPitch, rowPitch);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	return blocks;
+}
+
+static Buffer Decompress(const std::vector<uint8_t>& blocks, Format format, uint32_t width, uint32_t height)
+{
+	Buffer image(width, height);
+	const uint32_t columns = BlockCompressor::GetBlockCount(width);
+	const size_t blockSize = BlockCompressor::GetBlockSize(format);
+	uint8_t texels[64];
+	for (uint32_t by = 0; by < BlockCompressor::GetBlockCount(height); ++by)
+	{
+		for (uint32_t bx = 0; bx < columns; ++bx)
+		{
+			BlockCompressor::Decompress(format, &blocks[(static_cast<size_t>(by) * columns + bx) * blockSize], texels);
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					memcpy(&image.pixels[((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+			}
+		}
+	}
+	return image;
+}
+
+// Channels a format stores, as a mask over RGBA.
+static uint32_t GetChannelMask(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+		return 0x7;
+	case Format::BC4:
+		return 0x1;
+	case Format::BC5:
+		return 0x3;
+	default:
+		return 0xF;
+	}
+}
+
+static double ComputePsnr(const Buffer& reference, const Buffer& decoded, uint32_t channelMask)
+{
+	double sum = 0.0;
+	size_t count = 0;
+	for (size_t i = 0; i < reference.pixels.size(); ++i)
+	{
+		if (channelMask & (1u << (i % 4)))
+		{
+			const double difference = static_cast<double>(reference.pixels[i]) - decoded.pixels[i];
+			sum += difference * difference;
+			++count;
+		}
+	}
+	return sum == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * count / sum);
+}
+
+static bool IsNear(const uint8_t* texel, std::initializer_list<int> expected)
+{
+	const int* value = expected.begin();
+	for (size_t channel = 0; channel < expected.size(); ++channel)
+	{
+		if (std::abs(texel[channel] - value[channel]) > 1)
+			return false;
+	}
+	return true;
+}
+
+// Hand built blocks decode to the palettes the format defines, missing channels read 0 and alpha 255.
+static void TestDecode()
+{
+	uint8_t texels[64];
+
+	// Red and blue endpoints, texels 0 to 3 take the four palette entries.
+	const uint8_t bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0x00, 0x00, 0x00 };
+	BlockCompressor::Decompress(Format::BC1, bc1, texels);
+	CHECK(IsNear(&texels[0], { 255, 0, 0, 255 }) && IsNear(&texels[4], { 0, 0, 255, 255 }));
+	CHECK(IsNear(&texels[8], { 170, 0, 85, 255 }) && IsNear(&texels[12], { 85, 0, 170, 255 }));
+	CHECK(IsNear(&texels[60], { 255, 0, 0, 255 }));
+
+	// Endpoints in the other order select three colors and transparent black.
+	const uint8_t bc1Alpha[8] = { 0x1F, 0x00, 0x00, 0xF8, 0xE4, 0x00, 0x00, 0x00 };
+	BlockCompressor::Decompress(Format::BC1, bc1Alpha, texels);
+	CHECK(IsNear(&texels[8], { 128, 0, 128, 255 }) && IsNear(&texels[12], { 0, 0, 0, 0 }));
+
+	// 255 and 0 give eight values, texels 0 to 7 take indices 0 to 7.
+	const uint8_t bc4[8] = { 255, 0, 0x88, 0xC6, 0xFA, 0x00, 0x00, 0x00 };
+	BlockCompressor::Decompress(Format::BC4, bc4, texels);
+	const int values[8] = { 255, 0, 219, 182, 146, 109, 73, 36 };
+	bool bPalette = true;
+	for (int i = 0; i < 8; ++i)
+		bPalette &= IsNear(&texels[i * 4], { values[i], 0, 0, 255 });
+	CHECK(bPalette && IsNear(&texels[60], { 255, 0, 0, 255 }));
+
+	// Endpoints in the other order give six values, 0 and 255.
+	const uint8_t bc4Ends[8] = { 0, 255, 0x88, 0xC6, 0xFA, 0x00, 0x00, 0x00 };
+	BlockCompressor::Decompress(Format::BC4, bc4Ends, texels);
+	CHECK(IsNear(&texels[24], { 0, 0, 0, 255 }) && IsNear(&texels[28], { 255, 0, 0, 255 }));
+
+	// BC5 is two BC4 blocks, red then green.
+	uint8_t bc5[16];
+	memcpy(bc5, bc4, 8);
+	memcpy(bc5 + 8, bc4Ends, 8);
+	BlockCompressor::Decompress(Format::BC5, bc5, texels);
+	CHECK(IsNear(&texels[8], { 219, 51, 0, 255 }) && IsNear(&texels[60], { 255, 0, 0, 255 }));
+
+	// A reserved BC7 mode decodes to transparent black as the gpu does.
+	const uint8_t bc7[16] = {};
+	BlockCompressor::Decompress(Format::BC7, bc7, texels);
+	CHECK(std::all_of(texels, texels + 64, [](uint8_t value) { return value == 0; }));
+}
+
+// Encoding what a block decodes to gives it back, or one just as good.
+static void TestRoundTrip(std::mt19937& random)
+{
+	const Buffer image = CreateImage(32, 32, random);
+	for (Format format : Formats)
+	{
+		const Buffer decoded = Decompress(Compress(image, format, Quality::NORMAL), format, 32, 32);
+		const Buffer again = Decompress(Compress(decoded, format, Quality::NORMAL), format, 32, 32);
+		CHECK(ComputePsnr(decoded, again, GetChannelMask(format)) > 55.0);
+	}
+}
+
+// Error bounds per format and quality, and a better quality never loses to a faster one.
+static void TestQuality(std::mt19937& random)
+{
+	const Buffer image = CreateImage(64, 64, random);
+	const double minimums[][3] = { { 37, 37, 37 }, { 38, 38, 38 }, { 42, 42, 43 }, { 44, 44, 45 }, { 41, 41, 41 } };
+	for (size_t f = 0; f < std::size(Formats); ++f)
+	{
+		double psnr[3];
+		for (int quality = 0; quality < 3; ++quality)
+		{
+			const Format format = Formats[f];
+			psnr[quality] = ComputePsnr(image, Decompress(Compress(image, format, static_cast<Quality>(quality)), format, 64, 64), GetChannelMask(format));
+			CHECK(psnr[quality] > minimums[f][quality]);
+		}
+		CHECK(psnr[0] <= psnr[1] + 0.01 && psnr[1] <= psnr[2] + 0.01);
+	}
+}
+
+// A flat block comes back within the rounding of the endpoints: 565 for BC1 and BC3 color, 7 bits
+// and a p-bit for BC7, exact for BC4 and BC5.
+static void TestFlat(std::mt19937& random)
+{
+	for (Format format : Formats)
+	{
+		const int tolerance = format == Format::BC1 || format == Format::BC3 ? 8 : format == Format::BC7 ? 2 : 0;
+		for (int quality = 0; quality < 3; ++quality)
+		{
+			int worst = 0;
+			for (int block = 0; block < 100; ++block)
+			{
+				Buffer image(4, 4);
+				const uint8_t color[4] = { static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), static_cast<uint8_t>(random()),
+					static_cast<uint8_t>(block % 2 ? 255 : random()) };
+				for (uint32_t texel = 0; texel < 16; ++texel)
+					memcpy(&image.pixels[texel * 4], color, 4);
+				const Buffer decoded = Decompress(Compress(image, format, static_cast<Quality>(quality)), format, 4, 4);
+				for (size_t i = 0; i < 64; ++i)
+				{
+					if (GetChannelMask(format) & (1u << (i % 4)))
+						worst = (std::max)(worst, std::abs(decoded.pixels[i] - image.pixels[i]));
+				}
+			}
+			CHECK(worst <= tolerance);
+		}
+	}
+}
+
+// Texels past the right and bottom edge repeat the last column and row: odd sized images and ones
+// smaller than a block encode to the blocks of the same image padded that way.
+static void TestEdges(std::mt19937& random)
+{
+	for (const auto& [width, height] : { std::make_pair(7u, 5u), std::make_pair(1u, 1u), std::make_pair(2u, 3u), std::make_pair(13u, 4u) })
+	{
+		const Buffer image = CreateImage(width, height, random);
+		Buffer padded(BlockCompressor::GetBlockCount(width) * 4, BlockCompressor::GetBlockCount(height) * 4);
+		for (uint32_t y = 0; y < padded.height; ++y)
+		{
+			for (uint32_t x = 0; x < padded.width; ++x)
+			{
+				const uint32_t column = (std::min)(x, width - 1), row = (std::min)(y, height - 1);
+				memcpy(&padded.pixels[(y * padded.width + x) * 4], &image.pixels[(row * width + column) * 4], 4);
+			}
+		}
+		for (Format format : Formats)
+			CHECK(Compress(image, format, Quality::NORMAL) == Compress(padded, format, Quality::NORMAL));
+	}
+}
+
+// Bands encoded on several threads give the bytes of one pass over the image, BGRA those of RGBA.
+static void TestBands(std::mt19937& random)
+{
+	const Buffer image = CreateImage(40, 52, random);
+	for (Format format : Formats)
+	{
+		const auto single = Compress(image, format, Quality::NORMAL, 1, BlockCompressor::GetBlockCount(image.height));
+		CHECK(Compress(image, format, Quality::NORMAL, 4, 1) == single);
+		CHECK(Compress(image, format, Quality::NORMAL, 3, 5) == single);
+
+		Buffer bgra = image;
+		for (size_t i = 0; i < bgra.pixels.size(); i += 4)
+			std::swap(bgra.pixels[i], bgra.pixels[i + 2]);
+		CHECK(Compress(bgra, format, Quality::NORMAL, 2, 3, true) == single);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(11);
+	TestDecode();
+	TestRoundTrip(random);
+	TestQuality(random);
+	TestFlat(random);
+	TestEdges(random);
+	TestBands(random);
+	return Test::Result();
+}
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "Test.h"
+#include "Camera.h"
+#include "Common/BoundingVolumeHierarchy.h"
+#include <array>
+#include <random>
+
+using namespace Amadeus;
+
+// Builds the hierarchy over 1k, 10k and 100k boxes in clusters of 50 over a 1000 unit wide level,
+// then times a camera cull against the flat SSE2 test of every box, the nearest hit of random rays
+// against testing every box, and refitting after 1% of the boxes moved against a full refit.
+// Reports the mean over repeated runs.
+
+static float IntersectBox(const FrustumCuller::Boxes& boxes, uint32_t item, const float origin[3], const float inverse[3])
+{
+	const float minimum[3] = { boxes.minX[item], boxes.minY[item], boxes.minZ[item] };
+	const float maximum[3] = { boxes.maxX[item], boxes.maxY[item], boxes.maxZ[item] };
+	float enter = 0.0f;
+	float exit = std::numeric_limits<float>::infinity();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float t0 = (minimum[axis] - origin[axis]) * inverse[axis];
+		const float t1 = (maximum[axis] - origin[axis]) * inverse[axis];
+		enter = (std::max)(enter, (std::min)(t0, t1));
+		exit = (std::min)(exit, (std::max)(t0, t1));
+	}
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+int main()
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f), offset(-20.0f, 20.0f), size(0.2f, 3.0f), unit(-1.0f, 1.0f);
+
+	Test::Matrix view, projection, matrix;
+	const float eye[3] = { 0.0f, 30.0f, -400.0f }, direction[3] = { 0.3f, -0.1f, 1.0f };
+	Test::LookTo(eye, direction, view);
+	Test::Perspective(0.9f, 16.0f / 9.0f, 0.5f, 600.0f, projection);
+	Test::Multiply(view, projection, matrix);
+	const FrustumCuller::Frustum frustum = FrustumCuller::CreateFrustum(matrix);
+
+	std::printf("%7s %9s %10s %10s %9s %10s %10s %10s %9s\n", "items", "build ms", "cull ms", "flat ms", "visible",
+		"ray us", "brute us", "refit ms", "full ms");
+	for (size_t count : { 1000, 10000, 100000 })
+	{
+		std::vector<std::array<float, 3>> centers(count / 50 + 1);
+		for (auto& center : centers)
+			center = { position(random), position(random) * 0.1f, position(random) };
+		FrustumCuller::Boxes boxes;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto& center = centers[i % centers.size()];
+			const float point[3] = { center[0] + offset(random), center[1] + offset(random) * 0.3f, center[2] + offset(random) };
+			const float extent[3] = { size(random), size(random), size(random) };
+			const float minimum[3] = { point[0] - extent[0], point[1] - extent[1], point[2] - extent[2] };
+			const float maximum[3] = { point[0] + extent[0], point[1] + extent[1], point[2] + extent[2] };
+			boxes.Add(minimum, maximum);
+		}
+
+		BoundingVolumeHierarchy tree;
+		const int builds = count < 100000 ? 20 : 5;
+		auto start = std::chrono::steady_clock::now();
+		for (int run = 0; run < builds; ++run)
+			tree.Build(boxes);
+		const double build = Test::SecondsSince(start) * 1e3 / builds;
+
+		std::vector<uint32_t> visible;
+		std::vector<uint8_t> flat(count);
+		start = std::chrono::steady_clock::now();
+		for (int run = 0; run < 100; ++run)
+		{
+			visible.clear();
+			tree.Cull(frustum, visible);
+		}
+		const double cull = Test::SecondsSince(start) * 1e3 / 100;
+		start = std::chrono::steady_clock::now();
+		for (int run = 0; run < 100; ++run)
+			FrustumCuller::Cull(frustum, boxes, 0, count, flat.data());
+		const double flatCull = Test::SecondsSince(start) * 1e3 / 100;
+
+		const int rays = 1000;
+		double ray = 0.0;
+		double brute = 0.0;
+		size_t wrong = 0;
+		for (int i = 0; i < rays; ++i)
+		{
+			const float origin[3] = { position(random), unit(random) * 60.0f, position(random) };
+			float rayDirection[3] = { unit(random), unit(random) * 0.3f, unit(random) };
+			const float length = std::sqrt(rayDirection[0] * rayDirection[0] + rayDirection[1] * rayDirection[1] + rayDirection[2] * rayDirection[2]);
+			float inverse[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				rayDirection[axis] /= length;
+				inverse[axis] = 1.0f / rayDirection[axis];
+			}
+
+			float distance = (std::numeric_limits<float>::max)();
+			start = std::chrono::steady_clock::now();
+			tree.Raycast(origin, rayDirection, distance, [&](uint32_t item, float& closest)
+			{
+				const float itemDistance = IntersectBox(boxes, item, origin, inverse);
+				if (itemDistance >= closest)
+					return false;
+				closest = itemDistance;
+				return true;
+			});
+			ray += Test::SecondsSince(start);
+
+			float bruteDistance = (std::numeric_limits<float>::max)();
+			start = std::chrono::steady_clock::now();
+			for (uint32_t item = 0; item < count; ++item)
+				bruteDistance = (std::min)(bruteDistance, IntersectBox(boxes, item, origin, inverse));
+			brute += Test::SecondsSince(start);
+			wrong += distance != bruteDistance ? 1 : 0;
+		}
+
+		std::vector<uint32_t> moved;
+		for (uint32_t item = 0; item < count; item += 100)
+		{
+			moved.push_back(item);
+			const float x = offset(random), z = offset(random);
+			boxes.minX[item] += x;
+			boxes.maxX[item] += x;
+			boxes.minZ[item] += z;
+			boxes.maxZ[item] += z;
+		}
+		BoundingVolumeHierarchy full = tree;
+		start = std::chrono::steady_clock::now();
+		tree.Refit(boxes, moved.data(), moved.size());
+		const double refit = Test::SecondsSince(start) * 1e3;
+		start = std::chrono::steady_clock::now();
+		full.Refit(boxes);
+		const double fullRefit = Test::SecondsSince(start) * 1e3;
+
+		std::printf("%7zu %9.2f %10.3f %10.3f %9zu %10.2f %10.2f %10.3f %9.3f\n", count, build, cull, flatCull, visible.size(),
+			ray * 1e6 / rays, brute * 1e6 / rays, refit, fullRefit);
+		if (wrong != 0)
+		{
+			std::printf("FAIL %zu rays found another nearest hit than testing every box\n", wrong);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,276 @@
+#include "pch.h"
+#include "Test.h"
+#include "Camera.h"
+#include "Common/BoundingVolumeHierarchy.h"
+#include <array>
+#include <random>
+
+using namespace Amadeus;
+
+// Boxes in clusters of 50 scattered over a 1000 unit wide level, the way objects group in a scene.
+static FrustumCuller::Boxes CreateBoxes(size_t count, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f), offset(-20.0f, 20.0f), size(0.2f, 3.0f);
+	std::vector<std::array<float, 3>> centers(count / 50 + 1);
+	for (auto& center : centers)
+		center = { position(random), position(random) * 0.1f, position(random) };
+
+	FrustumCuller::Boxes boxes;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto& center = centers[i % centers.size()];
+		const float point[3] = { center[0] + offset(random), center[1] + offset(random) * 0.3f, center[2] + offset(random) };
+		const float extent[3] = { size(random), size(random), size(random) };
+		const float minimum[3] = { point[0] - extent[0], point[1] - extent[1], point[2] - extent[2] };
+		const float maximum[3] = { point[0] + extent[0], point[1] + extent[1], point[2] + extent[2] };
+		boxes.Add(minimum, maximum);
+	}
+	return boxes;
+}
+
+// Distance along the ray to the box, infinity for a miss, the intersection a picking callback reports.
+static float IntersectBox(const FrustumCuller::Boxes& boxes, uint32_t item, const float origin[3], const float direction[3])
+{
+	const float minimum[3] = { boxes.minX[item], boxes.minY[item], boxes.minZ[item] };
+	const float maximum[3] = { boxes.maxX[item], boxes.maxY[item], boxes.maxZ[item] };
+	float enter = 0.0f;
+	float exit = std::numeric_limits<float>::infinity();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (direction[axis] == 0.0f)
+		{
+			if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis])
+				return std::numeric_limits<float>::infinity();
+			continue;
+		}
+		const float t0 = (minimum[axis] - origin[axis]) / direction[axis];
+		const float t1 = (maximum[axis] - origin[axis]) / direction[axis];
+		enter = (std::max)(enter, (std::min)(t0, t1));
+		exit = (std::min)(exit, (std::max)(t0, t1));
+	}
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+// Visible items by the flat scalar test.
+static std::vector<uint32_t> CullFlat(const FrustumCuller::Frustum& frustum, const FrustumCuller::Boxes& boxes)
+{
+	std::vector<uint8_t> visible(boxes.Size());
+	FrustumCuller::CullScalar(frustum, boxes, 0, boxes.Size(), visible.data());
+	std::vector<uint32_t> items;
+	for (uint32_t item = 0; item < visible.size(); ++item)
+	{
+		if (visible[item])
+			items.push_back(item);
+	}
+	return items;
+}
+
+static std::vector<uint32_t> CullTree(const BoundingVolumeHierarchy& tree, const FrustumCuller::Frustum& frustum)
+{
+	std::vector<uint32_t> items;
+	tree.Cull(frustum, items);
+	std::sort(items.begin(), items.end());
+	return items;
+}
+
+// Every item in exactly one leaf of at most MaxLeafSize, and every node inside its parent.
+static void CheckStructure(const BoundingVolumeHierarchy& tree, size_t count)
+{
+	const auto& nodes = tree.GetNodes();
+	std::vector<uint32_t> slots(count, 0);
+	bool bContained = true;
+	for (const auto& node : nodes)
+	{
+		if (node.count > 0)
+		{
+			CHECK(node.count <= BoundingVolumeHierarchy::MaxLeafSize);
+			for (uint32_t slot = node.first; slot < node.first + node.count; ++slot)
+				++slots[slot];
+			continue;
+		}
+		for (uint32_t child = node.first; child < node.first + 2; ++child)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				bContained &= nodes[child].minimum[axis] >= node.minimum[axis];
+				bContained &= nodes[child].maximum[axis] <= node.maximum[axis];
+			}
+		}
+	}
+	CHECK(bContained);
+	CHECK(std::all_of(slots.begin(), slots.end(), [](uint32_t covered) { return covered == 1; }));
+	CHECK(tree.Size() == count);
+}
+
+// The tree culls exactly the items the flat test does, for frustums seeing part, all and none of the level.
+static void TestCull(const BoundingVolumeHierarchy& tree, const FrustumCuller::Boxes& boxes)
+{
+	Test::Matrix view, projection, matrix;
+	const float eye[3] = { 0.0f, 30.0f, -400.0f }, direction[3] = { 0.3f, -0.1f, 1.0f };
+	Test::LookTo(eye, direction, view);
+	Test::Perspective(0.9f, 16.0f / 9.0f, 0.5f, 600.0f, projection);
+	Test::Multiply(view, projection, matrix);
+	const FrustumCuller::Frustum camera = FrustumCuller::CreateFrustum(matrix);
+
+	const float lightEye[3] = { 100.0f, 200.0f, -100.0f }, lightDirection[3] = { -1.0f, -1.5f, 1.0f };
+	Test::LookTo(lightEye, lightDirection, view);
+	Test::Orthographic(150.0f, 150.0f, 0.1f, 500.0f, projection);
+	Test::Multiply(view, projection, matrix);
+	const FrustumCuller::Frustum shadow = FrustumCuller::CreateFrustum(matrix);
+
+	const float aboveEye[3] = { 0.0f, 2000.0f, 0.0f }, down[3] = { 0.001f, -1.0f, 0.0f }, up[3] = { 0.001f, 1.0f, 0.0f };
+	Test::LookTo(aboveEye, down, view);
+	Test::Orthographic(3000.0f, 3000.0f, 0.1f, 5000.0f, projection);
+	Test::Multiply(view, projection, matrix);
+	const FrustumCuller::Frustum everything = FrustumCuller::CreateFrustum(matrix);
+	Test::LookTo(aboveEye, up, view);
+	Test::Multiply(view, projection, matrix);
+	const FrustumCuller::Frustum nothing = FrustumCuller::CreateFrustum(matrix);
+
+	for (const auto* frustum : { &camera, &shadow })
+	{
+		const auto expected = CullFlat(*frustum, boxes);
+		CHECK(!expected.empty() && expected.size() < boxes.Size());
+		CHECK(CullTree(tree, *frustum) == expected);
+	}
+	CHECK(CullTree(tree, everything).size() == boxes.Size());
+	CHECK(CullTree(tree, nothing).empty());
+}
+
+// The nearest hit matches testing every box, for random rays and rays along the axes.
+static void TestRaycast(const BoundingVolumeHierarchy& tree, const FrustumCuller::Boxes& boxes, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f), unit(-1.0f, 1.0f);
+	size_t hits = 0;
+	size_t wrong = 0;
+	for (int ray = 0; ray < 2000; ++ray)
+	{
+		const float origin[3] = { position(random), unit(random) * 60.0f, position(random) };
+		float direction[3] = { unit(random), unit(random) * 0.3f, unit(random) };
+		if (ray % 4 == 0)
+		{
+			// Along one axis, the other slabs are parallel to the ray.
+			const int axis = ray / 4 % 3;
+			const float sign = direction[axis] < 0.0f ? -1.0f : 1.0f;
+			direction[0] = direction[1] = direction[2] = 0.0f;
+			direction[axis] = sign;
+		}
+		const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		for (float& component : direction)
+			component /= length;
+
+		float expectedDistance = (std::numeric_limits<float>::max)();
+		uint32_t expected = ~0u;
+		for (uint32_t item = 0; item < boxes.Size(); ++item)
+		{
+			const float distance = IntersectBox(boxes, item, origin, direction);
+			if (distance < expectedDistance)
+			{
+				expectedDistance = distance;
+				expected = item;
+			}
+		}
+
+		float distance = (std::numeric_limits<float>::max)();
+		const uint32_t hit = tree.Raycast(origin, direction, distance, [&](uint32_t item, float& closest)
+		{
+			const float itemDistance = IntersectBox(boxes, item, origin, direction);
+			if (itemDistance >= closest)
+				return false;
+			closest = itemDistance;
+			return true;
+		});
+		hits += hit != ~0u ? 1 : 0;
+		// Items at the same distance may come in either order.
+		if ((hit == ~0u) != (expected == ~0u) || distance != expectedDistance)
+			++wrong;
+	}
+	CHECK(wrong == 0);
+	// A few boxes are mostly missed, a full level is not.
+	CHECK(boxes.Size() < 1000 || hits > 100);
+}
+
+// Refitting the moved items along their paths gives the same nodes as refitting everything.
+static void TestRefit(BoundingVolumeHierarchy& tree, FrustumCuller::Boxes& boxes, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+	for (size_t step = 1; step <= 100; step *= 10)
+	{
+		// 10%, 1% and 0.1% of the items.
+		const size_t stride = (std::max)(boxes.Size() / (step * 10), size_t(1));
+		std::vector<uint32_t> moved;
+		for (size_t item = step % 7 % boxes.Size(); item < boxes.Size(); item += stride)
+		{
+			moved.push_back(static_cast<uint32_t>(item));
+			const float x = offset(random), y = offset(random), z = offset(random);
+			boxes.minX[item] += x;
+			boxes.maxX[item] += x;
+			boxes.minY[item] += y;
+			boxes.maxY[item] += y;
+			boxes.minZ[item] += z;
+			boxes.maxZ[item] += z;
+		}
+
+		BoundingVolumeHierarchy full = tree;
+		full.Refit(boxes);
+		tree.Refit(boxes, moved.data(), moved.size());
+		const auto& nodes = tree.GetNodes();
+		const auto& fullNodes = full.GetNodes();
+		CHECK(nodes.size() == fullNodes.size() && memcmp(nodes.data(), fullNodes.data(), nodes.size() * sizeof(nodes[0])) == 0);
+		CheckStructure(tree, boxes.Size());
+	}
+
+	Test::Matrix view, projection, matrix;
+	const float eye[3] = { -50.0f, 20.0f, -300.0f }, direction[3] = { 0.1f, -0.05f, 1.0f };
+	Test::LookTo(eye, direction, view);
+	Test::Perspective(1.2f, 16.0f / 9.0f, 0.5f, 800.0f, projection);
+	Test::Multiply(view, projection, matrix);
+	const FrustumCuller::Frustum frustum = FrustumCuller::CreateFrustum(matrix);
+	CHECK(CullTree(tree, frustum) == CullFlat(frustum, boxes));
+}
+
+// Empty, single and identical boxes, the last with every centroid in one place.
+static void TestDegenerate()
+{
+	BoundingVolumeHierarchy tree;
+	FrustumCuller::Boxes boxes;
+	const FrustumCuller::Frustum frustum = {};
+	std::vector<uint32_t> visible;
+	tree.Build(boxes);
+	tree.Cull(frustum, visible);
+	float distance = 1.0f;
+	const float origin[3] = {}, direction[3] = { 1.0f, 0.0f, 0.0f };
+	CHECK(tree.GetNodes().empty() && visible.empty());
+	CHECK(tree.Raycast(origin, direction, distance, [](uint32_t, float&) { return true; }) == ~0u);
+
+	const float minimum[3] = { 0.0f, 0.0f, 0.0f }, maximum[3] = { 1.0f, 1.0f, 1.0f };
+	boxes.Add(minimum, maximum);
+	tree.Build(boxes);
+	CHECK(tree.GetNodes().size() == 1 && tree.GetNodes()[0].count == 1);
+	CheckStructure(tree, 1);
+
+	for (int i = 1; i < 1000; ++i)
+		boxes.Add(minimum, maximum);
+	tree.Build(boxes);
+	CheckStructure(tree, 1000);
+}
+
+int main()
+{
+	std::mt19937 random(3);
+	for (size_t count : { 5, 100, 20000 })
+	{
+		FrustumCuller::Boxes boxes = CreateBoxes(count, random);
+		BoundingVolumeHierarchy tree;
+		tree.Build(boxes);
+		CheckStructure(tree, count);
+		CHECK(tree.ComputeCost() > 0.0f);
+
+		if (count > 100)
+			TestCull(tree, boxes);
+		TestRaycast(tree, boxes, random);
+		TestRefit(tree, boxes, random);
+	}
+	TestDegenerate();
+	return Test::Result();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+
+// View and projection matrices as DirectXMath builds them, row vectors and clip depth in [0, 1],
+// for tests that cull without the engine's math library.
+namespace Test
+{
+	using Matrix = float[4][4];
+
+	inline void Multiply(const Matrix a, const Matrix b, Matrix result)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result[row][column] = 0.0f;
+				for (int i = 0; i < 4; ++i)
+					result[row][column] += a[row][i] * b[i][column];
+			}
+		}
+	}
+
+	// XMMatrixLookToLH with +Y up.
+	inline void LookTo(const float eye[3], const float direction[3], Matrix result)
+	{
+		float z[3];
+		float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		for (int i = 0; i < 3; ++i)
+			z[i] = direction[i] / length;
+		float x[3] = { z[2], 0.0f, -z[0] };
+		length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+		for (int i = 0; i < 3; ++i)
+			x[i] /= length;
+		const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			result[i][0] = x[i];
+			result[i][1] = y[i];
+			result[i][2] = z[i];
+			result[i][3] = 0.0f;
+		}
+		result[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+		result[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+		result[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+		result[3][3] = 1.0f;
+	}
+
+	// XMMatrixPerspectiveFovLH.
+	inline void Perspective(float fovY, float aspect, float nearZ, float farZ, Matrix result)
+	{
+		std::memset(result, 0, sizeof(Matrix));
+		const float height = 1.0f / std::tan(fovY * 0.5f);
+		result[0][0] = height / aspect;
+		result[1][1] = height;
+		result[2][2] = farZ / (farZ - nearZ);
+		result[2][3] = 1.0f;
+		result[3][2] = -nearZ * farZ / (farZ - nearZ);
+	}
+
+	// XMMatrixOrthographicLH.
+	inline void Orthographic(float width, float height, float nearZ, float farZ, Matrix result)
+	{
+		std::memset(result, 0, sizeof(Matrix));
+		result[0][0] = 2.0f / width;
+		result[1][1] = 2.0f / height;
+		result[2][2] = 1.0f / (farZ - nearZ);
+		result[3][2] = -nearZ / (farZ - nearZ);
+		result[3][3] = 1.0f;
+	}
+
+	// Point times matrix, with w = 1.
+	inline void Transform(const float point[3], const Matrix matrix, float result[4])
+	{
+		for (int i = 0; i < 4; ++i)
+			result[i] = point[0] * matrix[0][i] + point[1] * matrix[1][i] + point[2] * matrix[2][i] + matrix[3][i];
+	}
+}
@@ -0,0 +1,280 @@
+#include "pch.h"
+#include "Test.h"
+#include "Camera.h"
+#include "Models.h"
+#include "Common/MeshOptimizer.h"
+#include "Common/MeshletBuilder.h"
+#include "Common/ClusterCuller.h"
+#include <array>
+
+using namespace Amadeus;
+
+using Vertex = VertexDecoder::Vertex;
+
+struct Meshlets
+{
+	std::vector<uint32_t> indices;
+	std::vector<Vertex> vertices;
+	std::vector<MeshletBuilder::Meshlet> meshlets;
+};
+
+// What Primitive does at import: vertex cache, overdraw, meshlets, then vertex fetch.
+static Meshlets Build(const Test::Mesh& mesh)
+{
+	Meshlets result;
+	std::vector<uint32_t> cached(mesh.indices.size());
+	result.indices.resize(mesh.indices.size());
+	MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), cached.data());
+	MeshOptimizer::OptimizeOverdraw(cached.data(), cached.size(), mesh.vertices[0].position, sizeof(Vertex), mesh.vertices.size(),
+		MeshOptimizer::DefaultOverdrawThreshold, result.indices.data());
+	result.meshlets = MeshletBuilder::Build(result.indices.data(), result.indices.size(), mesh.vertices[0].position, sizeof(Vertex),
+		mesh.vertices.size());
+	result.vertices = mesh.vertices;
+	result.vertices.resize(MeshOptimizer::OptimizeVertexFetch(result.indices.data(), result.indices.size(),
+		result.vertices.data(), result.vertices.size(), sizeof(Vertex)));
+	return result;
+}
+
+static std::multiset<std::array<float, 9>> Triangles(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	std::multiset<std::array<float, 9>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		std::array<float, 9> triangle;
+		for (int corner = 0; corner < 3; ++corner)
+			memcpy(&triangle[corner * 3], vertices[indices[i + corner]].position, sizeof(float) * 3);
+		triangles.insert(triangle);
+	}
+	return triangles;
+}
+
+// Meshlets cover the index buffer in order within the limits, every vertex is inside the sphere,
+// every triangle normal inside the cone, the triangles are kept and a second build is identical.
+static void TestBuild(const Test::Mesh& mesh, const Meshlets& built)
+{
+	CHECK(Triangles(mesh.indices, mesh.vertices) == Triangles(built.indices, built.vertices));
+
+	const Meshlets again = Build(mesh);
+	CHECK(again.indices == built.indices);
+	CHECK(again.meshlets.size() == built.meshlets.size()
+		&& memcmp(again.meshlets.data(), built.meshlets.data(), built.meshlets.size() * sizeof(MeshletBuilder::Meshlet)) == 0);
+
+	size_t next = 0, vertexCount = 0, cones = 0;
+	double coneAngles = 0.0;
+	bool bInside = true;
+	for (const auto& meshlet : built.meshlets)
+	{
+		CHECK(meshlet.firstIndex == next);
+		CHECK(meshlet.indexCount > 0 && meshlet.indexCount <= MeshletBuilder::MaxTriangles * 3);
+		next += meshlet.indexCount;
+
+		const auto begin = built.indices.begin() + meshlet.firstIndex;
+		const std::set<uint32_t> vertices(begin, begin + meshlet.indexCount);
+		CHECK(vertices.size() <= MeshletBuilder::MaxVertices);
+		vertexCount += vertices.size();
+		for (uint32_t vertex : vertices)
+		{
+			const float* p = built.vertices[vertex].position;
+			const float distance = std::sqrt((p[0] - meshlet.center[0]) * (p[0] - meshlet.center[0])
+				+ (p[1] - meshlet.center[1]) * (p[1] - meshlet.center[1]) + (p[2] - meshlet.center[2]) * (p[2] - meshlet.center[2]));
+			bInside &= distance <= meshlet.radius * 1.0001f + 1e-6f;
+		}
+
+		if (meshlet.coneCutoff >= 1.0f)
+			continue;
+		++cones;
+		coneAngles += std::asin(meshlet.coneCutoff) * 180.0 / 3.14159265358979323846;
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+		{
+			const float* p0 = built.vertices[built.indices[i]].position;
+			const float* p1 = built.vertices[built.indices[i + 1]].position;
+			const float* p2 = built.vertices[built.indices[i + 2]].position;
+			const double e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const double e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const double normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length == 0.0)
+				continue;
+			const double cosine = (normal[0] * meshlet.coneAxis[0] + normal[1] * meshlet.coneAxis[1] + normal[2] * meshlet.coneAxis[2]) / length;
+			bInside &= cosine >= std::sqrt(1.0 - meshlet.coneCutoff * meshlet.coneCutoff) - 1e-4;
+		}
+	}
+	CHECK(next == built.indices.size());
+	CHECK(bInside);
+	std::printf("%zu triangles -> %zu meshlets, %.1f triangles and %.1f vertices each, %zu with a cone (mean half angle %.1f degrees)\n",
+		built.indices.size() / 3, built.meshlets.size(), built.indices.size() / 3.0 / built.meshlets.size(),
+		static_cast<double>(vertexCount) / built.meshlets.size(), cones, cones ? coneAngles / cones : 0.0);
+}
+
+// 160 frames: orbits at three distances and a pass through the model, under an identity, a
+// rotated and scaled, and a mirrored world. Culling has to be conservative, every triangle left
+// out of the ranges is back facing or entirely outside one clip plane. Prints the rejection rates.
+static void TestCameraPath(const Meshlets& built)
+{
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const auto& vertex : built.vertices)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = (std::min)(minimum[axis], vertex.position[axis]);
+			maximum[axis] = (std::max)(maximum[axis], vertex.position[axis]);
+		}
+	}
+	const float center[3] = { (minimum[0] + maximum[0]) / 2, (minimum[1] + maximum[1]) / 2, (minimum[2] + maximum[2]) / 2 };
+	const float extent = (std::max)({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] });
+
+	const float worlds[3][4][4] = {
+		{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } },
+		{ { 2, 0, 0, 0 }, { 0, 0, 2, 0 }, { 0, -2, 0, 0 }, { 0, 0, 0, 1 } },
+		{ { -1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+	const char* worldNames[3] = { "identity", "rotated, scale 2", "mirrored" };
+	const float pi = 3.14159265f;
+
+	for (uint32_t mergeGap : { 0u, ClusterCuller::DefaultMergeGap })
+	{
+		for (int world = 0; world < 3; ++world)
+		{
+			float worldCenter[4];
+			Test::Transform(center, worlds[world], worldCenter);
+			const float worldExtent = extent * (world == 1 ? 2.0f : 1.0f);
+
+			ClusterCuller::Statistics total;
+			size_t unjustified = 0;
+			const int frames = 160;
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				float eye[3], direction[3];
+				if (frame < 120)
+				{
+					const float angle = frame * 2.0f * pi / 40.0f;
+					const float distance = worldExtent * (frame < 40 ? 2.0f : frame < 80 ? 1.0f : 0.6f);
+					eye[0] = worldCenter[0] + std::cos(angle) * distance;
+					eye[1] = worldCenter[1] + 0.3f * distance;
+					eye[2] = worldCenter[2] + std::sin(angle) * distance;
+					for (int axis = 0; axis < 3; ++axis)
+						direction[axis] = worldCenter[axis] - eye[axis];
+				}
+				else
+				{
+					const float t = (frame - 120) / 39.0f;
+					eye[0] = worldCenter[0] - worldExtent + 2.0f * worldExtent * t;
+					eye[1] = worldCenter[1];
+					eye[2] = worldCenter[2] - 0.2f * worldExtent;
+					direction[0] = 1.0f;
+					direction[1] = 0.1f;
+					direction[2] = 0.3f;
+				}
+
+				Test::Matrix view, projection, viewProjection;
+				Test::LookTo(eye, direction, view);
+				Test::Perspective(pi / 3.0f, 16.0f / 9.0f, 0.01f, 1000.0f, projection);
+				Test::Multiply(view, projection, viewProjection);
+
+				std::vector<ClusterCuller::DrawRange> ranges;
+				ClusterCuller::Statistics statistics;
+				ClusterCuller::Cull(built.meshlets.data(), built.meshlets.size(), worlds[world],
+					ClusterCuller::CreateView(viewProjection, eye), true, mergeGap, ranges, statistics);
+
+				std::vector<bool> drawn(built.indices.size() / 3, false);
+				for (const auto& range : ranges)
+				{
+					for (uint32_t triangle = range.firstIndex / 3; triangle < (range.firstIndex + range.indexCount) / 3; ++triangle)
+						drawn[triangle] = true;
+				}
+				for (size_t triangle = 0; triangle < drawn.size(); ++triangle)
+				{
+					if (drawn[triangle])
+						continue;
+
+					float clip[3][4], position[3][4];
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						Test::Transform(built.vertices[built.indices[triangle * 3 + corner]].position, worlds[world], position[corner]);
+						Test::Transform(position[corner], viewProjection, clip[corner]);
+					}
+					bool bOutside = false;
+					for (int plane = 0; plane < 6 && !bOutside; ++plane)
+					{
+						bool bAll = true;
+						for (const auto& c : clip)
+						{
+							const float distance = plane == 0 ? c[3] + c[0] : plane == 1 ? c[3] - c[0] : plane == 2 ? c[3] + c[1]
+								: plane == 3 ? c[3] - c[1] : plane == 4 ? c[2] : c[3] - c[2];
+							bAll &= distance < 1e-4f * std::fabs(c[3]) + 1e-6f;
+						}
+						bOutside = bAll;
+					}
+
+					double e0[3], e1[3];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						e0[axis] = position[1][axis] - position[0][axis];
+						e1[axis] = position[2][axis] - position[0][axis];
+					}
+					const double normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+					const double facing = normal[0] * (position[0][0] - eye[0]) + normal[1] * (position[0][1] - eye[1]) + normal[2] * (position[0][2] - eye[2]);
+					const bool bBack = facing >= -1e-9 * (std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2])) * worldExtent;
+					if (!bOutside && !bBack)
+						++unjustified;
+				}
+
+				total.meshlets += statistics.meshlets;
+				total.frustumCulled += statistics.frustumCulled;
+				total.coneCulled += statistics.coneCulled;
+				total.triangles += statistics.triangles;
+				total.trianglesCulled += statistics.trianglesCulled;
+				total.draws += statistics.draws;
+			}
+			CHECK(unjustified == 0);
+			CHECK(total.frustumCulled > 0 && total.coneCulled > 0);
+
+			std::printf("merge gap %3u, %-16s meshlets culled %4.1f%% by frustum, %4.1f%% by cone, triangles rejected %4.1f%%, %5.1f draws per frame\n",
+				mergeGap, worldNames[world], 100.0 * total.frustumCulled / total.meshlets, 100.0 * total.coneCulled / total.meshlets,
+				100.0 * total.trianglesCulled / total.triangles, static_cast<double>(total.draws) / frames);
+		}
+	}
+}
+
+// Non-uniform scale skews the normals, cones must not reject anything.
+static void TestNonUniformScale(const Meshlets& built)
+{
+	const float world[4][4] = { { 1, 0, 0, 0 }, { 0, 3, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+	const float eye[3] = { 0.0f, 0.0f, -10.0f };
+	const float direction[3] = { 0.0f, 0.0f, 1.0f };
+	Test::Matrix view, projection, viewProjection;
+	Test::LookTo(eye, direction, view);
+	Test::Perspective(1.0f, 1.0f, 0.01f, 1000.0f, projection);
+	Test::Multiply(view, projection, viewProjection);
+
+	std::vector<ClusterCuller::DrawRange> ranges;
+	ClusterCuller::Statistics statistics;
+	ClusterCuller::Cull(built.meshlets.data(), built.meshlets.size(), world, ClusterCuller::CreateView(viewProjection, eye),
+		true, 0, ranges, statistics);
+	CHECK(statistics.coneCulled == 0);
+}
+
+static void TestEdgeCases()
+{
+	CHECK(MeshletBuilder::Build(nullptr, 0, nullptr, 12, 0).empty());
+
+	// Degenerate triangles stay in.
+	const float positions[4][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 } };
+	std::vector<uint32_t> indices = { 0, 0, 1, 0, 1, 2, 3, 1, 2 };
+	const auto meshlets = MeshletBuilder::Build(indices.data(), indices.size(), positions[0], 12, 4);
+	CHECK(meshlets.size() == 1 && meshlets[0].indexCount == 9);
+}
+
+int main()
+{
+	const auto meshes = Test::LoadModel("DamagedHelmet");
+	CHECK(!meshes.empty());
+	if (!meshes.empty())
+	{
+		const Meshlets built = Build(meshes[0]);
+		TestBuild(meshes[0], built);
+		TestCameraPath(built);
+		TestNonUniformScale(built);
+	}
+	TestEdgeCases();
+	return Test::Result();
+}
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/DependencyGraph.h"
+
+using namespace Amadeus;
+
+using Node = DependencyGraph::Node;
+using Edge = DependencyGraph::Edge;
+
+// Owns the nodes and edges the way the frame graph does, the graph only keeps pointers to them.
+struct Graph
+{
+	DependencyGraph graph;
+	std::deque<Node> nodes;
+	std::deque<Edge> edges;
+
+	explicit Graph(size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			nodes.emplace_back(graph);
+	}
+
+	Node* operator[](size_t index) { return &nodes[index]; }
+
+	void Link(size_t from, size_t to) { edges.emplace_back(graph, &nodes[from], &nodes[to]); }
+
+	std::vector<uint32_t> Culled()
+	{
+		std::vector<uint32_t> culled;
+		for (const auto& node : nodes)
+		{
+			if (node.IsCulled())
+				culled.push_back(node.GetId());
+		}
+		return culled;
+	}
+};
+
+static std::vector<std::pair<uint32_t, uint32_t>> ToPairs(DependencyGraph::EdgeSpan edges)
+{
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	for (const Edge* edge : edges)
+		pairs.push_back({ edge->from, edge->to });
+	return pairs;
+}
+
+using Pairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Every node's edges in the order they were linked, rebuilt after nodes and edges are added or cleared.
+static void TestAdjacency()
+{
+	Graph graph(5);
+	graph.Link(0, 2);
+	graph.Link(1, 2);
+	graph.Link(2, 4);
+	graph.Link(0, 3);
+	graph.Link(3, 4);
+	graph.Link(0, 4);
+
+	CHECK(ToPairs(graph.graph.GetIncomingEdges(graph[4])) == Pairs({ { 2, 4 }, { 3, 4 }, { 0, 4 } }));
+	CHECK(ToPairs(graph.graph.GetOutgoingEdges(graph[0])) == Pairs({ { 0, 2 }, { 0, 3 }, { 0, 4 } }));
+	CHECK(ToPairs(graph.graph.GetIncomingEdges(graph[2])) == Pairs({ { 0, 2 }, { 1, 2 } }));
+	CHECK(graph.graph.GetIncomingEdges(graph[0]).empty() && graph.graph.GetIncomingEdges(graph[1]).empty());
+	CHECK(graph.graph.GetOutgoingEdges(graph[4]).empty());
+
+	// A node and an edge added after the spans were built.
+	graph.nodes.emplace_back(graph.graph);
+	graph.Link(4, 5);
+	CHECK(graph.graph.GetNodeCount() == 6 && graph.graph.GetNode(5) == graph[5]);
+	CHECK(ToPairs(graph.graph.GetIncomingEdges(graph[5])) == Pairs({ { 4, 5 } }));
+	CHECK(ToPairs(graph.graph.GetOutgoingEdges(graph[4])) == Pairs({ { 4, 5 } }));
+	CHECK(graph.graph.GetIncomingEdges(graph[4]).size() == 3);
+
+	graph.graph.ClearEdges();
+	size_t edges = 0;
+	for (auto& node : graph.nodes)
+		edges += graph.graph.GetIncomingEdges(&node).size() + graph.graph.GetOutgoingEdges(&node).size();
+	CHECK(edges == 0);
+	graph.edges.clear();
+	graph.Link(5, 0);
+	CHECK(ToPairs(graph.graph.GetOutgoingEdges(graph[5])) == Pairs({ { 5, 0 } }));
+	CHECK(graph.graph.GetIncomingEdges(graph[2]).empty());
+}
+
+static void TestAcyclic()
+{
+	{
+		Graph empty(0);
+		CHECK(empty.graph.IsAcyclic());
+	}
+	{
+		Graph single(1);
+		CHECK(single.graph.IsAcyclic());
+	}
+	{
+		// A diamond with a shortcut, and a node on its own.
+		Graph diamond(5);
+		diamond.Link(0, 1);
+		diamond.Link(0, 2);
+		diamond.Link(1, 3);
+		diamond.Link(2, 3);
+		diamond.Link(0, 3);
+		CHECK(diamond.graph.IsAcyclic());
+
+		diamond.Link(3, 0);
+		CHECK(!diamond.graph.IsAcyclic());
+	}
+	{
+		Graph loop(3);
+		loop.Link(0, 1);
+		loop.Link(1, 1);
+		CHECK(!loop.graph.IsAcyclic());
+	}
+	{
+		// Every node of the cycle has an incoming edge, none is a root.
+		Graph cycle(4);
+		cycle.Link(0, 1);
+		cycle.Link(1, 2);
+		cycle.Link(2, 3);
+		cycle.Link(3, 1);
+		CHECK(!cycle.graph.IsAcyclic());
+
+		cycle.graph.ClearEdges();
+		cycle.edges.clear();
+		cycle.Link(0, 1);
+		cycle.Link(1, 2);
+		CHECK(cycle.graph.IsAcyclic());
+	}
+	{
+		// Parallel edges are counted once each.
+		Graph parallel(2);
+		parallel.Link(0, 1);
+		parallel.Link(0, 1);
+		CHECK(parallel.graph.IsAcyclic());
+	}
+}
+
+// Nodes nothing reaches a target through are culled, the rest keep a reference per live reader.
+static void TestCull()
+{
+	// 0 -> 1 -> 2 (target), 0 -> 3 -> 4 with nothing reading 4, 5 on its own, 6 -> 2 and 6 -> 4.
+	Graph graph(7);
+	graph.Link(0, 1);
+	graph.Link(1, 2);
+	graph.Link(0, 3);
+	graph.Link(3, 4);
+	graph.Link(6, 2);
+	graph.Link(6, 4);
+	graph[2]->MakeTarget();
+	graph.graph.Cull();
+
+	CHECK(graph.Culled() == std::vector<uint32_t>({ 3, 4, 5 }));
+	CHECK(graph[0]->GetRefCount() == 1 && graph[6]->GetRefCount() == 1);
+	CHECK(graph[2]->IsTarget() && graph[2]->GetRefCount() == 1);
+	CHECK(graph.graph.IsEdgeValid(&graph.edges[0]) && !graph.graph.IsEdgeValid(&graph.edges[2]));
+	CHECK(!graph.graph.IsEdgeValid(&graph.edges[5]));
+
+	// Culling again starts over and gives the same.
+	graph.graph.Cull();
+	CHECK(graph.Culled() == std::vector<uint32_t>({ 3, 4, 5 }));
+
+	// A second target keeps its whole subgraph.
+	graph[4]->MakeTarget();
+	graph.graph.Cull();
+	CHECK(graph.Culled() == std::vector<uint32_t>({ 5 }));
+	CHECK(graph[0]->GetRefCount() == 2 && graph[6]->GetRefCount() == 2);
+
+	// Without edges only the targets survive.
+	graph.graph.ClearEdges();
+	graph.graph.Cull();
+	CHECK(graph.Culled() == std::vector<uint32_t>({ 0, 1, 3, 5, 6 }));
+
+	// A long chain feeding a culled node is culled all the way up.
+	Graph chain(1000);
+	for (size_t i = 1; i < 1000; ++i)
+		chain.Link(i - 1, i);
+	chain.Link(500, 999);
+	chain[998]->MakeTarget();
+	chain.graph.Cull();
+	CHECK(chain.Culled() == std::vector<uint32_t>({ 999 }));
+	CHECK(chain[500]->GetRefCount() == 1);
+}
+
+int main()
+{
+	TestAdjacency();
+	TestAcyclic();
+	TestCull();
+	return Test::Result();
+}
@@ -0,0 +1,254 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/DerivedDataCache.h"
+#include "Common/Hash.h"
+#include <random>
+
+using namespace Amadeus;
+
+// Size of an entry file holding a 1000 byte source, the header included.
+static constexpr uint64_t EntrySize = 1000 + 32;
+
+static std::vector<uint8_t> CreateSource()
+{
+	std::vector<uint8_t> source(1000);
+	for (size_t i = 0; i < source.size(); ++i)
+		source[i] = static_cast<uint8_t>(i * 7);
+	return source;
+}
+
+// Keyed the way the engine keys its derivations, from the source bytes and the settings.
+static uint64_t GetKey(const std::vector<uint8_t>& source, uint32_t setting)
+{
+	return HashBytes(&setting, sizeof(setting), HashBytes(source.data(), source.size()));
+}
+
+static std::vector<uint8_t> Derive(const std::vector<uint8_t>& source, uint32_t setting)
+{
+	std::vector<uint8_t> data(source.size());
+	for (size_t i = 0; i < source.size(); ++i)
+		data[i] = static_cast<uint8_t>(source[i] * 3 + setting);
+	return data;
+}
+
+static std::filesystem::path GetPath(const std::filesystem::path& directory, uint64_t key)
+{
+	char name[24];
+	snprintf(name, sizeof(name), "%016llx.ddc", static_cast<unsigned long long>(key));
+	return directory / name;
+}
+
+static size_t CountFiles(const std::filesystem::path& directory, const char* extension)
+{
+	size_t count = 0;
+	for (const auto& file : std::filesystem::directory_iterator(directory))
+		count += file.path().extension() == extension ? 1 : 0;
+	return count;
+}
+
+// Fetches through the cache, counts the derivations and checks the data either way.
+struct Fetcher
+{
+	DerivedDataCache& cache;
+	int computed = 0;
+
+	bool operator()(const std::vector<uint8_t>& source, uint32_t setting)
+	{
+		std::vector<uint8_t> data;
+		const bool bHit = cache.Fetch(GetKey(source, setting), data, [&](std::vector<uint8_t>& result)
+		{
+			++computed;
+			result = Derive(source, setting);
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		});
+		CHECK(data == Derive(source, setting));
+		return bHit;
+	}
+};
+
+// A changed source or setting misses and leaves the other entries hitting, also in the next run.
+static void TestInvalidation(const std::filesystem::path& directory)
+{
+	const std::vector<uint8_t> source = CreateSource();
+	std::vector<uint8_t> edited = source;
+	edited[500] ^= 1;
+	{
+		DerivedDataCache cache(directory, 1 << 20);
+		Fetcher fetch{ cache };
+		CHECK(!fetch(source, 1));
+		CHECK(fetch(source, 1));
+		CHECK(fetch.computed == 1);
+
+		CHECK(!fetch(source, 2));
+		CHECK(!fetch(edited, 1));
+		CHECK(fetch(source, 1));
+		CHECK(fetch.computed == 3);
+		CHECK(cache.GetSize() == 3 * EntrySize);
+
+		const auto statistics = cache.GetStatistics();
+		CHECK(statistics.hits == 2 && statistics.misses == 3);
+		CHECK(statistics.bytesRead == 2 * source.size() && statistics.bytesWritten == 3 * EntrySize);
+		CHECK(statistics.secondsSaved > 0.0);
+	}
+
+	// The source edited again between runs.
+	{
+		DerivedDataCache cache(directory, 1 << 20);
+		CHECK(cache.GetSize() == 3 * EntrySize);
+		Fetcher fetch{ cache };
+		CHECK(fetch(source, 1));
+		CHECK(fetch(source, 2));
+		CHECK(fetch(edited, 1));
+		edited[0] ^= 0x80;
+		CHECK(!fetch(edited, 1));
+		CHECK(fetch.computed == 1);
+
+		// An entry the caller drops is derived again.
+		cache.Remove(GetKey(source, 2));
+		CHECK(!std::filesystem::exists(GetPath(directory, GetKey(source, 2))));
+		CHECK(!fetch(source, 2));
+		CHECK(fetch.computed == 2);
+	}
+}
+
+// Truncated and foreign entries are derived again, temporaries of a run that ended while it stored
+// are cleared on start.
+static void TestCorruption(const std::filesystem::path& directory)
+{
+	const std::vector<uint8_t> source = CreateSource();
+	const auto path = GetPath(directory, GetKey(source, 1));
+	{
+		DerivedDataCache cache(directory, 1 << 20);
+		Fetcher fetch{ cache };
+		CHECK(!fetch(source, 1));
+	}
+
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+	{
+		DerivedDataCache cache(directory, 1 << 20);
+		Fetcher fetch{ cache };
+		CHECK(!fetch(source, 1));
+		CHECK(fetch(source, 1));
+		CHECK(fetch.computed == 1);
+
+		// The key in the header is another one.
+		{
+			std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+			const uint64_t key = 42;
+			file.seekp(8);
+			file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+		}
+		CHECK(!fetch(source, 1));
+		CHECK(fetch(source, 1));
+		CHECK(fetch.computed == 2);
+	}
+
+	std::ofstream(directory / "0000000000000001.ddc.7.tmp") << "x";
+	std::ofstream(directory / "notes.txt") << "x";
+	{
+		DerivedDataCache cache(directory, 1 << 20);
+		CHECK(CountFiles(directory, ".tmp") == 0);
+		CHECK(std::filesystem::exists(directory / "notes.txt"));
+		CHECK(cache.GetSize() == EntrySize);
+	}
+}
+
+// Past its capacity the least recently used entries go, hits count as use, and the next run picks
+// the order up from the file times.
+static void TestEviction(const std::filesystem::path& directory)
+{
+	const std::vector<uint8_t> source = CreateSource();
+	{
+		DerivedDataCache cache(directory, 3 * EntrySize);
+		Fetcher fetch{ cache };
+		for (uint32_t setting = 0; setting < 3; ++setting)
+			CHECK(!fetch(source, setting));
+		CHECK(cache.GetStatistics().evictions == 0);
+
+		// 1 is the least recently used after the hit on 0.
+		CHECK(fetch(source, 0));
+		CHECK(!fetch(source, 3));
+		CHECK(cache.GetStatistics().evictions == 1);
+		CHECK(!std::filesystem::exists(GetPath(directory, GetKey(source, 1))));
+		CHECK(fetch(source, 0));
+		CHECK(fetch(source, 2));
+		CHECK(fetch(source, 3));
+
+		// Now 0 is.
+		CHECK(!fetch(source, 1));
+		CHECK(cache.GetStatistics().evictions == 2);
+		CHECK(!std::filesystem::exists(GetPath(directory, GetKey(source, 0))));
+		CHECK(CountFiles(directory, ".ddc") == 3);
+		CHECK(cache.GetSize() == 3 * EntrySize);
+
+		// Larger than the whole cache, derived every time and never stored.
+		const std::vector<uint8_t> large(5000, 1);
+		CHECK(!fetch(large, 0));
+		CHECK(!fetch(large, 0));
+		CHECK(cache.GetStatistics().evictions == 2);
+		CHECK(CountFiles(directory, ".ddc") == 3);
+	}
+
+	// 2, 3 and 1 from the oldest, a smaller capacity evicts 2 on start.
+	{
+		DerivedDataCache cache(directory, 2 * EntrySize);
+		CHECK(CountFiles(directory, ".ddc") == 2);
+		CHECK(cache.GetSize() == 2 * EntrySize);
+		CHECK(cache.GetStatistics().evictions == 0);
+		Fetcher fetch{ cache };
+		CHECK(fetch(source, 3));
+		CHECK(fetch(source, 1));
+		CHECK(!fetch(source, 2));
+	}
+}
+
+// Import jobs fetching from several threads, with the cache evicting all along.
+static void TestThreads(const std::filesystem::path& directory)
+{
+	DerivedDataCache cache(directory, 64 * EntrySize);
+	std::vector<std::vector<uint8_t>> sources(100, CreateSource());
+	for (size_t i = 0; i < sources.size(); ++i)
+		sources[i][0] = static_cast<uint8_t>(i);
+
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<int> wrong{ 0 };
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < 8; ++t)
+	{
+		threads.emplace_back([&, t]
+		{
+			std::mt19937 random(t);
+			for (int fetch = 0; fetch < 300; ++fetch)
+			{
+				const auto& source = sources[random() % sources.size()];
+				std::vector<uint8_t> data;
+				hits += cache.Fetch(GetKey(source, 9), data, [&source](std::vector<uint8_t>& result) { result = Derive(source, 9); }) ? 1 : 0;
+				wrong += data != Derive(source, 9) ? 1 : 0;
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	const auto statistics = cache.GetStatistics();
+	CHECK(wrong.load() == 0);
+	CHECK(statistics.hits + statistics.misses == 8 * 300 && statistics.hits == hits.load());
+	CHECK(statistics.evictions > 0);
+	CHECK(cache.GetSize() <= 64 * EntrySize);
+	CHECK(CountFiles(directory, ".ddc") == cache.GetSize() / EntrySize);
+	CHECK(CountFiles(directory, ".tmp") == 0);
+}
+
+int main()
+{
+	const auto root = std::filesystem::temp_directory_path() / "DerivedDataCacheTest";
+	std::filesystem::remove_all(root);
+
+	TestInvalidation(root / "Invalidation");
+	TestCorruption(root / "Corruption");
+	TestEviction(root / "Eviction");
+	TestThreads(root / "Threads");
+
+	std::filesystem::remove_all(root);
+	return Test::Result();
+}
@@ -0,0 +1,206 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/DescriptorRing.h"
+#include <barrier>
+#include <random>
+
+using namespace Amadeus;
+
+// One thread: allocations fill a chunk before the next one is reserved, the ring runs out when the
+// frames in flight hold every chunk and gets them back as their fences complete.
+static void TestFrames()
+{
+	DescriptorRing ring(64, 16);
+	CHECK(ring.GetCapacity() == 64 && ring.GetChunkSize() == 16);
+
+	ring.BeginFrame(0);
+	CHECK(ring.Allocate(4) == 0);
+	CHECK(ring.Allocate(10) == 4);
+	// Three slots do not fit in the rest of the chunk.
+	CHECK(ring.Allocate(3) == 16);
+	CHECK(ring.GetUsed() == 32);
+	ring.EndFrame(1);
+
+	// A new frame starts a new chunk.
+	ring.BeginFrame(0);
+	CHECK(ring.Allocate(1) == 32);
+	CHECK(ring.Allocate(16) == 48);
+	CHECK(ring.Allocate(1) == DescriptorRing::InvalidSlot);
+	CHECK(ring.GetUsed() == 64);
+	ring.EndFrame(2);
+
+	ring.BeginFrame(0);
+	CHECK(ring.Allocate(1) == DescriptorRing::InvalidSlot);
+	ring.EndFrame(3);
+	CHECK(ring.GetUsed() == 64);
+
+	// The first frame completed, its two chunks come back and wrap to the start of the ring.
+	ring.BeginFrame(1);
+	CHECK(ring.GetUsed() == 32);
+	CHECK(ring.Allocate(2) == 0);
+	CHECK(ring.Allocate(16) == 16);
+	CHECK(ring.Allocate(1) == DescriptorRing::InvalidSlot);
+	ring.EndFrame(4);
+
+	ring.BeginFrame(4);
+	CHECK(ring.GetUsed() == 0);
+	CHECK(ring.Allocate(1) == 32);
+	ring.EndFrame(5);
+}
+
+// Tables of more than one slot stay in a row: one that does not fit in the rest of a chunk starts
+// the next, even when another thread took the chunk right after, the way the descriptor cache reserves
+// the IBL table next to single appends.
+static void TestTables()
+{
+	DescriptorRing ring(128, 32);
+	ring.BeginFrame(0);
+	for (uint32_t i = 0; i < 31; ++i)
+		CHECK(ring.Allocate() == i);
+
+	// Another thread reserves its chunk between this one's two.
+	uint32_t other = 0;
+	std::thread([&] { other = ring.Allocate(4); }).join();
+	CHECK(other == 32);
+
+	// Slot 31 is left over, the table goes to a new chunk past the other thread's.
+	const uint32_t table = ring.Allocate(2);
+	CHECK(table == 64);
+	CHECK(ring.Allocate(1) == 66);
+	CHECK(ring.Allocate(30) == 96);
+	CHECK(ring.Allocate(2) == 126);
+	// The ring is full, no chunk is left for a table that does not fit.
+	CHECK(ring.Allocate(3) == DescriptorRing::InvalidSlot);
+	ring.EndFrame(1);
+
+	// Tables filling a chunk exactly, after the ring wrapped.
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(16) == 0);
+	CHECK(ring.Allocate(16) == 16);
+	CHECK(ring.Allocate(32) == 32);
+	ring.EndFrame(2);
+
+	// Threads mixing tables with single slots: no table crosses a chunk and no slot is taken twice.
+	ring.BeginFrame(2);
+	std::vector<std::atomic<int>> taken(128);
+	std::atomic<int> errors{ 0 };
+	std::vector<std::thread> threads;
+	for (uint32_t thread = 0; thread < 4; ++thread)
+	{
+		threads.emplace_back([&, thread]
+		{
+			std::mt19937 random(thread);
+			for (int i = 0; i < 12; ++i)
+			{
+				const uint32_t count = i % 2 ? 1 : 2 + random() % 7;
+				const uint32_t slot = ring.Allocate(count);
+				if (slot == DescriptorRing::InvalidSlot)
+					continue;
+				if (slot / 32 != (slot + count - 1) / 32)
+					++errors;
+				for (uint32_t k = 0; k < count; ++k)
+					errors += taken[slot + k].fetch_add(1) != 0 ? 1 : 0;
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	ring.EndFrame(3);
+	CHECK(errors.load() == 0);
+}
+
+// Threads allocate between a BeginFrame and an EndFrame on the main thread while a simulated gpu
+// completes the frames a varying number of frames late. No slot is handed out twice in a frame or
+// again before the fence of the frame that had it completes. Meant to run under ThreadSanitizer too,
+// see AMADEUS_SANITIZE.
+static void TestThreads()
+{
+	const uint32_t capacity = 3 * 1024;
+	const uint32_t chunkSize = 32;
+	const uint32_t threadCount = 8;
+	const uint32_t frames = 5000;
+	const size_t framesInFlight = 3;
+
+	DescriptorRing ring(capacity, chunkSize);
+	// Fence of the frame that last had the slot.
+	std::vector<std::atomic<uint64_t>> owners(capacity);
+	std::atomic<uint64_t> allocated{ 0 };
+	std::atomic<uint64_t> exhausted{ 0 };
+	std::atomic<uint64_t> errors{ 0 };
+	// Written by the main thread between the barriers only.
+	uint64_t fence = 1;
+	uint64_t completed = 0;
+
+	std::barrier sync(threadCount + 1);
+	std::vector<std::thread> threads;
+	for (uint32_t thread = 0; thread < threadCount; ++thread)
+	{
+		threads.emplace_back([&, thread]
+		{
+			std::mt19937 random(thread);
+			for (uint32_t frame = 0; frame < frames; ++frame)
+			{
+				sync.arrive_and_wait();
+				const uint32_t allocations = random() % 160;
+				for (uint32_t i = 0; i < allocations; ++i)
+				{
+					const uint32_t count = 1 + random() % 4;
+					const uint32_t slot = ring.Allocate(count);
+					if (slot == DescriptorRing::InvalidSlot)
+					{
+						exhausted.fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+					if (slot + count > capacity)
+					{
+						errors.fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+					for (uint32_t k = 0; k < count; ++k)
+					{
+						const uint64_t previous = owners[slot + k].exchange(fence, std::memory_order_relaxed);
+						if (previous == fence || previous > completed)
+							errors.fetch_add(1, std::memory_order_relaxed);
+					}
+					allocated.fetch_add(count, std::memory_order_relaxed);
+				}
+				sync.arrive_and_wait();
+			}
+		});
+	}
+
+	std::deque<uint64_t> pending;
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		sync.arrive_and_wait();
+		sync.arrive_and_wait();
+		ring.EndFrame(fence);
+		pending.push_back(fence++);
+		const size_t lag = frame * 7919u % (framesInFlight + 1);
+		while (pending.size() > lag)
+		{
+			completed = pending.front();
+			pending.pop_front();
+		}
+		ring.BeginFrame(completed);
+		if (ring.GetUsed() > capacity)
+			errors.fetch_add(1, std::memory_order_relaxed);
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	CHECK(errors.load() == 0);
+	// Frames held back by the gpu run the ring out, and the ring is reused many times over.
+	CHECK(exhausted.load() > 0);
+	CHECK(allocated.load() > 100ull * capacity);
+	std::printf("%u threads, %u frames: %llu slots, %llu allocations failed on a full ring\n", threadCount, frames,
+		static_cast<unsigned long long>(allocated.load()), static_cast<unsigned long long>(exhausted.load()));
+}
+
+int main()
+{
+	TestFrames();
+	TestTables();
+	TestThreads();
+	return Test::Result();
+}
@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/DrawList.h"
+#include <random>
+
+using namespace Amadeus;
+
+// The radix sort orders like std::stable_sort over the keys, ties keep the order they were added in.
+static void TestSort()
+{
+	std::mt19937 random(1);
+	DrawList list;
+	for (size_t count : { 0, 1, 2, 17, 1000, 100000 })
+	{
+		// Few distinct keys give long runs of ties, random bytes give every digit a pass.
+		for (uint64_t mask : { 0x7ull, 0xF00000FF00000000ull, ~0ull })
+		{
+			list.Clear();
+			std::vector<std::pair<uint64_t, uint32_t>> expected;
+			for (uint32_t item = 0; item < count; ++item)
+			{
+				const uint64_t key = ((static_cast<uint64_t>(random()) << 32) | random()) & mask;
+				list.Add(key, item);
+				expected.push_back({ key, item });
+			}
+			list.Sort();
+			std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+			bool bEqual = list.Size() == count;
+			for (size_t i = 0; i < count && bEqual; ++i)
+				bEqual = list.GetKeys()[i] == expected[i].first && list.GetItems()[i] == expected[i].second;
+			CHECK(bEqual);
+		}
+	}
+
+	// Sorting a sorted list keeps it, every byte the same in every key is skipped.
+	list.Clear();
+	for (uint32_t item = 0; item < 100; ++item)
+		list.Add(0x1234, item);
+	list.Sort();
+	list.Sort();
+	CHECK(list.GetItems()[0] == 0 && list.GetItems()[99] == 99);
+}
+
+// Every pass is one contiguous range, the first and the last pass included.
+static void TestRange()
+{
+	const uint32_t passCount = 1u << DrawList::PassBits;
+	std::mt19937 random(2);
+	DrawList list;
+	std::vector<uint32_t> passes;
+	for (uint32_t item = 0; item < 5000; ++item)
+	{
+		// Passes 5 and 9 stay empty.
+		uint32_t pass = random() % passCount;
+		if (pass == 5 || pass == 9)
+			pass = 15;
+		passes.push_back(pass);
+		list.Add(DrawList::MakeKey(pass, random() % 256, random() % (1u << DrawList::MaterialBits), static_cast<float>(random() % 1000)), item);
+	}
+	list.Sort();
+
+	size_t covered = 0;
+	size_t previousEnd = 0;
+	for (uint32_t pass = 0; pass < passCount; ++pass)
+	{
+		const auto [begin, end] = list.GetRange(pass);
+		CHECK(begin == previousEnd && begin <= end);
+		bool bInPass = true;
+		for (size_t i = begin; i < end; ++i)
+			bInPass &= passes[list.GetItems()[i]] == pass;
+		CHECK(bInPass);
+		CHECK(end - begin == static_cast<size_t>(std::count(passes.begin(), passes.end(), pass)));
+		covered += end - begin;
+		previousEnd = end;
+	}
+	CHECK(covered == list.Size() && previousEnd == list.Size());
+	CHECK(list.GetRange(5).first == list.GetRange(5).second);
+	CHECK(list.GetRange(15).second == list.Size() && list.GetRange(15).first < list.Size());
+
+	list.Clear();
+	list.Sort();
+	CHECK(list.GetRange(0) == std::make_pair(size_t(0), size_t(0)));
+	CHECK(list.GetRange(15) == std::make_pair(size_t(0), size_t(0)));
+}
+
+// Depth bits order like the floats, negative depths behind the camera before every positive one.
+static void TestDepth()
+{
+	const float depths[] = { -FLT_MAX, -1000.0f, -1.5f, -1.0f, -FLT_MIN, -0.0f, 0.0f, FLT_MIN, 0.5f, 1.0f, 2.0f, 1000.0f, FLT_MAX };
+	for (size_t i = 1; i < std::size(depths); ++i)
+		CHECK(DrawList::GetDepthBits(depths[i - 1]) <= DrawList::GetDepthBits(depths[i]));
+	CHECK(DrawList::GetDepthBits(-1.0f) < DrawList::GetDepthBits(-0.5f));
+	CHECK(DrawList::GetDepthBits(-0.5f) < DrawList::GetDepthBits(0.5f));
+
+	// Front to back: grouped by pipeline, then material, nearest first inside a group.
+	DrawList list;
+	list.Add(DrawList::MakeKey(1, 2, 7, 5.0f), 0);
+	list.Add(DrawList::MakeKey(1, 2, 7, -3.0f), 1);
+	list.Add(DrawList::MakeKey(1, 1, 9, 100.0f), 2);
+	list.Add(DrawList::MakeKey(1, 2, 3, 50.0f), 3);
+	list.Add(DrawList::MakeKey(1, 2, 7, -0.5f), 4);
+	list.Add(DrawList::MakeKey(0, 200, 1000, 1e6f), 5);
+	list.Sort();
+	CHECK(list.GetItems() == std::vector<uint32_t>({ 5, 2, 3, 1, 4, 0 }));
+}
+
+// Back to front: furthest first whatever the state, state only breaks ties in depth.
+static void TestBackToFront()
+{
+	DrawList list;
+	list.Add(DrawList::MakeBackToFrontKey(6, 0, 1, 10.0f), 0);
+	list.Add(DrawList::MakeBackToFrontKey(6, 3, 0, 30.0f), 1);
+	list.Add(DrawList::MakeBackToFrontKey(6, 1, 5, -2.0f), 2);
+	list.Add(DrawList::MakeBackToFrontKey(6, 0, 2, 20.0f), 3);
+	list.Add(DrawList::MakeBackToFrontKey(6, 2, 0, 10.0f), 4);
+	list.Add(DrawList::MakeBackToFrontKey(6, 0, 4, 10.0f), 5);
+	list.Add(DrawList::MakeKey(5, 0, 0, 1.0f), 6);
+	list.Sort();
+	CHECK(list.GetItems() == std::vector<uint32_t>({ 6, 1, 3, 0, 5, 4, 2 }));
+	CHECK(list.GetRange(6) == std::make_pair(size_t(1), size_t(7)));
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> depth(-50.0f, 500.0f);
+	list.Clear();
+	std::vector<float> depths;
+	for (uint32_t item = 0; item < 10000; ++item)
+	{
+		depths.push_back(depth(random));
+		list.Add(DrawList::MakeBackToFrontKey(15, random() % 256, random() % 1000, depths.back()), item);
+	}
+	list.Sort();
+	bool bOrdered = true;
+	for (size_t i = 1; i < list.Size(); ++i)
+		bOrdered &= depths[list.GetItems()[i - 1]] >= depths[list.GetItems()[i]];
+	CHECK(bOrdered);
+}
+
+int main()
+{
+	TestSort();
+	TestRange();
+	TestDepth();
+	TestBackToFront();
+	return Test::Result();
+}
@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "Test.h"
+#include "Camera.h"
+#include "Common/FrustumCuller.h"
+#include <array>
+#include <random>
+
+using namespace Amadeus;
+
+// Culls 100k world boxes scattered over a 300 unit wide level against a camera frustum and an
+// orthographic shadow frustum, with the SSE2 kernel and the scalar reference, and transforms
+// them from object space the way MeshManager does before culling. Reports the mean over 100 runs.
+int main()
+{
+	const size_t count = 100000;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-150.0f, 150.0f), size(0.1f, 4.0f);
+	FrustumCuller::Boxes boxes;
+	std::vector<std::array<float, 6>> objectBoxes(count);
+	for (auto& box : objectBoxes)
+	{
+		const float center[3] = { position(random), position(random) * 0.3f, position(random) };
+		const float extent[3] = { size(random), size(random), size(random) };
+		box = { center[0] - extent[0], center[1] - extent[1], center[2] - extent[2],
+			center[0] + extent[0], center[1] + extent[1], center[2] + extent[2] };
+		boxes.Add(&box[0], &box[3]);
+	}
+
+	Test::Matrix view, projection, camera, lightView, lightProjection, light;
+	const float eye[3] = { 0.0f, 5.0f, -60.0f }, direction[3] = { 0.2f, -0.1f, 1.0f };
+	Test::LookTo(eye, direction, view);
+	Test::Perspective(0.8f, 16.0f / 9.0f, 0.1f, 200.0f, projection);
+	Test::Multiply(view, projection, camera);
+	const float lightEye[3] = { 20.0f, 30.0f, -20.0f }, lightDirection[3] = { -1.0f, -1.5f, 1.0f };
+	Test::LookTo(lightEye, lightDirection, lightView);
+	Test::Orthographic(45.0f, 45.0f, 0.1f, 40.0f, lightProjection);
+	Test::Multiply(lightView, lightProjection, light);
+
+	auto measure = [](auto&& cull)
+	{
+		cull();
+		const auto start = std::chrono::steady_clock::now();
+		for (int run = 0; run < 100; ++run)
+			cull();
+		return Test::SecondsSince(start) * 1e3 / 100;
+	};
+
+	std::vector<uint8_t> visible(count), reference(count);
+	bool bMatches = true;
+	std::printf("%-8s %9s %10s %10s %8s\n", "frustum", "visible", "sse2 ms", "scalar ms", "speedup");
+	for (const auto& [name, matrix] : { std::pair<const char*, const Test::Matrix*>{ "camera", &camera }, { "shadow", &light } })
+	{
+		const FrustumCuller::Frustum frustum = FrustumCuller::CreateFrustum(*matrix);
+		const double sse = measure([&] { FrustumCuller::Cull(frustum, boxes, 0, count, visible.data()); });
+		const double scalar = measure([&] { FrustumCuller::CullScalar(frustum, boxes, 0, count, reference.data()); });
+		bMatches &= visible == reference;
+		std::printf("%-8s %9zu %10.3f %10.3f %7.1fx\n", name,
+			static_cast<size_t>(std::count(visible.begin(), visible.end(), 1)), sse, scalar, scalar / sse);
+	}
+
+	// Object boxes under a rotation and scale, transformed into the arrays and culled each frame.
+	const float world[4][4] = { { 0.0f, 0.0f, 1.5f, 0.0f }, { 0.0f, 1.5f, 0.0f, 0.0f }, { -1.5f, 0.0f, 0.0f, 0.0f }, { 3.0f, 0.0f, -2.0f, 1.0f } };
+	const FrustumCuller::Frustum frustum = FrustumCuller::CreateFrustum(camera);
+	FrustumCuller::Boxes transformed;
+	const double total = measure([&]
+	{
+		transformed.Clear();
+		for (const auto& box : objectBoxes)
+		{
+			float minimum[3], maximum[3];
+			FrustumCuller::TransformBox(world, &box[0], &box[3], minimum, maximum);
+			transformed.Add(minimum, maximum);
+		}
+		FrustumCuller::Cull(frustum, transformed, 0, count, visible.data());
+	});
+	std::printf("transform and cull %zu object boxes: %.3f ms\n", count, total);
+
+	if (!bMatches)
+		std::printf("FAIL the SSE2 kernel disagrees with the scalar reference\n");
+	return bMatches ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "Test.h"
+
+using namespace Amadeus;
+
+// Each job does about as much as a small engine job that hands its result on.
+static void Work(std::vector<uint32_t>& results, size_t index)
+{
+	uint32_t value = static_cast<uint32_t>(index);
+	for (int i = 0; i < 16; ++i)
+		value = value * 1664525u + 1013904223u;
+	results[index] = value;
+}
+
+int main(int argc, char** argv)
+{
+	const size_t threads = argc > 1 ? std::stoul(argv[1]) : (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+	std::printf("%zu worker threads, %u hardware threads\n", threads, std::thread::hardware_concurrency());
+	std::printf("%-10s %-26s %10s %12s\n", "jobs", "system", "ms", "Mjobs/s");
+
+	ThreadPool pool(threads, L"ThreadPool");
+	JobSystem jobs(threads, L"JobSystem");
+	for (size_t count : { size_t(10000), size_t(100000), size_t(1000000) })
+	{
+		std::vector<uint32_t> results(count);
+		auto report = [&](const char* system, double seconds)
+		{
+			std::printf("%-10zu %-26s %10.2f %12.2f\n", count, system, seconds * 1e3, count / seconds / 1e6);
+		};
+
+		// What RenderSystem::Submit used to do, one future per job.
+		{
+			const auto start = std::chrono::steady_clock::now();
+			std::vector<std::future<void>> futures;
+			futures.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+				futures.push_back(pool.enqueue(Work, std::ref(results), i));
+			for (auto& future : futures)
+				future.get();
+			report("ThreadPool::enqueue", Test::SecondsSince(start));
+		}
+
+		// The same interface on the job system.
+		{
+			const auto start = std::chrono::steady_clock::now();
+			std::vector<std::future<void>> futures;
+			futures.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+				futures.push_back(jobs.Enqueue(Work, std::ref(results), i));
+			for (auto& future : futures)
+				future.get();
+			report("JobSystem::Enqueue", Test::SecondsSince(start));
+		}
+
+		// Children of one root as MeshManager and FrameGraph use it.
+		{
+			const auto start = std::chrono::steady_clock::now();
+			Job* root = jobs.CreateJob([] {});
+			for (size_t i = 0; i < count; ++i)
+				jobs.Run(jobs.CreateChildJob(root, [&results, i] { Work(results, i); }));
+			jobs.Run(root);
+			jobs.Wait(root);
+			report("JobSystem child jobs", Test::SecondsSince(start));
+		}
+	}
+	return 0;
+}
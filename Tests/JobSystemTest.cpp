@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "Test.h"
+
+using namespace Amadeus;
+
+static void TestChildren(JobSystem& jobs)
+{
+	// Children that create children of their own, the root waits for all of them.
+	std::atomic<int> count{ 0 };
+	Job* root = jobs.CreateJob([] {});
+	for (int i = 0; i < 100; ++i)
+	{
+		jobs.Run(jobs.CreateChildJob(root, [&jobs, &count, root]
+		{
+			for (int j = 0; j < 10; ++j)
+				jobs.Run(jobs.CreateChildJob(root, [&count] { count.fetch_add(1, std::memory_order_relaxed); }));
+			count.fetch_add(1, std::memory_order_relaxed);
+		}));
+	}
+	jobs.Run(root);
+	jobs.Wait(root);
+	CHECK(root->IsFinished());
+	CHECK(count.load() == 1100);
+}
+
+static void TestExceptions(JobSystem& jobs)
+{
+	// A root whose child throws and one that does not, waited on in the other order.
+	Job* failing = jobs.CreateJob([] {});
+	Job* passing = jobs.CreateJob([] {});
+	jobs.Run(jobs.CreateChildJob(failing, [] { throw std::runtime_error("failing child"); }));
+	jobs.Run(jobs.CreateChildJob(failing, [] { throw std::runtime_error("second failing child"); }));
+	std::atomic<int> count{ 0 };
+	for (int i = 0; i < 10; ++i)
+		jobs.Run(jobs.CreateChildJob(passing, [&count] { ++count; }));
+	jobs.Run(failing);
+	jobs.Run(passing);
+
+	bool bThrown = false;
+	try
+	{
+		jobs.Wait(passing);
+	}
+	catch (...)
+	{
+		bThrown = true;
+	}
+	CHECK(!bThrown);
+	CHECK(count.load() == 10);
+
+	std::string message;
+	try
+	{
+		jobs.Wait(failing);
+	}
+	catch (const std::runtime_error& error)
+	{
+		message = error.what();
+	}
+	CHECK(message == "failing child" || message == "second failing child");
+
+	// Nothing is left behind for the next root.
+	Job* next = jobs.CreateJob([] {});
+	jobs.Run(next);
+	bThrown = false;
+	try
+	{
+		jobs.Wait(next);
+	}
+	catch (...)
+	{
+		bThrown = true;
+	}
+	CHECK(!bThrown);
+}
+
+static void TestBackgroundException(JobSystem& jobs)
+{
+	// Nobody waits on a background job, what it throws does not surface in an unrelated Wait.
+	std::atomic<bool> bRan{ false };
+	jobs.RunBackground(jobs.CreateJob([&bRan]
+	{
+		bRan.store(true);
+		throw std::runtime_error("background");
+	}));
+	while (!bRan.load())
+		std::this_thread::yield();
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	Job* root = jobs.CreateJob([] {});
+	jobs.Run(root);
+	bool bThrown = false;
+	try
+	{
+		jobs.Wait(root);
+	}
+	catch (...)
+	{
+		bThrown = true;
+	}
+	CHECK(!bThrown);
+}
+
+static void TestPinnedRoot(JobSystem& jobs)
+{
+	// A finished root that is not waited on yet keeps its slot through a full wrap of the pool.
+	Job* pinned = jobs.CreateJob([] {});
+	jobs.Run(jobs.CreateChildJob(pinned, [] { throw std::runtime_error("pinned"); }));
+	jobs.Run(pinned);
+	while (!pinned->IsFinished())
+		std::this_thread::yield();
+
+	bool bReused = false;
+	for (size_t i = 0; i < 2 * JobSystem::JobPoolSize; ++i)
+	{
+		Job* job = jobs.CreateJob([] {});
+		bReused |= job == pinned;
+		jobs.Run(job);
+		jobs.Wait(job);
+	}
+	CHECK(!bReused);
+
+	// Its exception waited for it as well.
+	bool bThrown = false;
+	try
+	{
+		jobs.Wait(pinned);
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown);
+
+	// Waited on, the slot is free again.
+	bool bFreed = false;
+	for (size_t i = 0; i < JobSystem::JobPoolSize && !bFreed; ++i)
+	{
+		Job* job = jobs.CreateJob([] {});
+		bFreed = job == pinned;
+		jobs.Run(job);
+		jobs.Wait(job);
+	}
+	CHECK(bFreed);
+}
+
+static void TestForeignThreads(JobSystem& jobs)
+{
+	// Threads that are not workers create, run and wait on their own roots.
+	std::atomic<int> count{ 0 };
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&jobs, &count]
+		{
+			for (int k = 0; k < 50; ++k)
+			{
+				Job* root = jobs.CreateJob([] {});
+				for (int i = 0; i < 20; ++i)
+					jobs.Run(jobs.CreateChildJob(root, [&count] { count.fetch_add(1, std::memory_order_relaxed); }));
+				jobs.Run(root);
+				jobs.Wait(root);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	CHECK(count.load() == 4 * 50 * 20);
+}
+
+static void TestEnqueue(JobSystem& jobs)
+{
+	auto value = jobs.Enqueue([](int a, int b) { return a * b; }, 6, 7);
+	CHECK(value.get() == 42);
+
+	auto failed = jobs.Enqueue([] { throw std::runtime_error("enqueued"); });
+	bool bThrown = false;
+	try
+	{
+		failed.get();
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown);
+}
+
+int main()
+{
+	JobSystem jobs(3, L"JobSystemTest");
+	TestChildren(jobs);
+	TestExceptions(jobs);
+	TestBackgroundException(jobs);
+	TestPinnedRoot(jobs);
+	TestForeignThreads(jobs);
+	TestEnqueue(jobs);
+	return Test::Result();
+}
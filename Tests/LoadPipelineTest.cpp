@@ -0,0 +1,346 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/LoadPipeline.h"
+#include "Common/SlotList.h"
+#include <random>
+
+using namespace Amadeus;
+using Stage = LoadPipeline::Stage;
+
+// Worker tasks the test runs by hand, so that it decides when they happen.
+struct ManualDispatch
+{
+	std::deque<std::function<void()>> tasks;
+
+	LoadPipeline::Dispatch Get()
+	{
+		return [this](std::function<void()> task) { tasks.push_back(std::move(task)); };
+	}
+
+	size_t RunAll()
+	{
+		size_t count = 0;
+		while (!tasks.empty())
+		{
+			auto task = std::move(tasks.front());
+			tasks.pop_front();
+			task();
+			++count;
+		}
+		return count;
+	}
+
+	// Runs the tasks in a random order, tasks they dispatch included.
+	size_t RunShuffled(std::mt19937& random)
+	{
+		size_t count = 0;
+		while (!tasks.empty())
+		{
+			const auto position = tasks.begin() + random() % tasks.size();
+			auto task = std::move(*position);
+			tasks.erase(position);
+			task();
+			++count;
+		}
+		return count;
+	}
+};
+
+// Main thread tasks run in the order they became ready, Poll honours its limit.
+static void TestPollOrder()
+{
+	ManualDispatch workers;
+	LoadPipeline pipeline(workers.Get());
+	std::vector<int> order;
+	for (int i = 0; i < 10; ++i)
+		pipeline.Add({ { Stage::Commit, true, [&order, i] { order.push_back(i); } } });
+	pipeline.Add({});
+
+	CHECK(pipeline.GetPending(Stage::Commit) == 10);
+	CHECK(pipeline.Poll(3) == 3);
+	CHECK(order.size() == 3);
+	CHECK(pipeline.Poll() == 7);
+	CHECK(order == std::vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+	CHECK(pipeline.Poll() == 0);
+	CHECK(pipeline.Idle());
+	CHECK(pipeline.GetPending(Stage::Commit) == 0);
+	CHECK(pipeline.GetCompleted(Stage::Commit) == 10);
+}
+
+// The next task of an item is handed out only after the previous one returned, a main thread task
+// that follows a worker task becomes ready in the order the worker tasks finished.
+static void TestItemOrder()
+{
+	ManualDispatch workers;
+	LoadPipeline pipeline(workers.Get());
+	std::vector<std::string> log;
+	for (const char* name : { "a", "b" })
+	{
+		const std::string item = name;
+		pipeline.Add({
+			{ Stage::Parse, false, [&log, item] { log.push_back(item + "0"); } },
+			{ Stage::DecodeGeometry, false, [&log, item] { log.push_back(item + "1"); } },
+			{ Stage::Commit, true, [&log, item] { log.push_back(item + "2"); } },
+		});
+	}
+
+	CHECK(workers.tasks.size() == 2);
+	CHECK(pipeline.Poll() == 0);
+	// Runs the first task of both items, which dispatches their second.
+	CHECK(workers.RunAll() == 4);
+	CHECK(log == std::vector<std::string>({ "a0", "b0", "a1", "b1" }));
+	CHECK(pipeline.GetPending(Stage::Parse) == 0);
+	CHECK(pipeline.GetPending(Stage::Commit) == 2);
+	CHECK(!pipeline.Idle());
+
+	CHECK(pipeline.Poll() == 2);
+	CHECK(log.back() == "b2");
+	CHECK(pipeline.Idle());
+	CHECK(pipeline.GetCompleted(Stage::DecodeGeometry) == 2);
+}
+
+// The first exception of a worker task is rethrown by the next Poll and drops the rest of its item,
+// other items carry on.
+static void TestWorkerException()
+{
+	ManualDispatch workers;
+	LoadPipeline pipeline(workers.Get());
+	bool bRanAfter = false;
+	int committed = 0;
+	pipeline.Add({
+		{ Stage::DecodeTexture, false, [] { throw std::runtime_error("decode"); } },
+		{ Stage::Upload, false, [&bRanAfter] { bRanAfter = true; } },
+		{ Stage::Commit, true, [&bRanAfter] { bRanAfter = true; } },
+	});
+	pipeline.Add({ { Stage::DecodeTexture, false, [] { throw std::runtime_error("second"); } } });
+	pipeline.Add({ { Stage::DecodeTexture, false, [] {} }, { Stage::Commit, true, [&committed] { ++committed; } } });
+	workers.RunAll();
+
+	std::string message;
+	try
+	{
+		pipeline.Poll();
+	}
+	catch (const std::runtime_error& exception)
+	{
+		message = exception.what();
+	}
+	CHECK(message == "decode");
+	CHECK(!bRanAfter);
+	CHECK(pipeline.GetPending(Stage::Upload) == 0);
+	CHECK(pipeline.GetPending(Stage::DecodeTexture) == 0);
+	CHECK(pipeline.GetCompleted(Stage::DecodeTexture) == 1);
+
+	// Only the first one is kept, the next Poll goes on with the ready tasks.
+	CHECK(pipeline.Poll() == 1);
+	CHECK(committed == 1);
+	CHECK(pipeline.Idle());
+}
+
+// A main thread task that throws leaves Poll with its exception and drops its item.
+static void TestMainThreadException()
+{
+	ManualDispatch workers;
+	LoadPipeline pipeline(workers.Get());
+	bool bRanAfter = false;
+	pipeline.Add({ { Stage::Commit, true, [] { throw std::runtime_error("commit"); } }, { Stage::Cook, false, [&bRanAfter] { bRanAfter = true; } } });
+	pipeline.Add({ { Stage::Commit, true, [] {} } });
+
+	bool bThrown = false;
+	try
+	{
+		pipeline.Poll();
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown);
+	CHECK(workers.tasks.empty());
+	CHECK(pipeline.GetPending(Stage::Cook) == 0);
+	CHECK(pipeline.Poll() == 1);
+	CHECK(!bRanAfter);
+	CHECK(pipeline.Idle());
+}
+
+// Primitives committed in whatever order their decodes finish keep the ids their meshes reserved in
+// source order, the way the glTF loader commits them. A primitive that fails leaves its id unused.
+static void TestCommitOrder()
+{
+	const size_t counts[] = { 3, 1, 6, 4 };
+	for (uint32_t seed = 0; seed < 20; ++seed)
+	{
+		std::mt19937 random(seed);
+		ManualDispatch workers;
+		LoadPipeline pipeline(workers.Get());
+		std::vector<SlotList<int>> meshes(std::size(counts));
+		std::vector<std::vector<uint64_t>> commits(std::size(counts));
+		int source = 0;
+		for (size_t mesh = 0; mesh < meshes.size(); ++mesh)
+		{
+			uint64_t id = meshes[mesh].Reserve(counts[mesh]);
+			for (size_t i = 0; i < counts[mesh]; ++i, ++id)
+			{
+				const bool bFails = mesh == 2 && i == 1;
+				pipeline.Add({
+					{ Stage::DecodeGeometry, false, [bFails] { if (bFails) throw std::runtime_error("decode"); } },
+					{ Stage::Upload, false, [] {} },
+					{ Stage::Commit, true, [&, mesh, id, source] { meshes[mesh].Set(id, source); commits[mesh].push_back(id); } },
+				});
+				++source;
+			}
+		}
+
+		workers.RunShuffled(random);
+		try
+		{
+			pipeline.Poll();
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+		pipeline.Poll();
+		CHECK(pipeline.Idle());
+
+		bool bShuffled = false;
+		for (const auto& ids : commits)
+			bShuffled |= !std::is_sorted(ids.begin(), ids.end());
+		CHECK(seed > 0 || bShuffled);
+		CHECK(meshes[0].GetItems() == std::vector<int>({ 0, 1, 2 }));
+		CHECK(meshes[1].GetItems() == std::vector<int>({ 3 }));
+		CHECK(meshes[2].GetItems() == std::vector<int>({ 4, 6, 7, 8, 9 }));
+		CHECK(meshes[2].GetSlot(0) == 0 && meshes[2].GetSlot(1) == 2 && meshes[2].GetSlotCount() == 6);
+		CHECK(meshes[3].GetItems() == std::vector<int>({ 10, 11, 12, 13 }));
+	}
+}
+
+// Cancel waits for the worker tasks that started and drops everything else, nothing runs after it
+// returns and items added later are dropped at once.
+static void TestCancel(JobSystem& jobs)
+{
+	auto dispatch = [&jobs](std::function<void()> task) { jobs.RunBackground(jobs.CreateJob(std::move(task))); };
+	LoadPipeline pipeline(dispatch);
+	std::atomic<bool> bCancelled{ false };
+	std::atomic<int> afterCancel{ 0 };
+	for (int i = 0; i < 200; ++i)
+	{
+		pipeline.Add({
+			{ Stage::DecodeGeometry, false, [&] { std::this_thread::sleep_for(std::chrono::microseconds(200)); afterCancel += bCancelled.load(); } },
+			{ Stage::Upload, false, [&] { afterCancel += bCancelled.load(); } },
+			{ Stage::Commit, true, [&] { ++afterCancel; } },
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	pipeline.Cancel();
+	bCancelled = true;
+
+	CHECK(pipeline.Idle());
+	CHECK(pipeline.GetPending(Stage::DecodeGeometry) == 0);
+	CHECK(pipeline.GetPending(Stage::Commit) == 0);
+	CHECK(pipeline.Poll() == 0);
+	pipeline.Add({ { Stage::Commit, true, [&] { ++afterCancel; } } });
+	CHECK(pipeline.Poll() == 0);
+	CHECK(pipeline.Idle());
+	CHECK(afterCancel.load() == 0);
+}
+
+// A random mix of worker and main thread tasks on a job system, with items that fan out from worker
+// tasks. The tasks of one item never overlap, run in order and on the thread they asked for.
+static void TestThreads(JobSystem& jobs)
+{
+	struct ItemLog
+	{
+		std::atomic<int> busy{ 0 };
+		std::atomic<size_t> step{ 0 };
+		std::atomic<bool> bOverlapped{ false };
+		size_t expected = 0;
+	};
+
+	auto dispatch = [&jobs](std::function<void()> task) { jobs.RunBackground(jobs.CreateJob(std::move(task))); };
+	LoadPipeline pipeline(dispatch);
+	const std::thread::id mainThread = std::this_thread::get_id();
+	const size_t parents = 200;
+	const size_t children = 8;
+	std::vector<std::unique_ptr<ItemLog>> logs(parents * (children + 1));
+	for (auto& log : logs)
+		log.reset(new ItemLog());
+	std::atomic<size_t> nextLog{ 0 };
+	std::atomic<int> wrongThread{ 0 };
+
+	auto createTasks = [&](ItemLog* log, size_t count, std::mt19937& random)
+	{
+		std::vector<LoadPipeline::Task> tasks;
+		log->expected = count;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const bool bMainThread = random() % 3 == 0;
+			const Stage stage = static_cast<Stage>(random() % static_cast<uint32_t>(Stage::Count));
+			const int sleep = static_cast<int>(random() % 50);
+			tasks.push_back({ stage, bMainThread, [&, log, i, bMainThread, sleep]
+			{
+				if (log->busy.fetch_add(1) != 0 || log->step.load() != i)
+					log->bOverlapped = true;
+				if ((std::this_thread::get_id() == mainThread) != bMainThread)
+					++wrongThread;
+				if (!bMainThread)
+					std::this_thread::sleep_for(std::chrono::microseconds(sleep));
+				log->step.store(i + 1);
+				log->busy.fetch_sub(1);
+			} });
+		}
+		return tasks;
+	};
+
+	std::mt19937 random(7);
+	for (size_t parent = 0; parent < parents; ++parent)
+	{
+		ItemLog* log = logs[nextLog++].get();
+		auto tasks = createTasks(log, 1 + random() % 4, random);
+		const uint32_t seed = random();
+		tasks.push_back({ Stage::Parse, false, [&, seed]
+		{
+			std::mt19937 childRandom(seed);
+			for (size_t child = 0; child < children; ++child)
+				pipeline.Add(createTasks(logs[nextLog++].get(), 1 + childRandom() % 5, childRandom));
+		} });
+		pipeline.Add(std::move(tasks));
+	}
+
+	size_t polled = 0;
+	while (!pipeline.Idle())
+	{
+		polled += pipeline.Poll();
+		// A frame's jobs in between, as the engine polls between frames.
+		Job* frame = jobs.CreateJob([] {});
+		for (int i = 0; i < 8; ++i)
+			jobs.Run(jobs.CreateChildJob(frame, [] { std::this_thread::sleep_for(std::chrono::microseconds(100)); }));
+		jobs.Run(frame);
+		jobs.Wait(frame);
+	}
+
+	CHECK(nextLog.load() == logs.size());
+	for (const auto& log : logs)
+	{
+		CHECK(!log->bOverlapped);
+		// The fan out task of a parent is not logged.
+		CHECK(log->step.load() == log->expected);
+	}
+	CHECK(wrongThread.load() == 0);
+	for (uint32_t stage = 0; stage < static_cast<uint32_t>(Stage::Count); ++stage)
+		CHECK(pipeline.GetPending(static_cast<Stage>(stage)) == 0);
+	std::printf("%zu items, %zu main thread tasks\n", logs.size(), polled);
+}
+
+int main()
+{
+	TestPollOrder();
+	TestItemOrder();
+	TestWorkerException();
+	TestMainThreadException();
+	TestCommitOrder();
+
+	JobSystem jobs(4, L"LoadPipelineTest");
+	TestCancel(jobs);
+	TestThreads(jobs);
+	return Test::Result();
+}
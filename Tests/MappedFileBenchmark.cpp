@@ -0,0 +1,305 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/MappedFile.h"
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include "tinygltf/tiny_gltf.h"
+#include "tinygltf/json.hpp"
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace Amadeus;
+
+// Loads a generated scene of 32 meshes of 65536 vertices, about 100 MB of buffers, and DamagedHelmet
+// three ways: tinygltf reading the .gltf and its .bin, tinygltf reading the same scene as one .glb,
+// and the .glb mapped and its JSON parsed without the buffers the way LoadGltfAsset does it. Every
+// vertex and index is read after the load, as the vertex decoder would. Each load runs in a process
+// of its own, reports the best time of three, how far the peak resident set grew over the start and
+// how much of the resident set the loaded model keeps private. Mapped pages count as resident once
+// they are read but stay in the page cache, shared and dropped under memory pressure without a write.
+
+struct Result
+{
+	double seconds;
+	long peakKilobytes;
+	long privateKilobytes;
+	double checksum;
+};
+
+// A field of /proc/self/status in kB.
+static long GetStatusKilobytes(const char* field)
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.compare(0, strlen(field), field) == 0)
+			return std::stol(line.substr(strlen(field)));
+	}
+	return 0;
+}
+
+// Anonymous resident memory with the model and its buffers loaded, sampled by ReadVertices.
+static long loadedKilobytes = 0;
+
+// Positions, normals, tangents and texture coordinates, 48 bytes, and a 32 bit index per vertex.
+static void CreateScene(const std::filesystem::path& directory, uint32_t meshCount, uint32_t vertexCount)
+{
+	const size_t attributeSizes[4] = { 12, 12, 16, 8 };
+	const char* attributes[4] = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0" };
+	const char* types[4] = { "VEC3", "VEC3", "VEC4", "VEC2" };
+	const size_t meshSize = static_cast<size_t>(vertexCount) * (48 + 4);
+
+	nlohmann::json document;
+	document["asset"]["version"] = "2.0";
+	document["scene"] = 0;
+	for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+	{
+		document["scenes"][0]["nodes"].push_back(mesh);
+		document["nodes"].push_back({ { "mesh", mesh } });
+		nlohmann::json primitive;
+		size_t offset = mesh * meshSize;
+		for (uint32_t attribute = 0; attribute < 5; ++attribute)
+		{
+			const uint32_t index = mesh * 5 + attribute;
+			const size_t size = attribute < 4 ? attributeSizes[attribute] : 4;
+			document["bufferViews"].push_back({ { "buffer", 0 }, { "byteOffset", offset }, { "byteLength", size * vertexCount } });
+			if (attribute < 4)
+			{
+				primitive["attributes"][attributes[attribute]] = index;
+				document["accessors"].push_back({ { "bufferView", index }, { "componentType", TINYGLTF_COMPONENT_TYPE_FLOAT },
+					{ "count", vertexCount }, { "type", types[attribute] } });
+			}
+			else
+			{
+				primitive["indices"] = index;
+				document["accessors"].push_back({ { "bufferView", index }, { "componentType", TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT },
+					{ "count", vertexCount }, { "type", "SCALAR" } });
+			}
+			offset += size * vertexCount;
+		}
+		document["meshes"].push_back({ { "primitives", { primitive } } });
+	}
+	document["buffers"].push_back({ { "byteLength", meshSize * meshCount } });
+
+	std::vector<uint8_t> bin(meshSize * meshCount);
+	for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+	{
+		float* vertices = reinterpret_cast<float*>(&bin[mesh * meshSize]);
+		for (size_t i = 0; i < static_cast<size_t>(vertexCount) * 12; ++i)
+			vertices[i] = static_cast<float>(i % 1000) * 0.001f;
+		uint32_t* indices = reinterpret_cast<uint32_t*>(&bin[mesh * meshSize + static_cast<size_t>(vertexCount) * 48]);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+			indices[i] = static_cast<uint32_t>(static_cast<uint64_t>(i) * 7 % vertexCount);
+	}
+
+	// The .glb pads its JSON chunk with spaces to four bytes.
+	std::string json = document.dump();
+	json.resize((json.size() + 3) & ~size_t(3), ' ');
+	const uint32_t header[5] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()),
+		static_cast<uint32_t>(json.size()), 0x4E4F534A };
+	const uint32_t binHeader[2] = { static_cast<uint32_t>(bin.size()), 0x004E4942 };
+	std::ofstream glb(directory / "Scene.glb", std::ios::binary);
+	glb.write(reinterpret_cast<const char*>(header), sizeof(header));
+	glb.write(json.data(), json.size());
+	glb.write(reinterpret_cast<const char*>(binHeader), sizeof(binHeader));
+	glb.write(reinterpret_cast<const char*>(bin.data()), bin.size());
+
+	document["buffers"][0]["uri"] = "Scene.bin";
+	std::ofstream(directory / "Scene.gltf") << document.dump();
+	std::ofstream(directory / "Scene.bin", std::ios::binary).write(reinterpret_cast<const char*>(bin.data()), bin.size());
+}
+
+// Reads every element of every accessor of the triangle primitives.
+static double ReadVertices(const tinygltf::Model& model, const std::vector<std::span<const uint8_t>>& buffers)
+{
+	double checksum = 0.0;
+	for (const auto& mesh : model.meshes)
+	{
+		for (const auto& primitive : mesh.primitives)
+		{
+			auto attributes = primitive.attributes;
+			attributes["INDICES"] = primitive.indices;
+			for (const auto& [name, index] : attributes)
+			{
+				const auto& accessor = model.accessors[index];
+				const auto& view = model.bufferViews[accessor.bufferView];
+				const size_t size = tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
+				const size_t stride = view.byteStride ? view.byteStride : size;
+				const uint8_t* data = buffers[view.buffer].data() + view.byteOffset + accessor.byteOffset;
+				uint32_t sum = 0;
+				for (size_t element = 0; element < accessor.count; ++element)
+				{
+					uint32_t word;
+					memcpy(&word, data + element * stride, sizeof(word));
+					sum += word;
+				}
+				checksum += sum;
+			}
+		}
+	}
+	loadedKilobytes = GetStatusKilobytes("RssAnon:");
+	return checksum;
+}
+
+static double LoadFile(const std::filesystem::path& path)
+{
+	tinygltf::TinyGLTF loader;
+	tinygltf::Model model;
+	std::string error, warning;
+	const bool bLoaded = path.extension() == ".glb" ? loader.LoadBinaryFromFile(&model, &error, &warning, path.string())
+		: loader.LoadASCIIFromFile(&model, &error, &warning, path.string());
+	if (!bLoaded)
+		throw std::runtime_error(error);
+
+	std::vector<std::span<const uint8_t>> buffers;
+	for (const auto& buffer : model.buffers)
+		buffers.emplace_back(buffer.data);
+	return ReadVertices(model, buffers);
+}
+
+// LoadGltfAsset without the images: the buffers stay in the mapped files, tinygltf parses the rest.
+static double LoadMapped(const std::filesystem::path& path)
+{
+	std::vector<std::unique_ptr<MappedFile>> files;
+	files.emplace_back(std::make_unique<MappedFile>(path.wstring()));
+	const auto file = files.back()->GetBytes();
+
+	std::span<const uint8_t> json = file;
+	std::span<const uint8_t> bin;
+	if (file.size() >= 28 && memcmp(file.data(), "glTF", 4) == 0)
+	{
+		uint32_t jsonLength, binLength;
+		memcpy(&jsonLength, file.data() + 12, sizeof(jsonLength));
+		json = file.subspan(20, jsonLength);
+		if (file.size() >= 28 + jsonLength)
+		{
+			memcpy(&binLength, file.data() + 20 + jsonLength, sizeof(binLength));
+			bin = file.subspan(28 + jsonLength, binLength);
+		}
+	}
+
+	nlohmann::json document = nlohmann::json::parse(json.begin(), json.end());
+	std::vector<std::span<const uint8_t>> buffers;
+	for (const auto& buffer : document["buffers"])
+	{
+		std::span<const uint8_t> data = bin;
+		if (auto uri = buffer.find("uri"); uri != buffer.end())
+		{
+			files.emplace_back(std::make_unique<MappedFile>((path.parent_path() / uri->get<std::string>()).wstring()));
+			data = files.back()->GetBytes();
+		}
+		buffers.push_back(data.first(buffer.at("byteLength").get<size_t>()));
+	}
+	document.erase("buffers");
+
+	const std::string text = document.dump();
+	tinygltf::TinyGLTF loader;
+	tinygltf::Model model;
+	std::string error, warning;
+	if (!loader.LoadASCIIFromString(&model, &error, &warning, text.c_str(), static_cast<unsigned int>(text.size()), path.parent_path().string()))
+		throw std::runtime_error(error);
+	return ReadVertices(model, buffers);
+}
+
+static long GetPeakKilobytes()
+{
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+// Runs load in a child process so that every load starts from the same resident set.
+static Result Measure(const std::function<double()>& load)
+{
+	int pipeEnds[2];
+	if (pipe(pipeEnds) != 0)
+		throw std::runtime_error("pipe failed");
+	const pid_t child = fork();
+	if (child == 0)
+	{
+		close(pipeEnds[0]);
+		Result result = { 0.0, 0, 0, 0.0 };
+		const long startKilobytes = GetPeakKilobytes();
+		const long startPrivateKilobytes = GetStatusKilobytes("RssAnon:");
+		const auto start = std::chrono::steady_clock::now();
+		try
+		{
+			result.checksum = load();
+		}
+		catch (const std::exception& exception)
+		{
+			std::printf("%s\n", exception.what());
+			result.checksum = -1.0;
+		}
+		result.seconds = Test::SecondsSince(start);
+		result.peakKilobytes = GetPeakKilobytes() - startKilobytes;
+		result.privateKilobytes = loadedKilobytes - startPrivateKilobytes;
+		const ssize_t written = write(pipeEnds[1], &result, sizeof(result));
+		_exit(written == sizeof(result) ? 0 : 1);
+	}
+
+	close(pipeEnds[1]);
+	Result result = { 0.0, 0, 0, -1.0 };
+	if (read(pipeEnds[0], &result, sizeof(result)) != sizeof(result))
+		result.checksum = -1.0;
+	close(pipeEnds[0]);
+	waitpid(child, nullptr, 0);
+	return result;
+}
+
+int main()
+{
+	const auto directory = std::filesystem::temp_directory_path() / "MappedFileBenchmark";
+	std::filesystem::create_directories(directory);
+	CreateScene(directory, 32, 65536);
+	const auto helmet = std::filesystem::path(AMADEUS_ASSETS_DIR) / "Models" / "DamagedHelmet" / "DamagedHelmet.gltf";
+
+	struct Run
+	{
+		const char* name;
+		const char* method;
+		std::filesystem::path path;
+		bool bMapped;
+	};
+	const Run runs[] = {
+		{ "Scene", "tinygltf .gltf", directory / "Scene.gltf", false },
+		{ "Scene", "tinygltf .glb", directory / "Scene.glb", false },
+		{ "Scene", "mapped .glb", directory / "Scene.glb", true },
+		{ "Scene", "mapped .gltf", directory / "Scene.gltf", true },
+		{ "DamagedHelmet", "tinygltf .gltf", helmet, false },
+		{ "DamagedHelmet", "mapped .gltf", helmet, true },
+	};
+
+	std::printf("%-14s %-15s %9s %9s %9s %10s\n", "model", "method", "buffer MB", "load ms", "peak MB", "private MB");
+	double checksum = 0.0;
+	for (const auto& run : runs)
+	{
+		const size_t bufferSize = std::filesystem::file_size(run.path.extension() == ".glb" ? run.path : run.path.parent_path()
+			/ (run.path.stem().string() + ".bin"));
+		Result best = { DBL_MAX, 0, 0, 0.0 };
+		for (int repeat = 0; repeat < 3; ++repeat)
+		{
+			const Result result = Measure([&run] { return run.bMapped ? LoadMapped(run.path) : LoadFile(run.path); });
+			best.seconds = (std::min)(best.seconds, result.seconds);
+			best.peakKilobytes = (std::max)(best.peakKilobytes, result.peakKilobytes);
+			best.privateKilobytes = (std::max)(best.privateKilobytes, result.privateKilobytes);
+			best.checksum = result.checksum;
+		}
+		std::printf("%-14s %-15s %9.1f %9.1f %9.1f %10.1f\n", run.name, run.method, bufferSize / 1e6, best.seconds * 1e3,
+			best.peakKilobytes / 1024.0, best.privateKilobytes / 1024.0);
+
+		// Every method of a model reads the same vertices.
+		if (&run == runs || strcmp(run.name, (&run - 1)->name) != 0)
+			checksum = best.checksum;
+		if (best.checksum < 0.0 || best.checksum != checksum)
+		{
+			std::printf("FAIL %s %s read other vertices\n", run.name, run.method);
+			return 1;
+		}
+	}
+	std::filesystem::remove_all(directory);
+	return 0;
+}
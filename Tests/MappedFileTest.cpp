@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/MappedFile.h"
+
+using namespace Amadeus;
+
+// The mapping holds the bytes of the file, whatever their size.
+static void TestBytes(const std::filesystem::path& directory)
+{
+	for (size_t size : { size_t(1), size_t(4095), size_t(4096), size_t(1 << 20) + 3 })
+	{
+		std::vector<uint8_t> bytes(size);
+		for (size_t i = 0; i < size; ++i)
+			bytes[i] = static_cast<uint8_t>(i * 31 + size);
+		const auto path = directory / "Bytes.bin";
+		std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+		const MappedFile file(path.wstring());
+		const auto mapped = file.GetBytes();
+		CHECK(mapped.size() == size && memcmp(mapped.data(), bytes.data(), size) == 0);
+	}
+}
+
+// The bytes stay valid with the file removed, the mapping keeps it alive.
+static void TestLifetime(const std::filesystem::path& directory)
+{
+	const auto path = directory / "Removed.bin";
+	std::ofstream(path, std::ios::binary) << "mapped";
+	const MappedFile file(path.wstring());
+	std::filesystem::remove(path);
+	const auto mapped = file.GetBytes();
+	CHECK(mapped.size() == 6 && memcmp(mapped.data(), "mapped", 6) == 0);
+}
+
+// Empty files map to no bytes, missing ones throw.
+static void TestInvalid(const std::filesystem::path& directory)
+{
+	std::ofstream(directory / "Empty.bin", std::ios::binary);
+	const MappedFile empty((directory / "Empty.bin").wstring());
+	CHECK(empty.GetBytes().empty());
+
+	bool bThrown = false;
+	try
+	{
+		const MappedFile missing((directory / "Missing.bin").wstring());
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown);
+}
+
+int main()
+{
+	const auto directory = std::filesystem::temp_directory_path() / "MappedFileTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	TestBytes(directory);
+	TestLifetime(directory);
+	TestInvalid(directory);
+
+	std::filesystem::remove_all(directory);
+	return Test::Result();
+}
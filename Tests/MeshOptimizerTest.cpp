@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "Test.h"
+#include "Models.h"
+#include "Common/MeshOptimizer.h"
+#include <random>
+#include <tuple>
+
+using namespace Amadeus;
+
+using Vertex = VertexDecoder::Vertex;
+
+struct Optimized
+{
+	std::vector<uint32_t> cacheIndices;
+	std::vector<uint32_t> indices;
+	std::vector<Vertex> vertices;
+};
+
+// The import pipeline of GltfLoader: vertex cache, overdraw, then vertex fetch.
+static Optimized Optimize(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	Optimized result;
+	result.cacheIndices.resize(indices.size());
+	result.indices.resize(indices.size());
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertices.size(), result.cacheIndices.data());
+	MeshOptimizer::OptimizeOverdraw(result.cacheIndices.data(), result.cacheIndices.size(), vertices[0].position, sizeof(Vertex),
+		vertices.size(), MeshOptimizer::DefaultOverdrawThreshold, result.indices.data());
+	result.vertices = vertices;
+	result.vertices.resize(MeshOptimizer::OptimizeVertexFetch(result.indices.data(), result.indices.size(),
+		result.vertices.data(), result.vertices.size(), sizeof(Vertex)));
+	return result;
+}
+
+// Triangles by the content of their corners, in corner order.
+static std::multiset<std::tuple<float, float, float, float, float, float, float, float, float>> Triangles(
+	const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	std::multiset<std::tuple<float, float, float, float, float, float, float, float, float>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const Vertex& a = vertices[indices[i]];
+		const Vertex& b = vertices[indices[i + 1]];
+		const Vertex& c = vertices[indices[i + 2]];
+		triangles.insert({ a.position[0], a.position[1], a.position[2], b.position[0], b.position[1], b.position[2],
+			c.position[0], c.position[1], c.position[2] });
+	}
+	return triangles;
+}
+
+// Shuffles the triangles and renumbers the vertices, the worst input an exporter could write.
+static void Shuffle(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::vector<uint32_t> triangles(indices.size() / 3);
+	std::iota(triangles.begin(), triangles.end(), 0u);
+	std::shuffle(triangles.begin(), triangles.end(), random);
+	std::vector<uint32_t> remap(vertices.size());
+	std::iota(remap.begin(), remap.end(), 0u);
+	std::shuffle(remap.begin(), remap.end(), random);
+
+	std::vector<uint32_t> shuffledIndices(indices.size());
+	for (size_t i = 0; i < triangles.size(); ++i)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+			shuffledIndices[i * 3 + corner] = remap[indices[triangles[i] * 3 + corner]];
+	}
+	std::vector<Vertex> shuffledVertices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+		shuffledVertices[remap[i]] = vertices[i];
+	indices = std::move(shuffledIndices);
+	vertices = std::move(shuffledVertices);
+}
+
+// Every primitive of the bundled models, as exported and shuffled: the triangles are kept, the
+// vertices end up in first use order, a second run gives the same bytes, and ACMR does not get
+// worse than the overdraw threshold allows. Prints the statistics per model.
+static void TestModels()
+{
+	for (const char* name : { "DamagedHelmet", "Sponza" })
+	{
+		const auto meshes = Test::LoadModel(name);
+		if (meshes.empty())
+		{
+			std::printf("%-14s not available\n", name);
+			continue;
+		}
+
+		for (bool bShuffled : { false, true })
+		{
+			double before[2] = {}, cacheOnly[2] = {}, after[2] = {};
+			size_t triangleCount = 0, vertexCount = 0, fetchedCount = 0;
+			double seconds = 0.0;
+			for (const auto& mesh : meshes)
+			{
+				std::vector<uint32_t> indices = mesh.indices;
+				std::vector<Vertex> vertices = mesh.vertices;
+				if (bShuffled)
+					Shuffle(indices, vertices, 11);
+
+				const auto start = std::chrono::steady_clock::now();
+				const Optimized optimized = Optimize(indices, vertices);
+				seconds += Test::SecondsSince(start);
+
+				CHECK(Triangles(indices, vertices) == Triangles(optimized.indices, optimized.vertices));
+
+				uint32_t next = 0;
+				bool bFetchOrder = true;
+				for (uint32_t index : optimized.indices)
+				{
+					bFetchOrder &= index <= next;
+					if (index == next)
+						++next;
+				}
+				CHECK(bFetchOrder);
+
+				const Optimized again = Optimize(indices, vertices);
+				CHECK(again.indices == optimized.indices);
+				CHECK(again.vertices.size() == optimized.vertices.size()
+					&& memcmp(again.vertices.data(), optimized.vertices.data(), optimized.vertices.size() * sizeof(Vertex)) == 0);
+
+				const auto original = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+				const auto cached = MeshOptimizer::AnalyzeVertexCache(optimized.cacheIndices.data(), optimized.cacheIndices.size(), vertices.size());
+				const auto final = MeshOptimizer::AnalyzeVertexCache(optimized.indices.data(), optimized.indices.size(), optimized.vertices.size());
+				CHECK(final.acmr <= cached.acmr * MeshOptimizer::DefaultOverdrawThreshold);
+				CHECK(final.acmr <= original.acmr * MeshOptimizer::DefaultOverdrawThreshold);
+
+				const size_t triangles = indices.size() / 3;
+				triangleCount += triangles;
+				vertexCount += vertices.size();
+				fetchedCount += optimized.vertices.size();
+				before[0] += original.acmr * triangles;
+				before[1] += original.atvr * triangles;
+				cacheOnly[0] += cached.acmr * triangles;
+				cacheOnly[1] += cached.atvr * triangles;
+				after[0] += final.acmr * triangles;
+				after[1] += final.atvr * triangles;
+			}
+
+			std::printf("%s%s: %zu triangles, %zu -> %zu vertices, %.1f ms\n"
+				"  ACMR %.3f -> %.3f (vertex cache pass %.3f), ATVR %.3f -> %.3f (%.3f)\n",
+				name, bShuffled ? " shuffled" : "", triangleCount, vertexCount, fetchedCount, seconds * 1e3,
+				before[0] / triangleCount, after[0] / triangleCount, cacheOnly[0] / triangleCount,
+				before[1] / triangleCount, after[1] / triangleCount, cacheOnly[1] / triangleCount);
+		}
+	}
+}
+
+// A closed 256x128 UV sphere with shuffled triangles, the ACMR lower bound of a regular grid is
+// about 0.5.
+static void TestSphere()
+{
+	const uint32_t width = 256, height = 128;
+	std::vector<Vertex> vertices;
+	for (uint32_t y = 0; y <= height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const float theta = 3.14159265f * y / height;
+			const float phi = 2.0f * 3.14159265f * x / width;
+			Vertex vertex = {};
+			vertex.position[0] = std::sin(theta) * std::cos(phi);
+			vertex.position[1] = std::cos(theta);
+			vertex.position[2] = std::sin(theta) * std::sin(phi);
+			vertices.push_back(vertex);
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint32_t a = y * width + x, b = y * width + (x + 1) % width;
+			indices.insert(indices.end(), { a, b, a + width, b, b + width, a + width });
+		}
+	}
+	Shuffle(indices, vertices, 5);
+
+	const Optimized optimized = Optimize(indices, vertices);
+	const auto before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	const auto cached = MeshOptimizer::AnalyzeVertexCache(optimized.cacheIndices.data(), optimized.cacheIndices.size(), vertices.size());
+	const auto after = MeshOptimizer::AnalyzeVertexCache(optimized.indices.data(), optimized.indices.size(), optimized.vertices.size());
+	CHECK(cached.acmr < 0.75f);
+	CHECK(after.acmr < 0.8f);
+	std::printf("shuffled sphere: ACMR %.3f -> %.3f (vertex cache pass %.3f), ATVR %.3f -> %.3f\n",
+		before.acmr, after.acmr, cached.acmr, before.atvr, after.atvr);
+}
+
+// Empty input, degenerate triangles and unreferenced vertices.
+static void TestEdgeCases()
+{
+	const auto empty = MeshOptimizer::AnalyzeVertexCache(nullptr, 0, 0);
+	CHECK(empty.acmr == 0.0f && empty.atvr == 0.0f);
+	MeshOptimizer::OptimizeVertexCache(nullptr, 0, 0, nullptr);
+
+	const std::vector<uint32_t> indices = { 0, 0, 1, 1, 2, 2, 0, 1, 2 };
+	std::vector<Vertex> vertices(5);
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		vertices[i] = {};
+		vertices[i].position[0] = static_cast<float>(i);
+		vertices[i].position[1] = static_cast<float>(i * i);
+	}
+	const Optimized optimized = Optimize(indices, vertices);
+	CHECK(optimized.vertices.size() == 3);
+	CHECK(*std::max_element(optimized.indices.begin(), optimized.indices.end()) == 2);
+	CHECK(Triangles(indices, vertices) == Triangles(optimized.indices, optimized.vertices));
+}
+
+int main()
+{
+	TestModels();
+	TestSphere();
+	TestEdgeCases();
+	return Test::Result();
+}
@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/MipGenerator.h"
+#include <random>
+
+using namespace Amadeus;
+
+using Filter = MipGenerator::Filter;
+
+// A tightly packed RGBA image.
+struct Buffer
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+
+	Buffer(uint32_t width, uint32_t height)
+		: width(width)
+		, height(height)
+		, pixels(static_cast<size_t>(width) * height * 4)
+	{
+	}
+
+	MipGenerator::Image GetImage() { return { width, height, static_cast<size_t>(width) * 4, pixels.data() }; }
+};
+
+// Every level below base, each filtered from the one above it the way Texture builds the chain.
+static std::vector<Buffer> CreateChain(Buffer& base, Filter filter, bool bSrgb, bool bScalar)
+{
+	std::vector<Buffer> levels;
+	const uint32_t count = MipGenerator::GetLevelCount(base.width, base.height);
+	levels.reserve(count);
+	Buffer* source = &base;
+	for (uint32_t level = 1; level < count; ++level)
+	{
+		levels.emplace_back(MipGenerator::GetNextSize(source->width), MipGenerator::GetNextSize(source->height));
+		if (bScalar)
+			MipGenerator::DownsampleScalar(source->GetImage(), levels.back().GetImage(), filter, bSrgb);
+		else
+			MipGenerator::Downsample(source->GetImage(), levels.back().GetImage(), filter, bSrgb);
+		source = &levels.back();
+	}
+	return levels;
+}
+
+static void TestLevelCount()
+{
+	CHECK(MipGenerator::GetLevelCount(1, 1) == 1);
+	CHECK(MipGenerator::GetLevelCount(2, 1) == 2);
+	CHECK(MipGenerator::GetLevelCount(256, 1) == 9);
+	CHECK(MipGenerator::GetLevelCount(300, 17) == 9);
+	CHECK(MipGenerator::GetLevelCount(2048, 2048) == 12);
+	CHECK(MipGenerator::GetNextSize(1) == 1 && MipGenerator::GetNextSize(7) == 3 && MipGenerator::GetNextSize(8) == 4);
+}
+
+// The SSE kernels give the scalar reference's bytes, for odd, thin and even sizes, both filters,
+// sRGB and linear.
+static void TestKernels(std::mt19937& random)
+{
+	const std::pair<uint32_t, uint32_t> sizes[] = { { 37, 19 }, { 64, 64 }, { 1, 9 }, { 130, 3 }, { 5, 1 }, { 257, 129 } };
+	for (Filter filter : { Filter::BOX, Filter::KAISER })
+	{
+		for (bool bSrgb : { false, true })
+		{
+			for (const auto& [width, height] : sizes)
+			{
+				Buffer base(width, height);
+				for (auto& byte : base.pixels)
+					byte = static_cast<uint8_t>(random());
+				const auto levels = CreateChain(base, filter, bSrgb, false);
+				const auto reference = CreateChain(base, filter, bSrgb, true);
+				CHECK(levels.size() == MipGenerator::GetLevelCount(width, height) - 1);
+				bool bEqual = levels.size() == reference.size();
+				for (size_t level = 0; level < levels.size() && bEqual; ++level)
+					bEqual = levels[level].pixels == reference[level].pixels;
+				CHECK(bEqual);
+				CHECK(levels.back().width == 1 && levels.back().height == 1);
+			}
+		}
+	}
+}
+
+// A constant image stays constant at every level, the filter weights add up to one.
+static void TestConstant()
+{
+	for (Filter filter : { Filter::BOX, Filter::KAISER })
+	{
+		for (bool bSrgb : { false, true })
+		{
+			Buffer base(45, 33);
+			for (size_t i = 0; i < base.pixels.size(); i += 4)
+			{
+				base.pixels[i] = 10;
+				base.pixels[i + 1] = 128;
+				base.pixels[i + 2] = 250;
+				base.pixels[i + 3] = 77;
+			}
+			bool bConstant = true;
+			for (const auto& level : CreateChain(base, filter, bSrgb, false))
+			{
+				for (size_t i = 0; i < level.pixels.size(); i += 4)
+				{
+					bConstant &= level.pixels[i] == 10 && level.pixels[i + 1] == 128 && level.pixels[i + 2] == 250
+						&& level.pixels[i + 3] == 77;
+				}
+			}
+			CHECK(bConstant);
+		}
+	}
+}
+
+// sRGB color is averaged in linear space, alpha never is.
+static void TestSrgb()
+{
+	// A black and white checker with alpha following the color: 0.5 linear encodes to 188.
+	Buffer checker(2, 2);
+	const uint8_t pixels[16] = { 0, 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 0 };
+	memcpy(checker.pixels.data(), pixels, sizeof(pixels));
+	for (bool bScalar : { false, true })
+	{
+		Buffer result(1, 1);
+		const auto downsample = bScalar ? MipGenerator::DownsampleScalar : MipGenerator::Downsample;
+		downsample(checker.GetImage(), result.GetImage(), Filter::BOX, true);
+		CHECK(result.pixels == std::vector<uint8_t>({ 188, 188, 188, 128 }));
+		downsample(checker.GetImage(), result.GetImage(), Filter::BOX, false);
+		CHECK(result.pixels == std::vector<uint8_t>({ 128, 128, 128, 128 }));
+	}
+
+	// A larger checker stays grey down the chain with either filter.
+	Buffer base(64, 64);
+	for (uint32_t y = 0; y < 64; ++y)
+	{
+		for (uint32_t x = 0; x < 64; ++x)
+			memset(&base.pixels[(static_cast<size_t>(y) * 64 + x) * 4], (x + y) % 2 ? 255 : 0, 4);
+	}
+	for (Filter filter : { Filter::BOX, Filter::KAISER })
+	{
+		const auto levels = CreateChain(base, filter, true, false);
+		const auto& last = levels.back().pixels;
+		CHECK(std::abs(last[0] - 188) <= 1 && std::abs(last[3] - 128) <= 1);
+	}
+}
+
+// The box filter averages the texels a destination texel covers, the edges clamp.
+static void TestBox(std::mt19937& random)
+{
+	Buffer base(8, 6);
+	for (auto& byte : base.pixels)
+		byte = static_cast<uint8_t>(random());
+	Buffer result(4, 3);
+	MipGenerator::Downsample(base.GetImage(), result.GetImage(), Filter::BOX, false);
+	bool bAverage = true;
+	for (uint32_t y = 0; y < 3; ++y)
+	{
+		for (uint32_t x = 0; x < 4; ++x)
+		{
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				auto at = [&](uint32_t column, uint32_t row) { return static_cast<int>(base.pixels[(row * 8 + column) * 4 + channel]); };
+				const int sum = at(2 * x, 2 * y) + at(2 * x + 1, 2 * y) + at(2 * x, 2 * y + 1) + at(2 * x + 1, 2 * y + 1);
+				bAverage &= std::abs(result.pixels[(y * 4 + x) * 4 + channel] * 4 - sum) <= 2;
+			}
+		}
+	}
+	CHECK(bAverage);
+
+	// Three texels to one: the middle one counts fully, the outer ones half.
+	Buffer row(3, 1);
+	const uint8_t pixels[12] = { 0, 0, 0, 0, 90, 90, 90, 90, 255, 255, 255, 255 };
+	memcpy(row.pixels.data(), pixels, sizeof(pixels));
+	Buffer texel(1, 1);
+	MipGenerator::Downsample(row.GetImage(), texel.GetImage(), Filter::BOX, false);
+	CHECK(texel.pixels[0] == 115 && texel.pixels[3] == 115);
+
+	// The Kaiser filter stays inside the range of a ramp away from its ends.
+	Buffer ramp(64, 1);
+	for (uint32_t x = 0; x < 64; ++x)
+		memset(&ramp.pixels[x * 4], static_cast<int>(x * 4), 4);
+	Buffer half(32, 1);
+	MipGenerator::Downsample(ramp.GetImage(), half.GetImage(), Filter::KAISER, false);
+	bool bMonotone = true;
+	for (uint32_t x = 4; x < 28; ++x)
+		bMonotone &= half.pixels[x * 4] < half.pixels[(x + 1) * 4];
+	CHECK(bMonotone);
+}
+
+// Rows further apart than their width read the same texels, for the source and the destination.
+static void TestPitch(std::mt19937& random)
+{
+	Buffer base(17, 16);
+	for (auto& byte : base.pixels)
+		byte = static_cast<uint8_t>(random());
+	const size_t sourcePitch = 17 * 4 + 20;
+	std::vector<uint8_t> source(sourcePitch * 16, 0xCD);
+	for (uint32_t y = 0; y < 16; ++y)
+		memcpy(&source[y * sourcePitch], &base.pixels[y * 17 * 4], 17 * 4);
+
+	for (Filter filter : { Filter::BOX, Filter::KAISER })
+	{
+		for (bool bScalar : { false, true })
+		{
+			const auto downsample = bScalar ? MipGenerator::DownsampleScalar : MipGenerator::Downsample;
+			Buffer expected(8, 8);
+			downsample(base.GetImage(), expected.GetImage(), filter, true);
+
+			const size_t destinationPitch = 8 * 4 + 12;
+			std::vector<uint8_t> destination(destinationPitch * 8, 0xAB);
+			downsample({ 17, 16, sourcePitch, source.data() }, { 8, 8, destinationPitch, destination.data() }, filter, true);
+			bool bEqual = true;
+			bool bPadding = true;
+			for (uint32_t y = 0; y < 8; ++y)
+			{
+				bEqual &= memcmp(&destination[y * destinationPitch], &expected.pixels[y * 8 * 4], 8 * 4) == 0;
+				for (size_t i = 8 * 4; i < destinationPitch; ++i)
+					bPadding &= destination[y * destinationPitch + i] == 0xAB;
+			}
+			CHECK(bEqual);
+			CHECK(bPadding);
+		}
+	}
+}
+
+static void TestInvalid()
+{
+	Buffer small(2, 2), wide(4, 1);
+	bool bThrown = false;
+	try
+	{
+		MipGenerator::Downsample(small.GetImage(), wide.GetImage(), Filter::BOX, false);
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown);
+}
+
+int main()
+{
+	std::mt19937 random(7);
+	TestLevelCount();
+	TestKernels(random);
+	TestConstant();
+	TestSrgb();
+	TestBox(random);
+	TestPitch(random);
+	TestInvalid();
+	return Test::Result();
+}
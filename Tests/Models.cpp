@@ -0,0 +1,84 @@
+#include "pch.h"
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include "tinygltf/tiny_gltf.h"
+#include "Models.h"
+
+using namespace Amadeus;
+
+namespace Test
+{
+	static VertexDecoder::Stream GetStream(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+		const char* attribute, size_t elementSize, VertexDecoder::Format format)
+	{
+		VertexDecoder::Stream stream;
+		stream.format = format;
+		auto iter = primitive.attributes.find(attribute);
+		if (iter == primitive.attributes.end())
+			return stream;
+
+		const auto& accessor = model.accessors[iter->second];
+		const auto& view = model.bufferViews[accessor.bufferView];
+		stream.data = model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset;
+		stream.stride = view.byteStride ? view.byteStride : elementSize;
+		return stream;
+	}
+
+	std::vector<Mesh> LoadModel(const std::string& name)
+	{
+		tinygltf::TinyGLTF loader;
+		loader.SetImageLoader([](tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+		{
+			return true;
+		}, nullptr);
+
+		tinygltf::Model model;
+		std::string error, warning;
+		const std::string path = std::string(AMADEUS_ASSETS_DIR) + "/Models/" + name + "/" + name + ".gltf";
+		if (!loader.LoadASCIIFromFile(&model, &error, &warning, path))
+			return {};
+
+		std::vector<Mesh> meshes;
+		for (const auto& gltfMesh : model.meshes)
+		{
+			for (const auto& primitive : gltfMesh.primitives)
+			{
+				if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.indices < 0 || !primitive.attributes.count("POSITION"))
+					continue;
+
+				VertexDecoder::Streams streams;
+				streams.position = GetStream(model, primitive, "POSITION", 12, VertexDecoder::Format::FLOAT);
+				streams.normal = GetStream(model, primitive, "NORMAL", 12, VertexDecoder::Format::FLOAT);
+				streams.tangent = GetStream(model, primitive, "TANGENT", 16, VertexDecoder::Format::FLOAT);
+				if (auto iter = primitive.attributes.find("TEXCOORD_0"); iter != primitive.attributes.end())
+				{
+					switch (model.accessors[iter->second].componentType)
+					{
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+						streams.texCoord0 = GetStream(model, primitive, "TEXCOORD_0", 2, VertexDecoder::Format::UNORM8);
+						break;
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+						streams.texCoord0 = GetStream(model, primitive, "TEXCOORD_0", 4, VertexDecoder::Format::UNORM16);
+						break;
+					default:
+						streams.texCoord0 = GetStream(model, primitive, "TEXCOORD_0", 8, VertexDecoder::Format::FLOAT);
+						break;
+					}
+				}
+
+				Mesh& mesh = meshes.emplace_back();
+				mesh.vertices.resize(model.accessors[primitive.attributes.at("POSITION")].count);
+				VertexDecoder::DecodeVertices(streams, mesh.vertices.size(), mesh.vertices.data());
+
+				const auto& accessor = model.accessors[primitive.indices];
+				const auto& view = model.bufferViews[accessor.bufferView];
+				mesh.indices.resize(accessor.count);
+				VertexDecoder::DecodeIndices(model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset,
+					tinygltf::GetComponentSizeInBytes(accessor.componentType), accessor.count, mesh.indices.data());
+			}
+		}
+		return meshes;
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Common/VertexDecoder.h"
+
+// The glTF models under Assets/Models, decoded the way GltfLoader decodes them, for tests that
+// need real meshes.
+namespace Test
+{
+	struct Mesh
+	{
+		std::vector<Amadeus::VertexDecoder::Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// The indexed triangle primitives of Assets/Models/<name>/<name>.gltf. Images are not loaded.
+	// Empty when the model or one of its buffers is missing.
+	std::vector<Mesh> LoadModel(const std::string& name);
+}
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/PagedAllocator.h"
+#include <random>
+
+using namespace Amadeus;
+
+// Pages get bases far apart, like descriptor heaps, so that an address tells its page and slot.
+static constexpr uint64_t FirstBase = 0x100000;
+static constexpr uint64_t PageSpacing = 0x10000;
+
+static uint64_t GetBase(uint32_t page)
+{
+	return FirstBase + page * PageSpacing;
+}
+
+static void TestPages()
+{
+	const uint32_t pageSize = 8;
+	const uint64_t stride = 32;
+	PagedAllocator allocator(pageSize, stride);
+	uint32_t created = 0;
+	auto createPage = [&created](uint32_t page)
+	{
+		CHECK(page == created);
+		++created;
+		return GetBase(page);
+	};
+
+	CHECK(allocator.Allocate(0, createPage) == PagedAllocator::InvalidAddress);
+	CHECK(allocator.Allocate(pageSize + 1, createPage) == PagedAllocator::InvalidAddress);
+	CHECK(created == 0);
+
+	CHECK(allocator.Allocate(6, createPage) == GetBase(0));
+	CHECK(allocator.Allocate(1, createPage) == GetBase(0) + 6 * stride);
+
+	// Three slots do not fit in the rest of the first page, they start the second one.
+	CHECK(allocator.Allocate(3, createPage) == GetBase(1));
+	CHECK(allocator.Allocate(1, createPage) == GetBase(0) + 7 * stride);
+	CHECK(allocator.Allocate(1, createPage) == GetBase(1) + 3 * stride);
+	CHECK(created == 2);
+	CHECK(allocator.GetPageCount() == 2);
+	CHECK(allocator.GetAllocated() == 12);
+
+	// Freed slots of the first page are used again before the second page.
+	allocator.Free(GetBase(0) + 2 * stride, 2);
+	CHECK(allocator.GetAllocated() == 10);
+	CHECK(allocator.Allocate(1, createPage) == GetBase(0) + 2 * stride);
+	CHECK(allocator.Allocate(1, createPage) == GetBase(0) + 3 * stride);
+	CHECK(allocator.Allocate(pageSize, createPage) == GetBase(2));
+	CHECK(created == 3);
+	CHECK(allocator.GetPageSize() == pageSize);
+}
+
+// Threads allocate and free single slots and ranges at random, every slot has at most one owner
+// and no range crosses a page.
+static void TestThreads()
+{
+	const uint32_t pageSize = 256;
+	const uint64_t stride = 32;
+	const int threadCount = 8;
+	const int steps = 50000;
+	const uint32_t maxPages = 64;
+
+	PagedAllocator allocator(pageSize, stride);
+	std::atomic<uint32_t> created{ 0 };
+	auto createPage = [&created](uint32_t page)
+	{
+		created.fetch_add(1, std::memory_order_relaxed);
+		return GetBase(page);
+	};
+
+	std::vector<std::atomic<uint8_t>> owners(maxPages * pageSize);
+	std::atomic<int> errors{ 0 };
+	auto claim = [&](uint64_t address, uint32_t count, uint8_t from, uint8_t to)
+	{
+		const uint64_t page = (address - FirstBase) / PageSpacing;
+		const uint64_t offset = (address - FirstBase) % PageSpacing / stride;
+		if (page >= maxPages || offset + count > pageSize || (address - FirstBase) % PageSpacing % stride != 0)
+		{
+			errors.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint8_t expected = from;
+			if (!owners[page * pageSize + offset + i].compare_exchange_strong(expected, to))
+				errors.fetch_add(1, std::memory_order_relaxed);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < threadCount; ++thread)
+	{
+		threads.emplace_back([&, thread]
+		{
+			std::mt19937 random(thread);
+			std::vector<std::pair<uint64_t, uint32_t>> live;
+			for (int step = 0; step < steps; ++step)
+			{
+				if (live.size() < 300 && (live.empty() || random() % 2))
+				{
+					const uint32_t count = random() % 8 == 0 ? 1 + random() % 16 : 1;
+					const uint64_t address = allocator.Allocate(count, createPage);
+					if (address == PagedAllocator::InvalidAddress)
+					{
+						errors.fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+					claim(address, count, 0, 1);
+					live.push_back({ address, count });
+				}
+				else
+				{
+					const size_t index = random() % live.size();
+					const auto [address, count] = live[index];
+					live[index] = live.back();
+					live.pop_back();
+					claim(address, count, 1, 0);
+					allocator.Free(address, count);
+				}
+			}
+			for (const auto& [address, count] : live)
+			{
+				claim(address, count, 1, 0);
+				allocator.Free(address, count);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	CHECK(errors.load() == 0);
+	CHECK(allocator.GetAllocated() == 0);
+	CHECK(allocator.GetPageCount() == created.load());
+	CHECK(created.load() <= maxPages);
+	std::printf("%d threads, %d steps each, %u pages of %u slots\n", threadCount, steps, created.load(), pageSize);
+}
+
+int main()
+{
+	TestPages();
+	TestThreads();
+	return Test::Result();
+}
@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/PassScheduler.h"
+
+using namespace Amadeus;
+
+// A mock pass spends about as much cpu on recording as a pass with a few hundred draws.
+static uint32_t Record(uint32_t pass, uint32_t iterations)
+{
+	uint32_t value = pass;
+	for (uint32_t i = 0; i < iterations; ++i)
+		value = value * 1664525u + 1013904223u;
+	return value;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t levelCount = 8;
+	const uint32_t width = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 8;
+	const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 2000000;
+	const uint32_t frames = 20;
+
+	std::vector<std::vector<uint32_t>> levels(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+		for (uint32_t i = 0; i < width; ++i)
+			levels[level].push_back(level * width + i);
+
+	std::printf("%u levels of %u mock passes, %u hardware threads\n", levelCount, width, std::thread::hardware_concurrency());
+	std::printf("%-8s %12s %9s\n", "threads", "ms/frame", "speedup");
+
+	double serial = 0.0;
+	std::vector<uint32_t> results(levelCount * width);
+	for (size_t threads : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(7), size_t(15) })
+	{
+		// Worker threads besides the calling one, 0 records on the calling thread alone.
+		std::unique_ptr<JobSystem> jobs;
+		if (threads > 0)
+			jobs.reset(new JobSystem(threads, L"PassSchedulerBenchmark"));
+
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t frame = 0; frame < frames; ++frame)
+		{
+			PassScheduler::Execute(jobs.get(), levels,
+				[&](uint32_t pass)
+				{
+					results[pass] = Record(pass + frame, iterations);
+					return true;
+				},
+				[](const std::vector<uint32_t>&) {});
+		}
+		const double milliseconds = Test::SecondsSince(start) * 1e3 / frames;
+		if (threads == 0)
+			serial = milliseconds;
+		std::printf("%-8zu %12.2f %9.2f\n", threads + 1, milliseconds, serial / milliseconds);
+	}
+	return 0;
+}
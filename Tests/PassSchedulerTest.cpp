@@ -0,0 +1,290 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/PassScheduler.h"
+#include "Common/BarrierPlanner.h"
+#include "Common/TransientAllocator.h"
+
+using namespace Amadeus;
+
+// Allocations made by the current thread, the job system's workers do not count.
+static thread_local size_t tAllocations = 0;
+
+// Not inlined, so that GCC does not see free called on what operator new returned and warn about a
+// mismatched pair.
+[[gnu::noinline]] static void* Allocate(size_t size)
+{
+	++tAllocations;
+	return std::malloc(size ? size : 1);
+}
+
+[[gnu::noinline]] static void Release(void* p)
+{
+	std::free(p);
+}
+
+void* operator new(size_t size)
+{
+	if (void* p = Allocate(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { Release(p); }
+void operator delete(void* p, size_t) noexcept { Release(p); }
+
+// Passes of the default frame graph by level: Shadow and ZPre, SSAO, SSAOBlur, GBuffer, TAA,
+// Skybox, GBufferTransparent, Final.
+static const std::vector<std::vector<uint32_t>> DefaultLevels = { { 0, 1 }, { 2 }, { 3 }, { 4 }, { 5 }, { 6 }, { 7 }, { 8 } };
+
+static std::vector<std::vector<uint32_t>> WideLevels(uint32_t levels, uint32_t width)
+{
+	std::vector<std::vector<uint32_t>> result(levels);
+	for (uint32_t level = 0; level < levels; ++level)
+		for (uint32_t i = 0; i < width; ++i)
+			result[level].push_back(level * width + i);
+	return result;
+}
+
+// Every pass is recorded once, after every level before its own was submitted, and a level is
+// submitted only once all of its passes are recorded.
+static void TestOrder(JobSystem* jobs, const std::vector<std::vector<uint32_t>>& levels)
+{
+	uint32_t passCount = 0;
+	std::vector<uint32_t> passLevels;
+	for (uint32_t level = 0; level < levels.size(); ++level)
+	{
+		for (uint32_t pass : levels[level])
+		{
+			passLevels.resize((std::max)(static_cast<uint32_t>(passLevels.size()), pass + 1));
+			passLevels[pass] = level;
+			++passCount;
+		}
+	}
+
+	std::vector<std::atomic<int>> recorded(passCount);
+	std::atomic<uint32_t> submitted{ 0 };
+	std::atomic<int> outOfOrder{ 0 };
+	const bool bRecorded = PassScheduler::Execute(jobs, levels,
+		[&](uint32_t pass)
+		{
+			if (submitted.load() != passLevels[pass])
+				++outOfOrder;
+			++recorded[pass];
+			return true;
+		},
+		[&](const std::vector<uint32_t>& level)
+		{
+			for (uint32_t pass : level)
+			{
+				if (recorded[pass].load() != 1)
+					++outOfOrder;
+			}
+			++submitted;
+		});
+
+	CHECK(bRecorded);
+	CHECK(submitted.load() == levels.size());
+	CHECK(outOfOrder.load() == 0);
+	for (auto& count : recorded)
+		CHECK(count.load() == 1);
+}
+
+// A failing pass stops the frame before its level is submitted.
+static void TestFailure(JobSystem* jobs)
+{
+	const auto levels = WideLevels(4, 8);
+	std::atomic<uint32_t> submitted{ 0 };
+	std::atomic<uint32_t> recorded{ 0 };
+	const bool bRecorded = PassScheduler::Execute(jobs, levels,
+		[&](uint32_t pass)
+		{
+			++recorded;
+			return pass != 13;
+		},
+		[&](const std::vector<uint32_t>&) { ++submitted; });
+
+	CHECK(!bRecorded);
+	CHECK(submitted.load() == 1);
+	CHECK(recorded.load() <= 16);
+}
+
+// The default frame graph as the engine declares it: passes in declaration order, the writer
+// of every resource before its readers, and an edge from the writer to every reader.
+enum : uint32_t { Shadow, ZPre, SSAO, SSAOBlur, GBuffer, TAA, Skybox, GBufferTransparent, Final, PassCount };
+
+struct MockGraph
+{
+	std::vector<PassScheduler::Edge> edges;
+	std::vector<PassScheduler::Access> accesses;
+	uint32_t resourceCount = 0;
+
+	void Resource(uint32_t writer, std::initializer_list<std::pair<uint32_t, bool>> readers)
+	{
+		accesses.push_back({ writer, resourceCount, true });
+		for (const auto& reader : readers)
+		{
+			accesses.push_back({ reader.first, resourceCount, reader.second });
+			edges.push_back({ writer, reader.first });
+		}
+		++resourceCount;
+	}
+};
+
+static MockGraph DefaultGraph()
+{
+	MockGraph graph;
+	graph.Resource(Shadow, { { GBuffer, false } });
+	graph.Resource(ZPre, { { SSAO, false } });
+	graph.Resource(ZPre, { { SSAO, false } });
+	graph.Resource(ZPre, { { GBuffer, false }, { TAA, false }, { Skybox, false }, { GBufferTransparent, false } });
+	graph.Resource(SSAO, { { SSAOBlur, false } });
+	graph.Resource(SSAOBlur, { { GBuffer, false } });
+	graph.Resource(GBuffer, { { GBufferTransparent, true } });
+	graph.Resource(GBuffer, { { TAA, false }, { Skybox, true }, { GBufferTransparent, true } });
+	graph.Resource(GBuffer, { { GBufferTransparent, true } });
+	graph.Resource(GBuffer, { { TAA, false }, { GBufferTransparent, true } });
+	graph.Resource(TAA, { { Final, false } });
+	graph.Resource(Skybox, {});
+	graph.Resource(GBufferTransparent, { { Final, false } });
+	return graph;
+}
+
+// Writes after reads and reads after writes of the same resource land on later levels, which
+// is what orders Skybox and GBufferTransparent although no edge does.
+static void TestAssignLevels()
+{
+	const MockGraph graph = DefaultGraph();
+	const std::vector<uint32_t> levels = PassScheduler::AssignLevels(PassCount, graph.edges, graph.accesses);
+	const std::vector<uint32_t> expected = { 0, 0, 1, 2, 3, 4, 5, 6, 7 };
+	CHECK(levels == expected);
+
+	// An edge from a later pass is ignored, the pass set is taken in declaration order.
+	const std::vector<uint32_t> backwards = PassScheduler::AssignLevels(2, { { 1, 0 } }, {});
+	CHECK(backwards == std::vector<uint32_t>({ 0, 0 }));
+
+	// Reads share a level, the next write waits for the last of them.
+	const std::vector<uint32_t> reads = PassScheduler::AssignLevels(4,
+		{ { 0, 1 }, { 0, 2 } },
+		{ { 0, 0, true }, { 1, 0, false }, { 2, 0, false }, { 3, 0, true } });
+	CHECK(reads == std::vector<uint32_t>({ 0, 1, 1, 2 }));
+}
+
+// What FrameGraph::BuildPlan derives without D3D12: levels, barriers and the heap layout.
+struct MockPlan
+{
+	std::vector<uint32_t> passes;
+	std::vector<std::vector<uint32_t>> levels;
+	BarrierPlanner::Result barriers;
+	TransientAllocator::Result heap;
+};
+
+static void BuildMockPlan(const MockGraph& graph, const PassScheduler::Key& key, MockPlan& plan)
+{
+	plan.passes.clear();
+	for (uint32_t pass = 0; pass < PassCount; ++pass)
+		plan.passes.push_back(pass);
+
+	const std::vector<uint32_t> passLevels = PassScheduler::AssignLevels(PassCount, graph.edges, graph.accesses);
+	plan.levels.clear();
+	for (uint32_t pass = 0; pass < PassCount; ++pass)
+	{
+		if (plan.levels.size() <= passLevels[pass])
+			plan.levels.resize(passLevels[pass] + 1);
+		plan.levels[passLevels[pass]].push_back(pass);
+	}
+
+	std::vector<BarrierPlanner::Access> accesses;
+	std::vector<TransientAllocator::Request> requests(graph.resourceCount, { key.width * key.height * 4, 65536, UINT32_MAX, 0 });
+	for (const auto& access : graph.accesses)
+	{
+		const uint32_t level = passLevels[access.pass];
+		accesses.push_back({ access.resource, level, access.write ? 1u : 2u, access.write });
+		requests[access.resource].first = (std::min)(requests[access.resource].first, level);
+		requests[access.resource].last = (std::max)(requests[access.resource].last, level);
+	}
+	plan.barriers = BarrierPlanner::Plan(graph.resourceCount, static_cast<uint32_t>(plan.levels.size()), accesses);
+	plan.heap = TransientAllocator::Pack(requests);
+}
+
+// Compiling a plan that is still valid visits the passes without building or allocating, a
+// new key or Invalidate builds it once more.
+static void TestCompileAllocations()
+{
+	const MockGraph graph = DefaultGraph();
+	PassScheduler scheduler;
+	MockPlan plan;
+	PassScheduler::Key key;
+	key.width = 1920;
+	key.height = 1080;
+	key.toggles = 2;
+
+	uint32_t builds = 0;
+	uint64_t visits = 0;
+	auto compile = [&]
+	{
+		scheduler.Compile(key, plan.passes,
+			[&] { BuildMockPlan(graph, key, plan); ++builds; },
+			[&](uint32_t pass) { visits += pass + 1; });
+	};
+
+	compile();
+	CHECK(builds == 1);
+	CHECK(scheduler.IsValid(key));
+	CHECK(plan.levels.size() == 8);
+
+	const size_t allocations = tAllocations;
+	visits = 0;
+	for (int frame = 0; frame < 1000; ++frame)
+		compile();
+	CHECK(tAllocations - allocations == 0);
+	CHECK(builds == 1);
+	CHECK(visits == 1000ull * PassCount * (PassCount + 1) / 2);
+
+	key.width = 3840;
+	key.height = 2160;
+	CHECK(!scheduler.IsValid(key));
+	compile();
+	CHECK(builds == 2);
+	CHECK(plan.heap.heapSize >= 3840ull * 2160 * 4);
+
+	key.toggles = 3;
+	compile();
+	CHECK(builds == 3);
+
+	scheduler.Invalidate();
+	compile();
+	compile();
+	CHECK(builds == 4);
+
+	// A build that throws leaves the plan invalid, the next compile builds again.
+	scheduler.Invalidate();
+	bool bThrown = false;
+	try
+	{
+		scheduler.Compile(key, plan.passes, [] { throw std::runtime_error("build"); }, [](uint32_t) {});
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown);
+	CHECK(!scheduler.IsValid(key));
+	compile();
+	CHECK(builds == 5);
+}
+
+int main()
+{
+	TestAssignLevels();
+	TestCompileAllocations();
+
+	JobSystem jobs(3, L"PassSchedulerTest");
+	for (JobSystem* system : { static_cast<JobSystem*>(nullptr), &jobs })
+	{
+		TestOrder(system, DefaultLevels);
+		TestOrder(system, WideLevels(6, 16));
+		TestOrder(system, WideLevels(1, 200));
+		TestFailure(system);
+	}
+	return Test::Result();
+}
@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/RangeAllocator.h"
+#include <random>
+
+using namespace Amadeus;
+
+// Longest run of free slots in a slot map.
+static uint32_t GetLongestRun(const std::vector<uint8_t>& used)
+{
+	uint32_t run = 0;
+	uint32_t longest = 0;
+	for (uint8_t slot : used)
+	{
+		run = slot ? 0 : run + 1;
+		longest = (std::max)(longest, run);
+	}
+	return longest;
+}
+
+static void TestAllocate()
+{
+	RangeAllocator allocator(16);
+	CHECK(allocator.GetCapacity() == 16);
+	CHECK(allocator.GetLargestFree() == 16);
+
+	// First fit hands the ranges out back to back.
+	CHECK(allocator.Allocate(4) == 0);
+	CHECK(allocator.Allocate(8) == 4);
+	CHECK(allocator.Allocate(4) == 12);
+	CHECK(allocator.GetAllocated() == 16);
+	CHECK(allocator.GetLargestFree() == 0);
+
+	CHECK(allocator.Allocate(1) == RangeAllocator::InvalidOffset);
+	CHECK(allocator.Allocate(0) == RangeAllocator::InvalidOffset);
+	CHECK(allocator.GetAllocated() == 16);
+
+	RangeAllocator empty;
+	CHECK(empty.Allocate(1) == RangeAllocator::InvalidOffset);
+	CHECK(empty.GetLargestFree() == 0);
+}
+
+static void TestFree()
+{
+	RangeAllocator allocator(16);
+	const uint32_t a = allocator.Allocate(4);
+	const uint32_t b = allocator.Allocate(4);
+	allocator.Allocate(8);
+
+	// The hole is reused by the first request that fits, a larger one still fails.
+	allocator.Free(b, 4);
+	CHECK(allocator.GetAllocated() == 12);
+	CHECK(allocator.GetLargestFree() == 4);
+	CHECK(allocator.Allocate(5) == RangeAllocator::InvalidOffset);
+	CHECK(allocator.Allocate(2) == b);
+	CHECK(allocator.Allocate(2) == b + 2);
+
+	allocator.Free(a, 4);
+	allocator.Free(a, 0);
+	CHECK(allocator.GetAllocated() == 12);
+	CHECK(allocator.Allocate(4) == a);
+
+	allocator.Reset(32);
+	CHECK(allocator.GetCapacity() == 32);
+	CHECK(allocator.GetAllocated() == 0);
+	CHECK(allocator.GetLargestFree() == 32);
+}
+
+// A freed range merges with the free range before it, after it, or both.
+static void TestCoalescing()
+{
+	RangeAllocator allocator(20);
+	uint32_t ranges[5];
+	for (auto& range : ranges)
+		range = allocator.Allocate(4);
+
+	allocator.Free(ranges[1], 4);
+	allocator.Free(ranges[3], 4);
+	CHECK(allocator.GetLargestFree() == 4);
+
+	// Previous neighbour.
+	allocator.Free(ranges[2], 4);
+	CHECK(allocator.GetLargestFree() == 12);
+	CHECK(allocator.Allocate(12) == ranges[1]);
+	allocator.Free(ranges[1], 12);
+
+	// Next neighbour.
+	allocator.Free(ranges[0], 4);
+	CHECK(allocator.GetLargestFree() == 16);
+
+	// Both.
+	CHECK(allocator.Allocate(4) == 0);
+	CHECK(allocator.Allocate(4) == 4);
+	allocator.Free(0, 4);
+	allocator.Free(ranges[4], 4);
+	allocator.Free(4, 4);
+	CHECK(allocator.GetAllocated() == 0);
+	CHECK(allocator.GetLargestFree() == 20);
+	CHECK(allocator.Allocate(20) == 0);
+}
+
+// Random allocations and frees against a slot map: ranges never overlap, an allocation only fails
+// when no run of free slots is long enough, and freeing everything leaves one range.
+static void TestRandom()
+{
+	const uint32_t capacity = 4096;
+	RangeAllocator allocator(capacity);
+	std::vector<uint8_t> used(capacity);
+	std::vector<std::pair<uint32_t, uint32_t>> live;
+	std::mt19937 random(7);
+	size_t failures = 0;
+
+	for (int step = 0; step < 100000; ++step)
+	{
+		if (live.empty() || random() % 5 < 3)
+		{
+			const uint32_t count = 1 + random() % 12;
+			const uint32_t offset = allocator.Allocate(count);
+			if (offset == RangeAllocator::InvalidOffset)
+			{
+				const uint32_t longest = GetLongestRun(used);
+				CHECK(longest < count);
+				CHECK(allocator.GetLargestFree() == longest);
+				++failures;
+				continue;
+			}
+
+			CHECK(offset + count <= capacity);
+			bool bOverlaps = false;
+			for (uint32_t slot = offset; slot < (std::min)(offset + count, capacity); ++slot)
+			{
+				bOverlaps |= used[slot] != 0;
+				used[slot] = 1;
+			}
+			CHECK(!bOverlaps);
+			live.push_back({ offset, count });
+		}
+		else
+		{
+			const size_t index = random() % live.size();
+			const auto [offset, count] = live[index];
+			live[index] = live.back();
+			live.pop_back();
+			allocator.Free(offset, count);
+			std::fill(used.begin() + offset, used.begin() + offset + count, 0);
+		}
+		CHECK(allocator.GetAllocated() == static_cast<uint32_t>(std::count(used.begin(), used.end(), 1)));
+	}
+	// Allocating more often than freeing fills the slots, some allocations fail.
+	CHECK(failures > 0);
+
+	for (const auto& [offset, count] : live)
+		allocator.Free(offset, count);
+	CHECK(allocator.GetAllocated() == 0);
+	CHECK(allocator.GetLargestFree() == capacity);
+}
+
+int main()
+{
+	TestAllocate();
+	TestFree();
+	TestCoalescing();
+	TestRandom();
+	return Test::Result();
+}
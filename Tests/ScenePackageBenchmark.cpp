@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "Test.h"
+#include "Models.h"
+#include "Common/ScenePackage.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "tinygltf/stb_image.h"
+
+using namespace Amadeus;
+
+// The cpu side of starting a scene from its glTF against starting it from the package cooked from it.
+// The import parses the glTF, decodes the vertices and the images and builds the mip chains, the
+// package is read into memory and checked. Both read from a warm file cache, neither creates gpu
+// resources. Pass model names under Assets/Models, DamagedHelmet by default.
+
+struct Image
+{
+	std::string name;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	// RGBA8, every level down to 1x1.
+	std::vector<std::vector<uint8_t>> levels;
+};
+
+// A 2x2 box filter, the cpu mips the loader builds without the Kaiser filter.
+static void CreateMips(Image& image)
+{
+	uint32_t width = image.width;
+	uint32_t height = image.height;
+	while (width > 1 || height > 1)
+	{
+		const uint32_t nextWidth = (std::max)(width / 2, 1u);
+		const uint32_t nextHeight = (std::max)(height / 2, 1u);
+		const auto& source = image.levels.back();
+		std::vector<uint8_t> level(static_cast<size_t>(nextWidth) * nextHeight * 4);
+		for (uint32_t y = 0; y < nextHeight; ++y)
+		{
+			const uint32_t y0 = (std::min)(y * 2, height - 1), y1 = (std::min)(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < nextWidth; ++x)
+			{
+				const uint32_t x0 = (std::min)(x * 2, width - 1), x1 = (std::min)(x * 2 + 1, width - 1);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const uint32_t sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c]
+						+ source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+					level[(static_cast<size_t>(y) * nextWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		image.levels.push_back(std::move(level));
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+static std::vector<Image> LoadImages(const std::filesystem::path& directory, double& decodeSeconds, double& mipSeconds)
+{
+	std::vector<std::filesystem::path> paths;
+	for (const auto& entry : std::filesystem::directory_iterator(directory))
+	{
+		const auto extension = entry.path().extension();
+		if (extension == ".jpg" || extension == ".png")
+			paths.push_back(entry.path());
+	}
+	std::sort(paths.begin(), paths.end());
+
+	std::vector<Image> images;
+	for (const auto& path : paths)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int width = 0, height = 0, channels = 0;
+		stbi_uc* pixels = stbi_load(path.string().c_str(), &width, &height, &channels, 4);
+		if (!pixels)
+			continue;
+
+		Image& image = images.emplace_back();
+		image.name = path.filename().string();
+		image.width = static_cast<uint32_t>(width);
+		image.height = static_cast<uint32_t>(height);
+		image.levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(pixels);
+		decodeSeconds += Test::SecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		CreateMips(image);
+		mipSeconds += Test::SecondsSince(start);
+	}
+	return images;
+}
+
+static void Cook(const std::vector<Test::Mesh>& meshes, const std::vector<Image>& images, const std::filesystem::path& path)
+{
+	ScenePackage::Writer writer(images.size(), meshes.size());
+	const float boundsMin[3] = {};
+	const float boundsMax[3] = {};
+	writer.SetHeader(ScenePackage::FLAG_CPU_MIPS, boundsMin, boundsMax);
+
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		const Image& image = images[i];
+		ScenePackage::TextureRecord record = {};
+		record.width = image.width;
+		record.height = image.height;
+		record.arraySize = 1;
+		record.mipLevels = static_cast<uint32_t>(image.levels.size());
+		std::vector<ScenePackage::Writer::Subresource> subresources;
+		for (size_t level = 0; level < image.levels.size(); ++level)
+		{
+			const uint64_t width = (std::max)(image.width >> level, 1u);
+			subresources.push_back({ image.levels[level].data(), width * 4, image.levels[level].size() });
+		}
+		writer.SetTexture(i, record, image.name, subresources);
+	}
+
+	ScenePackage::NodeRecord node = {};
+	node.parent = -1;
+	node.primitiveCount = static_cast<uint32_t>(meshes.size());
+	node.matrix[0] = node.matrix[5] = node.matrix[10] = node.matrix[15] = 1;
+	writer.AddNode(node);
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const Test::Mesh& mesh = meshes[i];
+		ScenePackage::PrimitiveRecord record = {};
+		record.material = -1;
+		record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		record.vertexStride = sizeof(VertexDecoder::Vertex);
+		record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		record.indexSize = 4;
+		record.positionScale[0] = record.positionScale[1] = record.positionScale[2] = 1;
+		record.texCoordScale[0] = record.texCoordScale[1] = 1;
+		writer.SetPrimitive(i, record,
+			{ reinterpret_cast<const uint8_t*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(VertexDecoder::Vertex) },
+			{ reinterpret_cast<const uint8_t*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t) }, {});
+	}
+	writer.Write(path);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> names;
+	for (int i = 1; i < argc; ++i)
+		names.push_back(argv[i]);
+	if (names.empty())
+		names.push_back("DamagedHelmet");
+
+	const auto directory = std::filesystem::temp_directory_path() / "ScenePackageBenchmark";
+	std::filesystem::create_directories(directory);
+
+	std::printf("%-14s %9s %9s %9s %9s %9s %9s %8s %9s\n", "model", "parse ms", "images ms", "mips ms", "import ms",
+		"read ms", "check ms", "package", "speedup");
+	for (const auto& name : names)
+	{
+		const auto modelDirectory = std::filesystem::path(AMADEUS_ASSETS_DIR) / "Models" / name;
+		const auto path = directory / (name + ".ampk");
+
+		// Best of three for each step, the first run also warms the file cache.
+		double parse = DBL_MAX, decode = DBL_MAX, mips = DBL_MAX, read = DBL_MAX, check = DBL_MAX;
+		uint64_t fileSize = 0;
+		for (int run = 0; run < 3; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			const std::vector<Test::Mesh> meshes = Test::LoadModel(name);
+			parse = (std::min)(parse, Test::SecondsSince(start));
+			if (meshes.empty())
+				break;
+
+			double decodeSeconds = 0, mipSeconds = 0;
+			const std::vector<Image> images = LoadImages(modelDirectory, decodeSeconds, mipSeconds);
+			decode = (std::min)(decode, decodeSeconds);
+			mips = (std::min)(mips, mipSeconds);
+			if (run == 0)
+				Cook(meshes, images, path);
+
+			auto readStart = std::chrono::steady_clock::now();
+			fileSize = std::filesystem::file_size(path);
+			std::vector<uint64_t> bytes((fileSize + 7) / 8);
+			std::ifstream(path, std::ios::binary).read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(fileSize));
+			read = (std::min)(read, Test::SecondsSince(readStart));
+
+			const auto checkStart = std::chrono::steady_clock::now();
+			const ScenePackage package({ reinterpret_cast<const uint8_t*>(bytes.data()), static_cast<size_t>(fileSize) });
+			check = (std::min)(check, Test::SecondsSince(checkStart));
+			if (package.GetPrimitives().size() != meshes.size() || package.GetTextures().size() != images.size())
+			{
+				std::printf("FAIL the package of %s does not hold the scene\n", name.c_str());
+				return 1;
+			}
+		}
+		if (parse == DBL_MAX || read == DBL_MAX)
+		{
+			std::printf("%-14s missing\n", name.c_str());
+			continue;
+		}
+
+		const double import = parse + decode + mips;
+		std::printf("%-14s %9.2f %9.2f %9.2f %9.2f %9.2f %9.3f %6.1fMB %8.1fx\n", name.c_str(), parse * 1000, decode * 1000,
+			mips * 1000, import * 1000, read * 1000, check * 1000, fileSize / 1048576.0, import / (read + check));
+	}
+
+	std::filesystem::remove_all(directory);
+	return 0;
+}
@@ -0,0 +1,443 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/ScenePackage.h"
+#include "Common/MeshletBuilder.h"
+#include <random>
+
+using namespace Amadeus;
+
+using TextureRecord = ScenePackage::TextureRecord;
+using SubresourceRecord = ScenePackage::SubresourceRecord;
+using MaterialRecord = ScenePackage::MaterialRecord;
+using NodeRecord = ScenePackage::NodeRecord;
+using PrimitiveRecord = ScenePackage::PrimitiveRecord;
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// The reader wants the records aligned the way a mapped file is.
+struct AlignedBytes
+{
+	std::vector<uint64_t> storage;
+	size_t size;
+
+	explicit AlignedBytes(const std::vector<uint8_t>& bytes)
+		: storage((bytes.size() + 7) / 8)
+		, size(bytes.size())
+	{
+		memcpy(storage.data(), bytes.data(), bytes.size());
+	}
+
+	std::span<const uint8_t> Span() const { return { reinterpret_cast<const uint8_t*>(storage.data()), size }; }
+};
+
+static bool Opens(const std::vector<uint8_t>& bytes)
+{
+	AlignedBytes aligned(bytes);
+	try
+	{
+		ScenePackage package(aligned.Span());
+		return true;
+	}
+	catch (const std::runtime_error&)
+	{
+		return false;
+	}
+}
+
+// Three levels of an 8x4 RGBA texture, one of a 2x2 texture, a small primitive with 16 bit indices
+// and a large one with 32 bit indices and meshlets.
+struct Scene
+{
+	std::vector<std::vector<uint8_t>> levels;
+	std::vector<std::vector<uint8_t>> vertices;
+	std::vector<std::vector<uint8_t>> indices;
+	std::vector<std::vector<MeshletBuilder::Meshlet>> meshlets;
+};
+
+static Scene CreateScene()
+{
+	Scene scene;
+	std::mt19937 random(7);
+	const uint32_t sizes[][2] = { { 8, 4 }, { 4, 2 }, { 2, 1 }, { 2, 2 } };
+	for (const auto& size : sizes)
+	{
+		std::vector<uint8_t> level(size[0] * size[1] * 4);
+		for (auto& byte : level)
+			byte = static_cast<uint8_t>(random());
+		scene.levels.push_back(level);
+	}
+
+	for (int p = 0; p < 2; ++p)
+	{
+		const uint32_t vertexCount = p == 0 ? 6 : 70000;
+		const uint32_t indexSize = p == 0 ? 2 : 4;
+		const uint32_t indexCount = p == 0 ? 6 : 9;
+		std::vector<uint8_t> vertices(vertexCount * 20);
+		for (auto& byte : vertices)
+			byte = static_cast<uint8_t>(random());
+		std::vector<uint8_t> indices(indexCount * indexSize);
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			const uint32_t index = random() % vertexCount;
+			memcpy(indices.data() + i * indexSize, &index, indexSize);
+		}
+		scene.vertices.push_back(vertices);
+		scene.indices.push_back(indices);
+
+		std::vector<MeshletBuilder::Meshlet> meshlets;
+		if (p == 1)
+		{
+			meshlets.push_back({ 0, 6, { 1, 2, 3 }, 4, { 0, 0, 1 }, 0.5f });
+			meshlets.push_back({ 6, 3, { 1, 2, 3 }, 4, { 0, 1, 0 }, 1.0f });
+		}
+		scene.meshlets.push_back(meshlets);
+	}
+	return scene;
+}
+
+// Textures and primitives are set from one thread each in reverse order, the way the loader's workers
+// finish. The third texture shares the image of the first and has no data, unless bSkipTexture
+// leaves its slot empty.
+static void WriteScene(const Scene& scene, const std::filesystem::path& path, bool bSkipTexture = false)
+{
+	ScenePackage::Writer writer(3, 2);
+	const float boundsMin[3] = { -1, -2, -3 };
+	const float boundsMax[3] = { 1, 2, 3 };
+	writer.SetHeader(ScenePackage::FLAG_QUANTIZED | ScenePackage::FLAG_MESHLETS, boundsMin, boundsMax);
+	writer.AddSource("A.gltf", 1234, 5678);
+	writer.AddSource("buffers/A.bin", 70000, 9);
+	writer.AddSampler({ 21, 1, 3, 0 });
+	writer.AddSampler({ 0, 2, 2, 0 });
+
+	MaterialRecord material = {};
+	const int32_t textures[5] = { 0, -1, 2, -1, 1 };
+	memcpy(material.textures, textures, sizeof(textures));
+	material.sampler = 1;
+	material.baseColorFactor[0] = 0.5f;
+	material.alphaMode = 2;
+	writer.AddMaterial(material);
+
+	NodeRecord root = {};
+	root.parent = -1;
+	root.matrix[0] = root.matrix[5] = root.matrix[10] = root.matrix[15] = 1;
+	writer.AddNode(root);
+	NodeRecord child = root;
+	child.parent = 0;
+	child.firstPrimitive = 0;
+	child.primitiveCount = 2;
+	child.matrix[3] = 7;
+	writer.AddNode(child);
+
+	std::vector<std::thread> threads;
+	threads.emplace_back([&]
+	{
+		PrimitiveRecord record = {};
+		record.material = 0;
+		record.vertexCount = 70000;
+		record.vertexStride = 20;
+		record.indexCount = 9;
+		record.indexSize = 4;
+		record.meshletCount = 2;
+		record.positionScale[0] = 3;
+		const auto& meshlets = scene.meshlets[1];
+		writer.SetPrimitive(1, record, scene.vertices[1], scene.indices[1],
+			{ reinterpret_cast<const uint8_t*>(meshlets.data()), meshlets.size() * sizeof(MeshletBuilder::Meshlet) });
+	});
+	threads.emplace_back([&]
+	{
+		PrimitiveRecord record = {};
+		record.material = -1;
+		record.vertexCount = 6;
+		record.vertexStride = 20;
+		record.indexCount = 6;
+		record.indexSize = 2;
+		writer.SetPrimitive(0, record, scene.vertices[0], scene.indices[0], {});
+	});
+	threads.emplace_back([&]
+	{
+		TextureRecord record = {};
+		record.type = 1;
+		record.format = 29;
+		record.width = 8;
+		record.height = 4;
+		record.arraySize = 1;
+		record.mipLevels = 3;
+		std::vector<ScenePackage::Writer::Subresource> subresources;
+		for (uint32_t level = 0; level < 3; ++level)
+			subresources.push_back({ scene.levels[level].data(), (8ull >> level) * 4, scene.levels[level].size() });
+		writer.SetTexture(0, record, "Models\\A\\base.png", subresources);
+	});
+	threads.emplace_back([&]
+	{
+		TextureRecord record = {};
+		record.format = 28;
+		record.width = 2;
+		record.height = 2;
+		record.arraySize = 1;
+		record.mipLevels = 1;
+		const ScenePackage::Writer::Subresource subresource = { scene.levels[3].data(), 8, 16 };
+		writer.SetTexture(1, record, "Models\\A\\emissive.png", { &subresource, 1 });
+	});
+	for (auto& thread : threads)
+		thread.join();
+
+	if (!bSkipTexture)
+		writer.SetTexture(2, TextureRecord{}, "Models\\A\\base.png", {});
+	writer.Write(path);
+}
+
+// Every record and blob reads back as it was written.
+static void TestRoundTrip(const Scene& scene, const std::vector<uint8_t>& bytes)
+{
+	AlignedBytes aligned(bytes);
+	ScenePackage package(aligned.Span());
+
+	const auto& header = package.GetHeader();
+	CHECK(header.magic == ScenePackage::Magic && header.version == ScenePackage::Version);
+	CHECK(header.fileSize == bytes.size());
+	CHECK(header.flags == (ScenePackage::FLAG_QUANTIZED | ScenePackage::FLAG_MESHLETS));
+	CHECK(header.boundsMin[2] == -3 && header.boundsMax[1] == 2);
+
+	const auto sources = package.GetSources();
+	CHECK(sources.size() == 2 && package.GetPath(sources[0]) == "A.gltf" && package.GetPath(sources[1]) == "buffers/A.bin");
+	CHECK(sources[0].size == 1234 && sources[0].time == 5678 && sources[1].size == 70000 && sources[1].time == 9);
+
+	const auto samplers = package.GetSamplers();
+	CHECK(samplers.size() == 2 && samplers[0].filter == 21 && samplers[0].addressV == 3 && samplers[1].addressU == 2);
+
+	const auto textures = package.GetTextures();
+	CHECK(textures.size() == 3);
+	CHECK(package.GetName(textures[0]) == "Models\\A\\base.png");
+	CHECK(package.GetName(textures[1]) == "Models\\A\\emissive.png");
+	CHECK(package.GetName(textures[2]) == "Models\\A\\base.png");
+	CHECK(textures[0].type == 1 && textures[0].width == 8 && textures[0].mipLevels == 3 && textures[0].subresourceCount == 3);
+	CHECK(textures[2].subresourceCount == 0);
+
+	const auto levels = package.GetSubresources(textures[0]);
+	for (uint32_t level = 0; level < 3; ++level)
+	{
+		const auto data = package.GetBlob(levels[level].data);
+		CHECK(levels[level].data.offset % ScenePackage::BlobAlignment == 0);
+		CHECK(levels[level].rowPitch == (8ull >> level) * 4);
+		CHECK(data.size() == scene.levels[level].size() && memcmp(data.data(), scene.levels[level].data(), data.size()) == 0);
+	}
+	const auto emissive = package.GetSubresources(textures[1]);
+	CHECK(emissive.size() == 1 && emissive[0].rowPitch == 8);
+	CHECK(memcmp(package.GetBlob(emissive[0].data).data(), scene.levels[3].data(), 16) == 0);
+
+	const auto materials = package.GetMaterials();
+	CHECK(materials.size() == 1);
+	CHECK(materials[0].textures[0] == 0 && materials[0].textures[1] == -1 && materials[0].textures[4] == 1);
+	CHECK(materials[0].sampler == 1 && materials[0].baseColorFactor[0] == 0.5f && materials[0].alphaMode == 2);
+
+	const auto nodes = package.GetNodes();
+	CHECK(nodes.size() == 2 && nodes[0].parent == -1);
+	CHECK(nodes[1].parent == 0 && nodes[1].primitiveCount == 2 && nodes[1].matrix[3] == 7 && nodes[1].matrix[15] == 1);
+
+	const auto primitives = package.GetPrimitives();
+	CHECK(primitives.size() == 2);
+	for (size_t p = 0; p < 2; ++p)
+	{
+		const auto vertices = package.GetBlob(primitives[p].vertices);
+		const auto indices = package.GetBlob(primitives[p].indices);
+		CHECK(primitives[p].vertices.offset % ScenePackage::BlobAlignment == 0);
+		CHECK(vertices.size() == scene.vertices[p].size() && memcmp(vertices.data(), scene.vertices[p].data(), vertices.size()) == 0);
+		CHECK(indices.size() == scene.indices[p].size() && memcmp(indices.data(), scene.indices[p].data(), indices.size()) == 0);
+	}
+	CHECK(primitives[0].material == -1 && primitives[0].indexSize == 2);
+	CHECK(primitives[1].material == 0 && primitives[1].positionScale[0] == 3);
+	const auto meshlets = package.GetBlob(primitives[1].meshlets);
+	CHECK(meshlets.size() == 2 * sizeof(MeshletBuilder::Meshlet));
+	CHECK(reinterpret_cast<const MeshletBuilder::Meshlet*>(meshlets.data())[1].firstIndex == 6);
+}
+
+// Writing again gives the same bytes whatever order the workers finish in, and a load that never
+// filled a slot writes nothing.
+static void TestWrite(const Scene& scene, const std::filesystem::path& directory, const std::vector<uint8_t>& bytes)
+{
+	const auto path = directory / "scene.ampk";
+	WriteScene(scene, path);
+	CHECK(ReadFile(path) == bytes);
+	CHECK(!std::filesystem::exists(directory / "scene.ampk.tmp"));
+
+	bool bThrown = false;
+	try
+	{
+		WriteScene(scene, directory / "partial.ampk", true);
+	}
+	catch (const std::runtime_error&)
+	{
+		bThrown = true;
+	}
+	CHECK(bThrown && !std::filesystem::exists(directory / "partial.ampk"));
+}
+
+// Every header field, array, blob and index out of range is rejected, changes that stay in range are not.
+static void TestValidation(const std::vector<uint8_t>& bytes)
+{
+	CHECK(Opens(bytes));
+
+	AlignedBytes aligned(bytes);
+	const ScenePackage::Header header = ScenePackage(aligned.Span()).GetHeader();
+	auto opensWith = [&bytes](auto&& change)
+	{
+		std::vector<uint8_t> copy = bytes;
+		change(copy);
+		return Opens(copy);
+	};
+	auto headerOf = [](std::vector<uint8_t>& copy) { return reinterpret_cast<ScenePackage::Header*>(copy.data()); };
+	auto textures = [&header](std::vector<uint8_t>& copy) { return reinterpret_cast<TextureRecord*>(copy.data() + header.textures.offset); };
+	auto subresources = [&header](std::vector<uint8_t>& copy) { return reinterpret_cast<SubresourceRecord*>(copy.data() + header.subresources.offset); };
+	auto materials = [&header](std::vector<uint8_t>& copy) { return reinterpret_cast<MaterialRecord*>(copy.data() + header.materials.offset); };
+	auto nodes = [&header](std::vector<uint8_t>& copy) { return reinterpret_cast<NodeRecord*>(copy.data() + header.nodes.offset); };
+	auto primitives = [&header](std::vector<uint8_t>& copy) { return reinterpret_cast<PrimitiveRecord*>(copy.data() + header.primitives.offset); };
+	auto sources = [&header](std::vector<uint8_t>& copy) { return reinterpret_cast<ScenePackage::SourceRecord*>(copy.data() + header.sources.offset); };
+	auto meshlets = [&primitives](std::vector<uint8_t>& copy)
+	{
+		return reinterpret_cast<MeshletBuilder::Meshlet*>(copy.data() + primitives(copy)[1].meshlets.offset);
+	};
+
+	CHECK(!opensWith([&](auto& copy) { copy[0] ^= 1; }));
+	CHECK(!opensWith([&](auto& copy) { headerOf(copy)->version = ScenePackage::Version + 1; }));
+	CHECK(!opensWith([&](auto& copy) { headerOf(copy)->headerSize += 8; }));
+	CHECK(!opensWith([&](auto& copy) { copy.resize(copy.size() - 1); }));
+	CHECK(!opensWith([&](auto& copy) { copy.resize(sizeof(ScenePackage::Header) - 1); }));
+	CHECK(!opensWith([&](auto& copy) { headerOf(copy)->nodes.size += 4; }));
+	CHECK(!opensWith([&](auto& copy) { headerOf(copy)->primitives.offset = copy.size(); }));
+	CHECK(!opensWith([&](auto& copy) { headerOf(copy)->primitives.offset = ~0ull - 4; }));
+	CHECK(!opensWith([&](auto& copy) { textures(copy)[0].subresourceCount = 2; }));
+	CHECK(!opensWith([&](auto& copy) { textures(copy)[0].firstSubresource = 3; }));
+	CHECK(!opensWith([&](auto& copy) { textures(copy)[0].name.offset += 1; }));
+	CHECK(!opensWith([&](auto& copy) { textures(copy)[1].width = 0; }));
+	CHECK(!opensWith([&](auto& copy) { subresources(copy)[1].data.size = 1ull << 40; }));
+	CHECK(!opensWith([&](auto& copy) { subresources(copy)[1].slicePitch += 1; }));
+	CHECK(!opensWith([&](auto& copy) { materials(copy)[0].textures[2] = 3; }));
+	CHECK(!opensWith([&](auto& copy) { materials(copy)[0].textures[2] = -2; }));
+	CHECK(!opensWith([&](auto& copy) { materials(copy)[0].sampler = 2; }));
+	CHECK(!opensWith([&](auto& copy) { materials(copy)[0].sampler = -2; }));
+	CHECK(!opensWith([&](auto& copy) { nodes(copy)[1].parent = 1; }));
+	CHECK(!opensWith([&](auto& copy) { nodes(copy)[1].parent = 2; }));
+	CHECK(!opensWith([&](auto& copy) { nodes(copy)[1].primitiveCount = 3; }));
+	CHECK(!opensWith([&](auto& copy) { primitives(copy)[0].material = 1; }));
+	CHECK(!opensWith([&](auto& copy) { primitives(copy)[0].indexSize = 3; }));
+	CHECK(!opensWith([&](auto& copy) { primitives(copy)[0].indexCount = 5; }));
+	CHECK(!opensWith([&](auto& copy) { primitives(copy)[0].vertexCount = 7; }));
+	CHECK(!opensWith([&](auto& copy) { primitives(copy)[1].meshletCount = 1; }));
+	CHECK(!opensWith([&](auto& copy) { meshlets(copy)[1].indexCount = 4; }));
+	CHECK(!opensWith([&](auto& copy) { meshlets(copy)[1].firstIndex = 0xFFFFFFFF; }));
+	CHECK(!opensWith([&](auto& copy) { sources(copy)[1].path.offset += 1; }));
+	CHECK(!opensWith([&](auto& copy) { sources(copy)[1].path.size = copy.size(); }));
+	CHECK(!opensWith([&](auto& copy) { headerOf(copy)->sources.size += 1; }));
+
+	CHECK(opensWith([&](auto& copy) { nodes(copy)[1].parent = -1; }));
+	CHECK(opensWith([&](auto& copy) { materials(copy)[0].sampler = -1; }));
+	CHECK(opensWith([&](auto& copy)
+	{
+		primitives(copy)[1].meshletCount = 0;
+		primitives(copy)[1].meshlets.size = 0;
+	}));
+
+	// Random flips in the header and the records either open or throw, they never read out of range.
+	std::mt19937 random(11);
+	const size_t recordsEnd = header.sources.offset + header.sources.size;
+	for (int trial = 0; trial < 20000; ++trial)
+	{
+		std::vector<uint8_t> copy = bytes;
+		for (int flip = 0; flip < 3; ++flip)
+			copy[random() % recordsEnd] ^= static_cast<uint8_t>(1 << (random() % 8));
+		Opens(copy);
+	}
+}
+
+static void WriteFile(const std::filesystem::path& path, size_t size)
+{
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream(path, std::ios::binary) << std::string(size, 'x');
+}
+
+// Cooked from the files as they are now, the way the loader stamps the glTF, its buffers and images.
+static std::vector<uint8_t> CookSources(const std::filesystem::path& directory, std::initializer_list<const char8_t*> paths)
+{
+	ScenePackage::Writer writer(0, 0);
+	const float bounds[3] = {};
+	writer.SetHeader(0, bounds, bounds);
+	for (const char8_t* path : paths)
+	{
+		uint64_t size = 0;
+		uint64_t time = 0;
+		CHECK(ScenePackage::GetStamp(directory / path, size, time));
+		writer.AddSource(std::string_view(reinterpret_cast<const char*>(path)), size, time);
+	}
+	writer.Write(directory / "scene.ampk");
+	return ReadFile(directory / "scene.ampk");
+}
+
+static bool IsCurrent(const std::vector<uint8_t>& bytes, const std::filesystem::path& directory)
+{
+	AlignedBytes aligned(bytes);
+	return ScenePackage(aligned.Span()).IsCurrent(directory);
+}
+
+// A package goes stale when the glTF or any buffer or image it refers to changes, and is current again
+// once cooked from the changed files.
+static void TestSources(const std::filesystem::path& directory)
+{
+	const auto sources = { u8"A.gltf", u8"buffers/A.bin", u8"textures/b\u00e4se.png" };
+	WriteFile(directory / u8"A.gltf", 100);
+	WriteFile(directory / u8"buffers/A.bin", 5000);
+	WriteFile(directory / u8"textures/b\u00e4se.png", 300);
+	std::vector<uint8_t> bytes = CookSources(directory, sources);
+	CHECK(IsCurrent(bytes, directory));
+	CHECK(!IsCurrent(bytes, directory / "elsewhere"));
+
+	// The buffer rewritten with the same size, only its write time tells.
+	const auto buffer = directory / u8"buffers/A.bin";
+	const auto time = std::filesystem::last_write_time(buffer);
+	WriteFile(buffer, 5000);
+	std::filesystem::last_write_time(buffer, time + std::chrono::seconds(2));
+	CHECK(!IsCurrent(bytes, directory));
+	bytes = CookSources(directory, sources);
+	CHECK(IsCurrent(bytes, directory));
+
+	// An image grows and keeps its write time.
+	const auto image = directory / u8"textures/b\u00e4se.png";
+	const auto imageTime = std::filesystem::last_write_time(image);
+	WriteFile(image, 301);
+	std::filesystem::last_write_time(image, imageTime);
+	CHECK(!IsCurrent(bytes, directory));
+	bytes = CookSources(directory, sources);
+	CHECK(IsCurrent(bytes, directory));
+
+	// The glTF touched, a source removed.
+	std::filesystem::last_write_time(directory / u8"A.gltf", std::filesystem::last_write_time(directory / u8"A.gltf") - std::chrono::seconds(5));
+	CHECK(!IsCurrent(bytes, directory));
+	bytes = CookSources(directory, sources);
+	std::filesystem::remove(buffer);
+	CHECK(!IsCurrent(bytes, directory));
+
+	uint64_t size = 0;
+	uint64_t stamp = 0;
+	CHECK(!ScenePackage::GetStamp(buffer, size, stamp));
+}
+
+int main()
+{
+	const auto directory = std::filesystem::temp_directory_path() / "ScenePackageTest";
+	std::filesystem::create_directories(directory);
+
+	const Scene scene = CreateScene();
+	WriteScene(scene, directory / "scene.ampk");
+	const std::vector<uint8_t> bytes = ReadFile(directory / "scene.ampk");
+
+	TestRoundTrip(scene, bytes);
+	TestWrite(scene, directory, bytes);
+	TestValidation(bytes);
+	TestSources(directory / "Sources");
+
+	std::filesystem::remove_all(directory);
+	return Test::Result();
+}
@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/SlotList.h"
+#include <random>
+
+using namespace Amadeus;
+
+// Slots filled in any order give the items in slot order, whatever is still empty takes no place.
+static void TestOrder()
+{
+	std::mt19937 random(5);
+	for (uint64_t count : { 1, 2, 10, 1000 })
+	{
+		SlotList<uint64_t> list;
+		CHECK(list.Reserve(3) == 0);
+		const uint64_t first = list.Reserve(count);
+		CHECK(first == 3 && list.GetSlotCount() == count + 3);
+
+		std::vector<uint64_t> slots(count);
+		std::iota(slots.begin(), slots.end(), first);
+		std::shuffle(slots.begin(), slots.end(), random);
+		for (uint64_t slot : slots)
+		{
+			const size_t position = list.Set(slot, slot * 10);
+			CHECK(list.GetItems()[position] == slot * 10);
+		}
+
+		bool bOrdered = list.Size() == count;
+		for (size_t i = 0; i < list.Size() && bOrdered; ++i)
+			bOrdered = list.GetSlot(i) == first + i && list.GetItems()[i] == (first + i) * 10;
+		CHECK(bOrdered);
+
+		// The first three slots go in front of everything set before.
+		list.Set(1, 7);
+		CHECK(list.GetItems().front() == 7 && list.GetSlot(0) == 1);
+		CHECK(list.Size() == count + 1);
+	}
+}
+
+// Added items take a slot after every reserved one.
+static void TestAdd()
+{
+	SlotList<int> list;
+	CHECK(list.Add(1) == 0);
+	const uint64_t first = list.Reserve(2);
+	CHECK(list.Add(4) == 3);
+	list.Set(first + 1, 3);
+	CHECK(list.GetItems() == std::vector<int>({ 1, 3, 4 }));
+	CHECK(list.GetSlot(1) == 2);
+
+	list.Clear();
+	CHECK(list.Size() == 0 && list.GetSlotCount() == 0);
+	CHECK(list.Add(5) == 0);
+}
+
+// A slot past the reserved ones or one filled before throws and leaves the list as it was.
+static void TestInvalid()
+{
+	SlotList<int> list;
+	list.Reserve(2);
+	list.Set(1, 1);
+	for (uint64_t slot : { 1, 2, 100 })
+	{
+		bool bThrown = false;
+		try
+		{
+			list.Set(slot, 9);
+		}
+		catch (const std::runtime_error&)
+		{
+			bThrown = true;
+		}
+		CHECK(bThrown);
+	}
+	CHECK(list.GetItems() == std::vector<int>({ 1 }));
+}
+
+int main()
+{
+	TestOrder();
+	TestAdd();
+	TestInvalid();
+	return Test::Result();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+// Checks keep going after a failure so that one run reports every broken expectation, main returns
+// Test::Result().
+namespace Test
+{
+	inline int failures = 0;
+
+	inline int Result()
+	{
+		std::printf(failures ? "FAILED %d\n" : "ALL PASSED\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	// Seconds since start.
+	inline double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+			++Test::failures; \
+		} \
+	} while (0)
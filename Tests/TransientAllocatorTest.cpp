@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/TransientAllocator.h"
+#include <random>
+
+using namespace Amadeus;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Every offset is aligned, inside the heap, and no two resources alive on the same level share
+// a byte.
+static bool IsValid(const std::vector<TransientAllocator::Request>& requests, const TransientAllocator::Result& result)
+{
+	if (result.offsets.size() != requests.size())
+		return false;
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		if (result.offsets[i] % requests[i].alignment != 0 || result.offsets[i] + requests[i].size > result.heapSize)
+			return false;
+		if (result.heapAlignment % requests[i].alignment != 0)
+			return false;
+		for (size_t j = i + 1; j < requests.size(); ++j)
+		{
+			const bool bAlive = requests[i].first <= requests[j].last && requests[j].first <= requests[i].last;
+			const bool bShared = result.offsets[i] < result.offsets[j] + requests[j].size
+				&& result.offsets[j] < result.offsets[i] + requests[i].size;
+			if (bAlive && bShared)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void TestEmpty()
+{
+	const auto result = TransientAllocator::Pack({});
+	CHECK(result.offsets.empty());
+	CHECK(result.heapSize == 0);
+	CHECK(TransientAllocator::GetUnaliasedSize({}) == 0);
+}
+
+// Resources that are never alive at the same time start at the same offset.
+static void TestDisjoint()
+{
+	const std::vector<TransientAllocator::Request> requests = {
+		{ 4096, 256, 0, 1 }, { 8192, 256, 2, 3 }, { 1024, 256, 4, 4 } };
+	const auto result = TransientAllocator::Pack(requests);
+	CHECK(IsValid(requests, result));
+	CHECK(result.offsets == std::vector<uint64_t>({ 0, 0, 0 }));
+	CHECK(result.heapSize == 8192);
+	CHECK(TransientAllocator::GetUnaliasedSize(requests) == 4096 + 8192 + 1024);
+}
+
+// Lifetimes are inclusive, sharing one level is enough to keep two resources apart.
+static void TestOverlapping()
+{
+	const std::vector<TransientAllocator::Request> requests = {
+		{ 4096, 256, 0, 2 }, { 8192, 256, 2, 3 }, { 1024, 256, 1, 1 } };
+	const auto result = TransientAllocator::Pack(requests);
+	CHECK(IsValid(requests, result));
+	CHECK(result.heapSize == 4096 + 8192);
+	// The small resource is never alive with the second one and takes its memory.
+	CHECK(result.offsets[2] == result.offsets[1]);
+
+	// A resource alive from start to end keeps its memory to itself.
+	const std::vector<TransientAllocator::Request> nested = {
+		{ 1000, 1, 0, 9 }, { 500, 1, 0, 4 }, { 500, 1, 5, 9 } };
+	const auto packed = TransientAllocator::Pack(nested);
+	CHECK(IsValid(nested, packed));
+	CHECK(packed.heapSize == 1500);
+	CHECK(packed.offsets[1] == packed.offsets[2]);
+}
+
+// Gaps are aligned for the resource placed in them, the heap takes the largest alignment.
+static void TestAlignment()
+{
+	const std::vector<TransientAllocator::Request> requests = {
+		{ 100000, 1, 0, 0 }, { 300, 65536, 0, 0 }, { 10, 16, 0, 0 } };
+	const auto result = TransientAllocator::Pack(requests);
+	CHECK(IsValid(requests, result));
+	CHECK(result.heapAlignment == 65536);
+	CHECK(result.offsets[0] == 0);
+	CHECK(result.offsets[1] == 131072);
+	CHECK(result.offsets[2] == 100000);
+	CHECK(TransientAllocator::GetUnaliasedSize(requests) == AlignUp(AlignUp(100000, 65536) + 300, 16) + 10);
+}
+
+// Render targets of the default frame graph at 64 KiB granularity, by level: ShadowMap, the
+// three ZPrePass targets, SSAO and its blur, the four GBuffer targets, Skybox and the
+// transparent target. Reports the heap with and without aliasing.
+static void TestDefaultPipeline()
+{
+	for (const auto& [width, height] : { std::pair<uint64_t, uint64_t>{ 1920, 1080 }, { 3840, 2160 } })
+	{
+		auto target = [&](uint64_t bytesPerPixel) { return AlignUp(width * height * bytesPerPixel, 65536); };
+		const std::vector<TransientAllocator::Request> requests = {
+			{ AlignUp(2048ull * 2048 * 4, 65536), 65536, 0, 4 },
+			{ target(16), 65536, 1, 2 }, { target(4), 65536, 1, 2 }, { target(4), 65536, 1, 6 },
+			{ target(4), 65536, 2, 3 }, { target(4), 65536, 3, 4 },
+			{ target(4), 65536, 4, 6 }, { target(4), 65536, 4, 7 }, { target(4), 65536, 4, 6 }, { target(4), 65536, 4, 6 },
+			{ target(4), 65536, 5, 7 }, { target(4), 65536, 6, 7 },
+		};
+		const auto result = TransientAllocator::Pack(requests);
+		const uint64_t unaliased = TransientAllocator::GetUnaliasedSize(requests);
+		CHECK(IsValid(requests, result));
+		CHECK(result.heapSize < unaliased);
+
+		// No packing can beat the most memory alive on one level.
+		uint64_t peak = 0;
+		for (uint32_t level = 0; level < 8; ++level)
+		{
+			uint64_t alive = 0;
+			for (const auto& request : requests)
+			{
+				if (request.first <= level && level <= request.last)
+					alive += request.size;
+			}
+			peak = (std::max)(peak, alive);
+		}
+		CHECK(result.heapSize >= peak);
+
+		std::printf("%llux%llu: %.1f MiB aliased, %.1f MiB unaliased, %.1f MiB peak alive\n",
+			static_cast<unsigned long long>(width), static_cast<unsigned long long>(height),
+			result.heapSize / 1048576.0, unaliased / 1048576.0, peak / 1048576.0);
+	}
+}
+
+static void TestRandom()
+{
+	std::mt19937 random(1);
+	for (int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::vector<TransientAllocator::Request> requests(random() % 30 + 1);
+		for (auto& request : requests)
+		{
+			request.first = random() % 20;
+			request.last = request.first + random() % 6;
+			request.alignment = 1ull << (random() % 4 * 4);
+			request.size = random() % 5000 + 1;
+		}
+		const auto result = TransientAllocator::Pack(requests);
+		CHECK(IsValid(requests, result));
+		CHECK(result.heapSize <= TransientAllocator::GetUnaliasedSize(requests));
+	}
+}
+
+int main()
+{
+	TestEmpty();
+	TestDisjoint();
+	TestOverlapping();
+	TestAlignment();
+	TestDefaultPipeline();
+	TestRandom();
+	return Test::Result();
+}
@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/UploadRing.h"
+#include <random>
+
+using namespace Amadeus;
+
+static void TestAllocate()
+{
+	UploadRing ring;
+	ring.Reset(1024);
+	CHECK(ring.GetCapacity() == 1024);
+	CHECK(ring.Allocate(0, 16) == UploadRing::InvalidOffset);
+	CHECK(ring.Allocate(2048, 16) == UploadRing::InvalidOffset);
+
+	CHECK(ring.Allocate(10, 256) == 0);
+	CHECK(ring.Allocate(10, 256) == 256);
+	CHECK(ring.GetUsed() == 266);
+	CHECK(ring.Allocate(100, 1) == 266);
+	CHECK(ring.GetOldestFenceValue() == 0);
+
+	// Nothing in flight, the next range starts over at the beginning of the buffer.
+	ring.Submit(1);
+	CHECK(ring.GetOldestFenceValue() == 1);
+	ring.Retire(1);
+	CHECK(ring.GetUsed() == 0);
+	CHECK(ring.GetOldestFenceValue() == 0);
+	CHECK(ring.Allocate(1024, 16) == 0);
+}
+
+// The wrap skips the rest of the buffer, and nothing is handed out over a batch in flight.
+static void TestWraparound()
+{
+	UploadRing ring;
+	ring.Reset(1024);
+
+	CHECK(ring.Allocate(600, 16) == 0);
+	ring.Submit(1);
+	CHECK(ring.Allocate(600, 16) == UploadRing::InvalidOffset);
+	CHECK(ring.Allocate(400, 16) == 608);
+	CHECK(ring.GetUsed() == 1008);
+	ring.Submit(2);
+
+	// Before the first batch completes, a range at the start would overwrite it.
+	CHECK(ring.Allocate(32, 16) == UploadRing::InvalidOffset);
+	ring.Retire(1);
+	CHECK(ring.GetUsed() == 408);
+	CHECK(ring.GetOldestFenceValue() == 2);
+
+	// 500 bytes do not fit behind 1008, the 16 bytes up to the end are skipped.
+	CHECK(ring.Allocate(500, 16) == 0);
+	CHECK(ring.GetUsed() == 924);
+	// The second batch still holds [608, 1008).
+	CHECK(ring.Allocate(200, 16) == UploadRing::InvalidOffset);
+	CHECK(ring.Allocate(100, 16) == UploadRing::InvalidOffset);
+	CHECK(ring.Allocate(80, 16) == 512);
+	CHECK(ring.GetUsed() == 1016);
+	ring.Submit(3);
+
+	// Submitting nothing new adds no batch.
+	ring.Submit(4);
+	ring.Retire(2);
+	CHECK(ring.GetOldestFenceValue() == 3);
+	ring.Retire(3);
+	CHECK(ring.GetUsed() == 0);
+	CHECK(ring.GetOldestFenceValue() == 0);
+	CHECK(ring.Allocate(1024, 16) == 0);
+}
+
+// Random allocations, submits and late retires. New ranges are aligned, inside the buffer and never
+// overlap a range whose batch has not been retired.
+static void TestRandom()
+{
+	struct Range
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint64_t fenceValue;
+	};
+
+	const uint64_t capacity = 1 << 20;
+	UploadRing ring;
+	ring.Reset(capacity);
+	std::mt19937_64 random(7);
+	std::deque<Range> submitted;
+	std::vector<Range> pending;
+	uint64_t fenceValue = 0;
+	size_t allocations = 0;
+	size_t refused = 0;
+	size_t wraps = 0;
+	uint64_t lastOffset = 0;
+	bool bValid = true;
+
+	for (int step = 0; step < 200000 && bValid; ++step)
+	{
+		const uint64_t operation = random() % 10;
+		if (operation < 7)
+		{
+			const uint64_t size = 1 + (random() % 4 == 0 ? random() % (capacity / 4) : random() % 4096);
+			const uint64_t alignment = uint64_t(1) << (random() % 10);
+			const uint64_t offset = ring.Allocate(size, alignment);
+			if (offset == UploadRing::InvalidOffset)
+			{
+				// Everything fits in an empty ring.
+				CHECK(!submitted.empty() || !pending.empty());
+				++refused;
+				continue;
+			}
+
+			++allocations;
+			wraps += offset < lastOffset;
+			lastOffset = offset;
+			bValid &= offset % alignment == 0 && offset + size <= capacity;
+			auto overlaps = [&](const Range& range) { return offset < range.offset + range.size && range.offset < offset + size; };
+			bValid &= std::none_of(submitted.begin(), submitted.end(), overlaps);
+			bValid &= std::none_of(pending.begin(), pending.end(), overlaps);
+			pending.push_back({ offset, size, 0 });
+		}
+		else if (operation < 9)
+		{
+			ring.Submit(++fenceValue);
+			for (auto& range : pending)
+			{
+				range.fenceValue = fenceValue;
+				submitted.push_back(range);
+			}
+			pending.clear();
+		}
+		else
+		{
+			// The gpu is up to three submits behind.
+			const uint64_t completed = fenceValue - (std::min)(fenceValue, random() % 4);
+			ring.Retire(completed);
+			while (!submitted.empty() && submitted.front().fenceValue <= completed)
+				submitted.pop_front();
+		}
+		bValid &= ring.GetUsed() <= capacity;
+	}
+	CHECK(bValid);
+	CHECK(refused > 0);
+	CHECK(wraps > 100);
+	std::printf("%zu allocations, %zu wraps, %zu refused while batches were in flight\n", allocations, wraps, refused);
+}
+
+int main()
+{
+	TestAllocate();
+	TestWraparound();
+	TestRandom();
+	return Test::Result();
+}
@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "Test.h"
+#include "Common/VertexDecoder.h"
+#include <random>
+
+using namespace Amadeus;
+
+// Random counts, strides, formats and missing streams. Buffers end right after the last element,
+// so a kernel reading past it shows up under a sanitizer. The SIMD kernels must match the scalar
+// reference bit for bit and leave the element after the last one alone.
+static void TestVerticesMatchScalar()
+{
+	std::mt19937 random(1);
+	for (int iteration = 0; iteration < 3000; ++iteration)
+	{
+		const size_t count = random() % 70;
+		std::vector<std::vector<uint8_t>> buffers;
+		buffers.reserve(4);
+		auto fill = [&](VertexDecoder::Stream& stream, size_t elementSize, VertexDecoder::Format format)
+		{
+			stream.format = format;
+			if (count == 0 || random() % 5 == 0)
+				return;
+			stream.stride = elementSize + (random() % 3) * 4;
+			auto& buffer = buffers.emplace_back((count - 1) * stream.stride + elementSize);
+			for (auto& byte : buffer)
+				byte = static_cast<uint8_t>(random());
+			if (format == VertexDecoder::Format::FLOAT)
+			{
+				for (size_t offset = 0; offset + sizeof(float) <= buffer.size(); offset += sizeof(float))
+				{
+					const float value = static_cast<float>(random() % 10000) / 7.0f;
+					memcpy(&buffer[offset], &value, sizeof(float));
+				}
+			}
+			stream.data = buffer.data();
+		};
+
+		const auto texCoordFormat = static_cast<VertexDecoder::Format>(random() % 3);
+		const size_t texCoordSize = texCoordFormat == VertexDecoder::Format::FLOAT ? 8 : texCoordFormat == VertexDecoder::Format::UNORM8 ? 2 : 4;
+		VertexDecoder::Streams streams;
+		fill(streams.position, 12, VertexDecoder::Format::FLOAT);
+		fill(streams.normal, 12, VertexDecoder::Format::FLOAT);
+		fill(streams.tangent, 16, VertexDecoder::Format::FLOAT);
+		fill(streams.texCoord0, texCoordSize, texCoordFormat);
+
+		std::vector<VertexDecoder::Vertex> simd(count + 1), scalar(count + 1);
+		memset(simd.data(), 0xCD, simd.size() * sizeof(VertexDecoder::Vertex));
+		memset(scalar.data(), 0xCD, scalar.size() * sizeof(VertexDecoder::Vertex));
+		VertexDecoder::DecodeVertices(streams, count, simd.data());
+		VertexDecoder::DecodeVerticesScalar(streams, count, scalar.data());
+		CHECK(memcmp(simd.data(), scalar.data(), simd.size() * sizeof(VertexDecoder::Vertex)) == 0);
+	}
+}
+
+static void TestIndicesMatchScalar()
+{
+	std::mt19937 random(2);
+	for (int iteration = 0; iteration < 3000; ++iteration)
+	{
+		for (size_t indexSize : { 1, 2, 4 })
+		{
+			const size_t count = random() % 100;
+			std::vector<uint8_t> data(count * indexSize);
+			for (auto& byte : data)
+				byte = static_cast<uint8_t>(random());
+			std::vector<uint32_t> simd(count + 1, 7), scalar(count + 1, 7);
+			VertexDecoder::DecodeIndices(data.data(), indexSize, count, simd.data());
+			VertexDecoder::DecodeIndicesScalar(data.data(), indexSize, count, scalar.data());
+			CHECK(simd == scalar);
+		}
+	}
+}
+
+// The scalar reference against the glTF definition: normalized values divide by the maximum,
+// missing streams are zero.
+static void TestReference()
+{
+	const uint16_t unorm16[6] = { 65535, 32768, 0, 65535, 1, 2 };
+	const uint8_t unorm8[6] = { 255, 128, 0, 255, 1, 2 };
+	for (VertexDecoder::Format format : { VertexDecoder::Format::UNORM16, VertexDecoder::Format::UNORM8 })
+	{
+		const bool bShort = format == VertexDecoder::Format::UNORM16;
+		const float maximum = bShort ? 65535.0f : 255.0f;
+		VertexDecoder::Streams streams;
+		streams.texCoord0.data = bShort ? reinterpret_cast<const uint8_t*>(unorm16) : unorm8;
+		streams.texCoord0.stride = bShort ? 4 : 2;
+		streams.texCoord0.format = format;
+
+		VertexDecoder::Vertex vertices[3];
+		for (auto decode : { &VertexDecoder::DecodeVertices, &VertexDecoder::DecodeVerticesScalar })
+		{
+			decode(streams, 3, vertices);
+			CHECK(vertices[0].texCoord0[0] == 1.0f);
+			CHECK(vertices[0].texCoord0[1] == (bShort ? 32768.0f : 128.0f) / maximum);
+			CHECK(vertices[1].texCoord0[0] == 0.0f && vertices[1].texCoord0[1] == 1.0f);
+			CHECK(vertices[2].texCoord0[1] == 2.0f / maximum);
+			for (const auto& vertex : vertices)
+			{
+				CHECK(vertex.position[0] == 0.0f && vertex.normal[2] == 0.0f && vertex.tangent[3] == 0.0f);
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestVerticesMatchScalar();
+	TestIndicesMatchScalar();
+	TestReference();
+	return Test::Result();
+}
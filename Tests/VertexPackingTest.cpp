@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "Test.h"
+#include "Models.h"
+#include "Common/VertexPacking.h"
+#include <array>
+#include <random>
+
+using namespace Amadeus;
+
+static double AngleDegrees(const float a[3], const float b[3])
+{
+	const double dot = static_cast<double>(a[0]) * b[0] + static_cast<double>(a[1]) * b[1] + static_cast<double>(a[2]) * b[2];
+	const double lengths = std::sqrt((static_cast<double>(a[0]) * a[0] + static_cast<double>(a[1]) * a[1] + static_cast<double>(a[2]) * a[2])
+		* (static_cast<double>(b[0]) * b[0] + static_cast<double>(b[1]) * b[1] + static_cast<double>(b[2]) * b[2]));
+	return std::acos((std::min)(1.0, dot / lengths)) * 180.0 / 3.14159265358979323846;
+}
+
+// Octahedral snorm16 stays within 0.01 degrees everywhere, axes come back exactly and a zero
+// vector decodes as +Z.
+static void TestOctahedral()
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	double worst = 0.0;
+	auto roundTrip = [&](const float direction[3])
+	{
+		int16_t encoded[2];
+		float decoded[3];
+		VertexPacking::EncodeOctahedral(direction, encoded);
+		VertexPacking::DecodeOctahedral(encoded, decoded);
+		worst = (std::max)(worst, AngleDegrees(direction, decoded));
+		return std::array<float, 3>{ decoded[0], decoded[1], decoded[2] };
+	};
+
+	for (int i = 0; i < 1000000; ++i)
+	{
+		const float direction[3] = { uniform(random), uniform(random), uniform(random) };
+		if (direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2] > 1e-6f)
+			roundTrip(direction);
+	}
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (float sign : { -1.0f, 1.0f })
+		{
+			float direction[3] = {};
+			direction[axis] = sign;
+			const auto decoded = roundTrip(direction);
+			CHECK(decoded[axis] == sign);
+		}
+	}
+	std::printf("octahedral snorm16: %.5f degrees worst\n", worst);
+	CHECK(worst < 0.01);
+
+	const float zero[3] = {};
+	int16_t encoded[2];
+	float decoded[3];
+	VertexPacking::EncodeOctahedral(zero, encoded);
+	VertexPacking::DecodeOctahedral(encoded, decoded);
+	CHECK(decoded[0] == 0.0f && decoded[1] == 0.0f && decoded[2] == 1.0f);
+}
+
+// Unorm16 positions and texture coordinates are within half a step of the primitive's extent,
+// plus float rounding of the offset. Handedness survives exactly.
+static void TestUnorm16()
+{
+	std::mt19937 random(4);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	for (int iteration = 0; iteration < 200; ++iteration)
+	{
+		const size_t count = 1 + random() % 5000;
+		const float extent = std::pow(10.0f, uniform(random) * 3.0f);
+		const float offset = uniform(random) * 1000.0f;
+		const float texCoordExtent = static_cast<float>(1 + random() % 8);
+
+		std::vector<VertexDecoder::Vertex> vertices(count), unpacked(count);
+		for (auto& vertex : vertices)
+		{
+			float direction[3] = { uniform(random), uniform(random), uniform(random) };
+			const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+			for (int i = 0; i < 3; ++i)
+			{
+				vertex.position[i] = offset + uniform(random) * extent;
+				vertex.normal[i] = direction[i] / length;
+				vertex.tangent[i] = direction[(i + 1) % 3] / length;
+			}
+			vertex.tangent[3] = random() & 1 ? 1.0f : -1.0f;
+			vertex.texCoord0[0] = uniform(random) * texCoordExtent;
+			vertex.texCoord0[1] = uniform(random) * texCoordExtent;
+		}
+
+		std::vector<VertexPacking::PackedVertex> packed(count);
+		const auto quantization = VertexPacking::ComputeQuantization(vertices.data(), count);
+		VertexPacking::Pack(vertices.data(), count, quantization, packed.data());
+		VertexPacking::Unpack(packed.data(), count, quantization, unpacked.data());
+
+		bool bWithinBounds = true;
+		for (size_t i = 0; i < count; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				const float bound = quantization.positionScale[j] / 65535.0f * 0.5f
+					+ (std::fabs(quantization.positionOffset[j]) + quantization.positionScale[j]) * 3e-7f;
+				bWithinBounds &= std::fabs(unpacked[i].position[j] - vertices[i].position[j]) <= bound;
+			}
+			for (int j = 0; j < 2; ++j)
+			{
+				const float bound = quantization.texCoordScale[j] / 65535.0f * 0.5f + 1e-6f * texCoordExtent;
+				bWithinBounds &= std::fabs(unpacked[i].texCoord0[j] - vertices[i].texCoord0[j]) <= bound;
+			}
+			bWithinBounds &= unpacked[i].tangent[3] == vertices[i].tangent[3];
+		}
+		CHECK(bWithinBounds);
+	}
+
+	// A single vertex has no extent, it comes back exactly.
+	VertexDecoder::Vertex vertex = {};
+	vertex.position[0] = 5.0f;
+	VertexPacking::PackedVertex packed;
+	const auto quantization = VertexPacking::ComputeQuantization(&vertex, 1);
+	VertexPacking::Pack(&vertex, 1, quantization, &packed);
+	VertexDecoder::Vertex unpacked;
+	VertexPacking::Unpack(&packed, 1, quantization, &unpacked);
+	CHECK(unpacked.position[0] == 5.0f && unpacked.position[1] == 0.0f);
+}
+
+static void TestIndices()
+{
+	const uint32_t indices[3] = { 0, 65535, 7 };
+	uint16_t packed[3];
+	VertexPacking::PackIndices(indices, 3, packed);
+	CHECK(packed[0] == 0 && packed[1] == 65535 && packed[2] == 7);
+	CHECK(VertexPacking::FitsUInt16Indices(65536));
+	CHECK(!VertexPacking::FitsUInt16Indices(65537));
+}
+
+// Vertex and index memory of the bundled models before and after packing, with the worst error
+// packing adds to them.
+static void ReportModels()
+{
+	for (const char* name : { "DamagedHelmet", "Sponza" })
+	{
+		const auto meshes = Test::LoadModel(name);
+		if (meshes.empty())
+		{
+			std::printf("%-14s not available\n", name);
+			continue;
+		}
+
+		size_t before = 0, after = 0;
+		double positionError = 0.0, normalError = 0.0;
+		for (const auto& mesh : meshes)
+		{
+			const size_t count = mesh.vertices.size();
+			std::vector<VertexPacking::PackedVertex> packed(count);
+			std::vector<VertexDecoder::Vertex> unpacked(count);
+			const auto quantization = VertexPacking::ComputeQuantization(mesh.vertices.data(), count);
+			VertexPacking::Pack(mesh.vertices.data(), count, quantization, packed.data());
+			VertexPacking::Unpack(packed.data(), count, quantization, unpacked.data());
+			for (size_t i = 0; i < count; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+					positionError = (std::max)(positionError, static_cast<double>(std::fabs(unpacked[i].position[j] - mesh.vertices[i].position[j])));
+				if (mesh.vertices[i].normal[0] != 0.0f || mesh.vertices[i].normal[1] != 0.0f || mesh.vertices[i].normal[2] != 0.0f)
+					normalError = (std::max)(normalError, AngleDegrees(mesh.vertices[i].normal, unpacked[i].normal));
+			}
+
+			before += count * sizeof(VertexDecoder::Vertex) + mesh.indices.size() * sizeof(uint32_t);
+			after += count * sizeof(VertexPacking::PackedVertex)
+				+ mesh.indices.size() * (VertexPacking::FitsUInt16Indices(count) ? sizeof(uint16_t) : sizeof(uint32_t));
+		}
+		CHECK(after < before);
+		CHECK(normalError < 0.01);
+		std::printf("%-14s %zu primitives, %.2f MB -> %.2f MB (-%.0f%%), position error %.2e, normal error %.4f degrees\n",
+			name, meshes.size(), before / 1e6, after / 1e6, 100.0 * (1.0 - static_cast<double>(after) / before), positionError, normalError);
+	}
+}
+
+int main()
+{
+	TestOctahedral();
+	TestUnorm16();
+	TestIndices();
+	ReportModels();
+	return Test::Result();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// Stands in for Amadeus/pch.h, which pulls in the Windows and D3D12 headers. The platform-neutral
+// modules of Amadeus/Common only need the standard library and the Windows integer types from it.
+
+#include <cassert>
+#include <set>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+#include <future>
+#include <span>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <optional>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+// DirectXMath brings the SSE intrinsics along.
+#include <immintrin.h>
+
+typedef int INT;
+typedef unsigned int UINT;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+
+#include "Common/ThreadPool.h"
+#include "Common/JobSystem.h"